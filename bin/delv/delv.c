@@ -1951,8 +1951,7 @@ recvresponse(void *arg) {
 		fatal("request event result: %s", isc_result_totext(result));
 	}
 
-	dns_message_create(isc_g_mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &response);
+	dns_message_create(isc_g_mctx, DNS_MESSAGE_INTENTPARSE, &response);
 
 	result = dns_request_getresponse(request, response,
 					 DNS_MESSAGEPARSE_PRESERVEORDER);
@@ -2058,8 +2057,7 @@ sendquery(void *arg) {
 	/* Construct query message */
 	CHECK(convert_name(&qfn, &query_name, qname));
 
-	dns_message_create(isc_g_mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &message);
+	dns_message_create(isc_g_mctx, DNS_MESSAGE_INTENTRENDER, &message);
 	message->opcode = dns_opcode_query;
 	message->flags = DNS_MESSAGEFLAG_RD | DNS_MESSAGEFLAG_AD;
 	if (cdflag) {
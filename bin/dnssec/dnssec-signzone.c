@@ -785,17 +785,32 @@ signset(dns_diff_t *del, dns_diff_t *add, dns_dbnode_t *node, dns_name_t *name,
 	isc_mem_cput(isc_g_mctx, nowsignedby, arraysize, sizeof(bool));
 }
 
+/*
+ * Names are hashed in batches, so that several NSEC3 hash chains are
+ * computed at once.
+ */
+#define HASHLIST_BATCH (4 * ISC_ITERATED_HASH_LANES)
+
 struct hashlist {
 	unsigned char *hashbuf;
 	size_t entries;
 	size_t size;
 	size_t length;
+
+	unsigned int hashalg;
+	unsigned int iterations;
+	const unsigned char *salt;
+	size_t salt_len;
+	unsigned int pending;
+	dns_fixedname_t names[HASHLIST_BATCH];
+	bool speculative[HASHLIST_BATCH];
 };
 
 static void
 hashlist_init(hashlist_t *l, unsigned int nodes, unsigned int length) {
 	l->entries = 0;
 	l->length = length + 1;
+	l->pending = 0;
 
 	if (nodes != 0) {
 		l->size = nodes;
@@ -836,27 +851,71 @@ hashlist_add(hashlist_t *l, const unsigned char *hash, size_t len) {
 	l->entries++;
 }
 
+/*
+ * Hash the pending names and add them to the list.
+ */
+static void
+hashlist_flush(hashlist_t *l) {
+	char nametext[DNS_NAME_FORMATSIZE];
+	unsigned char hashes[HASHLIST_BATCH][NSEC3_MAX_HASH_LENGTH + 1];
+	unsigned char *out[HASHLIST_BATCH];
+	const unsigned char *in[HASHLIST_BATCH];
+	int inlength[HASHLIST_BATCH];
+	unsigned int len;
+	size_t i, j;
+
+	if (l->pending == 0) {
+		return;
+	}
+
+	for (i = 0; i < l->pending; i++) {
+		dns_name_t *name = dns_fixedname_name(&l->names[i]);
+
+		out[i] = hashes[i];
+		in[i] = name->ndata;
+		inlength[i] = name->length;
+	}
+
+	len = isc_iterated_hash_batch(out, l->hashalg, l->iterations, l->salt,
+				      (int)l->salt_len, in, inlength,
+				      l->pending);
+	if (len == 0) {
+		fatal("failed to compute NSEC3 hashes");
+	}
+
+	for (i = 0; i < l->pending; i++) {
+		unsigned char *hash = hashes[i];
+
+		if (verbose) {
+			dns_name_format(dns_fixedname_name(&l->names[i]),
+					nametext, sizeof nametext);
+			for (j = 0; j < len; j++) {
+				fprintf(stderr, "%02x", hash[j]);
+			}
+			fprintf(stderr, " %s\n", nametext);
+		}
+		hash[len] = l->speculative[i] ? 1 : 0;
+		hashlist_add(l, hash, len + 1);
+	}
+
+	l->pending = 0;
+}
+
 static void
 hashlist_add_dns_name(hashlist_t *l,
 		      /*const*/ dns_name_t *name, unsigned int hashalg,
 		      unsigned int iterations, const unsigned char *salt,
 		      size_t salt_len, bool speculative) {
-	char nametext[DNS_NAME_FORMATSIZE];
-	unsigned char hash[NSEC3_MAX_HASH_LENGTH + 1];
-	unsigned int len;
-	size_t i;
+	l->hashalg = hashalg;
+	l->iterations = iterations;
+	l->salt = salt;
+	l->salt_len = salt_len;
 
-	len = isc_iterated_hash(hash, hashalg, iterations, salt, (int)salt_len,
-				name->ndata, name->length);
-	if (verbose) {
-		dns_name_format(name, nametext, sizeof nametext);
-		for (i = 0; i < len; i++) {
-			fprintf(stderr, "%02x", hash[i]);
-		}
-		fprintf(stderr, " %s\n", nametext);
+	dns_name_copy(name, dns_fixedname_initname(&l->names[l->pending]));
+	l->speculative[l->pending] = speculative;
+	if (++l->pending == HASHLIST_BATCH) {
+		hashlist_flush(l);
 	}
-	hash[len++] = speculative ? 1 : 0;
-	hashlist_add(l, hash, len);
 }
 
 static int
@@ -866,6 +925,8 @@ hashlist_comp(const void *a, const void *b) {
 
 static void
 hashlist_sort(hashlist_t *l) {
+	hashlist_flush(l);
+
 	INSIST(l->hashbuf != NULL || l->length == 0);
 	if (l->length > 0) {
 		qsort(l->hashbuf, l->entries, l->length, hashlist_comp);
@@ -15,7 +15,7 @@
   <xsl:output method="html" indent="yes" version="4.0"/>
   <!-- the version number **below** must match version in bin/named/statschannel.c -->
   <!-- don't forget to update "/xml/v<STATS_XML_VERSION_MAJOR>" in the HTTP endpoints listed below -->
-  <xsl:template match="statistics[@version=&quot;3.14&quot;]">
+  <xsl:template match="statistics[@version=&quot;3.15&quot;]">
     <html>
       <head>
         <script type="text/javascript" src="https://ajax.googleapis.com/ajax/libs/jquery/3.4.1/jquery.min.js"></script>
@@ -932,6 +932,10 @@
                   <th>Records Received</th>
                   <th>Bytes Received</th>
                   <th>Transfer Rate (B/s)</th>
+                  <th>Records Applied</th>
+                  <th>Parse Rate (RR/s)</th>
+                  <th>Apply Rate (RR/s)</th>
+                  <th>Queued Batches</th>
                 </tr>
               </thead>
               <tbody>
@@ -961,6 +965,10 @@
                     <td><xsl:value-of select="nrecs"/></td>
                     <td><xsl:value-of select="nbytes"/></td>
                     <td><xsl:value-of select="rate"/></td>
+                    <td><xsl:value-of select="napplied"/></td>
+                    <td><xsl:value-of select="parserate"/></td>
+                    <td><xsl:value-of select="applyrate"/></td>
+                    <td><xsl:value-of select="queued"/></td>
                   </tr>
                 </xsl:for-each>
               </tbody>
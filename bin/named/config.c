@@ -50,6 +50,7 @@
 /*% default configuration */
 static char defaultconf[] = "\
 options {\n\
+	adb-snapshot-interval 0;\n\
 	answer-cookie true;\n\
 	automatic-interface-scan yes;\n\
 #	blackhole {none;};\n\
@@ -104,6 +105,7 @@ options {\n\
 	request-nsid false;\n\
 	request-zoneversion false;\n\
 	resolver-query-timeout 10;\n\
+	response-cache-entries 0;\n\
 #	responselog <boolean>;\n\
 	rrset-order { order random; };\n\
 	secroots-file \"named.secroots\";\n\
@@ -135,7 +137,9 @@ options {\n\
 	transfers-per-ns 2;\n\
 	trust-anchor-telemetry yes;\n\
 	udp-receive-buffer 0;\n\
+	udp-send-batch 32;\n\
 	udp-send-buffer 0;\n\
+	udp-socket-pool 0;\n\
 	update-quota 100;\n\
 \n\
 	/* view */\n\
@@ -250,6 +254,7 @@ options {\n\
 	serial-update-method increment;\n\
 	sig-signing-nodes 100;\n\
 	sig-signing-signatures 10;\n\
+	sig-signing-threads 1;\n\
 	sig-signing-type 65534;\n\
 	transfer-source *;\n\
 	transfer-source-v6 *;\n\
@@ -269,6 +269,8 @@ named_control_docommand(isccc_sexpr_t *message, bool readonly,
 	} else if (command_compare(command, NAMED_COMMAND_RETRANSFER)) {
 		result = named_server_retransfercommand(named_g_server, lex,
 							text);
+	} else if (command_compare(command, NAMED_COMMAND_SAVECACHE)) {
+		result = named_server_savecache(named_g_server, text);
 	} else if (command_compare(command, NAMED_COMMAND_SCAN)) {
 		named_server_scan_interfaces(named_g_server);
 		result = ISC_R_SUCCESS;
@@ -58,6 +58,7 @@
 #define NAMED_COMMAND_RESETSTATS   "reset-stats"
 #define NAMED_COMMAND_RESPONSELOG  "responselog"
 #define NAMED_COMMAND_RETRANSFER   "retransfer"
+#define NAMED_COMMAND_SAVECACHE	   "savecache"
 #define NAMED_COMMAND_SCAN	   "scan"
 #define NAMED_COMMAND_SECROOTS	   "secroots"
 #define NAMED_COMMAND_SERVESTALE   "serve-stale"
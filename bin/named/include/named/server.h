@@ -70,8 +70,10 @@ struct named_server {
 	isc_timer_t *heartbeat_timer;
 	isc_timer_t *pps_timer;
 	isc_timer_t *tat_timer;
+	isc_timer_t *adbsnapshot_timer;
 
 	uint32_t interface_interval;
+	uint32_t adbsnapshot_interval;
 
 	atomic_int reload_status;
 
@@ -216,6 +218,20 @@ named_server_saventa(named_server_t *server);
 isc_result_t
 named_server_loadnta(named_server_t *server);
 
+/*%
+ * Start saving snapshots of all caches that have a snapshot file
+ * configured; they are written in the background and the results are
+ * logged.  A summary is appended to 'text'.
+ */
+isc_result_t
+named_server_savecache(named_server_t *server, isc_buffer_t **text);
+
+/*%
+ * Restore the caches from their snapshot files.
+ */
+isc_result_t
+named_server_loadcache(named_server_t *server);
+
 /*%
  * Dump the current statistics to the statistics file.
  */
@@ -31,6 +31,7 @@
 #include <isc/async.h>
 #include <isc/attributes.h>
 #include <isc/base64.h>
+#include <isc/buffer.h>
 #include <isc/commandline.h>
 #include <isc/dir.h>
 #include <isc/file.h>
@@ -56,6 +57,7 @@
 #include <isc/time.h>
 #include <isc/timer.h>
 #include <isc/util.h>
+#include <isc/work.h>
 
 #include <dns/adb.h>
 #include <dns/badcache.h>
@@ -514,6 +516,9 @@ add_keydata_zone(dns_view_t *view, const char *directory, isc_mem_t *mctx);
 static void
 newzone_cfgctx_destroy(void **cfgp);
 
+static bool
+savecache(named_server_t *server, bool background);
+
 static isc_result_t
 putstr(isc_buffer_t **b, const char *str);
 
@@ -2937,7 +2942,7 @@ cleanup:
 		} else {                                                    \
 			rrl->rate.r = def;                                  \
 		}                                                           \
-		rrl->rate.scaled = rrl->rate.r;                             \
+		atomic_store_relaxed(&rrl->rate.scaled, rrl->rate.r);      \
 	} while (0)
 
 static isc_result_t
@@ -3011,7 +3016,6 @@ configure_rrl(dns_view_t *view, const cfg_obj_t *config, const cfg_obj_t *map) {
 		CHECK_RRL(i >= 1, "invalid 'qps-scale %d'%s", i, "");
 	}
 	rrl->qps_scale = i;
-	rrl->qps = 1.0;
 
 	i = 24;
 	obj = NULL;
@@ -4444,6 +4448,14 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	dns_cache_setservestalettl(cache, max_stale_ttl);
 	dns_cache_setservestalerefresh(cache, stale_refresh_time);
 
+	obj = NULL;
+	result = named_config_get(maps, "cache-snapshot-file", &obj);
+	if (result == ISC_R_SUCCESS) {
+		dns_cache_setsnapshotfile(cache, cfg_obj_asstring(obj));
+	} else if (!shared_cache) {
+		dns_cache_setsnapshotfile(cache, NULL);
+	}
+
 	dns_cache_detach(&cache);
 
 	obj = NULL;
@@ -5105,6 +5117,13 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 				       "except-from", isc_g_mctx,
 				       &view->answernames_exclude));
 
+	/*
+	 * Names for which the client subnet is sent to authoritative
+	 * servers and answers are cached per subnet.
+	 */
+	CHECK(configure_view_nametable(vconfig, config, "ecs-zones", NULL,
+				       isc_g_mctx, &view->ecszones));
+
 	/*
 	 * Configure default allow-update and allow-update-forwarding ACLs,
 	 * so they can be inherited by zones. (XXX: These are not
@@ -6195,6 +6214,7 @@ create_view(const cfg_obj_t *vconfig, dns_viewlist_t *viewlist,
 			&view);
 
 	isc_nonce_buf(view->secret, sizeof(view->secret));
+	dns_view_createlatencystats(view);
 
 	ISC_LIST_APPEND(*viewlist, view, link);
 	dns_view_attach(view, viewp);
@@ -7030,6 +7050,168 @@ pps_timer_tick(void *arg) {
 	oldrequests = requests;
 }
 
+/*
+ * The address database snapshots are copied on the main loop, and
+ * written to or read from the disk by a work thread.
+ */
+typedef struct adbsnapshot {
+	isc_mem_t *mctx;
+	dns_view_t *view;
+	isc_buffer_t *buffer;
+	uint64_t count;
+	isc_result_t result;
+} adbsnapshot_t;
+
+static adbsnapshot_t *
+adbsnapshot_new(named_server_t *server, dns_view_t *view) {
+	adbsnapshot_t *snap = isc_mem_get(server->mctx, sizeof(*snap));
+
+	*snap = (adbsnapshot_t){ .result = ISC_R_SUCCESS };
+	isc_mem_attach(server->mctx, &snap->mctx);
+	dns_view_attach(view, &snap->view);
+
+	return snap;
+}
+
+static void
+adbsnapshot_free(adbsnapshot_t *snap) {
+	if (snap->buffer != NULL) {
+		isc_buffer_free(&snap->buffer);
+	}
+	dns_view_detach(&snap->view);
+	isc_mem_putanddetach(&snap->mctx, snap, sizeof(*snap));
+}
+
+static void
+saveadb_work(void *arg) {
+	adbsnapshot_t *snap = arg;
+
+	snap->result = dns_view_saveadb(snap->view, snap->buffer);
+}
+
+static void
+saveadb_done(void *arg) {
+	adbsnapshot_t *snap = arg;
+
+	if (snap->result == ISC_R_SUCCESS) {
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_DEBUG(1),
+			      "view '%s': saved %" PRIu64
+			      " address database entries",
+			      snap->view->name, snap->count);
+	} else {
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_ERROR,
+			      "error writing address database "
+			      "snapshot for view '%s': %s",
+			      snap->view->name,
+			      isc_result_totext(snap->result));
+	}
+
+	adbsnapshot_free(snap);
+}
+
+/*
+ * Snapshot the address databases; the files are written in the
+ * background unless the server is shutting down.
+ */
+static void
+saveadb(named_server_t *server, bool background) {
+	ISC_LIST_FOREACH (server->viewlist, view, link) {
+		adbsnapshot_t *snap = NULL;
+		dns_adb_t *adb = NULL;
+
+		dns_view_getadb(view, &adb);
+		if (adb == NULL) {
+			continue;
+		}
+
+		snap = adbsnapshot_new(server, view);
+		dns_adb_snapshot(adb, &snap->buffer, &snap->count);
+		dns_adb_detach(&adb);
+
+		if (background) {
+			isc_work_enqueue(isc_loop_main(), saveadb_work,
+					 saveadb_done, snap);
+		} else {
+			saveadb_work(snap);
+			saveadb_done(snap);
+		}
+	}
+}
+
+static void
+loadadb_work(void *arg) {
+	adbsnapshot_t *snap = arg;
+
+	snap->result = dns_view_readadb(snap->view, &snap->buffer);
+}
+
+static void
+loadadb_done(void *arg) {
+	adbsnapshot_t *snap = arg;
+	dns_adb_t *adb = NULL;
+
+	if (snap->result == ISC_R_SUCCESS) {
+		dns_view_getadb(snap->view, &adb);
+		if (adb != NULL) {
+			snap->result = dns_adb_restore(adb, snap->buffer,
+						       &snap->count);
+			dns_adb_detach(&adb);
+		} else {
+			snap->result = ISC_R_SHUTTINGDOWN;
+		}
+	}
+
+	if (snap->result == ISC_R_SUCCESS) {
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_INFO,
+			      "view '%s': restored %" PRIu64
+			      " address database entries",
+			      snap->view->name, snap->count);
+	} else if (snap->result != ISC_R_FILENOTFOUND &&
+		   snap->result != ISC_R_SHUTTINGDOWN)
+	{
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_ERROR,
+			      "error loading address database "
+			      "snapshot for view '%s': %s",
+			      snap->view->name,
+			      isc_result_totext(snap->result));
+	}
+
+	adbsnapshot_free(snap);
+}
+
+/*
+ * Read the address database snapshots in the background, and restore
+ * them on the main loop.
+ */
+static void
+loadadb(named_server_t *server) {
+	ISC_LIST_FOREACH (server->viewlist, view, link) {
+		adbsnapshot_t *snap = NULL;
+		dns_adb_t *adb = NULL;
+
+		dns_view_getadb(view, &adb);
+		if (adb == NULL) {
+			continue;
+		}
+		dns_adb_detach(&adb);
+
+		snap = adbsnapshot_new(server, view);
+		isc_work_enqueue(isc_loop_main(), loadadb_work, loadadb_done,
+				 snap);
+	}
+}
+
+static void
+adbsnapshot_timer_tick(void *arg) {
+	named_server_t *server = (named_server_t *)arg;
+
+	saveadb(server, true);
+}
+
 /*
  * Replace the current value of '*field', a dynamically allocated
  * string or NULL, with a dynamically allocated copy of the
@@ -8187,6 +8369,21 @@ apply_configuration(cfg_parser_t *configparser, cfg_obj_t *config,
 
 #undef CAP_IF_NOT_ZERO
 
+	obj = NULL;
+	result = named_config_get(maps, "udp-send-batch", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	isc_nm_setudpsendbatch(cfg_obj_asuint32(obj));
+
+	obj = NULL;
+	result = named_config_get(maps, "udp-socket-pool", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_dispatchmgr_setudppool(named_g_dispatchmgr, cfg_obj_asuint32(obj));
+
+	obj = NULL;
+	result = named_config_get(maps, "response-cache-entries", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	server->sctx->respcache_size = cfg_obj_asuint32(obj);
+
 	/*
 	 * Configure sets of UDP query source ports.
 	 */
@@ -8454,6 +8651,21 @@ apply_configuration(cfg_parser_t *configparser, cfg_obj_t *config,
 	isc_interval_set(&interval, 1200, 0);
 	isc_timer_start(server->pps_timer, isc_timertype_ticker, &interval);
 
+	/*
+	 * Periodically checkpoint the address databases, if enabled.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "adb-snapshot-interval", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	server->adbsnapshot_interval = cfg_obj_asduration(obj);
+	if (server->adbsnapshot_interval == 0) {
+		isc_timer_stop(server->adbsnapshot_timer);
+	} else {
+		isc_interval_set(&interval, server->adbsnapshot_interval, 0);
+		isc_timer_start(server->adbsnapshot_timer, isc_timertype_ticker,
+				&interval);
+	}
+
 	isc_interval_set(&interval, named_g_tat_interval, 0);
 	isc_timer_start(server->tat_timer, isc_timertype_ticker, &interval);
 
@@ -9082,6 +9294,26 @@ apply_configuration(cfg_parser_t *configparser, cfg_obj_t *config,
 
 	(void)named_server_loadnta(server);
 
+	/*
+	 * Restore the cache snapshots while we are still exclusive.  The
+	 * caches only exist now, after the listeners have been opened by
+	 * the interface scan above, but the loops are paused, so that no
+	 * query is answered until they have been restored.  The snapshots
+	 * are loaded by threads of their own, not by the paused loops.
+	 */
+	if (first_time) {
+		INSIST(exclusive);
+		(void)named_server_loadcache(server);
+	}
+
+	/*
+	 * Likewise, restore what the address databases had learned about
+	 * the remote servers.
+	 */
+	if (first_time && server->adbsnapshot_interval != 0) {
+		loadadb(server);
+	}
+
 	/*
 	 * Record the time of most recent configuration
 	 */
@@ -9400,6 +9632,9 @@ run_server(void *arg) {
 	isc_timer_create(isc_loop_main(), pps_timer_tick, server,
 			 &server->pps_timer);
 
+	isc_timer_create(isc_loop_main(), adbsnapshot_timer_tick, server,
+			 &server->adbsnapshot_timer);
+
 	CHECKFATAL(cfg_parser_create(isc_g_mctx, &named_g_parser),
 		   "creating default configuration parser");
 
@@ -9470,6 +9705,10 @@ shutdown_server(void *arg) {
 	cfg_parser_destroy(&named_g_addparser);
 
 	(void)named_server_saventa(server);
+	(void)savecache(server, false);
+	if (server->adbsnapshot_interval != 0) {
+		saveadb(server, false);
+	}
 
 	ISC_LIST_FOREACH (server->kasplist, kasp, link) {
 		ISC_LIST_UNLINK(server->kasplist, kasp, link);
@@ -9502,6 +9741,7 @@ shutdown_server(void *arg) {
 	isc_timer_destroy(&server->interface_timer);
 	isc_timer_destroy(&server->pps_timer);
 	isc_timer_destroy(&server->tat_timer);
+	isc_timer_destroy(&server->adbsnapshot_timer);
 
 	ns_interfacemgr_detach(&server->interfacemgr);
 
@@ -15286,6 +15526,134 @@ named_server_loadnta(named_server_t *server) {
 	return ISC_R_SUCCESS;
 }
 
+/*
+ * The cache snapshots are written by a work thread, so that the main
+ * loop is not blocked while the caches are walked and written out.
+ */
+typedef struct cachesnapshot {
+	isc_mem_t *mctx;
+	dns_cache_t *cache;
+	isc_time_t start;
+	uint64_t count;
+	isc_result_t result;
+} cachesnapshot_t;
+
+static void
+savecache_work(void *arg) {
+	cachesnapshot_t *snap = arg;
+
+	snap->result = dns_cache_savesnapshot(snap->cache, &snap->count);
+}
+
+static void
+savecache_done(void *arg) {
+	cachesnapshot_t *snap = arg;
+	const char *name = dns_cache_getname(snap->cache);
+
+	if (snap->result == ISC_R_SUCCESS) {
+		isc_time_t end = isc_time_now();
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_INFO,
+			      "cache '%s': saved %" PRIu64
+			      " rdatasets in %" PRIu64 " ms",
+			      name, snap->count,
+			      isc_time_microdiff(&end, &snap->start) / 1000);
+	} else {
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_ERROR,
+			      "error saving snapshot of cache '%s': %s", name,
+			      isc_result_totext(snap->result));
+	}
+
+	dns_cache_detach(&snap->cache);
+	isc_mem_putanddetach(&snap->mctx, snap, sizeof(*snap));
+}
+
+/*
+ * Save the snapshots of the caches that have a snapshot file; they are
+ * written in the background unless the server is shutting down.
+ */
+static bool
+savecache(named_server_t *server, bool background) {
+	bool found = false;
+
+	ISC_LIST_FOREACH (server->cachelist, nsc, link) {
+		cachesnapshot_t *snap = NULL;
+
+		if (!dns_cache_hassnapshotfile(nsc->cache)) {
+			continue;
+		}
+		found = true;
+
+		snap = isc_mem_get(server->mctx, sizeof(*snap));
+		*snap = (cachesnapshot_t){
+			.start = isc_time_now(),
+			.result = ISC_R_SUCCESS,
+		};
+		isc_mem_attach(server->mctx, &snap->mctx);
+		dns_cache_attach(nsc->cache, &snap->cache);
+
+		if (background) {
+			isc_work_enqueue(isc_loop_main(), savecache_work,
+					 savecache_done, snap);
+		} else {
+			savecache_work(snap);
+			savecache_done(snap);
+		}
+	}
+
+	return found;
+}
+
+isc_result_t
+named_server_savecache(named_server_t *server, isc_buffer_t **text) {
+	REQUIRE(text != NULL);
+
+	if (savecache(server, true)) {
+		(void)putstr(text, "saving cache snapshots in the background; "
+				   "see the log for the results");
+	} else {
+		(void)putstr(text, "no cache snapshot file configured");
+	}
+	(void)putnull(text);
+
+	return ISC_R_SUCCESS;
+}
+
+isc_result_t
+named_server_loadcache(named_server_t *server) {
+	ISC_LIST_FOREACH (server->cachelist, nsc, link) {
+		const char *name = dns_cache_getname(nsc->cache);
+		isc_time_t start = isc_time_now();
+		isc_result_t result;
+		uint64_t count = 0;
+
+		if (!dns_cache_hassnapshotfile(nsc->cache)) {
+			continue;
+		}
+
+		result = dns_cache_loadsnapshot(nsc->cache,
+						isc_loopmgr_nloops(), &count);
+		if (result == ISC_R_SUCCESS) {
+			isc_time_t end = isc_time_now();
+			isc_log_write(NAMED_LOGCATEGORY_GENERAL,
+				      NAMED_LOGMODULE_SERVER, ISC_LOG_INFO,
+				      "cache '%s': restored %" PRIu64
+				      " rdatasets in %" PRIu64 " ms",
+				      name, count,
+				      isc_time_microdiff(&end, &start) / 1000);
+		} else if (result != ISC_R_FILENOTFOUND) {
+			isc_log_write(NAMED_LOGCATEGORY_GENERAL,
+				      NAMED_LOGMODULE_SERVER, ISC_LOG_ERROR,
+				      "error loading snapshot of cache '%s': "
+				      "%s",
+				      name, isc_result_totext(result));
+		}
+	}
+
+	return ISC_R_SUCCESS;
+}
+
 static isc_result_t
 mkey_refresh(dns_view_t *view, isc_buffer_t **text) {
 	isc_result_t result;
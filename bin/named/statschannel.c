@@ -32,8 +32,10 @@
 #include <dns/rdataclass.h>
 #include <dns/rdatatype.h>
 #include <dns/resolver.h>
+#include <dns/rrl.h>
 #include <dns/stats.h>
 #include <dns/transport.h>
+#include <dns/verifyqueue.h>
 #include <dns/view.h>
 #include <dns/xfrin.h>
 #include <dns/zt.h>
@@ -57,11 +59,11 @@
 #include "xsl_p.h"
 
 #define STATS_XML_VERSION_MAJOR "3"
-#define STATS_XML_VERSION_MINOR "14"
+#define STATS_XML_VERSION_MINOR "15"
 #define STATS_XML_VERSION	STATS_XML_VERSION_MAJOR "." STATS_XML_VERSION_MINOR
 
 #define STATS_JSON_VERSION_MAJOR "1"
-#define STATS_JSON_VERSION_MINOR "8"
+#define STATS_JSON_VERSION_MINOR "9"
 #define STATS_JSON_VERSION	 STATS_JSON_VERSION_MAJOR "." STATS_JSON_VERSION_MINOR
 
 #define CHECK(m)                               \
@@ -396,6 +398,10 @@ init_desc(void) {
 		       "queries dropped due to recursive client limit",
 		       "RecLimitDropped");
 	SET_NSSTATDESC(updatequota, "Update quota exceeded", "UpdateQuota");
+	SET_NSSTATDESC(respcachehit, "responses sent from the response cache",
+		       "RespCacheHit");
+	SET_NSSTATDESC(respcachemiss, "response cache misses",
+		       "RespCacheMiss");
 
 	INSIST(i == ns_statscounter_max);
 
@@ -491,6 +497,19 @@ init_desc(void) {
 	SET_RESSTATDESC(priming, "priming queries", "Priming");
 	SET_RESSTATDESC(forwardonlyfail, "all forwarders failed",
 			"ForwardOnlyFail");
+	SET_RESSTATDESC(ecsout, "queries sent with client subnet", "ECSOut");
+	SET_RESSTATDESC(ecsscoped, "client subnet scoped responses",
+			"ECSScoped");
+	SET_RESSTATDESC(ecsmismatch, "client subnet mismatch in response",
+			"ECSMismatch");
+	SET_RESSTATDESC(lockcontended, "fetch table lock contentions",
+			"LockContended");
+	SET_RESSTATDESC(keycachehit, "DNSKEY cache hits", "KeyCacheHit");
+	SET_RESSTATDESC(keycachemiss, "DNSKEY cache misses", "KeyCacheMiss");
+	SET_RESSTATDESC(sigcachehit, "signature verification cache hits",
+			"SigCacheHit");
+	SET_RESSTATDESC(sigcachemiss, "signature verification cache misses",
+			"SigCacheMiss");
 
 	INSIST(i == dns_resstatscounter_max);
 
@@ -551,6 +570,11 @@ init_desc(void) {
 	SET_ZONESTATDESC(xfrsuccess, "transfer requests succeeded",
 			 "XfrSuccess");
 	SET_ZONESTATDESC(xfrfail, "transfer requests failed", "XfrFail");
+	SET_ZONESTATDESC(sigsgenerated, "signatures generated",
+			 "SigsGenerated");
+	SET_ZONESTATDESC(sigsoffloaded,
+			 "signatures generated by helper threads",
+			 "SigsOffloaded");
 	INSIST(i == dns_zonestatscounter_max);
 
 	/* Initialize socket statistics */
@@ -636,6 +660,18 @@ init_desc(void) {
 			 "TCP4Clients");
 	SET_SOCKSTATDESC(tcp6clients, "TCP/IPv6 clients currently connected",
 			 "TCP6Clients");
+	SET_SOCKSTATDESC(udp4sendbatch, "UDP/IPv4 batched send calls",
+			 "UDP4SendBatch");
+	SET_SOCKSTATDESC(udp6sendbatch, "UDP/IPv6 batched send calls",
+			 "UDP6SendBatch");
+	SET_SOCKSTATDESC(udp4sendbatched, "UDP/IPv4 messages sent in batches",
+			 "UDP4SendBatched");
+	SET_SOCKSTATDESC(udp6sendbatched, "UDP/IPv6 messages sent in batches",
+			 "UDP6SendBatched");
+	SET_SOCKSTATDESC(udp4sendgso, "UDP/IPv4 GSO coalesced sends",
+			 "UDP4SendGSO");
+	SET_SOCKSTATDESC(udp6sendgso, "UDP/IPv6 GSO coalesced sends",
+			 "UDP6SendGSO");
 	INSIST(i == isc_sockstatscounter_max);
 
 	/* Initialize DNSSEC statistics */
@@ -1276,6 +1312,76 @@ cleanup:
 	return;
 #endif /* ifdef HAVE_LIBXML2 */
 }
+
+/*
+ * Per-view query latency histograms (see dns/stats.h), summarized as
+ * a population, a sum and a handful of percentiles.  The percentiles
+ * are listed in decreasing order as isc_histo_quantiles() requires.
+ */
+static const char *latency_transports[DNS_TRANSPORT_COUNT] = {
+	[DNS_TRANSPORT_UDP] = "udp",
+	[DNS_TRANSPORT_TCP] = "tcp",
+	[DNS_TRANSPORT_TLS] = "tls",
+	[DNS_TRANSPORT_HTTP] = "https",
+};
+
+static const char *latency_outcomes[dns_latencyoutcome_max] = {
+	[dns_latencyoutcome_cache] = "cache",
+	[dns_latencyoutcome_auth] = "auth",
+	[dns_latencyoutcome_recursion] = "recursion",
+};
+
+static const double latency_fractions[] = { 0.999, 0.99, 0.9, 0.5 };
+static const char *latency_fraction_names[] = { "p99.9", "p99", "p90",
+						"p50" };
+
+#define LATENCY_QUANTILES ARRAY_SIZE(latency_fractions)
+
+typedef struct {
+	uint64_t count;
+	double sum; /* microseconds */
+	uint64_t value[LATENCY_QUANTILES];
+} latency_summary_t;
+
+/*
+ * Returns false if nothing has been recorded.
+ */
+static bool
+histo_summarize(isc_histo_t *hg, latency_summary_t *summary) {
+	isc_result_t result;
+	double pop = 0.0, mean = 0.0;
+
+	isc_histo_moments(hg, &pop, &mean, NULL);
+	result = isc_histo_quantiles(hg, LATENCY_QUANTILES, latency_fractions,
+				     summary->value);
+
+	if (result != ISC_R_SUCCESS || pop == 0.0) {
+		return false;
+	}
+
+	summary->count = (uint64_t)pop;
+	summary->sum = pop * mean;
+	return true;
+}
+
+/*
+ * Returns false if no queries have been recorded.
+ */
+static bool
+latency_summarize(isc_histomulti_t *hm, latency_summary_t *summary) {
+	isc_histo_t *hg = NULL;
+	bool found;
+
+	if (hm == NULL) {
+		return false;
+	}
+
+	isc_histomulti_merge(&hg, hm);
+	found = histo_summarize(hg, summary);
+	isc_histo_destroy(&hg);
+
+	return found;
+}
 #endif /* defined(EXTENDED_STATS) */
 
 #ifdef HAVE_LIBXML2
@@ -1491,6 +1597,10 @@ xfrin_xmlrender(dns_zone_t *zone, void *arg) {
 	unsigned int nrecs = 0;
 	uint64_t nbytes = 0;
 	uint64_t rate = 0;
+	unsigned int napplied = 0;
+	uint64_t parserate = 0;
+	uint64_t applyrate = 0;
+	unsigned int queued = 0;
 
 	statlevel = dns_zone_getstatlevel(zone);
 	if (statlevel == dns_zonestat_none) {
@@ -1708,7 +1818,8 @@ xfrin_xmlrender(dns_zone_t *zone, void *arg) {
 	TRY0(xmlTextWriterEndElement(writer));
 
 	if (is_running) {
-		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes, &rate);
+		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes, &rate,
+				   &napplied, &parserate, &applyrate, &queued);
 	}
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "nmsg"));
 	TRY0(xmlTextWriterWriteFormatString(writer, "%u", nmsg));
@@ -1722,6 +1833,18 @@ xfrin_xmlrender(dns_zone_t *zone, void *arg) {
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "rate"));
 	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, rate));
 	TRY0(xmlTextWriterEndElement(writer));
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "napplied"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%u", napplied));
+	TRY0(xmlTextWriterEndElement(writer));
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "parserate"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, parserate));
+	TRY0(xmlTextWriterEndElement(writer));
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "applyrate"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, applyrate));
+	TRY0(xmlTextWriterEndElement(writer));
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "queued"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%u", queued));
+	TRY0(xmlTextWriterEndElement(writer));
 
 	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "ixfr"));
 	if (is_running && is_first_data_received) {
@@ -1751,6 +1874,62 @@ cleanup:
 	return ISC_R_FAILURE;
 }
 
+static isc_result_t
+latency_xmlrender(dns_view_t *view, xmlTextWriterPtr writer) {
+	int xmlrc;
+
+	for (size_t t = DNS_TRANSPORT_UDP; t < DNS_TRANSPORT_COUNT; t++) {
+		for (size_t o = 0; o < dns_latencyoutcome_max; o++) {
+			latency_summary_t summary;
+
+			if (!latency_summarize(view->latencystats[t][o],
+					       &summary))
+			{
+				continue;
+			}
+
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "latency"));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "transport",
+				ISC_XMLCHAR latency_transports[t]));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "outcome",
+				ISC_XMLCHAR latency_outcomes[o]));
+
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counter"));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "name",
+				ISC_XMLCHAR "count"));
+			TRY0(xmlTextWriterWriteFormatString(
+				writer, "%" PRIu64, summary.count));
+			TRY0(xmlTextWriterEndElement(writer)); /* counter */
+
+			for (size_t q = 0; q < LATENCY_QUANTILES; q++) {
+				TRY0(xmlTextWriterStartElement(
+					writer, ISC_XMLCHAR "counter"));
+				TRY0(xmlTextWriterWriteAttribute(
+					writer, ISC_XMLCHAR "name",
+					ISC_XMLCHAR latency_fraction_names[q]));
+				TRY0(xmlTextWriterWriteFormatString(
+					writer, "%" PRIu64, summary.value[q]));
+				TRY0(xmlTextWriterEndElement(writer));
+			}
+
+			TRY0(xmlTextWriterEndElement(writer)); /* latency */
+		}
+	}
+
+	return ISC_R_SUCCESS;
+
+cleanup:
+	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+		      ISC_LOG_ERROR, "Failed at latency_xmlrender()");
+
+	return ISC_R_FAILURE;
+}
+
 static isc_result_t
 generatexml(named_server_t *server, uint32_t flags, int *buflen,
 	    xmlChar **buf) {
@@ -2128,6 +2307,20 @@ generatexml(named_server_t *server, uint32_t flags, int *buflen,
 		TRY0(dns_cache_renderxml(view->cache, writer));
 		TRY0(xmlTextWriterEndElement(writer)); /* </cachestats> */
 
+		if (view->rrl != NULL) {
+			/* <rrlstats> */
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counters"));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "type",
+				ISC_XMLCHAR "rrlstats"));
+			TRY0(dns_rrl_renderxml(view->rrl, writer));
+			TRY0(xmlTextWriterEndElement(writer)); /* </rrlstats> */
+		}
+
+		/* <latency>, in microseconds */
+		CHECK(latency_xmlrender(view, writer));
+
 		TRY0(xmlTextWriterEndElement(writer)); /* view */
 
 		view = ISC_LIST_NEXT(view, link);
@@ -2340,6 +2533,52 @@ addzone(char *name, char *classname, const char *ztype, uint32_t serial,
 	return node;
 }
 
+static isc_result_t
+latency_jsonrender(dns_view_t *view, json_object *latency) {
+	isc_result_t result = ISC_R_SUCCESS;
+
+	for (size_t t = DNS_TRANSPORT_UDP; t < DNS_TRANSPORT_COUNT; t++) {
+		json_object *transport = NULL;
+
+		for (size_t o = 0; o < dns_latencyoutcome_max; o++) {
+			latency_summary_t summary;
+			json_object *outcome = NULL;
+
+			if (!latency_summarize(view->latencystats[t][o],
+					       &summary))
+			{
+				continue;
+			}
+
+			if (transport == NULL) {
+				transport = json_object_new_object();
+				CHECKMEM(transport);
+				json_object_object_add(latency,
+						       latency_transports[t],
+						       transport);
+			}
+
+			outcome = json_object_new_object();
+			CHECKMEM(outcome);
+			json_object_object_add(transport, latency_outcomes[o],
+					       outcome);
+
+			json_object_object_add(
+				outcome, "count",
+				json_object_new_int64(summary.count));
+			for (size_t q = 0; q < LATENCY_QUANTILES; q++) {
+				json_object_object_add(
+					outcome, latency_fraction_names[q],
+					json_object_new_int64(
+						summary.value[q]));
+			}
+		}
+	}
+
+cleanup:
+	return result;
+}
+
 static isc_result_t
 zone_jsonrender(dns_zone_t *zone, void *arg) {
 	isc_result_t result = ISC_R_SUCCESS;
@@ -2570,6 +2809,10 @@ xfrin_jsonrender(dns_zone_t *zone, void *arg) {
 	unsigned int nrecs = 0;
 	uint64_t nbytes = 0;
 	uint64_t rate = 0;
+	unsigned int napplied = 0;
+	uint64_t parserate = 0;
+	uint64_t applyrate = 0;
+	unsigned int queued = 0;
 
 	statlevel = dns_zone_getstatlevel(zone);
 	if (statlevel == dns_zonestat_none) {
@@ -2772,7 +3015,8 @@ xfrin_jsonrender(dns_zone_t *zone, void *arg) {
 	}
 
 	if (is_running) {
-		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes, &rate);
+		dns_xfrin_getstats(xfr, &nmsg, &nrecs, &nbytes, &rate,
+				   &napplied, &parserate, &applyrate, &queued);
 	}
 	json_object_object_add(xfrinobj, "nmsg",
 			       json_object_new_int64((int64_t)nmsg));
@@ -2786,6 +3030,20 @@ xfrin_jsonrender(dns_zone_t *zone, void *arg) {
 			       json_object_new_int64(rate > INT64_MAX
 							     ? INT64_MAX
 							     : (int64_t)rate));
+	json_object_object_add(xfrinobj, "napplied",
+			       json_object_new_int64((int64_t)napplied));
+	json_object_object_add(
+		xfrinobj, "parserate",
+		json_object_new_int64(parserate > INT64_MAX
+					      ? INT64_MAX
+					      : (int64_t)parserate));
+	json_object_object_add(
+		xfrinobj, "applyrate",
+		json_object_new_int64(applyrate > INT64_MAX
+					      ? INT64_MAX
+					      : (int64_t)applyrate));
+	json_object_object_add(xfrinobj, "queued",
+			       json_object_new_int64((int64_t)queued));
 
 	if (is_running && is_first_data_received) {
 		json_object_object_add(
@@ -3157,6 +3415,40 @@ generatejson(named_server_t *server, size_t *msglen, const char **msg,
 				json_object_object_add(res, "cachestats",
 						       counters);
 
+				if (view->rrl != NULL) {
+					counters = json_object_new_object();
+					CHECKMEM(counters);
+
+					result = dns_rrl_renderjson(view->rrl,
+								    counters);
+					if (result != ISC_R_SUCCESS) {
+						json_object_put(counters);
+						goto cleanup;
+					}
+
+					json_object_object_add(v, "rrl",
+							       counters);
+				}
+
+				/* query latency, in microseconds */
+				counters = json_object_new_object();
+				CHECKMEM(counters);
+
+				result = latency_jsonrender(view, counters);
+				if (result != ISC_R_SUCCESS) {
+					json_object_put(counters);
+					goto cleanup;
+				}
+
+				if (json_object_get_object(counters)->count !=
+				    0)
+				{
+					json_object_object_add(v, "latency",
+							       counters);
+				} else {
+					json_object_put(counters);
+				}
+
 				dns_view_getadb(view, &adb);
 				if (adb != NULL) {
 					istats = dns_adb_getstats(adb);
@@ -3496,6 +3788,773 @@ render_json_traffic(const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo,
 
 #endif /* HAVE_JSON_C */
 
+#if defined(EXTENDED_STATS)
+/*
+ * Prometheus text exposition format (version 0.0.4).
+ *
+ * The metrics are streamed to the client one family at a time, and the
+ * per-zone families are split across as many chunks as they need, so a
+ * scrape never holds more than a chunk of output in memory.  A scrape
+ * can be restricted to some of the families with one or more
+ * "family=<name>[,<name>...]" query parameters.
+ */
+typedef struct prometheus_state prometheus_state_t;
+typedef isc_result_t(prometheus_render_t)(prometheus_state_t *st,
+					  isc_buffer_t *b);
+
+static prometheus_render_t prometheus_server;
+static prometheus_render_t prometheus_sockets;
+static prometheus_render_t prometheus_resolver;
+static prometheus_render_t prometheus_latency;
+static prometheus_render_t prometheus_validation;
+static prometheus_render_t prometheus_zones;
+
+static const struct {
+	const char *name;
+	prometheus_render_t *render;
+} prometheus_families[] = {
+	{ "server", prometheus_server },     { "sockets", prometheus_sockets },
+	{ "resolver", prometheus_resolver }, { "latency", prometheus_latency },
+	{ "validation", prometheus_validation }, { "zones", prometheus_zones },
+};
+
+typedef struct prometheus_zone {
+	dns_zone_t *zone;
+	dns_view_t *view;
+} prometheus_zone_t;
+
+struct prometheus_state {
+	isc_mem_t *mctx;
+	named_server_t *server;
+	unsigned int families; /* requested families, one bit each */
+	size_t family;	       /* family being rendered */
+
+	/* Views and zones as they were when the scrape started */
+	dns_view_t **views;
+	size_t nviews;
+	prometheus_zone_t *zones;
+	size_t nzones;
+	size_t zonealloc;
+	bool zonescollected;
+	dns_view_t *collectview;
+
+	size_t zonepass; /* per-zone metric being rendered */
+	size_t zone;	 /* next zone for that metric */
+
+	isc_buffer_t *labels; /* scratch space for label sets */
+};
+
+typedef struct prometheus_dumparg {
+	isc_buffer_t *b;
+	const char *metric;
+	const char *labels;
+	const char *name;
+	const char **desc;
+	isc_result_t result;
+} prometheus_dumparg_t;
+
+static isc_result_t
+prometheus_putlabel(isc_buffer_t *b, const char *name, const char *value) {
+	isc_result_t result;
+
+	CHECK(isc_buffer_printf(b, "%s=\"", name));
+	for (const char *p = value; *p != '\0'; p++) {
+		switch (*p) {
+		case '\\':
+			CHECK(isc_buffer_printf(b, "\\\\"));
+			break;
+		case '"':
+			CHECK(isc_buffer_printf(b, "\\\""));
+			break;
+		case '\n':
+			CHECK(isc_buffer_printf(b, "\\n"));
+			break;
+		default:
+			isc_buffer_putuint8(b, *p);
+			break;
+		}
+	}
+	CHECK(isc_buffer_printf(b, "\""));
+
+cleanup:
+	return result;
+}
+
+/*
+ * Format the label set for 'view' and, if not NULL, 'zone' into
+ * st->labels as a NUL-terminated string.
+ */
+static isc_result_t
+prometheus_setlabels(prometheus_state_t *st, dns_view_t *view,
+		     dns_zone_t *zone) {
+	isc_result_t result;
+	char zonename[DNS_NAME_FORMATSIZE];
+
+	isc_buffer_clear(st->labels);
+	CHECK(prometheus_putlabel(st->labels, "view", view->name));
+	if (zone != NULL) {
+		dns_zone_nameonly(zone, zonename, sizeof(zonename));
+		isc_buffer_putuint8(st->labels, ',');
+		CHECK(prometheus_putlabel(st->labels, "zone", zonename));
+	}
+	isc_buffer_putuint8(st->labels, 0);
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_header(isc_buffer_t *b, const char *metric, const char *type,
+		  const char *help) {
+	return isc_buffer_printf(b, "# HELP %s %s\n# TYPE %s %s\n", metric,
+				 help, metric, type);
+}
+
+static void
+prometheus_sample(prometheus_dumparg_t *dumparg, const char *value,
+		  uint64_t val) {
+	if (dumparg->result != ISC_R_SUCCESS) {
+		return;
+	}
+
+	dumparg->result = isc_buffer_printf(
+		dumparg->b, "%s{%s%s%s=\"%s\"} %" PRIu64 "\n", dumparg->metric,
+		dumparg->labels, dumparg->labels[0] != '\0' ? "," : "",
+		dumparg->name, value, val);
+}
+
+static void
+prometheus_statdump(isc_statscounter_t counter, uint64_t val, void *arg) {
+	prometheus_dumparg_t *dumparg = arg;
+
+	prometheus_sample(dumparg, dumparg->desc[counter], val);
+}
+
+static void
+prometheus_rdtypedump(dns_rdatastatstype_t type, uint64_t val, void *arg) {
+	char typebuf[64];
+	const char *typestr = "Others";
+
+	if ((DNS_RDATASTATSTYPE_ATTR(type) &
+	     DNS_RDATASTATSTYPE_ATTR_OTHERTYPE) == 0)
+	{
+		dns_rdatatype_format(DNS_RDATASTATSTYPE_BASE(type), typebuf,
+				     sizeof(typebuf));
+		typestr = typebuf;
+	}
+
+	prometheus_sample(arg, typestr, val);
+}
+
+static void
+prometheus_opcodedump(dns_opcode_t code, uint64_t val, void *arg) {
+	isc_buffer_t b;
+	char codebuf[64];
+
+	isc_buffer_init(&b, codebuf, sizeof(codebuf) - 1);
+	dns_opcode_totext(code, &b);
+	codebuf[isc_buffer_usedlength(&b)] = '\0';
+
+	prometheus_sample(arg, codebuf, val);
+}
+
+static void
+prometheus_rcodedump(dns_rcode_t code, uint64_t val, void *arg) {
+	isc_buffer_t b;
+	char codebuf[64];
+
+	isc_buffer_init(&b, codebuf, sizeof(codebuf) - 1);
+	dns_rcode_totext(code, &b);
+	codebuf[isc_buffer_usedlength(&b)] = '\0';
+
+	prometheus_sample(arg, codebuf, val);
+}
+
+static isc_result_t
+prometheus_stats(isc_buffer_t *b, const char *metric, const char *labels,
+		 const char *name, const char **desc, isc_stats_t *stats,
+		 int options) {
+	prometheus_dumparg_t dumparg = {
+		.b = b,
+		.metric = metric,
+		.labels = labels,
+		.name = name,
+		.desc = desc,
+		.result = ISC_R_SUCCESS,
+	};
+
+	isc_stats_dump(stats, prometheus_statdump, &dumparg, options);
+
+	return dumparg.result;
+}
+
+static isc_result_t
+prometheus_server(prometheus_state_t *st, isc_buffer_t *b) {
+	isc_result_t result;
+	named_server_t *server = st->server;
+	prometheus_dumparg_t dumparg = {
+		.b = b,
+		.labels = "",
+		.result = ISC_R_SUCCESS,
+	};
+
+	dumparg.metric = "named_opcode_total";
+	dumparg.name = "opcode";
+	CHECK(prometheus_header(b, dumparg.metric, "counter",
+				"Requests received, by opcode."));
+	dns_opcodestats_dump(server->sctx->opcodestats, prometheus_opcodedump,
+			     &dumparg, ISC_STATSDUMP_VERBOSE);
+	CHECK(dumparg.result);
+
+	dumparg.metric = "named_rcode_total";
+	dumparg.name = "rcode";
+	CHECK(prometheus_header(b, dumparg.metric, "counter",
+				"Responses sent, by rcode."));
+	dns_rcodestats_dump(server->sctx->rcodestats, prometheus_rcodedump,
+			    &dumparg, ISC_STATSDUMP_VERBOSE);
+	CHECK(dumparg.result);
+
+	dumparg.metric = "named_qtype_total";
+	dumparg.name = "qtype";
+	CHECK(prometheus_header(b, dumparg.metric, "counter",
+				"Queries received, by RR type."));
+	dns_rdatatypestats_dump(server->sctx->rcvquerystats,
+				prometheus_rdtypedump, &dumparg, 0);
+	CHECK(dumparg.result);
+
+	CHECK(prometheus_header(b, "named_nsstat_total", "counter",
+				"Name server statistics."));
+	CHECK(prometheus_stats(b, "named_nsstat_total", "", "counter",
+			       nsstats_xmldesc,
+			       ns_stats_get(server->sctx->nsstats),
+			       ISC_STATSDUMP_VERBOSE));
+
+	CHECK(prometheus_header(b, "named_zonestat_total", "counter",
+				"Zone maintenance statistics."));
+	CHECK(prometheus_stats(b, "named_zonestat_total", "", "counter",
+			       zonestats_xmldesc, server->zonestats,
+			       ISC_STATSDUMP_VERBOSE));
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_sockets(prometheus_state_t *st, isc_buffer_t *b) {
+	isc_result_t result;
+
+	CHECK(prometheus_header(b, "named_sockstat_total", "counter",
+				"Socket I/O statistics."));
+	CHECK(prometheus_stats(b, "named_sockstat_total", "", "counter",
+			       sockstats_xmldesc, st->server->sockstats,
+			       ISC_STATSDUMP_VERBOSE));
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_resolver(prometheus_state_t *st, isc_buffer_t *b) {
+	isc_result_t result;
+	const char *metric = "named_resolver_total";
+	prometheus_dumparg_t dumparg = {
+		.b = b,
+		.metric = "named_resolver_qtype_total",
+		.name = "qtype",
+		.result = ISC_R_SUCCESS,
+	};
+
+	CHECK(prometheus_header(b, metric, "counter",
+				"Resolver statistics, by view."));
+	for (size_t i = 0; i < st->nviews; i++) {
+		dns_view_t *view = st->views[i];
+		isc_stats_t *istats = NULL;
+
+		if (view->resolver == NULL) {
+			continue;
+		}
+
+		dns_resolver_getstats(view->resolver, &istats);
+		if (istats == NULL) {
+			continue;
+		}
+
+		result = prometheus_setlabels(st, view, NULL);
+		if (result == ISC_R_SUCCESS) {
+			result = prometheus_stats(
+				b, metric, isc_buffer_base(st->labels),
+				"counter", resstats_xmldesc, istats, 0);
+		}
+		isc_stats_detach(&istats);
+		CHECK(result);
+	}
+
+	CHECK(prometheus_header(b, dumparg.metric, "counter",
+				"Queries sent by the resolver, by RR type."));
+	for (size_t i = 0; i < st->nviews; i++) {
+		dns_view_t *view = st->views[i];
+		dns_stats_t *dstats = NULL;
+
+		if (view->resolver == NULL) {
+			continue;
+		}
+
+		dns_resolver_getquerystats(view->resolver, &dstats);
+		if (dstats == NULL) {
+			continue;
+		}
+
+		result = prometheus_setlabels(st, view, NULL);
+		if (result == ISC_R_SUCCESS) {
+			dumparg.labels = isc_buffer_base(st->labels);
+			dns_rdatatypestats_dump(dstats, prometheus_rdtypedump,
+						&dumparg, 0);
+			result = dumparg.result;
+		}
+		dns_stats_detach(&dstats);
+		CHECK(result);
+	}
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_latency(prometheus_state_t *st, isc_buffer_t *b) {
+	isc_result_t result;
+	const char *metric = "named_query_latency_seconds";
+
+	CHECK(prometheus_header(b, metric, "summary",
+				"Time from the receipt of a query to the "
+				"sending of its response."));
+
+	for (size_t i = 0; i < st->nviews; i++) {
+		dns_view_t *view = st->views[i];
+
+		CHECK(prometheus_setlabels(st, view, NULL));
+
+		for (size_t t = DNS_TRANSPORT_UDP; t < DNS_TRANSPORT_COUNT;
+		     t++)
+		{
+			for (size_t o = 0; o < dns_latencyoutcome_max; o++) {
+				latency_summary_t summary;
+				char l[256];
+
+				if (!latency_summarize(view->latencystats[t][o],
+						       &summary))
+				{
+					continue;
+				}
+
+				snprintf(l, sizeof(l),
+					 "transport=\"%s\",outcome=\"%s\"",
+					 latency_transports[t],
+					 latency_outcomes[o]);
+
+				for (size_t q = 0; q < LATENCY_QUANTILES; q++) {
+					CHECK(isc_buffer_printf(
+						b,
+						"%s{%s,%s,quantile=\"%g\"} "
+						"%.6f\n",
+						metric,
+						(char *)isc_buffer_base(
+							st->labels),
+						l, latency_fractions[q],
+						summary.value[q] / 1e6));
+				}
+				CHECK(isc_buffer_printf(
+					b, "%s_sum{%s,%s} %.6f\n", metric,
+					(char *)isc_buffer_base(st->labels), l,
+					summary.sum / 1e6));
+				CHECK(isc_buffer_printf(
+					b, "%s_count{%s,%s} %" PRIu64 "\n",
+					metric,
+					(char *)isc_buffer_base(st->labels), l,
+					summary.count));
+			}
+		}
+	}
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_validation(prometheus_state_t *st, isc_buffer_t *b) {
+	isc_result_t result;
+	const char *depth = "named_validation_queue_depth";
+	const char *wait = "named_validation_queue_wait_seconds";
+
+	CHECK(prometheus_header(b, depth, "gauge",
+				"Signature verifications waiting for a "
+				"helper thread."));
+	for (size_t i = 0; i < st->nviews; i++) {
+		dns_view_t *view = st->views[i];
+
+		if (view->verifyqueue == NULL) {
+			continue;
+		}
+
+		CHECK(prometheus_setlabels(st, view, NULL));
+		CHECK(isc_buffer_printf(
+			b, "%s{%s} %zu\n", depth,
+			(char *)isc_buffer_base(st->labels),
+			dns_verifyqueue_depth(view->verifyqueue)));
+	}
+
+	CHECK(prometheus_header(b, wait, "summary",
+				"Time signature verifications waited for a "
+				"helper thread."));
+	for (size_t i = 0; i < st->nviews; i++) {
+		dns_view_t *view = st->views[i];
+		latency_summary_t summary;
+		isc_histo_t *hg = NULL;
+		bool found;
+
+		if (view->verifyqueue == NULL) {
+			continue;
+		}
+
+		dns_verifyqueue_latency(view->verifyqueue, &hg);
+		found = histo_summarize(hg, &summary);
+		isc_histo_destroy(&hg);
+		if (!found) {
+			continue;
+		}
+
+		CHECK(prometheus_setlabels(st, view, NULL));
+		for (size_t q = 0; q < LATENCY_QUANTILES; q++) {
+			CHECK(isc_buffer_printf(
+				b, "%s{%s,quantile=\"%g\"} %.6f\n", wait,
+				(char *)isc_buffer_base(st->labels),
+				latency_fractions[q], summary.value[q] / 1e6));
+		}
+		CHECK(isc_buffer_printf(b, "%s_sum{%s} %.6f\n", wait,
+					(char *)isc_buffer_base(st->labels),
+					summary.sum / 1e6));
+		CHECK(isc_buffer_printf(b, "%s_count{%s} %" PRIu64 "\n", wait,
+					(char *)isc_buffer_base(st->labels),
+					summary.count));
+	}
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_addzone(dns_zone_t *zone, void *arg) {
+	prometheus_state_t *st = arg;
+
+	if (dns_zone_getstatlevel(zone) == dns_zonestat_none) {
+		return ISC_R_SUCCESS;
+	}
+
+	if (st->nzones == st->zonealloc) {
+		size_t newalloc = ISC_MAX(st->zonealloc * 2, 64);
+		st->zones = isc_mem_creget(st->mctx, st->zones, st->zonealloc,
+					   newalloc, sizeof(st->zones[0]));
+		st->zonealloc = newalloc;
+	}
+
+	st->zones[st->nzones] = (prometheus_zone_t){ .view = st->collectview };
+	dns_zone_attach(zone, &st->zones[st->nzones].zone);
+	st->nzones++;
+
+	return ISC_R_SUCCESS;
+}
+
+static isc_result_t
+prometheus_zoneserial(prometheus_state_t *st, prometheus_zone_t *z,
+		      const char *metric, isc_buffer_t *b) {
+	isc_result_t result;
+	uint32_t serial;
+
+	if (dns_zone_getserial(z->zone, &serial) != ISC_R_SUCCESS) {
+		return ISC_R_SUCCESS;
+	}
+
+	CHECK(prometheus_setlabels(st, z->view, z->zone));
+	CHECK(isc_buffer_printf(b, "%s{%s} %u\n", metric,
+				(char *)isc_buffer_base(st->labels), serial));
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_zonerequests(prometheus_state_t *st, prometheus_zone_t *z,
+			const char *metric, isc_buffer_t *b) {
+	isc_result_t result;
+	isc_stats_t *zonestats = NULL;
+
+	if (dns_zone_getstatlevel(z->zone) != dns_zonestat_full) {
+		return ISC_R_SUCCESS;
+	}
+
+	zonestats = dns_zone_getrequeststats(z->zone);
+	if (zonestats == NULL) {
+		return ISC_R_SUCCESS;
+	}
+
+	CHECK(prometheus_setlabels(st, z->view, z->zone));
+	CHECK(prometheus_stats(b, metric, isc_buffer_base(st->labels),
+			       "counter", nsstats_xmldesc, zonestats, 0));
+
+cleanup:
+	return result;
+}
+
+static isc_result_t
+prometheus_zoneqtypes(prometheus_state_t *st, prometheus_zone_t *z,
+		      const char *metric, isc_buffer_t *b) {
+	isc_result_t result;
+	dns_stats_t *rcvquerystats = NULL;
+	prometheus_dumparg_t dumparg = {
+		.b = b,
+		.metric = metric,
+		.name = "qtype",
+		.result = ISC_R_SUCCESS,
+	};
+
+	if (dns_zone_getstatlevel(z->zone) != dns_zonestat_full) {
+		return ISC_R_SUCCESS;
+	}
+
+	rcvquerystats = dns_zone_getrcvquerystats(z->zone);
+	if (rcvquerystats == NULL) {
+		return ISC_R_SUCCESS;
+	}
+
+	CHECK(prometheus_setlabels(st, z->view, z->zone));
+	dumparg.labels = isc_buffer_base(st->labels);
+	dns_rdatatypestats_dump(rcvquerystats, prometheus_rdtypedump, &dumparg,
+				0);
+	result = dumparg.result;
+
+cleanup:
+	return result;
+}
+
+/*
+ * Per-zone metrics; each of them is rendered for all zones before
+ * moving on to the next one, as the exposition format requires the
+ * samples of a metric to be grouped together.  Zero-valued counters
+ * are left out to keep the output of large servers manageable.
+ */
+static const struct {
+	const char *metric;
+	const char *type;
+	const char *help;
+	isc_result_t (*render)(prometheus_state_t *st, prometheus_zone_t *z,
+			       const char *metric, isc_buffer_t *b);
+} prometheus_zonepasses[] = {
+	{ "named_zone_serial", "gauge", "SOA serial of the zone.",
+	  prometheus_zoneserial },
+	{ "named_zone_requests_total", "counter",
+	  "Name server statistics, by zone.", prometheus_zonerequests },
+	{ "named_zone_qtype_total", "counter",
+	  "Queries received, by zone and RR type.", prometheus_zoneqtypes },
+};
+
+static isc_result_t
+prometheus_zones(prometheus_state_t *st, isc_buffer_t *b) {
+	isc_result_t result = ISC_R_SUCCESS;
+
+	if (!st->zonescollected) {
+		for (size_t i = 0; i < st->nviews; i++) {
+			st->collectview = st->views[i];
+			(void)dns_view_apply(st->views[i], false, NULL,
+					     prometheus_addzone, st);
+		}
+		st->collectview = NULL;
+		st->zonescollected = true;
+	}
+
+	for (; st->zonepass < ARRAY_SIZE(prometheus_zonepasses);
+	     st->zonepass++, st->zone = 0)
+	{
+		const char *metric = prometheus_zonepasses[st->zonepass].metric;
+
+		if (st->zone == 0) {
+			CHECK(prometheus_header(
+				b, metric,
+				prometheus_zonepasses[st->zonepass].type,
+				prometheus_zonepasses[st->zonepass].help));
+		}
+
+		while (st->zone < st->nzones) {
+			CHECK(prometheus_zonepasses[st->zonepass].render(
+				st, &st->zones[st->zone], metric, b));
+			st->zone++;
+
+			if (isc_buffer_usedlength(b) >= ISC_HTTPD_CHUNKLEN) {
+				return DNS_R_CONTINUE;
+			}
+		}
+	}
+
+cleanup:
+	return result;
+}
+
+/*
+ * Parse the "family" query parameters into a set of family bits.
+ * Unknown family names are ignored; without any "family" parameter,
+ * all families are rendered.
+ */
+static unsigned int
+prometheus_parsefamilies(const isc_httpd_t *httpd) {
+	const char *query = NULL;
+	size_t len = 0;
+	unsigned int families = 0;
+	bool filtered = false;
+
+	query = isc_httpd_query(httpd, &len);
+	while (query != NULL && len > 0) {
+		const char *end = memchr(query, '&', len);
+		size_t plen = (end != NULL) ? (size_t)(end - query) : len;
+
+		if (plen >= 7 && strncmp(query, "family=", 7) == 0) {
+			const char *name = query + 7;
+			size_t left = plen - 7;
+
+			filtered = true;
+			while (left > 0) {
+				const char *comma = memchr(name, ',', left);
+				size_t nlen = (comma != NULL)
+						      ? (size_t)(comma - name)
+						      : left;
+
+				for (size_t i = 0;
+				     i < ARRAY_SIZE(prometheus_families); i++)
+				{
+					const char *f =
+						prometheus_families[i].name;
+					if (strlen(f) == nlen &&
+					    strncmp(f, name, nlen) == 0)
+					{
+						families |= 1 << i;
+					}
+				}
+
+				nlen = ISC_MIN(nlen + 1, left);
+				name += nlen;
+				left -= nlen;
+			}
+		}
+
+		plen = ISC_MIN(plen + 1, len);
+		query += plen;
+		len -= plen;
+	}
+
+	if (!filtered) {
+		families = (1 << ARRAY_SIZE(prometheus_families)) - 1;
+	}
+
+	return families;
+}
+
+static prometheus_state_t *
+prometheus_new(named_server_t *server, const isc_httpd_t *httpd) {
+	prometheus_state_t *st = NULL;
+	size_t i = 0;
+
+	st = isc_mem_get(server->mctx, sizeof(*st));
+	*st = (prometheus_state_t){
+		.server = server,
+		.families = prometheus_parsefamilies(httpd),
+	};
+	isc_mem_attach(server->mctx, &st->mctx);
+	isc_buffer_allocate(st->mctx, &st->labels, 256);
+
+	ISC_LIST_FOREACH (server->viewlist, view, link) {
+		st->nviews++;
+	}
+	if (st->nviews > 0) {
+		st->views = isc_mem_cget(st->mctx, st->nviews,
+					 sizeof(st->views[0]));
+	}
+	ISC_LIST_FOREACH (server->viewlist, view, link) {
+		dns_view_attach(view, &st->views[i++]);
+	}
+
+	return st;
+}
+
+static void
+prometheus_free(prometheus_state_t **stp) {
+	prometheus_state_t *st = *stp;
+
+	*stp = NULL;
+
+	for (size_t i = 0; i < st->nzones; i++) {
+		dns_zone_detach(&st->zones[i].zone);
+	}
+	if (st->zones != NULL) {
+		isc_mem_cput(st->mctx, st->zones, st->zonealloc,
+			     sizeof(st->zones[0]));
+	}
+	for (size_t i = 0; i < st->nviews; i++) {
+		dns_view_detach(&st->views[i]);
+	}
+	if (st->views != NULL) {
+		isc_mem_cput(st->mctx, st->views, st->nviews,
+			     sizeof(st->views[0]));
+	}
+	isc_buffer_free(&st->labels);
+	isc_mem_putanddetach(&st->mctx, st, sizeof(*st));
+}
+
+static isc_result_t
+render_prometheus(const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo,
+		  void *arg, void **statep, isc_buffer_t *b) {
+	isc_result_t result = ISC_R_SUCCESS;
+	prometheus_state_t *st = *statep;
+
+	UNUSED(urlinfo);
+
+	if (b == NULL) {
+		/* The scrape was abandoned */
+		if (st != NULL) {
+			prometheus_free((prometheus_state_t **)statep);
+		}
+		return ISC_R_NOMORE;
+	}
+
+	if (st == NULL) {
+		st = prometheus_new(arg, httpd);
+		*statep = st;
+	}
+
+	for (; st->family < ARRAY_SIZE(prometheus_families); st->family++) {
+		if ((st->families & (1 << st->family)) == 0) {
+			continue;
+		}
+
+		if (isc_buffer_usedlength(b) >= ISC_HTTPD_CHUNKLEN) {
+			return ISC_R_SUCCESS;
+		}
+
+		result = prometheus_families[st->family].render(st, b);
+		if (result == DNS_R_CONTINUE) {
+			return ISC_R_SUCCESS;
+		}
+		CHECK(result);
+	}
+
+	prometheus_free((prometheus_state_t **)statep);
+	return ISC_R_NOMORE;
+
+cleanup:
+	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+		      ISC_LOG_ERROR, "failed at rendering Prometheus metrics: %s",
+		      isc_result_totext(result));
+	prometheus_free((prometheus_state_t **)statep);
+	return result;
+}
+#endif /* defined(EXTENDED_STATS) */
+
 #if HAVE_LIBXML2
 /*
  * This is only needed if we have libxml2 and was confusingly returned if
@@ -3729,6 +4788,9 @@ add_listener(named_server_t *server, named_statschannel_t **listenerp,
 			    "/json/v" STATS_JSON_VERSION_MAJOR "/traffic",
 			    false, render_json_traffic, server);
 #endif /* ifdef HAVE_JSON_C */
+	isc_httpdmgr_addstream(listener->httpdmgr, "/metrics",
+			       "text/plain; version=0.0.4", render_prometheus,
+			       server);
 
 	*listenerp = listener;
 	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
@@ -1599,6 +1599,11 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 		INSIST(result == ISC_R_SUCCESS && obj != NULL);
 		dns_zone_setsignatures(zone, cfg_obj_asuint32(obj));
 
+		obj = NULL;
+		result = named_config_get(maps, "sig-signing-threads", &obj);
+		INSIST(result == ISC_R_SUCCESS && obj != NULL);
+		dns_zone_setsignthreads(zone, cfg_obj_asuint32(obj));
+
 		obj = NULL;
 		result = named_config_get(maps, "sig-signing-nodes", &obj);
 		INSIST(result == ISC_R_SUCCESS && obj != NULL);
@@ -179,6 +179,7 @@ command is one of the following:\n\
 		Enable / disable response logging.\n\
   retransfer zone [class [view]]\n\
 		Retransfer a single zone without checking serial number.\n\
+  savecache	Write snapshots of the caches to their cache-snapshot-file.\n\
   scan		Scan available network interfaces for changes.\n\
   secroots [view ...]\n\
 		Write security roots to the secroots file.\n\
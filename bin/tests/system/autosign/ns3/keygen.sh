@@ -341,3 +341,19 @@ cp $infile $zonefile
 ksk=$($KEYGEN -q -a $DEFAULT_ALGORITHM -3 -fk $zone 2>kg.out) || dumpit kg.out
 $KEYGEN -q -a $DEFAULT_ALGORITHM -3 $zone >kg.out 2>&1 || dumpit kg.out
 $DSFROMKEY $ksk.key >dsset-${zone}.
+
+#
+# Zones signed by several sig-signing-threads helpers
+#
+for zone in threads.example threads.nsec3.example; do
+  setup $zone
+  cp $infile $zonefile
+  count=1
+  while [ $count -le 1000 ]; do
+    echo "label${count} IN TXT label${count}" >>$zonefile
+    count=$((count + 1))
+  done
+  ksk=$($KEYGEN -q -a $DEFAULT_ALGORITHM -3 -fk $zone 2>kg.out) || dumpit kg.out
+  $KEYGEN -q -a $DEFAULT_ALGORITHM -3 $zone >kg.out 2>&1 || dumpit kg.out
+  $DSFROMKEY $ksk.key >dsset-${zone}.
+done
@@ -1366,5 +1366,33 @@ n=$((n + 1))
 if [ "$ret" -ne 0 ]; then echo_i "failed"; fi
 status=$((status + ret))
 
+echo_i "check that zones signed by several helper threads are fully signed ($n)"
+ret=0
+for z in threads.example threads.nsec3.example; do
+  i=0
+  while [ $i -lt 30 ]; do
+    _ret=0
+    $DIG $DIGOPTS $z @10.53.0.3 axfr >dig.out.ns3.test$n.$z || _ret=1
+    # Every authoritative RRset, including the NSEC or NSEC3 chain, must
+    # be covered by an RRSIG generated with the new keys.
+    awk '$4 == "RRSIG" { signed[$1 " " $5] = 1; next }
+$4 != "NS" || $1 == zone { rrsets[$1 " " $4] = 1 }
+END { for (r in rrsets) { if (!(r in signed)) { print r; bad = 1 } } exit(bad) }
+' zone="$z." dig.out.ns3.test$n.$z >unsigned.out.test$n.$z || _ret=1
+    grep -q "NSEC.*SOA" dig.out.ns3.test$n.$z || _ret=1
+    [ $_ret -eq 0 ] && break
+    i=$((i + 1))
+    sleep 1
+  done
+  if [ $_ret -ne 0 ]; then
+    echo_i "unsigned RRsets in $z:"
+    cat_i <unsigned.out.test$n.$z
+    ret=1
+  fi
+done
+n=$((n + 1))
+if [ "$ret" -ne 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
 echo_i "exit status: $status"
 [ $status -eq 0 ] || exit 1
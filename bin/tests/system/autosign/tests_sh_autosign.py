@@ -37,6 +37,7 @@ pytestmark = pytest.mark.extra_artifacts(
         "rev.key",
         "settime.out.*",
         "signing.*out*",
+        "unsigned.out.*",
         "standby.key",
         "sync.key",
         "unpub.key",
@@ -105,6 +106,8 @@ pytestmark = pytest.mark.extra_artifacts(
         "ns3/dsset-secure.nsec3.example.",
         "ns3/dsset-secure.optout.example.",
         "ns3/dsset-sync.example.",
+        "ns3/dsset-threads.example.",
+        "ns3/dsset-threads.nsec3.example.",
         "ns3/inactive",
         "ns3/inaczsk.example.db",
         "ns3/inaczsk2.example.db",
@@ -137,6 +140,8 @@ pytestmark = pytest.mark.extra_artifacts(
         "ns3/secure.optout.example.db",
         "ns3/st.out",
         "ns3/sync.example.db",
+        "ns3/threads.example.db",
+        "ns3/threads.nsec3.example.db",
         "ns3/trusted.conf",
         "ns3/ttl1.example.db",
         "ns3/ttl2.example.db",
@@ -79,8 +79,7 @@ recvresponse(void *arg) {
 		exit(EXIT_FAILURE);
 	}
 
-	dns_message_create(isc_g_mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &response);
+	dns_message_create(isc_g_mctx, DNS_MESSAGE_INTENTPARSE, &response);
 
 	result = dns_request_getresponse(request, response,
 					 DNS_MESSAGEPARSE_PRESERVEORDER);
@@ -142,8 +141,7 @@ sendquery(void) {
 				   dns_rootname, 0);
 	CHECK("dns_name_fromtext", result);
 
-	dns_message_create(isc_g_mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &message);
+	dns_message_create(isc_g_mctx, DNS_MESSAGE_INTENTRENDER, &message);
 
 	message->opcode = dns_opcode_query;
 	message->flags |= DNS_MESSAGEFLAG_RD;
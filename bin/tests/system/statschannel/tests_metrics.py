@@ -0,0 +1,172 @@
+#!/usr/bin/python3
+
+# Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+#
+# SPDX-License-Identifier: MPL-2.0
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0.  If a copy of the MPL was not distributed with this
+# file, you can obtain one at https://mozilla.org/MPL/2.0/.
+#
+# See the COPYRIGHT file distributed with this work for additional
+# information regarding copyright ownership.
+
+import socket
+
+import pytest
+
+import isctest.mark
+
+pytestmark = [
+    pytest.mark.skipif(
+        not (
+            isctest.mark.feature_test("--have-libxml2")
+            or isctest.mark.feature_test("--have-json-c")
+        ),
+        reason="the metrics endpoint needs libxml2 or json-c support",
+    ),
+    pytest.mark.extra_artifacts(
+        [
+            "ns2/*.jnl",
+            "ns2/*.signed",
+            "ns2/dsset-*",
+            "ns2/K*",
+            "ns2/dnssec.db.signed",
+            "ns2/dnssec.*.id",
+            "ns2/manykeys.*.id",
+            "ns2/signzone.out.*",
+            "ns3/_default.nzd",
+            "ns3/example-tcp.db",
+            "ns3/example-tls.db",
+            "ns3/example.db",
+        ]
+    ),
+]
+
+STATSIP = "10.53.0.2"
+
+SERVER_METRICS = {
+    "named_opcode_total",
+    "named_rcode_total",
+    "named_qtype_total",
+    "named_nsstat_total",
+    "named_zonestat_total",
+}
+ZONE_METRICS = {
+    "named_zone_serial",
+    "named_zone_requests_total",
+    "named_zone_qtype_total",
+}
+
+
+def fetch_metrics(statsport, query="", version="1.1"):
+    """
+    Send a raw HTTP request for /metrics and read the response until the
+    server closes the connection.  Returns the status line, the headers
+    (with lowercase names) and the body as it was sent.
+    """
+    path = "/metrics" + ("?" + query if query else "")
+    request = f"GET {path} HTTP/{version}\r\n"
+    if version == "1.1":
+        request += f"Host: {STATSIP}\r\nConnection: close\r\n"
+    request += "\r\n"
+
+    response = b""
+    with socket.create_connection((STATSIP, statsport), timeout=60) as sock:
+        sock.sendall(request.encode())
+        while True:
+            data = sock.recv(65536)
+            if not data:
+                break
+            response += data
+
+    head, sep, body = response.partition(b"\r\n\r\n")
+    assert sep
+    lines = head.decode().split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers[name.strip().lower()] = value.strip()
+
+    return lines[0], headers, body
+
+
+def dechunk(body):
+    """
+    Decode a chunked body, checking that it ends with the terminating
+    zero-length chunk and that nothing follows it.
+    """
+    decoded = b""
+    while True:
+        size, sep, body = body.partition(b"\r\n")
+        assert sep
+        size = int(size, 16)
+        if size == 0:
+            assert body == b"\r\n"
+            return decoded
+        assert len(body) >= size + 2
+        assert body[size : size + 2] == b"\r\n"
+        decoded += body[:size]
+        body = body[size + 2 :]
+
+
+def metrics(text):
+    """
+    Return the names of the metrics described by '# TYPE' lines.
+    """
+    names = set()
+    for line in text.decode().splitlines():
+        if line.startswith("# TYPE "):
+            names.add(line.split()[2])
+    return names
+
+
+def test_metrics_chunked(statsport):
+    status, headers, body = fetch_metrics(statsport)
+    assert status == "HTTP/1.1 200 OK"
+    assert headers["transfer-encoding"] == "chunked"
+    assert "content-length" not in headers
+    assert body.endswith(b"0\r\n\r\n")
+
+    names = metrics(dechunk(body))
+    assert SERVER_METRICS <= names
+    assert ZONE_METRICS <= names
+    assert "named_sockstat_total" in names
+    assert "named_query_latency_seconds" in names
+
+
+def test_metrics_http10(statsport):
+    status, headers, body = fetch_metrics(statsport, version="1.0")
+    assert status == "HTTP/1.0 200 OK"
+    assert headers["connection"] == "close"
+    assert "transfer-encoding" not in headers
+    assert "content-length" not in headers
+
+    # The body is sent as it is, and ends when the connection is closed
+    assert not body.endswith(b"0\r\n\r\n")
+    _, _, chunked = fetch_metrics(statsport)
+    assert metrics(body) == metrics(dechunk(chunked))
+
+
+@pytest.mark.parametrize(
+    "query",
+    [
+        "family=server,zones",
+        "family=server&family=zones",
+        "family=zones,server",
+        "family=server&family=bogus,zones",
+    ],
+)
+def test_metrics_family(statsport, query):
+    _, _, body = fetch_metrics(statsport, query)
+    assert metrics(dechunk(body)) == SERVER_METRICS | ZONE_METRICS
+
+
+def test_metrics_family_unknown(statsport):
+    # A filter without a known family leaves nothing to render
+    status, _, body = fetch_metrics(statsport, "family=bogus")
+    assert status == "HTTP/1.1 200 OK"
+    assert body == b"0\r\n\r\n"
+
+    _, _, body = fetch_metrics(statsport, "other=1&family=sockets")
+    assert metrics(dechunk(body)) == {"named_sockstat_total"}
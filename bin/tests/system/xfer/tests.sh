@@ -580,6 +580,18 @@ grep "'axfr-too-big/IN'.*: too many records" ns6/named.run >/dev/null || tmp=1
 if test $tmp != 0; then echo_i "failed"; fi
 status=$((status + tmp))
 
+n=$((n + 1))
+echo_i "test an AXFR which queues more batches than are loaded at once ($n)"
+tmp=0
+nextpartreset ns6/named.run
+msg="'axfr-backlog/IN' from 10.53.0.1#${PORT}: Transfer status: success"
+wait_for_log 60 "$msg" ns6/named.run || tmp=1
+$DIG $DIGOPTS axfr-backlog. @10.53.0.6 axfr >dig.out.ns6.test$n || tmp=1
+count=$(awk '$4 == "TXT"' dig.out.ns6.test$n | wc -l)
+[ "$count" -eq 50000 ] || tmp=1
+if test $tmp != 0; then echo_i "failed"; fi
+status=$((status + tmp))
+
 n=$((n + 1))
 echo_i "test that a zone with too many records is rejected (IXFR) ($n)"
 tmp=0
@@ -39,6 +39,7 @@ pytestmark = pytest.mark.extra_artifacts(
         "ns3/xfer-stats.bk",
         "ns4/nil.db",
         "ns4/root.db",
+        "ns6/axfr-backlog.bk",
         "ns6/axfr-max-idle-time.bk",
         "ns6/axfr-max-transfer-time.bk",
         "ns6/axfr-min-transfer-rate.bk",
@@ -3352,3 +3352,211 @@ dns_adb_getstats(dns_adb_t *adb) {
 
 	return adb->stats;
 }
+
+/*
+ * ADB snapshots: a header followed by fixed size records, one for each
+ * entry, holding what the resolver has learned about the server.
+ */
+#define ADB_SNAPSHOT_MAGIC   ISC_MAGIC('A', 'D', 'B', 'S')
+#define ADB_SNAPSHOT_VERSION 1
+#define ADB_SNAPSHOT_HDRLEN  16
+#define ADB_SNAPSHOT_RECLEN  (1 + 16 + 2 + 4 + 4 + 4 + 2 + 1 + 4)
+#define ADB_SNAPSHOT_RECORDS 1024 /* initial buffer size, in records */
+
+/*%
+ * Restored entries are kept for this long even if no name refers to
+ * them, so that the servers looked up shortly after the startup find
+ * them.
+ */
+#define ADB_PRELOAD_WINDOW ADB_STALE_MARGIN
+
+static void
+snapshot_putentry(isc_buffer_t *b, dns_adbentry_t *entry) {
+	const isc_sockaddr_t *sa = &entry->sockaddr;
+	unsigned char addr[16] = { 0 };
+
+	switch (sa->type.sa.sa_family) {
+	case AF_INET:
+		isc_buffer_putuint8(b, 4);
+		memmove(addr, &sa->type.sin.sin_addr, 4);
+		break;
+	case AF_INET6:
+		isc_buffer_putuint8(b, 6);
+		memmove(addr, &sa->type.sin6.sin6_addr, 16);
+		break;
+	default:
+		UNREACHABLE();
+	}
+	isc_buffer_putmem(b, addr, sizeof(addr));
+	isc_buffer_putuint16(b, isc_sockaddr_getport(sa));
+
+	isc_buffer_putuint32(b, atomic_load(&entry->srtt));
+	isc_buffer_putuint32(b, atomic_load(&entry->flags) &
+					DNS_ADB_SNAPSHOTFLAGS);
+	isc_buffer_putuint8(b, entry->edns);
+	isc_buffer_putuint8(b, entry->ednsto);
+	isc_buffer_putuint8(b, entry->plain);
+	isc_buffer_putuint8(b, entry->plainto);
+	isc_buffer_putuint16(b, entry->udpsize);
+	isc_buffer_putuint8(b, entry->mode);
+	/* The average timeout ratio, in millionths */
+	isc_buffer_putuint32(b, (uint32_t)(entry->atr * 1000000.0));
+}
+
+void
+dns_adb_snapshot(dns_adb_t *adb, isc_buffer_t **bufferp, uint64_t *countp) {
+	isc_buffer_t *b = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	dns_adbentry_t *adbentry = NULL;
+	struct cds_lfht_iter iter;
+	uint64_t count = 0;
+
+	REQUIRE(DNS_ADB_VALID(adb));
+	REQUIRE(bufferp != NULL && *bufferp == NULL);
+	REQUIRE(countp != NULL);
+
+	isc_buffer_allocate(adb->mctx, &b,
+			    ADB_SNAPSHOT_HDRLEN +
+				    ADB_SNAPSHOT_RECORDS * ADB_SNAPSHOT_RECLEN);
+	isc_buffer_putuint32(b, ADB_SNAPSHOT_MAGIC);
+	isc_buffer_putuint16(b, ADB_SNAPSHOT_VERSION);
+	isc_buffer_putuint16(b, ADB_SNAPSHOT_RECLEN);
+	isc_buffer_putuint32(b, now);
+	isc_buffer_putuint32(b, 0); /* reserved */
+
+	/*
+	 * Only the records are copied here, the buffer grows as needed and
+	 * is written out by the caller.
+	 */
+	rcu_read_lock();
+	cds_lfht_for_each_entry(adb->entries_ht, &iter, adbentry, ht_node) {
+		LOCK(&adbentry->lock);
+		if (!entry_expired(adbentry, now)) {
+			snapshot_putentry(b, adbentry);
+			count++;
+		}
+		UNLOCK(&adbentry->lock);
+	}
+	rcu_read_unlock();
+
+	*bufferp = b;
+	*countp = count;
+}
+
+static void
+snapshot_loadentry(dns_adb_t *adb, isc_buffer_t *b, isc_stdtime_t now) {
+	dns_adbentry_t *adbentry = NULL;
+	isc_sockaddr_t sockaddr;
+	unsigned char addr[16];
+	uint8_t family = isc_buffer_getuint8(b);
+	in_port_t port;
+	uint32_t flags;
+	uint8_t mode;
+
+	memmove(addr, isc_buffer_current(b), sizeof(addr));
+	isc_buffer_forward(b, sizeof(addr));
+	port = isc_buffer_getuint16(b);
+
+	switch (family) {
+	case 4: {
+		struct in_addr ina;
+		memmove(&ina, addr, 4);
+		isc_sockaddr_fromin(&sockaddr, &ina, port);
+		break;
+	}
+	case 6: {
+		struct in6_addr in6a;
+		memmove(&in6a, addr, 16);
+		isc_sockaddr_fromin6(&sockaddr, &in6a, port);
+		break;
+	}
+	default:
+		isc_buffer_forward(b, ADB_SNAPSHOT_RECLEN - 1 - 16 - 2);
+		return;
+	}
+
+	adbentry = get_attached_and_locked_entry(adb, now, &sockaddr);
+
+	atomic_store(&adbentry->srtt, isc_buffer_getuint32(b));
+	flags = isc_buffer_getuint32(b) & DNS_ADB_SNAPSHOTFLAGS;
+	atomic_store(&adbentry->flags,
+		     (atomic_load(&adbentry->flags) & ~DNS_ADB_SNAPSHOTFLAGS) |
+			     flags);
+	adbentry->edns = isc_buffer_getuint8(b);
+	adbentry->ednsto = isc_buffer_getuint8(b);
+	adbentry->plain = isc_buffer_getuint8(b);
+	adbentry->plainto = isc_buffer_getuint8(b);
+	adbentry->udpsize = isc_buffer_getuint16(b);
+	mode = isc_buffer_getuint8(b);
+	adbentry->mode = ISC_MIN(mode, QUOTA_ADJ_SIZE - 1);
+	adbentry->atr = ISC_CLAMP(isc_buffer_getuint32(b) / 1000000.0, 0.0,
+				  1.0);
+
+	/*
+	 * The quota itself depends on the configured 'fetches-per-server'
+	 * and is recomputed from the adjustment level.
+	 */
+	if (adb->quota != 0) {
+		atomic_store_relaxed(&adbentry->quota,
+				     adb->quota * quota_adj[adbentry->mode] /
+					     10000);
+	}
+
+	adbentry->expires = ISC_MAX(adbentry->expires,
+				    now + ADB_PRELOAD_WINDOW);
+
+	UNLOCK(&adbentry->lock);
+	dns_adbentry_detach(&adbentry);
+}
+
+isc_result_t
+dns_adb_restore(dns_adb_t *adb, isc_buffer_t *buffer, uint64_t *countp) {
+	isc_stdtime_t now = isc_stdtime_now();
+	isc_stdtime_t saved;
+	uint64_t count = 0;
+
+	REQUIRE(DNS_ADB_VALID(adb));
+	REQUIRE(ISC_BUFFER_VALID(buffer));
+	REQUIRE(countp != NULL);
+
+	if (isc_buffer_remaininglength(buffer) < ADB_SNAPSHOT_HDRLEN) {
+		return ISC_R_UNEXPECTEDEND;
+	}
+
+	if (isc_buffer_getuint32(buffer) != ADB_SNAPSHOT_MAGIC ||
+	    isc_buffer_getuint16(buffer) != ADB_SNAPSHOT_VERSION ||
+	    isc_buffer_getuint16(buffer) != ADB_SNAPSHOT_RECLEN)
+	{
+		return ISC_R_NOTIMPLEMENTED;
+	}
+
+	/*
+	 * What was learned a day ago is no better than nothing.
+	 */
+	saved = isc_buffer_getuint32(buffer);
+	(void)isc_buffer_getuint32(buffer); /* reserved */
+	if (saved > now || now - saved > ADB_CACHE_MAXIMUM) {
+		*countp = 0;
+		return ISC_R_SUCCESS;
+	}
+
+	if (isc_buffer_remaininglength(buffer) % ADB_SNAPSHOT_RECLEN != 0) {
+		return ISC_R_UNEXPECTEDEND;
+	}
+
+	rcu_read_lock();
+	if (atomic_load(&adb->shuttingdown)) {
+		rcu_read_unlock();
+		return ISC_R_SHUTTINGDOWN;
+	}
+
+	while (isc_buffer_remaininglength(buffer) > 0) {
+		snapshot_loadentry(adb, buffer, now);
+		count++;
+	}
+	rcu_read_unlock();
+
+	*countp = count;
+
+	return ISC_R_SUCCESS;
+}
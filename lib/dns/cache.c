@@ -16,12 +16,14 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/file.h>
 #include <isc/log.h>
 #include <isc/loop.h>
 #include <isc/mem.h>
 #include <isc/refcount.h>
 #include <isc/result.h>
 #include <isc/stats.h>
+#include <isc/stdio.h>
 #include <isc/string.h>
 #include <isc/time.h>
 #include <isc/timer.h>
@@ -81,6 +83,7 @@ struct dns_cache {
 	isc_stats_t *stats;
 	uint32_t maxrrperset;
 	uint32_t maxtypepername;
+	char *snapshotfile;
 };
 
 /***
@@ -156,6 +159,9 @@ cache_destroy(dns_cache_t *cache) {
 	isc_stats_detach(&cache->stats);
 	isc_mutex_destroy(&cache->lock);
 	isc_mem_free(cache->mctx, cache->name);
+	if (cache->snapshotfile != NULL) {
+		isc_mem_free(cache->mctx, cache->snapshotfile);
+	}
 	if (cache->hmctx != NULL) {
 		isc_mem_detach(&cache->hmctx);
 	}
@@ -331,6 +337,135 @@ dns_cache_getservestalerefresh(dns_cache_t *cache) {
 	return result == ISC_R_SUCCESS ? interval : 0;
 }
 
+void
+dns_cache_setsnapshotfile(dns_cache_t *cache, const char *filename) {
+	REQUIRE(VALID_CACHE(cache));
+
+	LOCK(&cache->lock);
+	if (cache->snapshotfile != NULL) {
+		isc_mem_free(cache->mctx, cache->snapshotfile);
+	}
+	if (filename != NULL) {
+		cache->snapshotfile = isc_mem_strdup(cache->mctx, filename);
+	}
+	UNLOCK(&cache->lock);
+}
+
+bool
+dns_cache_hassnapshotfile(dns_cache_t *cache) {
+	bool ret;
+
+	REQUIRE(VALID_CACHE(cache));
+
+	LOCK(&cache->lock);
+	ret = (cache->snapshotfile != NULL);
+	UNLOCK(&cache->lock);
+
+	return ret;
+}
+
+isc_result_t
+dns_cache_savesnapshot(dns_cache_t *cache, uint64_t *countp) {
+	isc_result_t result, tresult;
+	dns_db_t *db = NULL;
+	char *filename = NULL;
+	char *tempname = NULL;
+	size_t tempnamelen;
+	FILE *fp = NULL;
+
+	REQUIRE(VALID_CACHE(cache));
+	REQUIRE(countp != NULL);
+
+	LOCK(&cache->lock);
+	if (cache->snapshotfile != NULL) {
+		filename = isc_mem_strdup(cache->mctx, cache->snapshotfile);
+	}
+	dns_db_attach(cache->db, &db);
+	UNLOCK(&cache->lock);
+
+	if (filename == NULL) {
+		result = ISC_R_NOTFOUND;
+		goto cleanup;
+	}
+
+	/*
+	 * Write to a temporary file and rename it into place, so that
+	 * an existing snapshot is never replaced by a partial one.
+	 */
+	tempnamelen = strlen(filename) + 20;
+	tempname = isc_mem_allocate(cache->mctx, tempnamelen);
+	result = isc_file_mktemplate(filename, tempname, tempnamelen);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+	result = isc_file_openunique(tempname, &fp);
+	if (result != ISC_R_SUCCESS) {
+		goto cleanup;
+	}
+
+	result = dns_db_savesnapshot(db, fp, countp);
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_flush(fp);
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_sync(fp);
+	}
+	tresult = isc_stdio_close(fp);
+	if (result == ISC_R_SUCCESS) {
+		result = tresult;
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = isc_file_rename(tempname, filename);
+	}
+	if (result != ISC_R_SUCCESS) {
+		(void)isc_file_remove(tempname);
+	}
+
+cleanup:
+	if (tempname != NULL) {
+		isc_mem_free(cache->mctx, tempname);
+	}
+	if (filename != NULL) {
+		isc_mem_free(cache->mctx, filename);
+	}
+	dns_db_detach(&db);
+
+	return result;
+}
+
+isc_result_t
+dns_cache_loadsnapshot(dns_cache_t *cache, unsigned int nthreads,
+		       uint64_t *countp) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	char *filename = NULL;
+
+	REQUIRE(VALID_CACHE(cache));
+	REQUIRE(countp != NULL);
+
+	LOCK(&cache->lock);
+	if (cache->snapshotfile != NULL) {
+		filename = isc_mem_strdup(cache->mctx, cache->snapshotfile);
+	}
+	dns_db_attach(cache->db, &db);
+	UNLOCK(&cache->lock);
+
+	if (filename == NULL) {
+		result = ISC_R_NOTFOUND;
+	} else if (!isc_file_exists(filename)) {
+		result = ISC_R_FILENOTFOUND;
+	} else {
+		result = dns_db_loadsnapshot(db, filename, nthreads, countp);
+	}
+
+	if (filename != NULL) {
+		isc_mem_free(cache->mctx, filename);
+	}
+	dns_db_detach(&db);
+
+	return result;
+}
+
 isc_result_t
 dns_cache_flush(dns_cache_t *cache) {
 	dns_db_t *db = NULL, *olddb;
@@ -366,6 +501,11 @@ clearnode(dns_db_t *db, dns_dbnode_t *node) {
 	isc_result_t result;
 	dns_rdatasetiter_t *iter = NULL;
 
+	/*
+	 * Client subnet scoped data is not seen by the iterator.
+	 */
+	(void)dns_db_deleterdataset(db, node, NULL, dns_rdatatype_any, 0);
+
 	result = dns_db_allrdatasets(db, node, NULL, DNS_DB_STALEOK,
 				     (isc_stdtime_t)0, &iter);
 	if (result != ISC_R_SUCCESS) {
@@ -695,6 +695,30 @@ dns__db_addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	return ISC_R_NOTIMPLEMENTED;
 }
 
+isc_result_t
+dns__db_addecsrdataset(dns_db_t *db, dns_dbnode_t *node, isc_stdtime_t now,
+		       const dns_ecs_t *ecs, dns_rdataset_t *rdataset,
+		       unsigned int options,
+		       dns_rdataset_t *addedrdataset DNS__DB_FLARG) {
+	REQUIRE(DNS_DB_VALID(db));
+	REQUIRE((db->attributes & DNS_DBATTR_CACHE) != 0);
+	REQUIRE(node != NULL);
+	REQUIRE(ecs != NULL && ecs->scope > 0 && ecs->scope <= ecs->source);
+	REQUIRE(DNS_RDATASET_VALID(rdataset));
+	REQUIRE(dns_rdataset_isassociated(rdataset));
+	REQUIRE(rdataset->rdclass == db->rdclass);
+	REQUIRE(addedrdataset == NULL ||
+		(DNS_RDATASET_VALID(addedrdataset) &&
+		 !dns_rdataset_isassociated(addedrdataset)));
+
+	if (db->methods->addecsrdataset != NULL) {
+		return (db->methods->addecsrdataset)(
+			db, node, now, ecs, rdataset, options,
+			addedrdataset DNS__DB_FLARG_PASS);
+	}
+	return ISC_R_NOTIMPLEMENTED;
+}
+
 isc_result_t
 dns__db_subtractrdataset(dns_db_t *db, dns_dbnode_t *node,
 			 dns_dbversion_t *version, dns_rdataset_t *rdataset,
@@ -1207,3 +1231,31 @@ dns_db_getzoneversion(dns_db_t *db, isc_buffer_t *b) {
 	}
 	return ISC_R_NOTIMPLEMENTED;
 }
+
+isc_result_t
+dns_db_savesnapshot(dns_db_t *db, FILE *fp, uint64_t *countp) {
+	REQUIRE(DNS_DB_VALID(db));
+	REQUIRE((db->attributes & DNS_DBATTR_CACHE) != 0);
+	REQUIRE(fp != NULL);
+	REQUIRE(countp != NULL);
+
+	if (db->methods->savesnapshot != NULL) {
+		return (db->methods->savesnapshot)(db, fp, countp);
+	}
+	return ISC_R_NOTIMPLEMENTED;
+}
+
+isc_result_t
+dns_db_loadsnapshot(dns_db_t *db, const char *filename, unsigned int nthreads,
+		    uint64_t *countp) {
+	REQUIRE(DNS_DB_VALID(db));
+	REQUIRE((db->attributes & DNS_DBATTR_CACHE) != 0);
+	REQUIRE(filename != NULL);
+	REQUIRE(countp != NULL);
+
+	if (db->methods->loadsnapshot != NULL) {
+		return (db->methods->loadsnapshot)(db, filename, nthreads,
+						   countp);
+	}
+	return ISC_R_NOTIMPLEMENTED;
+}
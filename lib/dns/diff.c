@@ -146,6 +146,16 @@ dns_diff_append(dns_diff_t *diff, dns_difftuple_t **tuplep) {
 	*tuplep = NULL;
 }
 
+void
+dns_diff_move(dns_diff_t *target, dns_diff_t *source) {
+	REQUIRE(DNS_DIFF_VALID(target));
+	REQUIRE(DNS_DIFF_VALID(source));
+
+	ISC_LIST_APPENDLIST(target->tuples, source->tuples, link);
+	target->size += source->size;
+	source->size = 0;
+}
+
 bool
 dns_diff_is_boundary(const dns_diff_t *diff, dns_name_t *new_name) {
 	REQUIRE(DNS_DIFF_VALID(diff));
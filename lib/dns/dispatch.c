@@ -24,6 +24,7 @@
 #include <unistd.h>
 
 #include <isc/async.h>
+#include <isc/atomic.h>
 #include <isc/hash.h>
 #include <isc/hashmap.h>
 #include <isc/log.h>
@@ -38,6 +39,7 @@
 #include <isc/string.h>
 #include <isc/tid.h>
 #include <isc/time.h>
+#include <isc/timer.h>
 #include <isc/tls.h>
 #include <isc/urcu.h>
 #include <isc/util.h>
@@ -69,8 +71,25 @@ struct dns_dispatchmgr {
 	unsigned int nv4ports; /*%< # of available ports for IPv4 */
 	in_port_t *v6ports;    /*%< available ports for IPv4 */
 	unsigned int nv6ports; /*%< # of available ports for IPv4 */
+
+	atomic_uint_fast32_t udppool; /*%< shared UDP sockets per dispatch */
 };
 
+/*%
+ * A shared, unconnected UDP socket.  When the UDP socket pool is
+ * enabled, each UDP dispatch keeps a small number of these open and
+ * the dispatch entries send their queries through them instead of
+ * opening a connected socket per query; the responses are matched to
+ * the dispatch entries through the QID table.
+ */
+typedef struct dispsock {
+	isc_refcount_t references;
+	dns_dispatch_t *disp;
+	isc_nmhandle_t *handle;
+	in_port_t port;
+	unsigned int queries; /*%< queries sent since the socket was opened */
+} dispsock_t;
+
 typedef enum {
 	DNS_DISPATCHSTATE_NONE = 0UL,
 	DNS_DISPATCHSTATE_CONNECTING,
@@ -85,6 +104,8 @@ struct dns_dispentry {
 	dns_dispatch_t *disp;
 	isc_loop_t *loop;
 	isc_nmhandle_t *handle; /*%< netmgr handle for UDP connection */
+	dispsock_t *dsock;	/*%< shared UDP socket, if pooled */
+	isc_timer_t *timer;	/*%< read timer for the shared UDP socket */
 	dns_dispatchstate_t state;
 	dns_transport_t *transport;
 	isc_tlsctx_cache_t *tlsctx_cache;
@@ -133,6 +154,9 @@ struct dns_dispatch {
 
 	uint_fast32_t requests; /*%< how many requests we have */
 
+	dispsock_t **pool; /*%< shared UDP sockets */
+	uint32_t npool;
+
 	unsigned int timedout;
 
 	struct cds_lfht_node ht_node;
@@ -173,6 +197,17 @@ ISC_REFCOUNT_DECL(dns_dispentry);
 #define QIDS_INIT_SIZE (1 << 4) /* Must be power of 2 */
 #define QIDS_MIN_SIZE  (1 << 4) /* Must be power of 2 */
 
+/*
+ * The number of queries sent through a shared UDP socket before it is
+ * replaced by a socket bound to a new random port.
+ */
+#define UDP_POOL_ROTATE 512
+
+/*
+ * The number of random ports to try when opening a shared UDP socket.
+ */
+#define UDP_POOL_TRIES 5
+
 /*
  * Statics.
  */
@@ -201,6 +236,11 @@ tcp_dispatch_getnext(dns_dispatch_t *disp, dns_dispentry_t *resp,
 		     int64_t timeout);
 static void
 udp_dispatch_getnext(dns_dispentry_t *resp, int64_t timeout);
+static void
+udp_pool_recv(isc_nmhandle_t *handle, isc_result_t eresult,
+	      isc_region_t *region, void *arg);
+
+ISC_REFCOUNT_STATIC_DECL(dispsock);
 
 static const char *
 socktype2str(dns_dispentry_t *resp) {
@@ -337,6 +377,95 @@ dispentry_log(dns_dispentry_t *resp, int level, const char *fmt, ...) {
 		     socktype2str(resp), resp, msgbuf);
 }
 
+static void
+dispsock_destroy(dispsock_t *dsock) {
+	dns_dispatch_t *disp = dsock->disp;
+
+	dispatch_log(disp, ISC_LOG_DEBUG(90),
+		     "closing shared UDP socket %p on port %u after %u queries",
+		     dsock->handle, dsock->port, dsock->queries);
+
+	/*
+	 * Nobody is reading from the socket anymore; clear the read
+	 * callback, so it's not called with the freed 'dsock'.
+	 */
+	isc_nmhandle_close(dsock->handle);
+	isc_nmhandle_detach(&dsock->handle);
+
+	isc_mem_put(disp->mctx, dsock, sizeof(*dsock));
+}
+
+ISC_REFCOUNT_STATIC_IMPL(dispsock, dispsock_destroy);
+
+/*%
+ * Open a shared UDP socket bound to a random port from 'ports'.
+ */
+static isc_result_t
+dispsock_open(dns_dispatch_t *disp, in_port_t *ports, unsigned int nports,
+	      dispsock_t **dsockp) {
+	isc_result_t result = ISC_R_FAILURE;
+	isc_sockaddr_t local = disp->local;
+	dispsock_t *dsock = isc_mem_get(disp->mctx, sizeof(*dsock));
+
+	*dsock = (dispsock_t){ .disp = disp };
+
+	for (size_t i = 0; i < UDP_POOL_TRIES; i++) {
+		dsock->port = ports[isc_random_uniform(nports)];
+		isc_sockaddr_setport(&local, dsock->port);
+
+		result = isc_nm_udpbind(&local, udp_pool_recv, dsock,
+					&dsock->handle);
+		if (result != ISC_R_NOPERM && result != ISC_R_ADDRINUSE) {
+			/* probably not a port collision, don't retry */
+			break;
+		}
+	}
+	if (result != ISC_R_SUCCESS) {
+		isc_mem_put(disp->mctx, dsock, sizeof(*dsock));
+		return result;
+	}
+
+	dispatch_log(disp, ISC_LOG_DEBUG(90),
+		     "opened shared UDP socket %p on port %u", dsock->handle,
+		     dsock->port);
+
+	isc_refcount_init(&dsock->references, 1);
+	*dsockp = dsock;
+
+	return ISC_R_SUCCESS;
+}
+
+/*%
+ * Assign one of the dispatch's shared UDP sockets to a dispatch entry,
+ * opening it first if necessary.  After UDP_POOL_ROTATE queries the
+ * socket is replaced by a new one with a different random port; the old
+ * one stays open until the outstanding queries sent through it are done.
+ */
+static isc_result_t
+udp_pool_setup(dns_dispatch_t *disp, dns_dispentry_t *resp, in_port_t *ports,
+	       unsigned int nports) {
+	dispsock_t **dsockp = &disp->pool[isc_random_uniform(disp->npool)];
+
+	if (*dsockp != NULL && (*dsockp)->queries >= UDP_POOL_ROTATE) {
+		dispsock_detach(dsockp);
+	}
+
+	if (*dsockp == NULL) {
+		isc_result_t result = dispsock_open(disp, ports, nports,
+						    dsockp);
+		if (result != ISC_R_SUCCESS) {
+			return result;
+		}
+	}
+
+	(*dsockp)->queries++;
+	isc_sockaddr_setport(&resp->local, (*dsockp)->port);
+	resp->port = (*dsockp)->port;
+	dispsock_attach(*dsockp, &resp->dsock);
+
+	return ISC_R_SUCCESS;
+}
+
 /*%
  * Choose a random port number for a dispatch entry.
  */
@@ -366,6 +495,10 @@ setup_socket(dns_dispatch_t *disp, dns_dispentry_t *resp,
 	resp->local = disp->local;
 	resp->peer = *dest;
 
+	if (disp->npool > 0) {
+		return udp_pool_setup(disp, resp, ports, nports);
+	}
+
 	if (port == 0) {
 		port = ports[isc_random_uniform(nports)];
 		isc_sockaddr_setport(&resp->local, port);
@@ -434,6 +567,14 @@ dispentry_destroy(dns_dispentry_t *resp) {
 		isc_nmhandle_detach(&resp->handle);
 	}
 
+	if (resp->timer != NULL) {
+		isc_timer_destroy(&resp->timer);
+	}
+
+	if (resp->dsock != NULL) {
+		dispsock_detach(&resp->dsock);
+	}
+
 	if (resp->tlsctx_cache != NULL) {
 		isc_tlsctx_cache_detach(&resp->tlsctx_cache);
 	}
@@ -629,6 +770,171 @@ done:
 	dns_dispentry_detach(&resp); /* DISPENTRY003 */
 }
 
+static void
+udp_pool_response(dns_dispentry_t *resp, isc_result_t eresult,
+		  isc_region_t *region) {
+	INSIST(resp->reading);
+	resp->reading = false;
+	isc_timer_stop(resp->timer);
+
+	dispentry_log(resp, ISC_LOG_DEBUG(90), "UDP read callback on %p: %s",
+		      resp->handle, isc_result_totext(eresult));
+	resp->response(eresult, region, resp->arg);
+
+	dns_dispentry_detach(&resp); /* DISPENTRY003 */
+}
+
+static void
+udp_pool_timeout(void *arg) {
+	dns_dispentry_t *resp = (dns_dispentry_t *)arg;
+
+	REQUIRE(VALID_RESPONSE(resp));
+	REQUIRE(resp->disp->tid == isc_tid());
+
+	if (resp->reading) {
+		udp_pool_response(resp, ISC_R_TIMEDOUT, NULL);
+	}
+}
+
+/*
+ * Read callback for the shared UDP sockets.  Unlike the connected
+ * sockets, the datagrams can come from any peer and belong to any of the
+ * dispatch entries using the socket, so the QID table is used to find
+ * the dispatch entry waiting for the response.  Datagrams that match
+ * no entry, or an entry that is not currently reading, are dropped.
+ */
+static void
+udp_pool_recv(isc_nmhandle_t *handle, isc_result_t eresult,
+	      isc_region_t *region, void *arg) {
+	dispsock_t *dsock = (dispsock_t *)arg;
+	dns_dispatch_t *disp = dsock->disp;
+	dns_dispatchmgr_t *mgr = disp->mgr;
+	dns_dispentry_t *resp = NULL;
+	isc_result_t dres;
+	isc_buffer_t source;
+	dns_messageid_t id;
+	unsigned int flags;
+	isc_sockaddr_t peer;
+	isc_netaddr_t netaddr;
+	int match;
+
+	REQUIRE(VALID_DISPATCH(disp));
+	REQUIRE(disp->tid == isc_tid());
+
+	if (eresult != ISC_R_SUCCESS) {
+		/*
+		 * The reading continues (or the socket is being closed);
+		 * the dispatch entries will time out on their own.
+		 */
+		dispatch_log(disp, ISC_LOG_DEBUG(90),
+			     "shared UDP socket %p read: %s", dsock->handle,
+			     isc_result_totext(eresult));
+		return;
+	}
+
+	peer = isc_nmhandle_peeraddr(handle);
+	isc_netaddr_fromsockaddr(&netaddr, &peer);
+
+	/*
+	 * If this is from a blackholed address, drop it.
+	 */
+	if (mgr->blackhole != NULL &&
+	    dns_acl_match(&netaddr, NULL, mgr->blackhole, NULL, &match,
+			  NULL) == ISC_R_SUCCESS &&
+	    match > 0)
+	{
+		if (isc_log_wouldlog(ISC_LOG_DEBUG(10))) {
+			char netaddrstr[ISC_NETADDR_FORMATSIZE];
+			isc_netaddr_format(&netaddr, netaddrstr,
+					   sizeof(netaddrstr));
+			dispatch_log(disp, ISC_LOG_DEBUG(10),
+				     "blackholed packet from %s", netaddrstr);
+		}
+		return;
+	}
+
+	/*
+	 * Peek into the buffer to see what we can see.
+	 */
+	isc_buffer_init(&source, region->base, region->length);
+	isc_buffer_add(&source, region->length);
+	dres = dns_message_peekheader(&source, &id, &flags);
+	if (dres != ISC_R_SUCCESS) {
+		char netaddrstr[ISC_NETADDR_FORMATSIZE];
+		isc_netaddr_format(&netaddr, netaddrstr, sizeof(netaddrstr));
+		dispatch_log(disp, ISC_LOG_DEBUG(10),
+			     "got garbage packet from %s", netaddrstr);
+		return;
+	}
+
+	dispatch_log(disp, ISC_LOG_DEBUG(92),
+		     "got valid DNS message header, /QR %c, id %u",
+		     ((flags & DNS_MESSAGEFLAG_QR) != 0) ? '1' : '0', id);
+
+	/*
+	 * Look at the message flags.  If it's a query, ignore it.
+	 */
+	if ((flags & DNS_MESSAGEFLAG_QR) == 0) {
+		return;
+	}
+
+	/*
+	 * The QID, the port and the address must match a dispatch entry
+	 * that is waiting for a response on this socket.
+	 */
+	dns_dispentry_t key = {
+		.id = id,
+		.peer = peer,
+		.port = dsock->port,
+	};
+	struct cds_lfht_iter iter;
+
+	rcu_read_lock();
+	cds_lfht_lookup(mgr->qids, qid_hash(&key), qid_match, &key, &iter);
+	resp = cds_lfht_entry(cds_lfht_iter_get_node(&iter), dns_dispentry_t,
+			      ht_node);
+	if (resp == NULL || resp->dsock != dsock || !resp->reading) {
+		rcu_read_unlock();
+		dispatch_log(disp, ISC_LOG_DEBUG(90),
+			     "response doesn't match");
+		inc_stats(mgr, dns_resstatscounter_mismatch);
+		return;
+	}
+	rcu_read_unlock();
+
+	/*
+	 * We have the right resp, so call the caller back; the reference
+	 * held while reading keeps it alive outside of the RCU lock.
+	 */
+	udp_pool_response(resp, ISC_R_SUCCESS, region);
+}
+
+static void
+udp_pool_read(dns_dispentry_t *resp, int64_t timeout) {
+	if (resp->timer == NULL) {
+		isc_timer_create(resp->loop, udp_pool_timeout, resp,
+				 &resp->timer);
+	}
+
+	if (timeout == 0) {
+		timeout = resp->timeout;
+	}
+	if (timeout > 0) {
+		isc_interval_t interval;
+
+		INSIST(timeout <= UINT32_MAX);
+		isc_interval_set(&interval, timeout / 1000,
+				 (timeout % 1000) * 1000000);
+		isc_timer_start(resp->timer, isc_timertype_once, &interval);
+	}
+
+	dispentry_log(resp, ISC_LOG_DEBUG(90), "reading from shared socket %p",
+		      resp->handle);
+
+	dns_dispentry_ref(resp); /* DISPENTRY003 */
+	resp->reading = true;
+}
+
 static isc_result_t
 tcp_recv_oldest(dns_dispatch_t *disp, dns_dispentry_t **respp) {
 	dns_dispentry_t *resp = NULL;
@@ -1082,6 +1388,13 @@ dispatchmgr_destroy(dns_dispatchmgr_t *mgr) {
 	isc_mem_putanddetach(&mgr->mctx, mgr, sizeof(dns_dispatchmgr_t));
 }
 
+void
+dns_dispatchmgr_setudppool(dns_dispatchmgr_t *mgr, uint32_t size) {
+	REQUIRE(VALID_DISPATCHMGR(mgr));
+
+	atomic_store_relaxed(&mgr->udppool, size);
+}
+
 void
 dns_dispatchmgr_setstats(dns_dispatchmgr_t *mgr, isc_stats_t *stats) {
 	REQUIRE(VALID_DISPATCHMGR(mgr));
@@ -1348,6 +1661,18 @@ dispatch_createudp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *localaddr,
 
 	disp->local = *localaddr;
 
+	/*
+	 * The shared UDP sockets need random ports; a dispatch with
+	 * a fixed local port keeps using a socket per query.
+	 */
+	disp->npool = atomic_load_relaxed(&mgr->udppool);
+	if (disp->npool > 0 && isc_sockaddr_getport(localaddr) == 0) {
+		disp->pool = isc_mem_cget(disp->mctx, disp->npool,
+					  sizeof(disp->pool[0]));
+	} else {
+		disp->npool = 0;
+	}
+
 	/*
 	 * Don't append it to the dispatcher list, we don't care about UDP, only
 	 * TCP should be searched
@@ -1396,6 +1721,15 @@ dispatch_destroy(dns_dispatch_t *disp) {
 	if (disp->transport != NULL) {
 		dns_transport_detach(&disp->transport);
 	}
+	if (disp->pool != NULL) {
+		for (size_t i = 0; i < disp->npool; i++) {
+			if (disp->pool[i] != NULL) {
+				dispsock_detach(&disp->pool[i]);
+			}
+		}
+		isc_mem_cput(disp->mctx, disp->pool, disp->npool,
+			     sizeof(disp->pool[0]));
+	}
 	dns_dispatchmgr_detach(&disp->mgr);
 
 	call_rcu(&disp->rcu_head, dispatch_destroy_rcu);
@@ -1498,6 +1832,9 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop,
 	} while (i++ < QID_MAX_TRIES);
 fail:
 	if (result != ISC_R_SUCCESS) {
+		if (resp->dsock != NULL) {
+			dispsock_detach(&resp->dsock);
+		}
 		isc_mem_put(disp->mctx, resp, sizeof(*resp));
 		rcu_read_unlock();
 		return result;
@@ -1574,6 +1911,7 @@ udp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 
 	dns_dispatch_t *disp = resp->disp;
 	bool respond = false;
+	bool detach = false;
 
 	REQUIRE(disp->tid == isc_tid());
 	dispentry_log(resp, ISC_LOG_DEBUG(90),
@@ -1597,7 +1935,16 @@ udp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 		break;
 
 	case DNS_DISPATCHSTATE_CONNECTED:
-		if (resp->reading) {
+		if (resp->reading && resp->dsock != NULL) {
+			/*
+			 * There's no read to cancel on the shared socket,
+			 * just stop waiting for the response.
+			 */
+			respond = true;
+			detach = true;
+			resp->reading = false;
+			isc_timer_stop(resp->timer);
+		} else if (resp->reading) {
 			respond = true;
 			dispentry_log(resp, ISC_LOG_DEBUG(90),
 				      "canceling read on %p", resp->handle);
@@ -1624,6 +1971,10 @@ unlock:
 			      isc_result_totext(result));
 		resp->response(result, NULL, resp->arg);
 	}
+
+	if (detach) {
+		dns_dispentry_detach(&resp); /* DISPENTRY003 */
+	}
 }
 
 /*
@@ -1767,6 +2118,10 @@ udp_startrecv(isc_nmhandle_t *handle, dns_dispentry_t *resp) {
 	dispentry_log(resp, ISC_LOG_DEBUG(90), "attaching handle %p to %p",
 		      handle, &resp->handle);
 	isc_nmhandle_attach(handle, &resp->handle);
+	if (resp->dsock != NULL) {
+		udp_pool_read(resp, 0);
+		return;
+	}
 	dns_dispentry_ref(resp); /* DISPENTRY003 */
 	dispentry_log(resp, ISC_LOG_DEBUG(90), "reading");
 	isc_nm_read(resp->handle, udp_recv, resp);
@@ -1936,6 +2291,13 @@ detach:
 	dns_dispentry_detach(&resp); /* DISPENTRY004 */
 }
 
+static void
+udp_pool_connected(void *arg) {
+	dns_dispentry_t *resp = (dns_dispentry_t *)arg;
+
+	udp_connected(resp->dsock->handle, ISC_R_SUCCESS, resp);
+}
+
 static void
 udp_dispatch_connect(dns_dispatch_t *disp, dns_dispentry_t *resp) {
 	REQUIRE(disp->tid == isc_tid());
@@ -1944,6 +2306,15 @@ udp_dispatch_connect(dns_dispatch_t *disp, dns_dispentry_t *resp) {
 	dns_dispentry_ref(resp); /* DISPENTRY004 */
 	ISC_LIST_APPEND(disp->pending, resp, plink);
 
+	if (resp->dsock != NULL) {
+		/*
+		 * The shared socket is already open, but the connect
+		 * callback must not be called synchronously.
+		 */
+		isc_async_run(resp->loop, udp_pool_connected, resp);
+		return;
+	}
+
 	isc_nm_udpconnect(&resp->local, &resp->peer, udp_connected, resp,
 			  resp->timeout);
 }
@@ -2135,6 +2506,11 @@ udp_dispatch_getnext(dns_dispentry_t *resp, int64_t timeout) {
 		return;
 	}
 
+	if (resp->dsock != NULL) {
+		udp_pool_read(resp, timeout);
+		return;
+	}
+
 	if (timeout != 0) {
 		INSIST(timeout > 0 && timeout <= UINT32_MAX);
 		isc_nmhandle_settimeout(resp->handle, timeout);
@@ -2183,6 +2559,12 @@ dns_dispatch_send(dns_dispentry_t *resp, isc_region_t *r) {
 	dispentry_log(resp, ISC_LOG_DEBUG(90), "sending");
 	switch (disp->socktype) {
 	case isc_socktype_udp:
+		if (resp->dsock != NULL) {
+			dns_dispentry_ref(resp); /* DISPENTRY007 */
+			isc_nm_udpsendto(resp->dsock->handle, &resp->peer, r,
+					 send_done, resp);
+			return;
+		}
 		isc_nmhandle_attach(resp->handle, &sendhandle);
 		break;
 	case isc_socktype_tcp:
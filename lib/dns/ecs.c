@@ -94,6 +94,74 @@ dns_ecs_equals(const dns_ecs_t *ecs1, const dns_ecs_t *ecs2) {
 	return true;
 }
 
+void
+dns_ecs_fromnetaddr(dns_ecs_t *ecs, const isc_netaddr_t *addr,
+		    unsigned int source) {
+	isc_netaddr_t v4;
+	unsigned char *bytes = NULL;
+	unsigned int alen;
+
+	REQUIRE(ecs != NULL);
+	REQUIRE(addr != NULL);
+
+	if (addr->family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&addr->type.in6))
+	{
+		isc_netaddr_fromv4mapped(&v4, addr);
+		addr = &v4;
+	}
+
+	*ecs = (dns_ecs_t){ .addr = *addr };
+	ecs->addr.zone = 0;
+	switch (addr->family) {
+	case AF_INET:
+		bytes = (unsigned char *)&ecs->addr.type.in;
+		alen = 4;
+		break;
+	case AF_INET6:
+		bytes = (unsigned char *)&ecs->addr.type.in6;
+		alen = 16;
+		break;
+	default:
+		UNREACHABLE();
+	}
+
+	source = ISC_MIN(source, alen * 8);
+	ecs->source = source;
+
+	/*
+	 * Zero everything past the source prefix length.
+	 */
+	for (unsigned int i = 0; i < alen; i++) {
+		if (source >= 8) {
+			source -= 8;
+		} else {
+			bytes[i] &= (~0U << (8 - source)) & 0xff;
+			source = 0;
+		}
+	}
+}
+
+bool
+dns_ecs_covers(const dns_ecs_t *ecs, const isc_netaddr_t *addr,
+	       unsigned int prefixlen) {
+	isc_netaddr_t v4;
+
+	REQUIRE(ecs != NULL && addr != NULL);
+	REQUIRE(prefixlen <= ecs->source);
+
+	if (addr->family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&addr->type.in6))
+	{
+		isc_netaddr_fromv4mapped(&v4, addr);
+		addr = &v4;
+	}
+
+	if (addr->family != ecs->addr.family) {
+		return false;
+	}
+
+	return isc_netaddr_eqprefix(addr, &ecs->addr, prefixlen);
+}
+
 void
 dns_ecs_format(const dns_ecs_t *ecs, char *buf, size_t size) {
 	size_t len;
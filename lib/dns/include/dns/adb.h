@@ -195,6 +195,14 @@ struct dns_adbfind {
 #define DNS_ADBFIND_STATICSTUB 0x00001000
 #define DNS_ADBFIND_NOVALIDATE 0x00002000
 
+/*%
+ * The resolver flags which dns_adb_snapshot() saves: whether the server
+ * handles EDNS (0x00000004) or not (0x00000040), and the EDNS version
+ * it supports (0xff800000).  The other flags only make sense to the
+ * running resolver.
+ */
+#define DNS_ADB_SNAPSHOTFLAGS 0xff800044U
+
 /*%
  * The answers to queries come back as a list of these.
  */
@@ -424,6 +432,55 @@ dns_adb_dump(dns_adb_t *adb, FILE *f);
  *\li	f != NULL, and is a file open for writing.
  */
 
+void
+dns_adb_snapshot(dns_adb_t *adb, isc_buffer_t **bufferp, uint64_t *countp);
+/*%<
+ * Copy what the ADB has learned about the servers it knows (smoothed
+ * RTT, EDNS and UDP size state, resolver flags and fetch quota
+ * adjustments) into a newly allocated buffer, in a binary format which
+ * dns_adb_restore() reads back.  Only the DNS_ADB_SNAPSHOTFLAGS bits of
+ * the resolver flags are saved.  The number of entries copied is
+ * returned in '*countp'.
+ *
+ * No I/O is done here, so that the caller can write the buffer out
+ * from a work thread.
+ *
+ * Requires:
+ *
+ *\li	adb is valid.
+ *
+ *\li	bufferp != NULL && *bufferp == NULL.
+ *
+ *\li	countp != NULL.
+ */
+
+isc_result_t
+dns_adb_restore(dns_adb_t *adb, isc_buffer_t *buffer, uint64_t *countp);
+/*%<
+ * Restore the entries copied by dns_adb_snapshot() from the remaining
+ * region of 'buffer'.  The restored entries are kept for a while even
+ * if no name refers to them, so that they are found when the servers
+ * are looked up again.  A snapshot older than a day is ignored.  The
+ * number of entries restored is returned in '*countp'.
+ *
+ * This must be called from a loop thread.
+ *
+ * Requires:
+ *
+ *\li	adb is valid.
+ *
+ *\li	buffer is a valid buffer.
+ *
+ *\li	countp != NULL.
+ *
+ * Returns:
+ *
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOTIMPLEMENTED	the buffer is not a snapshot in a known format.
+ *\li	#ISC_R_UNEXPECTEDEND	the snapshot is truncated.
+ *\li	#ISC_R_SHUTTINGDOWN
+ */
+
 /*
  * Reasonable defaults for RTT adjustments
  *
@@ -182,6 +182,66 @@ dns_cache_getservestalerefresh(dns_cache_t *cache);
  *\li	'cache' to be valid.
  */
 
+void
+dns_cache_setsnapshotfile(dns_cache_t *cache, const char *filename);
+/*%<
+ * Set the name of the file to which dns_cache_savesnapshot() writes the
+ * contents of the cache and from which dns_cache_loadsnapshot() restores
+ * them.  A NULL 'filename' disables snapshots.
+ *
+ * Requires:
+ *\li	'cache' to be valid.
+ */
+
+bool
+dns_cache_hassnapshotfile(dns_cache_t *cache);
+/*%<
+ * Return true if a snapshot file has been set for 'cache'.
+ *
+ * Requires:
+ *\li	'cache' to be valid.
+ */
+
+isc_result_t
+dns_cache_savesnapshot(dns_cache_t *cache, uint64_t *countp);
+/*%<
+ * Write a snapshot of the cache to its snapshot file, replacing any
+ * previous snapshot atomically.  The number of rdatasets written is
+ * returned in '*countp'.
+ *
+ * Requires:
+ *\li	'cache' to be valid.
+ *\li	'countp' is not NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOTFOUND		no snapshot file is set.
+ *\li	other error returns.
+ */
+
+isc_result_t
+dns_cache_loadsnapshot(dns_cache_t *cache, unsigned int nthreads,
+		       uint64_t *countp);
+/*%<
+ * Restore the data saved by dns_cache_savesnapshot() into the cache,
+ * using up to 'nthreads' threads, and skipping data which has expired
+ * since the snapshot was written.  The number of rdatasets added is
+ * returned in '*countp'.
+ *
+ * This is intended to be called when the server starts, before it
+ * begins answering queries.
+ *
+ * Requires:
+ *\li	'cache' to be valid.
+ *\li	'countp' is not NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOTFOUND		no snapshot file is set.
+ *\li	#ISC_R_FILENOTFOUND	the snapshot file does not exist.
+ *\li	other error returns, see dns_db_loadsnapshot().
+ */
+
 isc_result_t
 dns_cache_flush(dns_cache_t *cache);
 /*%<
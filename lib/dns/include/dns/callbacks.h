@@ -49,6 +49,26 @@ struct dns_rdatacallbacks {
 	dns_transactionfunc_t setup;
 	dns_transactionfunc_t commit;
 
+	/*%
+	 * When a raw zonefile is loaded in parallel, dns_master_load*()
+	 * call 'addslab' (if defined) instead of 'add', passing the
+	 * rdataslab image of the RRset along with an rdataset that
+	 * describes it.  The image is only valid for the duration of
+	 * the call; the database must copy it.  The rdataset may carry
+	 * no rdata at all, in which case only its class, type, covers,
+	 * TTL, trust and re-signing time are meaningful.
+	 */
+	dns_addslabfunc_t addslab;
+
+	/*%
+	 * Maximum number of threads dns_master_load*() may use to decode
+	 * a large raw file when 'addslab' is set.  The records
+	 * are still handed to 'addslab' from a single thread and in file
+	 * order.  0 or 1 means the file is loaded by the calling thread
+	 * alone.
+	 */
+	unsigned int nthreads;
+
 	/*%
 	 * dns_master_load*() call this when loading a raw zonefile,
 	 * to pass back information obtained from the file header
@@ -51,6 +51,7 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 #include <isc/loop.h>
 #include <isc/magic.h>
@@ -183,6 +184,14 @@ typedef struct dns_dbmethods {
 	void (*setmaxrrperset)(dns_db_t *db, uint32_t value);
 	void (*setmaxtypepername)(dns_db_t *db, uint32_t value);
 	isc_result_t (*getzoneversion)(dns_db_t *db, isc_buffer_t *b);
+	isc_result_t (*addecsrdataset)(dns_db_t *db, dns_dbnode_t *node,
+				       isc_stdtime_t now, const dns_ecs_t *ecs,
+				       dns_rdataset_t *rdataset,
+				       unsigned int    options,
+				       dns_rdataset_t *addedrdataset DNS__DB_FLARG);
+	isc_result_t (*savesnapshot)(dns_db_t *db, FILE *fp, uint64_t *countp);
+	isc_result_t (*loadsnapshot)(dns_db_t *db, const char *filename,
+				     unsigned int nthreads, uint64_t *countp);
 } dns_dbmethods_t;
 
 typedef isc_result_t (*dns_dbcreatefunc_t)(isc_mem_t	    *mctx,
@@ -1272,6 +1281,52 @@ dns__db_addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
  *	implementation used.
  */
 
+#define dns_db_addecsrdataset(db, node, now, ecs, rdataset, options,  \
+			      addedrdataset)                           \
+	dns__db_addecsrdataset(db, node, now, ecs, rdataset, options, \
+			       addedrdataset DNS__DB_FILELINE)
+isc_result_t
+dns__db_addecsrdataset(dns_db_t *db, dns_dbnode_t *node, isc_stdtime_t now,
+		       const dns_ecs_t *ecs, dns_rdataset_t *rdataset,
+		       unsigned int		     options,
+		       dns_rdataset_t *addedrdataset DNS__DB_FLARG);
+/*%<
+ * Add 'rdataset' to 'node' of the cache database 'db', restricted to
+ * clients whose address falls within the first 'ecs->scope' bits of
+ * 'ecs->addr' (EDNS Client Subnet, RFC 7871).
+ *
+ * Notes:
+ *
+ * \li	The scoped rdataset is kept apart from the global data at 'node';
+ *	it is only returned by dns_db_findext() when the client address
+ *	supplied through the 'methods' and 'clientinfo' arguments is covered
+ *	by the prefix.  A scoped rdataset for the same type and prefix
+ *	replaces any previous one.
+ *
+ * \li	The number of prefixes stored per name may be limited by the
+ *	implementation; when the limit is reached the entry closest to
+ *	expiry is replaced.
+ *
+ * Requires:
+ *
+ * \li	'db' is a valid cache database.
+ *
+ * \li	'node' is a valid node.
+ *
+ * \li	'ecs' is not NULL and 'ecs->scope' is between 1 and 'ecs->source'.
+ *
+ * \li	'rdataset' is a valid, associated rdataset with the same class
+ *	as 'db'.
+ *
+ * \li	'addedrdataset' is NULL, or a valid, unassociated rdataset.
+ *
+ * Returns:
+ *
+ * \li	#ISC_R_SUCCESS
+ * \li	#DNS_R_UNCHANGED	The existing scoped data was better.
+ * \li	#ISC_R_NOTIMPLEMENTED	The database does not support scoped data.
+ */
+
 #define dns_db_subtractrdataset(db, node, version, rdataset, options,  \
 				newrdataset)                           \
 	dns__db_subtractrdataset(db, node, version, rdataset, options, \
@@ -1824,3 +1879,53 @@ dns_db_getzoneversion(dns_db_t *db, isc_buffer_t *b);
  *     ZONEVERSION
  * \li ISC_R_FAILURE other failures
  */
+
+isc_result_t
+dns_db_savesnapshot(dns_db_t *db, FILE *fp, uint64_t *countp);
+/*%<
+ * Write a snapshot of the contents of the cache database 'db' to 'fp',
+ * in an implementation specific binary format that can be read back by
+ * dns_db_loadsnapshot().  The number of rdatasets written is returned
+ * in '*countp'.
+ *
+ * Expired data which can no longer be served, even as stale data, is
+ * not written.
+ *
+ * Requires:
+ * \li	'db' is a valid cache database.
+ * \li	'fp' is a stream open for writing.
+ * \li	'countp' is not NULL.
+ *
+ * Returns:
+ * \li	#ISC_R_SUCCESS
+ * \li	#ISC_R_NOTIMPLEMENTED	the database does not support snapshots.
+ * \li	Other errors are possible, e.g. write errors.
+ */
+
+isc_result_t
+dns_db_loadsnapshot(dns_db_t *db, const char *filename, unsigned int nthreads,
+		    uint64_t *countp);
+/*%<
+ * Add the contents of the snapshot in 'filename', written by
+ * dns_db_savesnapshot(), to the cache database 'db', using up to
+ * 'nthreads' threads (including the calling one).  Data which has
+ * expired in the meantime is skipped; the original expiry times of the
+ * remaining data are preserved.  The number of rdatasets added is
+ * returned in '*countp'.
+ *
+ * If an error occurs, data which was already added is left in 'db'.
+ *
+ * Requires:
+ * \li	'db' is a valid cache database.
+ * \li	'filename' is not NULL.
+ * \li	'countp' is not NULL.
+ *
+ * Returns:
+ * \li	#ISC_R_SUCCESS
+ * \li	#ISC_R_FILENOTFOUND	'filename' does not exist.
+ * \li	#ISC_R_NOTIMPLEMENTED	the database does not support snapshots,
+ *				or the snapshot format is not supported.
+ * \li	#DNS_R_BADCLASS	the snapshot was written for another class.
+ * \li	#ISC_R_UNEXPECTEDEND	the snapshot is truncated.
+ * \li	#DNS_R_BADDB		the snapshot is corrupt.
+ */
@@ -195,6 +195,18 @@ dns_diff_append(dns_diff_t *diff, dns_difftuple_t **tuple);
  * \li	The tuple has been freed, or will be freed when the diff is cleared.
  */
 
+void
+dns_diff_move(dns_diff_t *target, dns_diff_t *source);
+/*%<
+ * Move all the tuples of 'source' to the end of 'target'.
+ *
+ * Requires:
+ * \li	'target' and 'source' are valid diffs.
+ *
+ * Ensures:
+ * \li	'source' is empty, but still valid.
+ */
+
 bool
 dns_diff_is_boundary(const dns_diff_t *diff, dns_name_t *name);
 /*%<
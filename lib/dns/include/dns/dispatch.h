@@ -161,6 +161,24 @@ dns_dispatchmgr_setstats(dns_dispatchmgr_t *mgr, isc_stats_t *stats);
  *	(see dns/stats.h).
  */
 
+void
+dns_dispatchmgr_setudppool(dns_dispatchmgr_t *mgr, uint32_t size);
+/*%<
+ * Sets the number of shared UDP sockets each UDP dispatch created
+ * afterwards opens for its queries.  The queries are then sent from
+ * unconnected sockets bound to random ports and shared by many
+ * concurrent queries, with the responses matched by the QID, the peer
+ * address and the port, instead of from a new connected socket per
+ * query.  Each shared socket is replaced by one with a new random port
+ * after a fixed number of queries.  If 'size' is 0 (the default), every
+ * query uses its own socket.
+ *
+ * Dispatches bound to a fixed local port always use a socket per query.
+ *
+ * Requires:
+ *\li	mgr is a valid dispatchmgr.
+ */
+
 isc_result_t
 dns_dispatch_createudp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *localaddr,
 		       dns_dispatch_t **dispp);
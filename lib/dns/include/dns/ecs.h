@@ -65,6 +65,33 @@ dns_ecs_equals(const dns_ecs_t *ecs1, const dns_ecs_t *ecs2);
  * match. Subsequent address bits and the 'scope' values are ignored.
  */
 
+void
+dns_ecs_fromnetaddr(dns_ecs_t *ecs, const isc_netaddr_t *addr,
+		    unsigned int source);
+/*%<
+ * Set 'ecs' to the prefix formed by the first 'source' bits of 'addr';
+ * the remaining address bits and the scope are set to zero.  An IPv4
+ * address mapped into IPv6 is converted to IPv4 first.  'source' is
+ * clamped to the length of the address.
+ *
+ * Requires:
+ * \li 'ecs' is not NULL.
+ * \li 'addr' is an IPv4 or IPv6 address.
+ */
+
+bool
+dns_ecs_covers(const dns_ecs_t *ecs, const isc_netaddr_t *addr,
+	       unsigned int prefixlen);
+/*%<
+ * Determine whether 'addr' falls within the first 'prefixlen' bits of
+ * the ECS address prefix.  An IPv4 address mapped into IPv6 is compared
+ * as IPv4.
+ *
+ * Requires:
+ * \li 'ecs' and 'addr' are not NULL.
+ * \li 'prefixlen' is not greater than 'ecs->source'.
+ */
+
 void
 dns_ecs_format(const dns_ecs_t *ecs, char *buf, size_t size);
 /*%<
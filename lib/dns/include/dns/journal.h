@@ -44,6 +44,7 @@
 #define DNS_JOURNAL_READ   0x00000000 /* false */
 #define DNS_JOURNAL_CREATE 0x00000001 /* true */
 #define DNS_JOURNAL_WRITE  0x00000002
+#define DNS_JOURNAL_MAP	   0x00000004
 
 #define DNS_JOURNAL_SIZE_MAX INT32_MAX
 #define DNS_JOURNAL_SIZE_MIN 4096
@@ -109,6 +110,13 @@ dns_journal_open(isc_mem_t *mctx, const char *filename, unsigned int mode,
  * the journal if it does not exist.
  * DNS_JOURNAL_WRITE open the journal for reading and writing.
  * DNS_JOURNAL_READ open the journal for reading only.
+ * DNS_JOURNAL_MAP, together with DNS_JOURNAL_READ, maps the journal into
+ * memory, so that the RRs are read without copying them from the file,
+ * and indexes the transactions as it looks for serial numbers, so that
+ * finding a serial number that was walked past is a binary search.  This is worthwhile when reading
+ * a large part of a big journal, e.g. for outgoing IXFR or rolling the
+ * journal forward; if the journal can't be mapped, it is read from the
+ * file as usual.
  */
 
 void
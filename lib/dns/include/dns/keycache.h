@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/keycache.h
+ * \brief
+ * Defines dns_keycache_t, a cache of parsed DNSKEYs.
+ *
+ * Notes:
+ *\li	Building a dst_key_t from DNSKEY rdata means decoding the public
+ *	key and constructing a crypto library key object, which is
+ *	expensive compared to the number of distinct keys a validating
+ *	resolver sees.  The key cache maps an owner name and DNSKEY
+ *	rdata to the dst_key_t built from them, so the same key can be
+ *	shared by all validations.
+ *
+ *\li	Lookups are lock-free (RCU).  The entries are spread over one
+ *	LRU list per loop; when a list holds more than its share of the
+ *	cache, its least recently used entry is evicted.  Entries that
+ *	have been found since they were last considered get a second
+ *	chance.
+ *
+ * Reliability:
+ *
+ * Resources:
+ *\li	At most 'maxkeys' keys are held.
+ *
+ * Security:
+ *
+ * Standards:
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <isc/mem.h>
+
+#include <dns/types.h>
+
+#include <dst/dst.h>
+
+/*%
+ * Default number of keys held by a view's key cache.
+ */
+#define DNS_KEYCACHE_SIZE 8192
+
+/***
+ ***	Functions
+ ***/
+
+dns_keycache_t *
+dns_keycache_new(isc_mem_t *mctx, size_t maxkeys);
+/*%
+ * Allocate and initialize a key cache holding at most 'maxkeys' keys.
+ *
+ * Requires:
+ * \li	mctx != NULL
+ * \li	maxkeys > 0
+ */
+
+void
+dns_keycache_destroy(dns_keycache_t **kcp);
+/*%
+ * Flush and then free the key cache in 'kcp'. '*kcp' is set to NULL on
+ * return.
+ *
+ * Requires:
+ * \li	'*kcp' to be a valid key cache
+ */
+
+isc_result_t
+dns_keycache_find(dns_keycache_t *kc, const dns_name_t *name,
+		  const dns_rdata_t *rdata, dst_key_t **keyp);
+/*%
+ * Look up the key built from the DNSKEY 'rdata' owned by 'name'.
+ *
+ * Requires:
+ * \li	'kc' to be a valid key cache
+ * \li	'rdata' is a DNSKEY
+ * \li	keyp != NULL && *keyp == NULL
+ *
+ * Returns:
+ * \li	ISC_R_SUCCESS	the key was found and attached to '*keyp'
+ * \li	ISC_R_NOTFOUND
+ */
+
+void
+dns_keycache_add(dns_keycache_t *kc, const dns_name_t *name,
+		 const dns_rdata_t *rdata, dst_key_t *key);
+/*%
+ * Add 'key', built from the DNSKEY 'rdata' owned by 'name', to the
+ * cache.  The cache attaches to 'key'.  If the key is already in the
+ * cache, this is a no-op.
+ *
+ * Requires:
+ * \li	'kc' to be a valid key cache
+ * \li	'rdata' is a DNSKEY
+ * \li	'key' is a valid key
+ */
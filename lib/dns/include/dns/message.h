@@ -48,8 +48,9 @@
  *
  * Notes on using the gettemp*() and puttemp*() functions:
  *
- * These functions return items (names, rdatasets, etc) allocated from some
- * internal state of the dns_message_t.
+ * These functions return items (names, rdatasets, etc) allocated from an
+ * arena owned by the dns_message_t.  The arena is released as a whole when
+ * the message is reset or destroyed, so no item may be used after that.
  *
  * Names and rdatasets must be put back into the dns_message_t in
  * one of two ways.  Assume a name was allocated via
@@ -260,7 +261,6 @@ struct dns_message {
 	unsigned int	     tkey	      : 1; /* 13 */
 	unsigned int	     rdclass_set      : 1; /* 14 */
 	unsigned int	     fuzzing	      : 1; /* 15 */
-	unsigned int	     free_pools	      : 1; /* 16 */
 	unsigned int			      : 0;
 
 	unsigned int opt_reserved;
@@ -273,16 +273,15 @@ struct dns_message {
 	isc_buffer_t   *buffer;
 	dns_compress_t *cctx;
 
-	isc_mem_t     *mctx;
-	isc_mempool_t *namepool;
-	isc_mempool_t *rdspool;
+	isc_mem_t *mctx;
 
 	isc_bufferlist_t scratchpad;
 	isc_bufferlist_t cleanup;
 
-	ISC_LIST(dns_msgblock_t) rdatas;
-	ISC_LIST(dns_msgblock_t) rdatalists;
+	ISC_LIST(dns_msgblock_t) arena;
 
+	ISC_LIST(dns_name_t) freename;
+	ISC_LIST(dns_rdataset_t) freerdataset;
 	ISC_LIST(dns_rdata_t) freerdata;
 	ISC_LIST(dns_rdatalist_t) freerdatalist;
 
@@ -324,8 +323,7 @@ typedef void (*dns_message_cb_t)(void *arg, isc_result_t result);
  ***/
 
 void
-dns_message_create(isc_mem_t *mctx, isc_mempool_t *namepool,
-		   isc_mempool_t *rdspool, dns_message_intent_t intent,
+dns_message_create(isc_mem_t *mctx, dns_message_intent_t intent,
 		   dns_message_t **msgp);
 /*%<
  * Create msg structure.
@@ -338,9 +336,6 @@ dns_message_create(isc_mem_t *mctx, isc_mempool_t *namepool,
  *
  *\li	'msgp' be non-null and '*msg' be NULL.
  *
- *\li	'namepool' and 'rdspool' must be either both NULL or both valid
- *	isc_mempool_t
- *
  *\li	'intent' must be one of DNS_MESSAGE_INTENTPARSE or
  *	#DNS_MESSAGE_INTENTRENDER.
  *
@@ -1450,9 +1445,3 @@ dns_message_response_minttl(dns_message_t *msg, dns_ttl_t *pttl);
  *\li	msg be a valid rendered message;
  *\li	'pttl != NULL'.
  */
-
-void
-dns_message_createpools(isc_mem_t *mctx, isc_mempool_t **namepoolp,
-			isc_mempool_t **rdspoolp);
-void
-dns_message_destroypools(isc_mempool_t **namepoolp, isc_mempool_t **rdspoolp);
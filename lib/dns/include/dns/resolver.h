@@ -136,6 +136,7 @@ enum {
 						 * CD=0, but retry with CD=1
 						 * if it returns SERVFAIL.
 						 */
+	DNS_FETCHOPT_WANTECS = 1 << 19,		/*%< Sent client subnet */
 
 	/*% EDNS version bits: */
 	DNS_FETCHOPT_EDNSVERSIONSET = 1 << 23,
@@ -21,7 +21,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include <isc/atomic.h>
 #include <isc/attributes.h>
+#include <isc/mutex.h>
 
 #include <dns/fixedname.h>
 #include <dns/rdata.h>
@@ -187,38 +189,28 @@ struct dns_rrl_qname_buf {
 typedef struct dns_rrl_rate dns_rrl_rate_t;
 struct dns_rrl_rate {
 	int	    r;
-	int	    scaled;
+	atomic_int  scaled;
 	const char *str;
 };
 
 /*
- * Per-view query rate limit parameters and a pointer to database.
+ * Responses are spread over several independent tables ("shards") by
+ * client address, so that responses to different clients rarely contend
+ * for the same lock.  All of the entries for one client (per-response,
+ * TCP and all-per-second) live in the same shard, so a response never
+ * takes more than one shard lock.
  */
-typedef struct dns_rrl dns_rrl_t;
-struct dns_rrl {
-	isc_mutex_t lock;
-	isc_mem_t  *mctx;
-
-	bool	       log_only;
-	dns_rrl_rate_t responses_per_second;
-	dns_rrl_rate_t referrals_per_second;
-	dns_rrl_rate_t nodata_per_second;
-	dns_rrl_rate_t nxdomains_per_second;
-	dns_rrl_rate_t errors_per_second;
-	dns_rrl_rate_t all_per_second;
-	dns_rrl_rate_t slip;
-	int	       window;
-	double	       qps_scale;
-	int	       max_entries;
+#define DNS_RRL_SHARDS_PER_LOOP 4
+#define DNS_RRL_MAX_SHARDS	256
 
-	dns_acl_t *exempt;
+typedef struct dns_rrl	    dns_rrl_t;
+typedef struct dns_rrl_shard dns_rrl_shard_t;
+struct dns_rrl_shard {
+	isc_mutex_t lock;
+	dns_rrl_t  *rrl;
 
 	int num_entries;
 
-	int	      qps_responses;
-	isc_stdtime_t qps_time;
-	double	      qps;
-
 	unsigned int probes;
 	unsigned int searches;
 
@@ -233,11 +225,6 @@ struct dns_rrl {
 #define DNS_RRL_TS_BASES (1 << DNS_RRL_TS_GEN_BITS)
 	isc_stdtime_t ts_bases[DNS_RRL_TS_BASES];
 
-	int	 ipv4_prefixlen;
-	uint32_t ipv4_mask;
-	int	 ipv6_prefixlen;
-	uint32_t ipv6_mask[4];
-
 	isc_stdtime_t	 log_stops_time;
 	dns_rrl_entry_t *last_logged;
 	int		 num_logged;
@@ -245,6 +232,53 @@ struct dns_rrl {
 	ISC_LIST(dns_rrl_qname_buf_t) qname_free;
 #define DNS_RRL_QNAMES (1 << DNS_RRL_QNAMES_BITS)
 	dns_rrl_qname_buf_t *qnames[DNS_RRL_QNAMES];
+
+	/*
+	 * Statistics, protected by 'lock'.
+	 */
+	uint64_t lookups;
+	uint64_t contended;
+};
+
+/*
+ * Per-view query rate limit parameters and a pointer to database.
+ */
+struct dns_rrl {
+	isc_mem_t *mctx;
+
+	bool	       log_only;
+	dns_rrl_rate_t responses_per_second;
+	dns_rrl_rate_t referrals_per_second;
+	dns_rrl_rate_t nodata_per_second;
+	dns_rrl_rate_t nxdomains_per_second;
+	dns_rrl_rate_t errors_per_second;
+	dns_rrl_rate_t all_per_second;
+	dns_rrl_rate_t slip;
+	int	       window;
+	double	       qps_scale;
+	int	       max_entries;
+
+	/*
+	 * The view-wide response rate for "qps-scale".  Every shard counts
+	 * its responses here without taking a lock.  The scaled limits in
+	 * the dns_rrl_rate_t structures are recomputed from this rate at
+	 * most once a second, by the first response of that second.
+	 */
+	atomic_uint_fast32_t qps_responses;
+	atomic_uint_fast32_t qps_time;
+	atomic_uint_fast32_t qps;	 /*%< rate of the last full window */
+	atomic_uint_fast32_t scale_time; /*%< when the limits were scaled */
+	atomic_bool	     scaled;	 /*%< the limits are scaled down */
+
+	dns_acl_t *exempt;
+
+	int	 ipv4_prefixlen;
+	uint32_t ipv4_mask;
+	int	 ipv6_prefixlen;
+	uint32_t ipv6_mask[4];
+
+	unsigned int	 nshards;
+	dns_rrl_shard_t *shards;
 };
 
 typedef enum {
@@ -264,3 +298,20 @@ dns_rrl_view_destroy(dns_view_t *view);
 
 isc_result_t
 dns_rrl_init(dns_rrl_t **rrlp, dns_view_t *view, int min_entries);
+
+#ifdef HAVE_LIBXML2
+int
+dns_rrl_renderxml(dns_rrl_t *rrl, void *writer0);
+/*
+ * Render rate limit table statistics, including how evenly the
+ * responses are spread over the shards, in XML for 'writer'.
+ */
+#endif /* HAVE_LIBXML2 */
+
+#ifdef HAVE_JSON_C
+isc_result_t
+dns_rrl_renderjson(dns_rrl_t *rrl, void *rstats0);
+/*
+ * Render rate limit table statistics in JSON.
+ */
+#endif /* HAVE_JSON_C */
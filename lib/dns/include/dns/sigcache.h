@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/sigcache.h
+ * \brief
+ * Defines dns_sigcache_t, a cache of successful signature verifications.
+ *
+ * Notes:
+ *\li	The same RRset and RRSIG are verified again whenever they are
+ *	fetched again after their TTL expired, or by different fetches.
+ *	The signature cache remembers that the RRSIG has been verified
+ *	with a DNSKEY over an RRset, so the public key operation doesn't
+ *	have to be repeated while the RRSIG is temporally valid.
+ *
+ *\li	The entries are identified by a SHA-256 digest of the RRset in
+ *	canonical order, the full RRSIG rdata, and the DNSKEY, so a
+ *	verification is only reused for exactly the same data.
+ *
+ *\li	Lookups are lock-free (RCU).  The entries are spread over one
+ *	LRU list per loop; when a list holds more than its share of the
+ *	cache, its least recently used entry is evicted.  Entries that
+ *	have been found since they were last considered get a second
+ *	chance.
+ *
+ * Reliability:
+ *
+ * Resources:
+ *\li	At most 'maxentries' verifications are held.
+ *
+ * Security:
+ *\li	Only successful verifications are cached, and a cached
+ *	verification is ignored outside of the RRSIG validity period.
+ *
+ * Standards:
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <isc/mem.h>
+#include <isc/stdtime.h>
+
+#include <dns/types.h>
+
+#include <dst/dst.h>
+
+/*%
+ * Default number of verifications held by a view's signature cache.
+ */
+#define DNS_SIGCACHE_SIZE 16384
+
+#define DNS_SIGCACHE_DIGESTLEN 32 /* SHA-256 */
+
+/*%
+ * Identifies a verification of an RRSIG over an RRset with a DNSKEY.
+ */
+typedef struct dns_sigcachekey {
+	uint8_t	 digest[DNS_SIGCACHE_DIGESTLEN];
+	uint32_t timesigned;
+	uint32_t timeexpire;
+} dns_sigcachekey_t;
+
+/***
+ ***	Functions
+ ***/
+
+dns_sigcache_t *
+dns_sigcache_new(isc_mem_t *mctx, size_t maxentries);
+/*%
+ * Allocate and initialize a signature cache holding at most 'maxentries'
+ * verifications.
+ *
+ * Requires:
+ * \li	mctx != NULL
+ * \li	maxentries > 0
+ */
+
+void
+dns_sigcache_destroy(dns_sigcache_t **scp);
+/*%
+ * Flush and then free the signature cache in 'scp'. '*scp' is set to
+ * NULL on return.
+ *
+ * Requires:
+ * \li	'*scp' to be a valid signature cache
+ */
+
+isc_result_t
+dns_sigcache_key(const dns_name_t *name, dns_rdataset_t *rdataset,
+		 dst_key_t *key, dns_rdata_t *sigrdata, isc_mem_t *mctx,
+		 dns_sigcachekey_t *skey);
+/*%
+ * Compute the key identifying the verification of the RRSIG 'sigrdata'
+ * over 'rdataset' owned by 'name' with 'key'.
+ *
+ * Requires:
+ * \li	'name', 'rdataset', 'key' and 'skey' are not NULL
+ * \li	'rdataset' is associated and not empty
+ * \li	'sigrdata' is an RRSIG
+ *
+ * Returns:
+ * \li	ISC_R_SUCCESS
+ * \li	any error from converting the key or the RRSIG
+ */
+
+isc_result_t
+dns_sigcache_find(dns_sigcache_t *sc, const dns_sigcachekey_t *skey,
+		  isc_stdtime_t now, dns_name_t *wild);
+/*%
+ * Look up the verification identified by 'skey'.  If the RRSIG was
+ * generated by wildcard expansion, the wildcard name is copied to
+ * 'wild', as dns_dnssec_verify() would.
+ *
+ * Requires:
+ * \li	'sc' to be a valid signature cache
+ * \li	'skey' is not NULL
+ *
+ * Returns:
+ * \li	ISC_R_SUCCESS		the RRSIG has been verified
+ * \li	DNS_R_FROMWILDCARD	the RRSIG has been verified, and was
+ *				generated by wildcard expansion
+ * \li	ISC_R_NOTFOUND		the RRSIG has not been verified, or is
+ *				not temporally valid at 'now'
+ */
+
+void
+dns_sigcache_add(dns_sigcache_t *sc, const dns_sigcachekey_t *skey,
+		 isc_result_t result, const dns_name_t *wild);
+/*%
+ * Remember that the verification identified by 'skey' succeeded with
+ * 'result'; if 'result' is DNS_R_FROMWILDCARD, 'wild' is the wildcard
+ * name.  If the verification is already in the cache, this is a no-op.
+ *
+ * Requires:
+ * \li	'sc' to be a valid signature cache
+ * \li	'skey' is not NULL
+ * \li	'result' is ISC_R_SUCCESS or DNS_R_FROMWILDCARD
+ * \li	'wild' is not NULL if 'result' is DNS_R_FROMWILDCARD
+ */
@@ -75,7 +75,15 @@ enum {
 	dns_resstatscounter_nextitem = 44,
 	dns_resstatscounter_priming = 45,
 	dns_resstatscounter_forwardonlyfail = 46,
-	dns_resstatscounter_max = 47,
+	dns_resstatscounter_ecsout = 47,
+	dns_resstatscounter_ecsscoped = 48,
+	dns_resstatscounter_ecsmismatch = 49,
+	dns_resstatscounter_lockcontended = 50,
+	dns_resstatscounter_keycachehit = 51,
+	dns_resstatscounter_keycachemiss = 52,
+	dns_resstatscounter_sigcachehit = 53,
+	dns_resstatscounter_sigcachemiss = 54,
+	dns_resstatscounter_max = 55,
 
 	/*
 	 * DNSSEC stats.
@@ -103,8 +111,10 @@ enum {
 	dns_zonestatscounter_ixfrreqv6 = 10,
 	dns_zonestatscounter_xfrsuccess = 11,
 	dns_zonestatscounter_xfrfail = 12,
+	dns_zonestatscounter_sigsgenerated = 13,
+	dns_zonestatscounter_sigsoffloaded = 14,
 
-	dns_zonestatscounter_max = 13,
+	dns_zonestatscounter_max = 15,
 
 	/*
 	 * Adb statistics values.
@@ -203,6 +213,25 @@ enum {
 	dns_sizecounter_out_max = DNS_SIZEHISTO_MAXOUT + 1,
 };
 
+/*%
+ * Query latency statistics, kept per view: the time in microseconds
+ * from the receipt of a request to the sending of its response.  The
+ * histograms are indexed by the transport the request arrived on (a
+ * dns_transport_type_t) and by how the response was produced.
+ *
+ * Four significant bits give a relative error of about 6%, which is
+ * plenty for percentiles.
+ */
+enum {
+	dns_latencyoutcome_cache = 0,
+	dns_latencyoutcome_auth = 1,
+	dns_latencyoutcome_recursion = 2,
+
+	dns_latencyoutcome_max = 3,
+};
+
+#define DNS_LATENCYHISTO_SIGBITS 4
+
 /*%
  * Attributes for statistics counters of RRset and Rdatatype types.
  *
@@ -282,6 +311,20 @@ dns_rdatatypestats_create(isc_mem_t *mctx, dns_stats_t **statsp);
  *\li	'statsp' != NULL && '*statsp' == NULL.
  */
 
+void
+dns_rdatatypestats_create_perloop(isc_mem_t *mctx, dns_stats_t **statsp);
+/*%<
+ * Like dns_rdatatypestats_create(), but the counters are counted per loop
+ * (see isc_stats_create_perloop()).  This is meant for the server-wide
+ * statistics, which are updated for every query; the per-zone and per-view
+ * ones are many and rarely contended, and stay shared.
+ *
+ * Requires:
+ *\li	'mctx' must be a valid memory context.
+ *
+ *\li	'statsp' != NULL && '*statsp' == NULL.
+ */
+
 void
 dns_rdatasetstats_create(isc_mem_t *mctx, dns_stats_t **statsp);
 /*%<
@@ -296,7 +339,9 @@ dns_rdatasetstats_create(isc_mem_t *mctx, dns_stats_t **statsp);
 void
 dns_opcodestats_create(isc_mem_t *mctx, dns_stats_t **statsp);
 /*%<
- * Create a statistics counter structure per opcode.
+ * Create a statistics counter structure per opcode.  The counters are
+ * counted per loop (see isc_stats_create_perloop()), so this is meant for
+ * the server-wide statistics.
  *
  * Requires:
  *\li	'mctx' must be a valid memory context.
@@ -307,7 +352,9 @@ dns_opcodestats_create(isc_mem_t *mctx, dns_stats_t **statsp);
 void
 dns_rcodestats_create(isc_mem_t *mctx, dns_stats_t **statsp);
 /*%<
- * Create a statistics counter structure per assigned rcode.
+ * Create a statistics counter structure per assigned rcode.  The counters are
+ * counted per loop (see isc_stats_create_perloop()), so this is meant for
+ * the server-wide statistics.
  *
  * Requires:
  *\li	'mctx' must be a valid memory context.
@@ -107,6 +107,7 @@ typedef struct dns_kasp_key dns_kasp_key_t;
 typedef ISC_LIST(dns_kasp_key_t) dns_kasp_keylist_t;
 typedef struct dns_kasp_nsec3param dns_kasp_nsec3param_t;
 typedef uint16_t		   dns_keyflags_t;
+typedef struct dns_keycache	   dns_keycache_t;
 typedef struct dns_keynode	   dns_keynode_t;
 typedef ISC_LIST(dns_keynode_t) dns_keynodelist_t;
 typedef struct dns_keytable dns_keytable_t;
@@ -152,6 +153,7 @@ typedef struct dns_resolver	   dns_resolver_t;
 typedef struct dns_qpnode	   dns_qpnode_t;
 typedef uint8_t			   dns_secalg_t;
 typedef uint8_t			   dns_secproto_t;
+typedef struct dns_sigcache	   dns_sigcache_t;
 typedef struct dns_signature	   dns_signature_t;
 typedef struct dns_skr		   dns_skr_t;
 typedef struct dns_slabheader	   dns_slabheader_t;
@@ -171,6 +173,7 @@ typedef uint32_t		  dns_typepair_t;
 typedef struct dns_unreachcache	  dns_unreachcache_t;
 typedef struct dns_update_state	  dns_update_state_t;
 typedef struct dns_validator	  dns_validator_t;
+typedef struct dns_verifyqueue	  dns_verifyqueue_t;
 typedef struct dns_view		  dns_view_t;
 typedef ISC_LIST(dns_view_t) dns_viewlist_t;
 typedef struct dns_zone dns_zone_t;
@@ -434,6 +437,9 @@ typedef isc_result_t (*dns_addrdatasetfunc_t)(void *arg, const dns_name_t *name,
 					      dns_rdataset_t *rdataset
 						      DNS__DB_FLARG);
 typedef void (*dns_transactionfunc_t)(void *arg);
+typedef isc_result_t (*dns_addslabfunc_t)(
+	void *arg, const dns_name_t *name, dns_rdataset_t *rdataset,
+	const isc_region_t *slab DNS__DB_FLARG);
 
 typedef isc_result_t (*dns_additionaldatafunc_t)(
 	void *arg, const dns_name_t *name, dns_rdatatype_t type,
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/verifyqueue.h
+ * \brief
+ * Defines dns_verifyqueue_t, a queue of signature verification jobs
+ * shared by all the validators of a view.
+ *
+ * Notes:
+ *\li	The validators hand the signature verifications over to the
+ *	helper threads, so the network loops don't stall on expensive
+ *	public key operations.  Without a shared queue, each job runs on
+ *	the helper of the loop that started the validation, even when
+ *	that helper is still busy with a slow (e.g. RSA-4096) verification
+ *	and the helpers of other loops are idle.
+ *
+ *\li	The verify queue collects the jobs from all the validators and
+ *	lets every helper serve them.  A helper takes a batch of jobs at a
+ *	time and runs them back to back, until it finds the queue empty;
+ *	a helper is only woken up when it isn't serving the queue already,
+ *	so under load the helpers are not woken up for every job.
+ *
+ *\li	The number of queued jobs and the time they spend in the queue
+ *	are available for the statistics.
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <isc/histo.h>
+#include <isc/job.h>
+#include <isc/mem.h>
+#include <isc/refcount.h>
+#include <isc/tid.h>
+
+#include <dns/types.h>
+
+/*%
+ * The most jobs a helper takes from the queue at a time.
+ */
+#define DNS_VERIFYQUEUE_BATCH 16
+
+/***
+ ***	Functions
+ ***/
+
+dns_verifyqueue_t *
+dns_verifyqueue_new(isc_mem_t *mctx);
+/*%
+ * Create a verify queue served by the helpers of all the loops.
+ *
+ * Requires:
+ * \li	mctx != NULL
+ * \li	the loop manager has been created
+ */
+
+ISC_REFCOUNT_DECL(dns_verifyqueue);
+
+void
+dns_verifyqueue_run(dns_verifyqueue_t *vq, isc_tid_t tid, isc_job_cb cb,
+		    void *cbarg);
+/*%
+ * Queue the job 'cb(cbarg)' to run on one of the helper threads,
+ * preferably the helper of the loop 'tid'.  As with isc_helper_run(),
+ * the job must pass its results back to the loop with isc_async_run().
+ *
+ * Requires:
+ * \li	'vq' is a valid verify queue
+ * \li	'tid' is a valid loop thread id
+ * \li	cb != NULL
+ */
+
+size_t
+dns_verifyqueue_depth(dns_verifyqueue_t *vq);
+/*%
+ * Return the number of jobs waiting in the queue.
+ *
+ * Requires:
+ * \li	'vq' is a valid verify queue
+ */
+
+void
+dns_verifyqueue_latency(dns_verifyqueue_t *vq, isc_histo_t **hgp);
+/*%
+ * Add the time the jobs have waited in the queue, in microseconds, to
+ * the histogram '*hgp', creating it if '*hgp' is NULL.
+ *
+ * Requires:
+ * \li	'vq' is a valid verify queue
+ * \li	hgp != NULL
+ */
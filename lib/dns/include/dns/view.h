@@ -73,6 +73,7 @@
 #include <dns/rdatastruct.h>
 #include <dns/rpz.h>
 #include <dns/rrl.h>
+#include <dns/stats.h>
 #include <dns/transport.h>
 #include <dns/types.h>
 #include <dns/zt.h>
@@ -141,6 +142,7 @@ struct dns_view {
 	dns_nametree_t	     *answeracl_exclude;
 	dns_nametree_t	     *denyanswernames;
 	dns_nametree_t	     *answernames_exclude;
+	dns_nametree_t	     *ecszones;
 	dns_nametree_t	     *sfd;
 	dns_rrl_t	     *rrl;
 	bool		      provideixfr;
@@ -154,6 +156,7 @@ struct dns_view {
 	uint32_t	      nta_lifetime;
 	uint32_t	      nta_recheck;
 	char		     *nta_file;
+	char		     *adb_file;
 	dns_ttl_t	      prefetch_trigger;
 	dns_ttl_t	      prefetch_eligible;
 	in_port_t	      dstport;
@@ -179,6 +182,9 @@ struct dns_view {
 	uint32_t	      fail_ttl;
 	dns_badcache_t	     *failcache;
 	dns_unreachcache_t   *unreachcache;
+	dns_keycache_t	     *keycache;
+	dns_sigcache_t	     *sigcache;
+	dns_verifyqueue_t    *verifyqueue;
 	unsigned int	      udpsize;
 	uint32_t	      sig0key_checks_limit;
 	uint32_t	      sig0message_checks_limit;
@@ -240,6 +246,10 @@ struct dns_view {
 	/* Hook table */
 	void *hooktable; /* ns_hooktable */
 	void (*hooktable_free)(isc_mem_t *, void **);
+
+	/* Query latency histograms, see dns/stats.h */
+	isc_histomulti_t *latencystats[DNS_TRANSPORT_COUNT]
+				      [dns_latencyoutcome_max];
 };
 
 #define DNS_VIEW_MAGIC	     ISC_MAGIC('V', 'i', 'e', 'w')
@@ -1145,6 +1155,37 @@ dns_view_loadnta(dns_view_t *view);
  *\li	'view' to be valid.
  */
 
+isc_result_t
+dns_view_saveadb(dns_view_t *view, isc_buffer_t *snapshot);
+/*%<
+ * Write 'snapshot', copied from the view's address database by
+ * dns_adb_snapshot(), to the view's ADB snapshot file, replacing the
+ * previous snapshot atomically.  This does blocking I/O and can be
+ * called from a work thread.
+ *
+ * Requires:
+ *\li	'view' to be valid.
+ *\li	'snapshot' to be a valid buffer.
+ */
+
+isc_result_t
+dns_view_readadb(dns_view_t *view, isc_buffer_t **bufferp);
+/*%<
+ * Read the snapshot written by dns_view_saveadb() into a newly
+ * allocated buffer, for dns_adb_restore().  This does blocking I/O
+ * and can be called from a work thread.
+ *
+ * Requires:
+ *\li	'view' to be valid.
+ *\li	'bufferp' is not NULL and '*bufferp' is NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_FILENOTFOUND	there is no snapshot file.
+ *\li	#ISC_R_RANGE		the snapshot file is empty or too large.
+ *\li	other error returns.
+ */
+
 void
 dns_view_setviewcommit(dns_view_t *view);
 /*%<
@@ -1309,6 +1350,31 @@ dns_view_getadb(dns_view_t *view, dns_adb_t **adbp);
  *\li	'adbp' is non-NULL and '*adbp' is NULL.
  */
 
+void
+dns_view_createlatencystats(dns_view_t *view);
+/*%<
+ * Create the view's query latency histograms, one for each transport
+ * and outcome (see dns/stats.h).  Until this is called, latencies are
+ * not recorded.
+ *
+ * Requires:
+ *
+ *\li	'view' is a valid view without latency histograms.
+ */
+
+void
+dns_view_latency(dns_view_t *view, dns_transport_type_t transport,
+		 unsigned int outcome, uint64_t usecs);
+/*%<
+ * Record a query on 'transport' that was answered in 'usecs'
+ * microseconds with the given 'outcome' (a dns_latencyoutcome_t value).
+ *
+ * Requires:
+ *
+ *\li	'view' is a valid view.
+ *\li	'outcome' is less than dns_latencyoutcome_max.
+ */
+
 void
 dns_view_setmaxrestarts(dns_view_t *view, uint8_t max_restarts);
 /*%<
@@ -140,7 +140,9 @@ dns_xfrin_getendserial(dns_xfrin_t *xfr);
 
 void
 dns_xfrin_getstats(dns_xfrin_t *xfr, unsigned int *nmsgp, unsigned int *nrecsp,
-		   uint64_t *nbytesp, uint64_t *ratep);
+		   uint64_t *nbytesp, uint64_t *ratep, unsigned int *nappliedp,
+		   uint64_t *parseratep, uint64_t *applyratep,
+		   unsigned int *queuedp);
 /*%<
  * Get various statistics values of the xfrin object: number of the received
  * messages, number of the received records, number of the received bytes,
@@ -148,6 +150,13 @@ dns_xfrin_getstats(dns_xfrin_t *xfr, unsigned int *nmsgp, unsigned int *nrecsp,
  * 'min-transfer-rate-in <bytes> <minutes>' minutes interval. If no such
  * interval has passed yet, then the overall average rate is reported instead.
  *
+ * The throughput of each stage of the transfer is reported as well: the
+ * number of records applied to the database, the rates (in
+ * records-per-second of the time spent in each stage) at which the
+ * records are parsed from the responses and applied to the database, and
+ * the number of batches of records waiting to be applied.  The optional
+ * pointers can be NULL.
+ *
  * Requires:
  *\li	'xfr' is a valid dns_xfrin_t.
  *
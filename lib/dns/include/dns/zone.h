@@ -140,6 +140,8 @@ typedef enum {
 	    * exponential backoff */
 #endif	   /* ifndef DNS_ZONE_DEFAULTRETRY */
 
+#define DNS_ZONE_MAXSIGNTHREADS 128 /*%< see dns_zone_setsignthreads() */
+
 /***
  ***	Functions
  ***/
@@ -2186,6 +2188,23 @@ dns_zone_getsignatures(dns_zone_t *zone);
  * Get the number of signatures that will be generated per quantum.
  */
 
+void
+dns_zone_setsignthreads(dns_zone_t *zone, uint32_t threads);
+/*%<
+ * Set the number of threads computing signatures when signing the zone
+ * incrementally with a new key.  With more than one, the signatures of a
+ * quantum are computed by up to 'threads' helpers from the isc_work thread
+ * pool after the quantum is committed, and added by the next quantum.
+ * Each quantum is scaled up by 'threads'.  The value is clamped to
+ * 1..DNS_ZONE_MAXSIGNTHREADS.
+ */
+
+uint32_t
+dns_zone_getsignthreads(dns_zone_t *zone);
+/*%<
+ * Get the number of threads computing signatures.
+ */
+
 isc_result_t
 dns_zone_signwithkey(dns_zone_t *zone, dst_algorithm_t algorithm,
 		     uint16_t keyid, bool deleteit);
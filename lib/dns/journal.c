@@ -17,7 +17,10 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <sys/mman.h>
+
 #include <isc/dir.h>
+#include <isc/errno.h>
 #include <isc/file.h>
 #include <isc/log.h>
 #include <isc/mem.h>
@@ -101,9 +104,22 @@
 
 #define JOURNAL_SERIALSET 0x01U
 
+/*%
+ * dns_journal_rollforward() applies the journal to the database in
+ * batches of this many RRs; dns_diff_apply() groups the consecutive
+ * RRs of the same name and type, so larger batches mean fewer database
+ * node lookups and rdataset merges.
+ */
+#define JOURNAL_ROLLFORWARD_BATCH 1024
+
 static isc_result_t
 index_to_disk(dns_journal_t *);
 
+static void
+journal_map(dns_journal_t *);
+static void
+journal_unmap(dns_journal_t *);
+
 static uint32_t
 decode_uint32(unsigned char *p) {
 	return ((uint32_t)p[0] << 24) + ((uint32_t)p[1] << 16) +
@@ -329,6 +345,12 @@ struct dns_journal {
 	unsigned char *rawindex;     /*%< In-core buffer for journal index
 				      * in on-disk format */
 	journal_pos_t *index;	     /*%< In-core journal index */
+	unsigned char *map;	     /*%< Journal file mapped in memory */
+	size_t maplen;		     /*%< Length of the mapping */
+	journal_pos_t *xindex;	     /*%< Positions of the transactions
+				      *   found in the mapped journal */
+	unsigned int xindex_count;   /*%< Number of positions in it */
+	unsigned int xindex_alloc;   /*%< Allocated size of it */
 
 	/*% Current transaction state (when writing). */
 	struct {
@@ -409,6 +431,18 @@ static isc_result_t
 journal_seek(dns_journal_t *j, uint32_t offset) {
 	isc_result_t result;
 
+	if (j->map != NULL) {
+		if (offset > j->maplen) {
+			isc_log_write(DNS_LOGCATEGORY_GENERAL,
+				      DNS_LOGMODULE_JOURNAL, ISC_LOG_ERROR,
+				      "%s: seek: offset %u beyond end of file",
+				      j->filename, offset);
+			return ISC_R_UNEXPECTED;
+		}
+		j->offset = offset;
+		return ISC_R_SUCCESS;
+	}
+
 	result = isc_stdio_seek(j->fp, (off_t)offset, SEEK_SET);
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(DNS_LOGCATEGORY_GENERAL, DNS_LOGMODULE_JOURNAL,
@@ -420,10 +454,38 @@ journal_seek(dns_journal_t *j, uint32_t offset) {
 	return ISC_R_SUCCESS;
 }
 
+/*
+ * Point '*basep' at the next 'nbytes' of the mapped journal 'j', and
+ * advance the file offset past them.
+ */
+static isc_result_t
+journal_read_map(dns_journal_t *j, size_t nbytes, unsigned char **basep) {
+	REQUIRE(j->map != NULL);
+
+	if (j->offset < 0 || (size_t)j->offset > j->maplen ||
+	    nbytes > j->maplen - (size_t)j->offset)
+	{
+		return ISC_R_NOMORE;
+	}
+	*basep = j->map + j->offset;
+	j->offset += (off_t)nbytes;
+	return ISC_R_SUCCESS;
+}
+
 static isc_result_t
 journal_read(dns_journal_t *j, void *mem, size_t nbytes) {
 	isc_result_t result;
 
+	if (j->map != NULL) {
+		unsigned char *base = NULL;
+
+		result = journal_read_map(j, nbytes, &base);
+		if (result == ISC_R_SUCCESS) {
+			memmove(mem, base, nbytes);
+		}
+		return result;
+	}
+
 	result = isc_stdio_read(mem, 1, nbytes, j->fp, NULL);
 	if (result != ISC_R_SUCCESS) {
 		if (result == ISC_R_EOF) {
@@ -769,6 +831,8 @@ dns_journal_open(isc_mem_t *mctx, const char *filename, unsigned int mode,
 	create = ((mode & DNS_JOURNAL_CREATE) != 0);
 	writable = ((mode & (DNS_JOURNAL_WRITE | DNS_JOURNAL_CREATE)) != 0);
 
+	REQUIRE(!writable || (mode & DNS_JOURNAL_MAP) == 0);
+
 	result = journal_open(mctx, filename, writable, create, false,
 			      journalp);
 	if (result == ISC_R_NOTFOUND) {
@@ -786,6 +850,9 @@ dns_journal_open(isc_mem_t *mctx, const char *filename, unsigned int mode,
 		result = journal_open(mctx, backup, writable, writable, false,
 				      journalp);
 	}
+	if (result == ISC_R_SUCCESS && (mode & DNS_JOURNAL_MAP) != 0) {
+		journal_map(*journalp);
+	}
 	return result;
 }
 
@@ -1094,6 +1161,171 @@ index_invalidate(dns_journal_t *j, uint32_t serial) {
 	}
 }
 
+/*
+ * The index of the mapped journal 'j' holds the position of every
+ * transaction that journal_find() has walked past, sorted by offset
+ * (and so by serial number).  If it contains an entry "better" than
+ * '*best_guess', replace '*best_guess' with it, as index_find() does:
+ * the best one is found by binary search, and it is the closest
+ * known transaction at or before the one with the initial serial
+ * number 'serial'.
+ */
+static void
+xindex_find(dns_journal_t *j, uint32_t serial, journal_pos_t *best_guess) {
+	unsigned int lo = 0, hi;
+
+	if (j->xindex == NULL) {
+		return;
+	}
+
+	hi = j->xindex_count;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (DNS_SERIAL_GE(serial, j->xindex[mid].serial)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo > 0 &&
+	    DNS_SERIAL_GT(j->xindex[lo - 1].serial, best_guess->serial))
+	{
+		*best_guess = j->xindex[lo - 1];
+	}
+}
+
+/*
+ * Append the position of a transaction walked past by journal_find()
+ * to the index of the mapped journal 'j'; xindex_merge() puts it in
+ * order once the walk is over.
+ */
+static void
+xindex_append(dns_journal_t *j, const journal_pos_t *pos) {
+	if (j->map == NULL) {
+		return;
+	}
+
+	if (j->xindex_count == j->xindex_alloc) {
+		unsigned int alloc = ISC_MAX(64, 2 * j->xindex_alloc);
+		j->xindex = isc_mem_creget(j->mctx, j->xindex, j->xindex_alloc,
+					   alloc, sizeof(j->xindex[0]));
+		j->xindex_alloc = alloc;
+	}
+	j->xindex[j->xindex_count++] = *pos;
+}
+
+static void
+xindex_reverse(journal_pos_t *pos, unsigned int n) {
+	for (unsigned int i = 0; i < n / 2; i++) {
+		journal_pos_t tmp = pos[i];
+		pos[i] = pos[n - 1 - i];
+		pos[n - 1 - i] = tmp;
+	}
+}
+
+/*
+ * Move the run of positions appended to the index of 'j' since it held
+ * 'sorted' of them to its place.  The run is a walk between two known
+ * transactions, so none of it is already in the index and it all goes
+ * in the same place: the run and the positions following that place
+ * are swapped by reversing both, then the whole tail.
+ */
+static void
+xindex_merge(dns_journal_t *j, unsigned int sorted) {
+	unsigned int lo = 0, hi = sorted;
+	uint32_t offset;
+
+	if (sorted == j->xindex_count) {
+		return;
+	}
+
+	offset = j->xindex[sorted].offset;
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (j->xindex[mid].offset < offset) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	if (lo == sorted) {
+		return;
+	}
+
+	xindex_reverse(j->xindex + lo, sorted - lo);
+	xindex_reverse(j->xindex + sorted, j->xindex_count - sorted);
+	xindex_reverse(j->xindex + lo, j->xindex_count - lo);
+}
+
+/*
+ * Map the journal 'j', opened for reading, into memory.  The
+ * transaction and RR headers are then read from the mapping instead
+ * of with a read(2) per header, and the RR data is parsed in place.
+ * The transactions are indexed as journal_find() walks past them, so
+ * that it doesn't have to walk them again from the closest entry of
+ * the on-disk index, which only covers a few of them.
+ *
+ * Mapping is an optimization: if it fails, the journal is read from
+ * the file as usual.
+ */
+static void
+journal_map(dns_journal_t *j) {
+	isc_result_t result;
+	off_t size;
+	void *base = NULL;
+
+	REQUIRE(j->state == JOURNAL_STATE_READ);
+	INSIST(j->map == NULL);
+
+	if (JOURNAL_EMPTY(&j->header)) {
+		return;
+	}
+
+	result = isc_file_getsizefd(fileno(j->fp), &size);
+	if (result != ISC_R_SUCCESS) {
+		goto failure;
+	}
+	if ((uintmax_t)size > SIZE_MAX || size < j->header.end.offset) {
+		CHECK(ISC_R_RANGE);
+	}
+
+	base = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fileno(j->fp),
+		    0);
+	if (base == MAP_FAILED) {
+		CHECK(isc_errno_toresult(errno));
+	}
+
+	j->map = base;
+	j->maplen = (size_t)size;
+
+	isc_log_write(DNS_LOGCATEGORY_GENERAL, DNS_LOGMODULE_JOURNAL,
+		      ISC_LOG_DEBUG(3), "%s: mapped %zu bytes", j->filename,
+		      j->maplen);
+	return;
+
+failure:
+	isc_log_write(DNS_LOGCATEGORY_GENERAL, DNS_LOGMODULE_JOURNAL,
+		      ISC_LOG_DEBUG(1), "%s: not mapping journal: %s",
+		      j->filename, isc_result_totext(result));
+	journal_unmap(j);
+}
+
+static void
+journal_unmap(dns_journal_t *j) {
+	if (j->xindex != NULL) {
+		isc_mem_cput(j->mctx, j->xindex, j->xindex_alloc,
+			     sizeof(j->xindex[0]));
+		j->xindex_count = 0;
+		j->xindex_alloc = 0;
+	}
+	if (j->map != NULL) {
+		RUNTIME_CHECK(munmap(j->map, j->maplen) == 0);
+		j->map = NULL;
+		j->maplen = 0;
+	}
+	j->offset = -1; /* Invalid, must seek explicitly. */
+}
+
 /*
  * Try to find a transaction with initial serial number 'serial'
  * in the journal 'j'.
@@ -1117,6 +1349,7 @@ static isc_result_t
 journal_find(dns_journal_t *j, uint32_t serial, journal_pos_t *pos) {
 	isc_result_t result;
 	journal_pos_t current_pos;
+	unsigned int sorted;
 
 	REQUIRE(DNS_JOURNAL_VALID(j));
 
@@ -1133,16 +1366,28 @@ journal_find(dns_journal_t *j, uint32_t serial, journal_pos_t *pos) {
 
 	current_pos = j->header.begin;
 	index_find(j, serial, &current_pos);
+	xindex_find(j, serial, &current_pos);
 
+	sorted = j->xindex_count;
 	while (current_pos.serial != serial) {
 		if (DNS_SERIAL_GT(current_pos.serial, serial)) {
+			/* The last position may already be indexed */
+			if (j->xindex_count > sorted) {
+				j->xindex_count--;
+			}
+			xindex_merge(j, sorted);
 			return ISC_R_NOTFOUND;
 		}
 		result = journal_next(j, &current_pos);
 		if (result != ISC_R_SUCCESS) {
+			/* Forget the positions read from a corrupt journal */
+			j->xindex_count = sorted;
 			return result;
 		}
+		xindex_append(j, &current_pos);
 	}
+	xindex_merge(j, sorted);
+
 	*pos = current_pos;
 	return ISC_R_SUCCESS;
 }
@@ -1457,9 +1702,10 @@ dns_journal_destroy(dns_journal_t **journalp) {
 	if (j->it.target.base != NULL) {
 		isc_mem_put(j->mctx, j->it.target.base, j->it.target.length);
 	}
-	if (j->it.source.base != NULL) {
+	if (j->it.source.base != NULL && j->map == NULL) {
 		isc_mem_put(j->mctx, j->it.source.base, j->it.source.length);
 	}
+	journal_unmap(j);
 	if (j->filename != NULL) {
 		isc_mem_free(j->mctx, j->filename);
 	}
@@ -1580,7 +1826,7 @@ dns_journal_rollforward(dns_journal_t *j, dns_db_t *db, unsigned int options) {
 		dns_difftuple_create(diff.mctx, op, name, ttl, rdata, &tuple);
 		dns_diff_append(&diff, &tuple);
 
-		if (++n_put > 100) {
+		if (++n_put > JOURNAL_ROLLFORWARD_BATCH) {
 			isc_log_write(DNS_LOGCATEGORY_GENERAL,
 				      DNS_LOGMODULE_JOURNAL, ISC_LOG_DEBUG(3),
 				      "%s: applying diff to database (%u)",
@@ -2024,8 +2270,18 @@ read_one_rr(dns_journal_t *j) {
 		FAIL(ISC_R_UNEXPECTED);
 	}
 
-	size_buffer(j->mctx, &j->it.source, rrhdr.size);
-	CHECK(journal_read(j, j->it.source.base, rrhdr.size));
+	if (j->map != NULL) {
+		unsigned char *base = NULL;
+
+		/*
+		 * Parse the RR in place.
+		 */
+		CHECK(journal_read_map(j, rrhdr.size, &base));
+		isc_buffer_init(&j->it.source, base, rrhdr.size);
+	} else {
+		size_buffer(j->mctx, &j->it.source, rrhdr.size);
+		CHECK(journal_read(j, j->it.source.base, rrhdr.size));
+	}
 	isc_buffer_add(&j->it.source, rrhdr.size);
 
 	/*
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <isc/atomic.h>
+#include <isc/hash.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/keycache.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+
+#include <dst/dst.h>
+
+#define KEYCACHE_MAGIC	  ISC_MAGIC('K', 'y', 'C', 'a')
+#define VALID_KEYCACHE(m) ISC_MAGIC_VALID(m, KEYCACHE_MAGIC)
+
+#define KEYCACHE_INIT_SIZE (1 << 10) /* Must be power of 2 */
+#define KEYCACHE_MIN_SIZE  (1 << 8)  /* Must be power of 2 */
+
+typedef struct dns_kcentry dns_kcentry_t;
+
+typedef struct dns_kckey {
+	const dns_name_t *name;
+	const dns_rdata_t *rdata;
+} dns__kckey_t;
+
+/*
+ * The entries are spread over one LRU list per loop by their hash value,
+ * so the lists are rarely contended; the lookups don't touch them at all.
+ */
+typedef struct dns_kclru {
+	isc_mutex_t lock;
+	struct cds_list_head head;
+	size_t count;
+} dns_kclru_t;
+
+struct dns_keycache {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	struct cds_lfht *ht;
+	dns_kclru_t *lru;
+	uint32_t nlru;
+	size_t maxperlru;
+};
+
+struct dns_kcentry {
+	isc_mem_t *mctx;
+	dst_key_t *key;
+
+	/*
+	 * Set when the entry is found, cleared when the entry is given
+	 * a second chance instead of being evicted.
+	 */
+	atomic_bool used;
+
+	struct cds_lfht_node ht_node;
+	struct rcu_head rcu_head;
+	struct cds_list_head lru_head;
+
+	dns_rdataclass_t rdclass;
+	isc_region_t rdata;
+	dns_name_t name;
+};
+
+static void
+kcentry_destroy(struct rcu_head *rcu_head);
+
+dns_keycache_t *
+dns_keycache_new(isc_mem_t *mctx, size_t maxkeys) {
+	uint32_t nlru = ISC_MAX(isc_loopmgr_nloops(), 1);
+
+	REQUIRE(maxkeys > 0);
+
+	dns_keycache_t *kc = isc_mem_get(mctx, sizeof(*kc));
+	*kc = (dns_keycache_t){
+		.magic = KEYCACHE_MAGIC,
+		.nlru = nlru,
+		.maxperlru = ISC_MAX(maxkeys / nlru, 1),
+	};
+
+	kc->ht = cds_lfht_new(KEYCACHE_INIT_SIZE, KEYCACHE_MIN_SIZE, 0,
+			      CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	INSIST(kc->ht != NULL);
+
+	kc->lru = isc_mem_cget(mctx, kc->nlru, sizeof(kc->lru[0]));
+	for (size_t i = 0; i < kc->nlru; i++) {
+		isc_mutex_init(&kc->lru[i].lock);
+		CDS_INIT_LIST_HEAD(&kc->lru[i].head);
+	}
+
+	isc_mem_attach(mctx, &kc->mctx);
+
+	return kc;
+}
+
+void
+dns_keycache_destroy(dns_keycache_t **kcp) {
+	REQUIRE(kcp != NULL && *kcp != NULL);
+	REQUIRE(VALID_KEYCACHE(*kcp));
+
+	dns_keycache_t *kc = *kcp;
+	*kcp = NULL;
+	kc->magic = 0;
+
+	dns_kcentry_t *entry = NULL;
+	struct cds_lfht_iter iter;
+	cds_lfht_for_each_entry(kc->ht, &iter, entry, ht_node) {
+		INSIST(!cds_lfht_del(kc->ht, &entry->ht_node));
+		kcentry_destroy(&entry->rcu_head);
+	}
+	RUNTIME_CHECK(!cds_lfht_destroy(kc->ht, NULL));
+
+	for (size_t i = 0; i < kc->nlru; i++) {
+		isc_mutex_destroy(&kc->lru[i].lock);
+	}
+	isc_mem_cput(kc->mctx, kc->lru, kc->nlru, sizeof(kc->lru[0]));
+
+	isc_mem_putanddetach(&kc->mctx, kc, sizeof(dns_keycache_t));
+}
+
+static int
+kcentry_match(struct cds_lfht_node *ht_node, const void *key0) {
+	const dns__kckey_t *key = key0;
+	dns_kcentry_t *entry = caa_container_of(ht_node, dns_kcentry_t,
+						ht_node);
+
+	return entry->rdclass == key->rdata->rdclass &&
+	       entry->rdata.length == key->rdata->length &&
+	       memcmp(entry->rdata.base, key->rdata->data,
+		      entry->rdata.length) == 0 &&
+	       dns_name_equal(&entry->name, key->name);
+}
+
+static uint32_t
+kcentry_hash(const dns__kckey_t *key) {
+	isc_hash32_t state;
+	isc_hash32_init(&state);
+	isc_hash32_hash(&state, key->name->ndata, key->name->length, false);
+	isc_hash32_hash(&state, key->rdata->data, key->rdata->length, true);
+	return isc_hash32_finalize(&state);
+}
+
+static dns_kcentry_t *
+kcentry_new(isc_mem_t *mctx, const dns_name_t *name, const dns_rdata_t *rdata,
+	    dst_key_t *key) {
+	dns_kcentry_t *entry = isc_mem_get(mctx, sizeof(*entry));
+	*entry = (dns_kcentry_t){
+		.rdclass = rdata->rdclass,
+		.lru_head = CDS_LIST_HEAD_INIT(entry->lru_head),
+	};
+
+	isc_mem_attach(mctx, &entry->mctx);
+	dst_key_attach(key, &entry->key);
+
+	entry->rdata.length = rdata->length;
+	entry->rdata.base = isc_mem_get(mctx, rdata->length);
+	memmove(entry->rdata.base, rdata->data, rdata->length);
+
+	dns_name_init(&entry->name);
+	dns_name_dup(name, mctx, &entry->name);
+
+	return entry;
+}
+
+static void
+kcentry_destroy(struct rcu_head *rcu_head) {
+	dns_kcentry_t *entry = caa_container_of(rcu_head, dns_kcentry_t,
+						rcu_head);
+
+	dst_key_free(&entry->key);
+	dns_name_free(&entry->name, entry->mctx);
+	isc_mem_put(entry->mctx, entry->rdata.base, entry->rdata.length);
+	isc_mem_putanddetach(&entry->mctx, entry, sizeof(*entry));
+}
+
+/*
+ * Evict the least recently used entry of the list, giving the entries
+ * that have been found since they were last considered a second chance.
+ * The list must be locked.
+ */
+static void
+kcentry_evict(struct cds_lfht *ht, dns_kclru_t *lru) {
+	dns_kcentry_t *entry = NULL;
+
+	for (size_t chances = lru->count; chances > 0; chances--) {
+		entry = cds_list_first_entry(&lru->head, dns_kcentry_t,
+					     lru_head);
+		if (!atomic_exchange_relaxed(&entry->used, false)) {
+			break;
+		}
+		cds_list_move_tail(&entry->lru_head, &lru->head);
+	}
+
+	entry = cds_list_first_entry(&lru->head, dns_kcentry_t, lru_head);
+	cds_list_del(&entry->lru_head);
+	lru->count--;
+
+	INSIST(!cds_lfht_del(ht, &entry->ht_node));
+	call_rcu(&entry->rcu_head, kcentry_destroy);
+}
+
+isc_result_t
+dns_keycache_find(dns_keycache_t *kc, const dns_name_t *name,
+		  const dns_rdata_t *rdata, dst_key_t **keyp) {
+	REQUIRE(VALID_KEYCACHE(kc));
+	REQUIRE(name != NULL);
+	REQUIRE(rdata != NULL && rdata->type == dns_rdatatype_dnskey);
+	REQUIRE(keyp != NULL && *keyp == NULL);
+
+	isc_result_t result = ISC_R_NOTFOUND;
+	dns__kckey_t key = {
+		.name = name,
+		.rdata = rdata,
+	};
+	uint32_t hashval = kcentry_hash(&key);
+	struct cds_lfht_iter iter;
+
+	rcu_read_lock();
+	struct cds_lfht *ht = rcu_dereference(kc->ht);
+	INSIST(ht != NULL);
+
+	cds_lfht_lookup(ht, hashval, kcentry_match, &key, &iter);
+	dns_kcentry_t *found = cds_lfht_entry(cds_lfht_iter_get_node(&iter),
+					      dns_kcentry_t, ht_node);
+	if (found != NULL) {
+		/* Avoid dirtying the cache line when it's already set */
+		if (!atomic_load_relaxed(&found->used)) {
+			atomic_store_relaxed(&found->used, true);
+		}
+		dst_key_attach(found->key, keyp);
+		result = ISC_R_SUCCESS;
+	}
+
+	rcu_read_unlock();
+
+	return result;
+}
+
+void
+dns_keycache_add(dns_keycache_t *kc, const dns_name_t *name,
+		 const dns_rdata_t *rdata, dst_key_t *key) {
+	REQUIRE(VALID_KEYCACHE(kc));
+	REQUIRE(name != NULL);
+	REQUIRE(rdata != NULL && rdata->type == dns_rdatatype_dnskey);
+	REQUIRE(key != NULL);
+
+	dns__kckey_t kckey = {
+		.name = name,
+		.rdata = rdata,
+	};
+	uint32_t hashval = kcentry_hash(&kckey);
+	dns_kclru_t *lru = &kc->lru[hashval % kc->nlru];
+	dns_kcentry_t *entry = kcentry_new(kc->mctx, name, rdata, key);
+
+	rcu_read_lock();
+	struct cds_lfht *ht = rcu_dereference(kc->ht);
+	INSIST(ht != NULL);
+
+	struct cds_lfht_node *ht_node = cds_lfht_add_unique(
+		ht, hashval, kcentry_match, &kckey, &entry->ht_node);
+	if (ht_node != &entry->ht_node) {
+		/* Someone else built the same key; keep the first one */
+		rcu_read_unlock();
+		kcentry_destroy(&entry->rcu_head);
+		return;
+	}
+
+	LOCK(&lru->lock);
+	cds_list_add_tail(&entry->lru_head, &lru->head);
+	lru->count++;
+
+	while (lru->count > kc->maxperlru) {
+		kcentry_evict(ht, lru);
+	}
+	UNLOCK(&lru->lock);
+
+	rcu_read_unlock();
+}
@@ -13,11 +13,16 @@
 
 /*! \file */
 
+#include <errno.h>
 #include <inttypes.h>
 #include <stdbool.h>
+#include <sys/mman.h>
 
 #include <isc/async.h>
 #include <isc/atomic.h>
+#include <isc/barrier.h>
+#include <isc/errno.h>
+#include <isc/file.h>
 #include <isc/lex.h>
 #include <isc/loop.h>
 #include <isc/magic.h>
@@ -28,6 +33,7 @@
 #include <isc/stdio.h>
 #include <isc/stdtime.h>
 #include <isc/string.h>
+#include <isc/thread.h>
 #include <isc/util.h>
 #include <isc/work.h>
 
@@ -39,6 +45,7 @@
 #include <dns/rdataclass.h>
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
+#include <dns/rdataslab.h>
 #include <dns/rdatastruct.h>
 #include <dns/rdatatype.h>
 #include <dns/soa.h>
@@ -134,6 +141,10 @@ struct dns_loadctx {
 	bool first;
 	dns_masterrawheader_t header;
 
+	/* The mapped file, when it is loaded in parallel */
+	unsigned char *map;
+	size_t maplen;
+
 	/* Which fixed buffers we are using? */
 	isc_result_t result;
 
@@ -183,6 +194,15 @@ openfile_raw(dns_loadctx_t *lctx, const char *master_file);
 static isc_result_t
 load_raw(dns_loadctx_t *lctx);
 
+static isc_result_t
+record_length(dns_loadctx_t *lctx, size_t offset, uint32_t *totallenp);
+
+static bool
+parload_usable(dns_loadctx_t *lctx);
+
+static isc_result_t
+load_parallel(dns_loadctx_t *lctx, size_t offset);
+
 static isc_result_t
 pushfile(const char *master_file, dns_name_t *origin, dns_loadctx_t *lctx);
 
@@ -190,6 +210,9 @@ static isc_result_t
 commit(dns_rdatacallbacks_t *, dns_loadctx_t *, rdatalist_head_t *,
        dns_name_t *, const char *, unsigned int);
 
+static uint32_t
+resign_fromlist(dns_rdatalist_t *this, dns_loadctx_t *lctx);
+
 static bool
 is_glue(rdatalist_head_t *, dns_name_t *);
 
@@ -438,6 +461,10 @@ loadctx_destroy(dns_loadctx_t *lctx) {
 		incctx_destroy(lctx->mctx, lctx->inc);
 	}
 
+	if (lctx->map != NULL) {
+		RUNTIME_CHECK(munmap(lctx->map, lctx->maplen) == 0);
+	}
+
 	if (lctx->f != NULL) {
 		isc_result_t result = isc_stdio_close(lctx->f);
 		if (result != ISC_R_SUCCESS) {
@@ -2345,6 +2372,16 @@ load_raw(dns_loadctx_t *lctx) {
 		}
 	}
 
+	if (parload_usable(lctx)) {
+		off_t offset;
+
+		result = isc_stdio_tell(lctx->f, &offset);
+		if (result != ISC_R_SUCCESS) {
+			return result;
+		}
+		return load_parallel(lctx, (size_t)offset);
+	}
+
 	ISC_LIST_INIT(head);
 	ISC_LIST_INIT(dummy);
 
@@ -2618,6 +2655,680 @@ cleanup:
 	return result;
 }
 
+static isc_result_t
+mapfile(dns_loadctx_t *lctx) {
+	isc_result_t result;
+	off_t size;
+	void *base = NULL;
+
+	INSIST(lctx->f != NULL && lctx->map == NULL);
+
+	result = isc_file_getsizefd(fileno(lctx->f), &size);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	/*
+	 * The file was big enough when parload_usable() looked at it.
+	 */
+	if (size == 0) {
+		return ISC_R_UNEXPECTEDEND;
+	}
+	if ((uintmax_t)size > SIZE_MAX) {
+		return ISC_R_RANGE;
+	}
+
+	/*
+	 * The file is only mapped to be read without copying it into a
+	 * buffer first; the records end up in the database's own memory,
+	 * and the mapping is released when the load is done.
+	 */
+	base = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE,
+		    fileno(lctx->f), 0);
+	if (base == MAP_FAILED) {
+		result = isc_errno_toresult(errno);
+		UNEXPECTED_ERROR("mmap() failed: %s",
+				 isc_result_totext(result));
+		return result;
+	}
+	(void)posix_madvise(base, (size_t)size, POSIX_MADV_SEQUENTIAL);
+
+	lctx->map = base;
+	lctx->maplen = (size_t)size;
+
+	return ISC_R_SUCCESS;
+}
+
+/*
+ * Decode one RRset from a raw file held in memory, in the same way as
+ * load_raw() does from a stream.  The rdata are decoded into 'scratch',
+ * which must be at least as long as the record.
+ */
+static isc_result_t
+raw_record(dns_loadctx_t *lctx, isc_buffer_t *target,
+	   dns_rdatalist_t *rdatalist, dns_name_t *name, isc_region_t *owner,
+	   dns_rdata_t **rdatap, unsigned int *rdata_sizep,
+	   unsigned int *rdcountp, isc_buffer_t *scratch) {
+	isc_result_t result;
+	dns_rdatacallbacks_t *callbacks = lctx->callbacks;
+	rdatalist_head_t head, dummy;
+	unsigned int i, rdcount;
+	uint16_t namelen;
+
+	ISC_LIST_INIT(head);
+	ISC_LIST_INIT(dummy);
+
+	/* Construct RRset headers */
+	rdatalist->rdclass = isc_buffer_getuint16(target);
+	if (lctx->zclass != rdatalist->rdclass) {
+		return DNS_R_BADCLASS;
+	}
+	rdatalist->type = isc_buffer_getuint16(target);
+	rdatalist->covers = isc_buffer_getuint16(target);
+	rdatalist->ttl = isc_buffer_getuint32(target);
+	rdcount = isc_buffer_getuint32(target);
+	if (rdcount == 0 || rdcount > 0xffff) {
+		return ISC_R_RANGE;
+	}
+
+	/* Owner name: length followed by name */
+	if (isc_buffer_remaininglength(target) < sizeof(namelen)) {
+		return ISC_R_RANGE;
+	}
+	namelen = isc_buffer_getuint16(target);
+	if (namelen > DNS_NAME_MAXWIRE ||
+	    isc_buffer_remaininglength(target) < namelen)
+	{
+		return ISC_R_RANGE;
+	}
+	isc_buffer_remainingregion(target, owner);
+	owner->length = namelen;
+	isc_buffer_setactive(target, (unsigned int)namelen);
+	result = dns_name_fromwire(name, target, DNS_DECOMPRESS_NEVER, NULL);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	if ((lctx->options & DNS_MASTER_CHECKTTL) != 0 &&
+	    rdatalist->ttl > lctx->maxttl)
+	{
+		(callbacks->error)(callbacks,
+				   "dns_master_load: "
+				   "TTL %d exceeds configured "
+				   "max-zone-ttl %d",
+				   rdatalist->ttl, lctx->maxttl);
+		return ISC_R_RANGE;
+	}
+
+	if (rdcount > *rdata_sizep) {
+		*rdatap = grow_rdata(rdcount + RDSZ, *rdatap, *rdata_sizep,
+				     &head, &dummy, lctx->mctx);
+		*rdata_sizep = rdcount + RDSZ;
+	}
+
+	isc_buffer_clear(scratch);
+	for (i = 0; i < rdcount; i++) {
+		dns_rdata_t *rdata = &(*rdatap)[i];
+		uint16_t rdlen;
+
+		if (isc_buffer_remaininglength(target) < sizeof(rdlen)) {
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+		rdlen = isc_buffer_getuint16(target);
+		if (isc_buffer_remaininglength(target) < rdlen) {
+			result = ISC_R_RANGE;
+			goto cleanup;
+		}
+		isc_buffer_setactive(target, (unsigned int)rdlen);
+
+		dns_rdata_init(rdata);
+		result = dns_rdata_fromwire(rdata, rdatalist->rdclass,
+					    rdatalist->type, target,
+					    DNS_DECOMPRESS_NEVER, scratch);
+		if (result != ISC_R_SUCCESS) {
+			goto cleanup;
+		}
+		ISC_LIST_APPEND(rdatalist->rdata, rdata, link);
+	}
+
+	if (isc_buffer_remaininglength(target) != 0) {
+		result = ISC_R_RANGE;
+		goto cleanup;
+	}
+
+	*rdcountp = rdcount;
+	return ISC_R_SUCCESS;
+
+cleanup:
+	while (i-- > 0) {
+		ISC_LIST_UNLINK(rdatalist->rdata, &(*rdatap)[i], link);
+		dns_rdata_reset(&(*rdatap)[i]);
+	}
+	return result;
+}
+
+/*
+ * Parallel loading of raw files.
+ *
+ * Records in the raw format are length-prefixed, so a file can be cut
+ * into chunks at record boundaries without parsing it.  The chunks are
+ * decoded into slab images by worker threads, a batch at a time, while
+ * the calling thread merges the previous batch into the database in
+ * file order through the 'addslab' callback.  The database therefore
+ * still sees a single writer and a single load transaction.
+ *
+ * The workers are started once per load and wait on a barrier for each
+ * batch.  The load itself already runs on an offloaded work thread, and
+ * blocking it on more offloaded work could exhaust the work pool.
+ */
+#define PARLOAD_CHUNKSIZE (1024 * 1024)
+#define PARLOAD_CHUNKS	  4 /*%< chunks per worker in each batch */
+
+typedef struct parload_rrset {
+	dns_rdatatype_t type;
+	dns_rdatatype_t covers;
+	dns_ttl_t ttl;
+	bool resign;
+	uint32_t resigntime;
+	size_t name; /*%< offset of the owner name in the mapping */
+	uint16_t namelen;
+	size_t slab; /*%< offset of the slab image */
+	unsigned int slablen;
+} parload_rrset_t;
+
+typedef struct parload_chunk {
+	size_t start;
+	size_t end;
+	isc_result_t result;
+	parload_rrset_t *rrsets;
+	size_t nrrsets;
+	size_t nalloc;
+	isc_buffer_t *slabs; /*%< decoded slab images */
+} parload_chunk_t;
+
+typedef struct parload_batch {
+	parload_chunk_t *chunks;
+	size_t nchunks;
+	atomic_uint_fast32_t next;
+	atomic_bool failed;
+} parload_batch_t;
+
+typedef struct parload_pool parload_pool_t;
+
+typedef struct parload_worker {
+	isc_thread_t thread;
+	dns_loadctx_t *lctx;
+	parload_pool_t *pool;
+	dns_rdata_t *rdata;
+	unsigned int rdata_size;
+	unsigned char *scratch;
+	size_t scratchlen;
+} parload_worker_t;
+
+struct parload_pool {
+	parload_worker_t *workers;
+	unsigned int nworkers;
+	parload_batch_t *batch; /*%< NULL tells the workers to exit */
+	isc_barrier_t start;	/*%< the batch is ready to be decoded */
+	isc_barrier_t done;	/*%< the batch has been decoded */
+};
+
+/*
+ * Read and check the total length of the record at 'offset'.
+ */
+static isc_result_t
+record_length(dns_loadctx_t *lctx, size_t offset, uint32_t *totallenp) {
+	size_t remaining = lctx->maplen - offset;
+	size_t minlen = sizeof(uint32_t) + sizeof(uint16_t) +
+			sizeof(uint16_t) + sizeof(uint16_t) +
+			sizeof(uint32_t) + sizeof(uint32_t);
+	isc_buffer_t b;
+	uint32_t totallen;
+
+	if (remaining < sizeof(totallen)) {
+		return ISC_R_UNEXPECTEDEND;
+	}
+	isc_buffer_init(&b, lctx->map + offset, sizeof(totallen));
+	isc_buffer_add(&b, sizeof(totallen));
+	totallen = isc_buffer_getuint32(&b);
+	if (totallen < minlen) {
+		return ISC_R_RANGE;
+	}
+	if (totallen > remaining) {
+		return ISC_R_UNEXPECTEDEND;
+	}
+
+	*totallenp = totallen;
+	return ISC_R_SUCCESS;
+}
+
+static bool
+parload_usable(dns_loadctx_t *lctx) {
+	off_t size;
+
+	if (lctx->callbacks->addslab == NULL ||
+	    lctx->callbacks->nthreads < 2)
+	{
+		return false;
+	}
+
+	return isc_file_getsizefd(fileno(lctx->f), &size) == ISC_R_SUCCESS &&
+	       size >= 2 * PARLOAD_CHUNKSIZE;
+}
+
+/*
+ * Cut the next batch of chunks, starting at '*offsetp'.
+ */
+static isc_result_t
+parload_scan(dns_loadctx_t *lctx, parload_batch_t *batch, size_t maxchunks,
+	     size_t *offsetp) {
+	isc_result_t result = ISC_R_SUCCESS;
+	size_t offset = *offsetp;
+
+	batch->nchunks = 0;
+	atomic_init(&batch->next, 0);
+	atomic_init(&batch->failed, false);
+
+	while (batch->nchunks < maxchunks && offset < lctx->maplen) {
+		parload_chunk_t *chunk = &batch->chunks[batch->nchunks++];
+
+		chunk->start = offset;
+		chunk->result = ISC_R_CANCELED;
+		chunk->nrrsets = 0;
+		while (offset < lctx->maplen &&
+		       offset - chunk->start < PARLOAD_CHUNKSIZE)
+		{
+			uint32_t totallen;
+
+			result = record_length(lctx, offset, &totallen);
+			if (result != ISC_R_SUCCESS) {
+				break;
+			}
+			offset += totallen;
+		}
+		chunk->end = offset;
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+	}
+
+	*offsetp = offset;
+	return result;
+}
+
+static isc_result_t
+parload_decode(parload_worker_t *worker, parload_chunk_t *chunk) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_loadctx_t *lctx = worker->lctx;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	size_t offset = chunk->start;
+
+	if (chunk->slabs == NULL) {
+		isc_buffer_allocate(lctx->mctx, &chunk->slabs,
+				    PARLOAD_CHUNKSIZE);
+	}
+	isc_buffer_clear(chunk->slabs);
+
+	while (offset < chunk->end) {
+		dns_rdatalist_t rdatalist;
+		dns_rdataset_t rdataset;
+		parload_rrset_t *rrset = NULL;
+		isc_buffer_t target, scratch;
+		isc_region_t owner, slab;
+		unsigned int i, rdcount = 0;
+		uint32_t totallen;
+
+		RUNTIME_CHECK(record_length(lctx, offset, &totallen) ==
+			      ISC_R_SUCCESS);
+		isc_buffer_init(&target, lctx->map + offset, totallen);
+		isc_buffer_add(&target, totallen);
+		isc_buffer_forward(&target, sizeof(totallen));
+		offset += totallen;
+
+		if (worker->scratchlen < ISC_MAX(totallen, DNS_RDATA_MAXLENGTH))
+		{
+			size_t newlen = ISC_MAX(totallen, DNS_RDATA_MAXLENGTH);
+			if (worker->scratch != NULL) {
+				isc_mem_put(lctx->mctx, worker->scratch,
+					    worker->scratchlen);
+			}
+			worker->scratch = isc_mem_get(lctx->mctx, newlen);
+			worker->scratchlen = newlen;
+		}
+
+		dns_rdatalist_init(&rdatalist);
+		isc_buffer_init(&scratch, worker->scratch,
+				(unsigned int)worker->scratchlen);
+		result = raw_record(lctx, &target, &rdatalist, name, &owner,
+				    &worker->rdata, &worker->rdata_size,
+				    &rdcount, &scratch);
+		if (result != ISC_R_SUCCESS) {
+			return result;
+		}
+
+		if (chunk->nrrsets == chunk->nalloc) {
+			size_t newalloc = ISC_MAX(chunk->nalloc * 2, 256);
+			chunk->rrsets = isc_mem_creget(
+				lctx->mctx, chunk->rrsets, chunk->nalloc,
+				newalloc, sizeof(chunk->rrsets[0]));
+			chunk->nalloc = newalloc;
+		}
+		rrset = &chunk->rrsets[chunk->nrrsets];
+		*rrset = (parload_rrset_t){
+			.type = rdatalist.type,
+			.covers = rdatalist.covers,
+			.ttl = rdatalist.ttl,
+			.name = owner.base - lctx->map,
+			.namelen = owner.length,
+		};
+		if (rdatalist.type == dns_rdatatype_rrsig &&
+		    (lctx->options & DNS_MASTER_RESIGN) != 0)
+		{
+			rrset->resign = true;
+			rrset->resigntime = resign_fromlist(&rdatalist, lctx);
+		}
+
+		/*
+		 * Sort and de-duplicate here, so that the database only
+		 * has to copy the result.
+		 */
+		dns_rdataset_init(&rdataset);
+		dns_rdatalist_tordataset(&rdatalist, &rdataset);
+		result = dns_rdataslab_fromrdataset(&rdataset, lctx->mctx,
+						    &slab, 0);
+		if (result == ISC_R_SUCCESS) {
+			rrset->slab = isc_buffer_usedlength(chunk->slabs);
+			rrset->slablen = slab.length - sizeof(dns_slabheader_t);
+			isc_buffer_putmem(chunk->slabs,
+					  slab.base + sizeof(dns_slabheader_t),
+					  rrset->slablen);
+			isc_mem_put(lctx->mctx, slab.base, slab.length);
+		}
+
+		for (i = 0; i < rdcount; i++) {
+			ISC_LIST_UNLINK(rdatalist.rdata, &worker->rdata[i],
+					link);
+			dns_rdata_reset(&worker->rdata[i]);
+		}
+
+		if (result != ISC_R_SUCCESS) {
+			return result;
+		}
+		chunk->nrrsets++;
+	}
+
+	return ISC_R_SUCCESS;
+}
+
+static void *
+parload_work(void *arg) {
+	parload_worker_t *worker = arg;
+	parload_pool_t *pool = worker->pool;
+
+	for (;;) {
+		parload_batch_t *batch = NULL;
+		size_t i;
+
+		isc_barrier_wait(&pool->start);
+		batch = pool->batch;
+		if (batch == NULL) {
+			break;
+		}
+
+		/*
+		 * Chunks are taken in order, so after a failure every
+		 * chunk before the failed one has still been decoded.
+		 */
+		while (!atomic_load_relaxed(&batch->failed) &&
+		       (i = atomic_fetch_add_relaxed(&batch->next, 1)) <
+			       batch->nchunks)
+		{
+			parload_chunk_t *chunk = &batch->chunks[i];
+
+			chunk->result = parload_decode(worker, chunk);
+			if (chunk->result != ISC_R_SUCCESS) {
+				atomic_store_relaxed(&batch->failed, true);
+				break;
+			}
+		}
+
+		isc_barrier_wait(&pool->done);
+	}
+
+	return NULL;
+}
+
+static void
+parload_pool_init(parload_pool_t *pool, dns_loadctx_t *lctx,
+		  unsigned int nworkers) {
+	*pool = (parload_pool_t){
+		.workers = isc_mem_cget(lctx->mctx, nworkers,
+					sizeof(pool->workers[0])),
+		.nworkers = nworkers,
+	};
+
+	isc_barrier_init(&pool->start, nworkers + 1);
+	isc_barrier_init(&pool->done, nworkers + 1);
+
+	for (unsigned int i = 0; i < nworkers; i++) {
+		pool->workers[i].lctx = lctx;
+		pool->workers[i].pool = pool;
+		isc_thread_create(parload_work, &pool->workers[i],
+				  &pool->workers[i].thread);
+	}
+}
+
+static void
+parload_pool_destroy(parload_pool_t *pool, isc_mem_t *mctx) {
+	/* Let the workers exit */
+	pool->batch = NULL;
+	isc_barrier_wait(&pool->start);
+
+	for (unsigned int i = 0; i < pool->nworkers; i++) {
+		parload_worker_t *worker = &pool->workers[i];
+
+		isc_thread_join(worker->thread, NULL);
+		if (worker->rdata != NULL) {
+			isc_mem_cput(mctx, worker->rdata, worker->rdata_size,
+				     sizeof(worker->rdata[0]));
+		}
+		if (worker->scratch != NULL) {
+			isc_mem_put(mctx, worker->scratch, worker->scratchlen);
+		}
+	}
+
+	isc_barrier_destroy(&pool->start);
+	isc_barrier_destroy(&pool->done);
+
+	isc_mem_cput(mctx, pool->workers, pool->nworkers,
+		     sizeof(pool->workers[0]));
+}
+
+/*
+ * Hand 'batch' over to the waiting workers.
+ */
+static void
+parload_start(parload_pool_t *pool, parload_batch_t *batch) {
+	pool->batch = batch;
+	isc_barrier_wait(&pool->start);
+}
+
+/*
+ * Wait until the workers are done with the batch.
+ */
+static void
+parload_wait(parload_pool_t *pool) {
+	isc_barrier_wait(&pool->done);
+}
+
+static isc_result_t
+parload_merge(dns_loadctx_t *lctx, parload_chunk_t *chunk) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_rdatacallbacks_t *callbacks = lctx->callbacks;
+	unsigned char *slabs = NULL;
+
+	if (chunk->result != ISC_R_SUCCESS) {
+		return chunk->result;
+	}
+
+	slabs = isc_buffer_base(chunk->slabs);
+
+	for (size_t i = 0; i < chunk->nrrsets; i++) {
+		parload_rrset_t *rrset = &chunk->rrsets[i];
+		dns_rdatalist_t rdatalist;
+		dns_rdataset_t rdataset;
+		dns_name_t name;
+		isc_region_t r = {
+			.base = lctx->map + rrset->name,
+			.length = rrset->namelen,
+		};
+		isc_region_t slab = {
+			.base = slabs + rrset->slab,
+			.length = rrset->slablen,
+		};
+
+		dns_name_init(&name);
+		dns_name_fromregion(&name, &r);
+
+		/*
+		 * The rdataset only describes the RRset; its contents
+		 * are in the slab image.
+		 */
+		dns_rdatalist_init(&rdatalist);
+		rdatalist.rdclass = lctx->zclass;
+		rdatalist.type = rrset->type;
+		rdatalist.covers = rrset->covers;
+		rdatalist.ttl = rrset->ttl;
+		dns_rdataset_init(&rdataset);
+		dns_rdatalist_tordataset(&rdatalist, &rdataset);
+		rdataset.trust = dns_trust_ultimate;
+		if (rrset->resign) {
+			rdataset.attributes.resign = true;
+			rdataset.resign = rrset->resigntime;
+		}
+
+		result = callbacks->addslab(callbacks->add_private, &name,
+					    &rdataset, &slab DNS__DB_FILELINE);
+		if (result != ISC_R_SUCCESS) {
+			char namebuf[DNS_NAME_FORMATSIZE];
+
+			dns_name_format(&name, namebuf, sizeof(namebuf));
+			(*callbacks->error)(callbacks, "%s: %s: %s",
+					    "dns_master_load", namebuf,
+					    isc_result_totext(result));
+			break;
+		}
+	}
+
+	return result;
+}
+
+static isc_result_t
+load_parallel(dns_loadctx_t *lctx, size_t offset) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_rdatacallbacks_t *callbacks = lctx->callbacks;
+	isc_mem_t *mctx = lctx->mctx;
+	unsigned int nworkers = callbacks->nthreads - 1;
+	parload_pool_t pool;
+	parload_batch_t batch[2] = { 0 };
+	size_t maxchunks = (size_t)nworkers * PARLOAD_CHUNKS;
+	unsigned int cur = 0;
+
+	result = mapfile(lctx);
+	if (result != ISC_R_SUCCESS) {
+		goto done;
+	}
+	INSIST(offset <= lctx->maplen);
+
+	parload_pool_init(&pool, lctx, nworkers);
+	for (size_t i = 0; i < ARRAY_SIZE(batch); i++) {
+		batch[i].chunks = isc_mem_cget(mctx, maxchunks,
+					       sizeof(batch[i].chunks[0]));
+	}
+
+	/* open a database transaction */
+	if (callbacks->setup != NULL) {
+		callbacks->setup(callbacks->add_private);
+	}
+
+	result = parload_scan(lctx, &batch[cur], maxchunks, &offset);
+	if (batch[cur].nchunks > 0) {
+		parload_start(&pool, &batch[cur]);
+	}
+
+	/*
+	 * Decode batch N+1 while batch N is being merged.
+	 */
+	while (batch[cur].nchunks > 0) {
+		parload_batch_t *this = &batch[cur];
+		parload_batch_t *next = &batch[cur ^ 1];
+
+		parload_wait(&pool);
+
+		next->nchunks = 0;
+		if (result == ISC_R_SUCCESS) {
+			result = parload_scan(lctx, next, maxchunks, &offset);
+			if (next->nchunks > 0) {
+				parload_start(&pool, next);
+			}
+		}
+
+		for (size_t i = 0;
+		     result == ISC_R_SUCCESS && i < this->nchunks; i++)
+		{
+			result = parload_merge(lctx, &this->chunks[i]);
+		}
+
+		if (result != ISC_R_SUCCESS && next->nchunks > 0) {
+			atomic_store_relaxed(&next->failed, true);
+			parload_wait(&pool);
+			next->nchunks = 0;
+		}
+		this->nchunks = 0;
+		cur ^= 1;
+	}
+
+	if (result == ISC_R_SUCCESS && lctx->result != ISC_R_SUCCESS) {
+		result = lctx->result;
+	}
+
+	if (result == ISC_R_SUCCESS && callbacks->rawdata != NULL) {
+		(*callbacks->rawdata)(callbacks->zone, &lctx->header);
+	}
+
+	/* commit the database transaction */
+	if (callbacks->commit != NULL) {
+		callbacks->commit(callbacks->add_private);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(batch); i++) {
+		for (size_t j = 0; j < maxchunks; j++) {
+			parload_chunk_t *chunk = &batch[i].chunks[j];
+			if (chunk->rrsets != NULL) {
+				isc_mem_cput(mctx, chunk->rrsets,
+					     chunk->nalloc,
+					     sizeof(chunk->rrsets[0]));
+			}
+			if (chunk->slabs != NULL) {
+				isc_buffer_free(&chunk->slabs);
+			}
+		}
+		isc_mem_cput(mctx, batch[i].chunks, maxchunks,
+			     sizeof(batch[i].chunks[0]));
+	}
+	parload_pool_destroy(&pool, mctx);
+
+done:
+	if (result != ISC_R_SUCCESS) {
+		(*callbacks->error)(callbacks, "dns_master_load: %s",
+				    isc_result_totext(result));
+	}
+
+	return result;
+}
+
 isc_result_t
 dns_master_loadfile(const char *master_file, dns_name_t *top,
 		    dns_name_t *origin, dns_rdataclass_t zclass,
@@ -19,7 +19,9 @@
 
 #include <ctype.h>
 #include <inttypes.h>
+#include <stdalign.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <isc/async.h>
 #include <isc/buffer.h>
@@ -121,14 +123,17 @@ hexdump(const char *msg, const char *msg2, void *base, size_t len) {
  * of various block allocations used within the server.
  * XXXMLG These should come from a config setting.
  */
-#define SCRATCHPAD_SIZE	   1232
-#define NAME_FILLCOUNT	   1024
-#define NAME_FREEMAX	   8 * NAME_FILLCOUNT
-#define OFFSET_COUNT	   4
-#define RDATA_COUNT	   8
-#define RDATALIST_COUNT	   8
-#define RDATASET_FILLCOUNT 1024
-#define RDATASET_FREEMAX   8 * RDATASET_FILLCOUNT
+#define SCRATCHPAD_SIZE 1232
+#define OFFSET_COUNT	4
+
+/*%
+ * Size of each arena block, and the alignment of the items handed out
+ * from it.  The first block is kept across dns_message_reset(), so a
+ * message that is reused for many queries normally does not allocate
+ * any memory for its names, rdatasets, rdatalists and rdatas at all.
+ */
+#define MSGARENA_SIZE  4096
+#define MSGARENA_ALIGN alignof(max_align_t)
 
 /*%
  * Text representation of the different items, for message_totext
@@ -174,21 +179,18 @@ static const char *edetext[] = { "Other",
 				 "Invalid Data" };
 
 /*%
- * "helper" type, which consists of a block of some type, and is linkable.
- * For it to work, sizeof(dns_msgblock_t) must be a multiple of the pointer
- * size, or the allocated elements will not be aligned correctly.
+ * Message arena block.  Names, rdatasets, rdatalists and rdatas handed
+ * out by a message are carved from a list of these blocks with a simple
+ * bump pointer, and are all released at once when the message is reset
+ * or destroyed.  The items themselves follow the (aligned) header.
  */
 struct dns_msgblock {
-	unsigned int count;
-	unsigned int remaining;
+	unsigned int size;
+	unsigned int used;
 	ISC_LINK(dns_msgblock_t) link;
 }; /* dynamically sized */
 
-static dns_msgblock_t *
-msgblock_allocate(isc_mem_t *, unsigned int, unsigned int);
-
-#define msgblock_get(block, type) \
-	((type *)msgblock_internalget(block, sizeof(type)))
+#define MSGBLOCK_HDRLEN ISC_ALIGN(sizeof(dns_msgblock_t), MSGARENA_ALIGN)
 
 /*
  * A context type to pass information when checking a message signature
@@ -206,21 +208,12 @@ typedef struct checksig_ctx {
 /*
  * This function differs from public dns_message_puttemprdataset() that it
  * requires the *rdatasetp to be associated, and it will disassociate and
- * put it back to the memory pool.
+ * put it back on the message free list.
  */
 static void
 dns__message_putassociatedrdataset(dns_message_t *msg,
 				   dns_rdataset_t **rdatasetp);
 
-static void *
-msgblock_internalget(dns_msgblock_t *, unsigned int);
-
-static void
-msgblock_reset(dns_msgblock_t *);
-
-static void
-msgblock_free(isc_mem_t *, dns_msgblock_t *, unsigned int);
-
 static void
 logfmtpacket(dns_message_t *message, const char *description,
 	     const isc_sockaddr_t *from, const isc_sockaddr_t *to,
@@ -228,63 +221,50 @@ logfmtpacket(dns_message_t *message, const char *description,
 	     const dns_master_style_t *style, int level, isc_mem_t *mctx);
 
 /*
- * Allocate a new dns_msgblock_t, and return a pointer to it.  If no memory
- * is free, return NULL.
- */
-static dns_msgblock_t *
-msgblock_allocate(isc_mem_t *mctx, unsigned int sizeof_type,
-		  unsigned int count) {
-	dns_msgblock_t *block;
-	unsigned int length;
-
-	length = sizeof(dns_msgblock_t) + (sizeof_type * count);
-
-	block = isc_mem_get(mctx, length);
-
-	block->count = count;
-	block->remaining = count;
-
-	ISC_LINK_INIT(block, link);
-
-	return block;
-}
-
-/*
- * Return an element from the msgblock.  If no more are available, return
- * NULL.
+ * Return 'size' bytes of suitably aligned memory from the message arena,
+ * adding a new block to it if the current one is exhausted.
  */
 static void *
-msgblock_internalget(dns_msgblock_t *block, unsigned int sizeof_type) {
-	void *ptr;
+msgarena_get(dns_message_t *msg, size_t size) {
+	dns_msgblock_t *block = ISC_LIST_TAIL(msg->arena);
+	void *ptr = NULL;
 
-	if (block == NULL || block->remaining == 0) {
-		return NULL;
-	}
+	size = ISC_ALIGN(size, MSGARENA_ALIGN);
+	INSIST(size <= MSGARENA_SIZE - MSGBLOCK_HDRLEN);
 
-	block->remaining--;
+	if (block == NULL || block->size - block->used < size) {
+		block = isc_mem_get(msg->mctx, MSGARENA_SIZE);
+		*block = (dns_msgblock_t){
+			.size = MSGARENA_SIZE - MSGBLOCK_HDRLEN,
+			.link = ISC_LINK_INITIALIZER,
+		};
+		ISC_LIST_APPEND(msg->arena, block, link);
+	}
 
-	ptr = (((unsigned char *)block) + sizeof(dns_msgblock_t) +
-	       (sizeof_type * block->remaining));
+	ptr = (unsigned char *)block + MSGBLOCK_HDRLEN + block->used;
+	block->used += size;
 
 	return ptr;
 }
 
-static void
-msgblock_reset(dns_msgblock_t *block) {
-	block->remaining = block->count;
-}
-
 /*
- * Release memory associated with a message block.
+ * Release the whole arena in one go, except for the first block when
+ * 'everything' is false; that one is simply rewound.
  */
 static void
-msgblock_free(isc_mem_t *mctx, dns_msgblock_t *block,
-	      unsigned int sizeof_type) {
-	unsigned int length;
-
-	length = sizeof(dns_msgblock_t) + (sizeof_type * block->count);
+msgarena_reset(dns_message_t *msg, bool everything) {
+	dns_msgblock_t *block = ISC_LIST_HEAD(msg->arena);
 
-	isc_mem_put(mctx, block, length);
+	if (!everything && block != NULL) {
+		block->used = 0;
+		block = ISC_LIST_NEXT(block, link);
+	}
+	while (block != NULL) {
+		dns_msgblock_t *next = ISC_LIST_NEXT(block, link);
+		ISC_LIST_UNLINK(msg->arena, block, link);
+		isc_mem_put(msg->mctx, block, MSGARENA_SIZE);
+		block = next;
+	}
 }
 
 /*
@@ -320,26 +300,15 @@ releaserdata(dns_message_t *msg, dns_rdata_t *rdata) {
 
 static dns_rdata_t *
 newrdata(dns_message_t *msg) {
-	dns_msgblock_t *msgblock;
-	dns_rdata_t *rdata;
+	dns_rdata_t *rdata = ISC_LIST_HEAD(msg->freerdata);
 
-	rdata = ISC_LIST_HEAD(msg->freerdata);
 	if (rdata != NULL) {
 		ISC_LIST_UNLINK(msg->freerdata, rdata, link);
 		dns_rdata_reset(rdata);
 		return rdata;
 	}
 
-	msgblock = ISC_LIST_TAIL(msg->rdatas);
-	rdata = msgblock_get(msgblock, dns_rdata_t);
-	if (rdata == NULL) {
-		msgblock = msgblock_allocate(msg->mctx, sizeof(dns_rdata_t),
-					     RDATA_COUNT);
-		ISC_LIST_APPEND(msg->rdatas, msgblock, link);
-
-		rdata = msgblock_get(msgblock, dns_rdata_t);
-	}
-
+	rdata = msgarena_get(msg, sizeof(*rdata));
 	dns_rdata_init(rdata);
 	return rdata;
 }
@@ -351,26 +320,14 @@ releaserdatalist(dns_message_t *msg, dns_rdatalist_t *rdatalist) {
 
 static dns_rdatalist_t *
 newrdatalist(dns_message_t *msg) {
-	dns_msgblock_t *msgblock;
-	dns_rdatalist_t *rdatalist;
+	dns_rdatalist_t *rdatalist = ISC_LIST_HEAD(msg->freerdatalist);
 
-	rdatalist = ISC_LIST_HEAD(msg->freerdatalist);
 	if (rdatalist != NULL) {
 		ISC_LIST_UNLINK(msg->freerdatalist, rdatalist, link);
-		dns_rdatalist_init(rdatalist);
-		goto out;
+	} else {
+		rdatalist = msgarena_get(msg, sizeof(*rdatalist));
 	}
 
-	msgblock = ISC_LIST_TAIL(msg->rdatalists);
-	rdatalist = msgblock_get(msgblock, dns_rdatalist_t);
-	if (rdatalist == NULL) {
-		msgblock = msgblock_allocate(msg->mctx, sizeof(dns_rdatalist_t),
-					     RDATALIST_COUNT);
-		ISC_LIST_APPEND(msg->rdatalists, msgblock, link);
-
-		rdatalist = msgblock_get(msgblock, dns_rdatalist_t);
-	}
-out:
 	dns_rdatalist_init(rdatalist);
 	return rdatalist;
 }
@@ -489,7 +446,6 @@ msgresetsigs(dns_message_t *msg, bool replying) {
 	}
 	if (msg->tsig != NULL) {
 		INSIST(dns_rdataset_isassociated(msg->tsig));
-		INSIST(msg->namepool != NULL);
 		if (replying) {
 			INSIST(msg->querytsig == NULL);
 			msg->querytsig = msg->tsig;
@@ -521,7 +477,6 @@ msgresetsigs(dns_message_t *msg, bool replying) {
  */
 static void
 msgreset(dns_message_t *msg, bool everything) {
-	dns_msgblock_t *msgblock = NULL, *next_msgblock = NULL;
 	isc_buffer_t *dynbuf = NULL, *next_dynbuf = NULL;
 
 	msgresetnames(msg, 0);
@@ -533,16 +488,13 @@ msgreset(dns_message_t *msg, bool everything) {
 	 */
 
 	/*
-	 * Run through the free lists, and just unlink anything found there.
-	 * The memory isn't lost since these are part of message blocks we
-	 * have allocated.
+	 * Everything on the free lists lives in the message arena, which
+	 * is released below, so the lists can simply be forgotten.
 	 */
-	ISC_LIST_FOREACH (msg->freerdata, rdata, link) {
-		ISC_LIST_UNLINK(msg->freerdata, rdata, link);
-	}
-	ISC_LIST_FOREACH (msg->freerdatalist, rdatalist, link) {
-		ISC_LIST_UNLINK(msg->freerdatalist, rdatalist, link);
-	}
+	ISC_LIST_INIT(msg->freename);
+	ISC_LIST_INIT(msg->freerdataset);
+	ISC_LIST_INIT(msg->freerdata);
+	ISC_LIST_INIT(msg->freerdatalist);
 
 	dynbuf = ISC_LIST_HEAD(msg->scratchpad);
 	INSIST(dynbuf != NULL);
@@ -557,33 +509,7 @@ msgreset(dns_message_t *msg, bool everything) {
 		dynbuf = next_dynbuf;
 	}
 
-	msgblock = ISC_LIST_HEAD(msg->rdatas);
-	if (!everything && msgblock != NULL) {
-		msgblock_reset(msgblock);
-		msgblock = ISC_LIST_NEXT(msgblock, link);
-	}
-	while (msgblock != NULL) {
-		next_msgblock = ISC_LIST_NEXT(msgblock, link);
-		ISC_LIST_UNLINK(msg->rdatas, msgblock, link);
-		msgblock_free(msg->mctx, msgblock, sizeof(dns_rdata_t));
-		msgblock = next_msgblock;
-	}
-
-	/*
-	 * rdatalists could be empty.
-	 */
-
-	msgblock = ISC_LIST_HEAD(msg->rdatalists);
-	if (!everything && msgblock != NULL) {
-		msgblock_reset(msgblock);
-		msgblock = ISC_LIST_NEXT(msgblock, link);
-	}
-	while (msgblock != NULL) {
-		next_msgblock = ISC_LIST_NEXT(msgblock, link);
-		ISC_LIST_UNLINK(msg->rdatalists, msgblock, link);
-		msgblock_free(msg->mctx, msgblock, sizeof(dns_rdatalist_t));
-		msgblock = next_msgblock;
-	}
+	msgarena_reset(msg, everything);
 
 	if (msg->tsigkey != NULL) {
 		dns_tsigkey_detach(&msg->tsigkey);
@@ -671,16 +597,13 @@ spacefortsig(dns_tsigkey_t *key, int otherlen) {
 }
 
 void
-dns_message_create(isc_mem_t *mctx, isc_mempool_t *namepool,
-		   isc_mempool_t *rdspool, dns_message_intent_t intent,
+dns_message_create(isc_mem_t *mctx, dns_message_intent_t intent,
 		   dns_message_t **msgp) {
 	REQUIRE(mctx != NULL);
 	REQUIRE(msgp != NULL);
 	REQUIRE(*msgp == NULL);
 	REQUIRE(intent == DNS_MESSAGE_INTENTPARSE ||
 		intent == DNS_MESSAGE_INTENTRENDER);
-	REQUIRE((namepool != NULL && rdspool != NULL) ||
-		(namepool == NULL && rdspool == NULL));
 
 	dns_message_t *msg = isc_mem_get(mctx, sizeof(dns_message_t));
 	*msg = (dns_message_t){
@@ -688,22 +611,16 @@ dns_message_create(isc_mem_t *mctx, isc_mempool_t *namepool,
 		.references = ISC_REFCOUNT_INITIALIZER(1),
 		.scratchpad = ISC_LIST_INITIALIZER,
 		.cleanup = ISC_LIST_INITIALIZER,
-		.rdatas = ISC_LIST_INITIALIZER,
-		.rdatalists = ISC_LIST_INITIALIZER,
+		.arena = ISC_LIST_INITIALIZER,
+		.freename = ISC_LIST_INITIALIZER,
+		.freerdataset = ISC_LIST_INITIALIZER,
 		.freerdata = ISC_LIST_INITIALIZER,
 		.freerdatalist = ISC_LIST_INITIALIZER,
 		.magic = DNS_MESSAGE_MAGIC,
-		.namepool = namepool,
-		.rdspool = rdspool,
-		.free_pools = (namepool == NULL && rdspool == NULL),
 	};
 
 	isc_mem_attach(mctx, &msg->mctx);
 
-	if (msg->free_pools) {
-		dns_message_createpools(mctx, &msg->namepool, &msg->rdspool);
-	}
-
 	msginit(msg);
 
 	for (size_t i = 0; i < DNS_SECTION_MAX; i++) {
@@ -736,10 +653,6 @@ dns__message_destroy(dns_message_t *msg) {
 
 	msg->magic = 0;
 
-	if (msg->free_pools) {
-		dns_message_destroypools(&msg->namepool, &msg->rdspool);
-	}
-
 	isc_mem_putanddetach(&msg->mctx, msg, sizeof(dns_message_t));
 }
 
@@ -2415,7 +2328,16 @@ dns_message_gettempname(dns_message_t *msg, dns_name_t **item) {
 	REQUIRE(DNS_MESSAGE_VALID(msg));
 	REQUIRE(item != NULL && *item == NULL);
 
-	fn = isc_mempool_get(msg->namepool);
+	/*
+	 * 'name' is the first field in dns_fixedname_t, so a name taken
+	 * from the free list is also the address of its fixedname.
+	 */
+	fn = (dns_fixedname_t *)ISC_LIST_HEAD(msg->freename);
+	if (fn != NULL) {
+		ISC_LIST_UNLINK(msg->freename, &fn->name, link);
+	} else {
+		fn = msgarena_get(msg, sizeof(*fn));
+	}
 	*item = dns_fixedname_initname(fn);
 }
 
@@ -2432,7 +2354,12 @@ dns_message_gettemprdataset(dns_message_t *msg, dns_rdataset_t **item) {
 	REQUIRE(DNS_MESSAGE_VALID(msg));
 	REQUIRE(item != NULL && *item == NULL);
 
-	*item = isc_mempool_get(msg->rdspool);
+	*item = ISC_LIST_HEAD(msg->freerdataset);
+	if (*item != NULL) {
+		ISC_LIST_UNLINK(msg->freerdataset, *item, link);
+	} else {
+		*item = msgarena_get(msg, sizeof(**item));
+	}
 	dns_rdataset_init(*item);
 }
 
@@ -2468,12 +2395,7 @@ dns_message_puttempname(dns_message_t *msg, dns_name_t **itemp) {
 		dns_name_free(item, msg->mctx);
 	}
 
-	/*
-	 * 'name' is the first field in dns_fixedname_t, so putting
-	 * back the address of name is the same as putting back
-	 * the fixedname.
-	 */
-	isc_mempool_put(msg->namepool, item);
+	ISC_LIST_PREPEND(msg->freename, item, link);
 }
 
 void
@@ -2497,7 +2419,8 @@ dns_message_puttemprdataset(dns_message_t *msg, dns_rdataset_t **item) {
 	REQUIRE(item != NULL && *item != NULL);
 
 	REQUIRE(!dns_rdataset_isassociated(*item));
-	isc_mempool_put(msg->rdspool, *item);
+	ISC_LIST_PREPEND(msg->freerdataset, *item, link);
+	*item = NULL;
 }
 
 void
@@ -5065,33 +4988,3 @@ dns_message_response_minttl(dns_message_t *msg, dns_ttl_t *pttl) {
 
 	return ISC_R_SUCCESS;
 }
-
-void
-dns_message_createpools(isc_mem_t *mctx, isc_mempool_t **namepoolp,
-			isc_mempool_t **rdspoolp) {
-	REQUIRE(mctx != NULL);
-	REQUIRE(namepoolp != NULL && *namepoolp == NULL);
-	REQUIRE(rdspoolp != NULL && *rdspoolp == NULL);
-
-	isc_mempool_create(mctx, sizeof(dns_fixedname_t), "dns_fixedname_pool",
-			   namepoolp);
-	isc_mempool_setfillcount(*namepoolp, NAME_FILLCOUNT);
-	isc_mempool_setfreemax(*namepoolp, NAME_FREEMAX);
-
-	isc_mempool_create(mctx, sizeof(dns_rdataset_t), "dns_rdataset_pool",
-			   rdspoolp);
-	isc_mempool_setfillcount(*rdspoolp, RDATASET_FILLCOUNT);
-	isc_mempool_setfreemax(*rdspoolp, RDATASET_FREEMAX);
-}
-
-void
-dns_message_destroypools(isc_mempool_t **namepoolp, isc_mempool_t **rdspoolp) {
-	REQUIRE(namepoolp != NULL && *namepoolp != NULL);
-	REQUIRE(rdspoolp != NULL && *rdspoolp != NULL);
-
-	ENSURE(isc_mempool_getallocated(*namepoolp) == 0);
-	ENSURE(isc_mempool_getallocated(*rdspoolp) == 0);
-
-	isc_mempool_destroy(rdspoolp);
-	isc_mempool_destroy(namepoolp);
-}
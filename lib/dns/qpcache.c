@@ -36,6 +36,7 @@
 #include <isc/sieve.h>
 #include <isc/stdio.h>
 #include <isc/string.h>
+#include <isc/thread.h>
 #include <isc/time.h>
 #include <isc/urcu.h>
 #include <isc/util.h>
@@ -43,6 +44,7 @@
 #include <dns/callbacks.h>
 #include <dns/db.h>
 #include <dns/dbiterator.h>
+#include <dns/ecs.h>
 #include <dns/fixedname.h>
 #include <dns/masterdump.h>
 #include <dns/nsec.h>
@@ -139,6 +141,30 @@
  */
 #define DNS_QPDB_EXPIRE_TTL_COUNT 10
 
+/*%
+ * The maximum number of EDNS Client Subnet scoped rdatasets (including
+ * signatures) kept for one name.
+ */
+#define QPCACHE_ECS_MAXENTRIES 16
+
+/*%
+ * Client subnet scoped rdatasets of a node.  Each entry holds the
+ * address prefix the data is valid for (with 'source' set to the scope
+ * prefix length) and a slab header which is kept out of the node's
+ * 'data' list, so it is never returned to a client outside the prefix.
+ * The headers are on the TTL heap and SIEVE list like any other, and
+ * replaced headers are chained through 'down' until the node is cleaned.
+ */
+typedef struct qpc_ecsentry {
+	dns_ecs_t prefix;
+	dns_slabheader_t *header;
+} qpc_ecsentry_t;
+
+typedef struct qpc_ecsindex {
+	unsigned int count;
+	qpc_ecsentry_t entries[QPCACHE_ECS_MAXENTRIES];
+} qpc_ecsindex_t;
+
 /*%
  * This is the structure that is used for each node in the qp trie of
  * trees.
@@ -182,6 +208,11 @@ struct qpcnode {
 	isc_refcount_t erefs;
 	void *data;
 
+	/*%
+	 * Client subnet scoped data; protected by the node lock.
+	 */
+	qpc_ecsindex_t *ecs;
+
 	/*%
 	 * NOTE: The 'dirty' flag is protected by the node lock, so
 	 * this bitfield has to be separated from the one above.
@@ -554,6 +585,33 @@ clean_stale_headers(dns_slabheader_t *top) {
 	top->down = NULL;
 }
 
+/*
+ * Free the expired and replaced client subnet scoped headers of 'node',
+ * and the index itself once it is empty.
+ */
+static void
+clean_ecs_index(qpcnode_t *node) {
+	qpc_ecsindex_t *index = node->ecs;
+	unsigned int n = 0;
+
+	for (unsigned int i = 0; i < index->count; i++) {
+		dns_slabheader_t *header = index->entries[i].header;
+
+		clean_stale_headers(header);
+		if (!EXISTS(header) || ANCIENT(header)) {
+			dns_slabheader_destroy(&header);
+			continue;
+		}
+		index->entries[n++] = index->entries[i];
+	}
+	index->count = n;
+
+	if (index->count == 0) {
+		isc_mem_put(node->mctx, index, sizeof(*index));
+		node->ecs = NULL;
+	}
+}
+
 static void
 clean_cache_node(qpcache_t *qpdb, qpcnode_t *node) {
 	dns_slabheader_t *current = NULL, *top_prev = NULL, *top_next = NULL;
@@ -582,6 +640,9 @@ clean_cache_node(qpcache_t *qpdb, qpcnode_t *node) {
 			top_prev = current;
 		}
 	}
+	if (node->ecs != NULL) {
+		clean_ecs_index(node);
+	}
 	node->dirty = 0;
 }
 
@@ -731,7 +792,7 @@ qpcnode_release(qpcache_t *qpdb, qpcnode_t *node, isc_rwlocktype_t *nlocktypep,
 	}
 
 	/* Handle easy and typical case first. */
-	if (!node->dirty && node->data != NULL) {
+	if (!node->dirty && (node->data != NULL || node->ecs != NULL)) {
 		goto unref;
 	}
 
@@ -762,7 +823,7 @@ qpcnode_release(qpcache_t *qpdb, qpcnode_t *node, isc_rwlocktype_t *nlocktypep,
 		clean_cache_node(qpdb, node);
 	}
 
-	if (node->data != NULL) {
+	if (node->data != NULL || node->ecs != NULL) {
 		goto unref;
 	}
 
@@ -1494,12 +1555,80 @@ qpc_search_init(qpc_search_t *search, qpcache_t *db, unsigned int options,
 	search->zonecut_sigheader = NULL;
 }
 
+/*
+ * Look for a client subnet scoped rdataset of 'type', or a CNAME if
+ * 'cname_ok' is set, whose prefix covers 'addr'; the longest matching
+ * prefix wins.  The signature is looked up under the same prefix.
+ * Rdatasets, and signatures, whose trust level 'options' does not
+ * accept are skipped, as they are by MISSING_ANSWER() in find().
+ *
+ * Caller must be holding the node lock.
+ */
+static bool
+ecs_find(qpcnode_t *node, const isc_netaddr_t *addr, dns_rdatatype_t type,
+	 bool cname_ok, unsigned int options, isc_stdtime_t now,
+	 dns_slabheader_t **foundp, dns_slabheader_t **foundsigp) {
+	qpc_ecsindex_t *index = node->ecs;
+	qpc_ecsentry_t *best = NULL;
+	dns_slabheader_t *sig = NULL;
+	dns_typepair_t sigtype;
+
+	for (unsigned int i = 0; i < index->count; i++) {
+		qpc_ecsentry_t *entry = &index->entries[i];
+		dns_slabheader_t *header = entry->header;
+
+		if (header->type != type &&
+		    (!cname_ok || header->type != dns_rdatatype_cname))
+		{
+			continue;
+		}
+		if (!EXISTS(header) || ANCIENT(header) ||
+		    !ACTIVE(header, now) || MISSING_ANSWER(header, options))
+		{
+			continue;
+		}
+		if (best != NULL && best->prefix.source >= entry->prefix.source)
+		{
+			continue;
+		}
+		if (dns_ecs_covers(&entry->prefix, addr, entry->prefix.source))
+		{
+			best = entry;
+		}
+	}
+
+	if (best == NULL) {
+		return false;
+	}
+
+	sigtype = DNS_SIGTYPE(best->header->type);
+	for (unsigned int i = 0; i < index->count; i++) {
+		qpc_ecsentry_t *entry = &index->entries[i];
+		dns_slabheader_t *header = entry->header;
+
+		if (header->type == sigtype && EXISTS(header) &&
+		    !ANCIENT(header) && ACTIVE(header, now) &&
+		    dns_ecs_equals(&entry->prefix, &best->prefix))
+		{
+			if (MISSING_ANSWER(header, options)) {
+				return false;
+			}
+			sig = header;
+			break;
+		}
+	}
+
+	*foundp = best->header;
+	*foundsigp = sig;
+
+	return true;
+}
+
 static isc_result_t
-qpcache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
-	     dns_rdatatype_t type, unsigned int options, isc_stdtime_t __now,
-	     dns_dbnode_t **nodep, dns_name_t *foundname,
-	     dns_rdataset_t *rdataset,
-	     dns_rdataset_t *sigrdataset DNS__DB_FLARG) {
+find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
+     dns_rdatatype_t type, unsigned int options, isc_stdtime_t __now,
+     dns_dbnode_t **nodep, dns_name_t *foundname, const isc_netaddr_t *ecsaddr,
+     dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset DNS__DB_FLARG) {
 	qpcnode_t *node = NULL;
 	isc_result_t result;
 	bool cname_ok = true;
@@ -1630,6 +1759,19 @@ qpcache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 	cnamesig = NULL;
 	empty_node = true;
 	header_prev = NULL;
+
+	/*
+	 * Data cached for the client's subnet takes precedence over
+	 * data cached for everyone.
+	 */
+	if (ecsaddr != NULL && node->ecs != NULL &&
+	    type != dns_rdatatype_any &&
+	    ecs_find(node, ecsaddr, type, cname_ok, options, search.now,
+		     &found, &foundsig))
+	{
+		goto answer;
+	}
+
 	for (header = node->data; header != NULL; header = header_next) {
 		header_next = header->next;
 		if (check_stale_header(header, &search, &header_prev)) {
@@ -1810,6 +1952,7 @@ qpcache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
 	 * We found what we were looking for, or we found a CNAME.
 	 */
 
+answer:
 	if (nodep != NULL) {
 		qpcnode_acquire(search.qpdb, node, nlocktype,
 				tlocktype DNS__DB_FLARG_PASS);
@@ -1875,6 +2018,39 @@ tree_exit:
 	return result;
 }
 
+static isc_result_t
+qpcache_find(dns_db_t *db, const dns_name_t *name, dns_dbversion_t *version,
+	     dns_rdatatype_t type, unsigned int options, isc_stdtime_t now,
+	     dns_dbnode_t **nodep, dns_name_t *foundname,
+	     dns_rdataset_t *rdataset,
+	     dns_rdataset_t *sigrdataset DNS__DB_FLARG) {
+	return find(db, name, version, type, options, now, nodep, foundname,
+		    NULL, rdataset, sigrdataset DNS__DB_FLARG_PASS);
+}
+
+static isc_result_t
+qpcache_findext(dns_db_t *db, const dns_name_t *name,
+		dns_dbversion_t *version, dns_rdatatype_t type,
+		unsigned int options, isc_stdtime_t now, dns_dbnode_t **nodep,
+		dns_name_t *foundname, dns_clientinfomethods_t *methods,
+		dns_clientinfo_t *clientinfo, dns_rdataset_t *rdataset,
+		dns_rdataset_t *sigrdataset DNS__DB_FLARG) {
+	isc_netaddr_t netaddr, *ecsaddr = NULL;
+	isc_sockaddr_t *sourceip = NULL;
+
+	if (methods != NULL && methods->sourceip != NULL &&
+	    clientinfo != NULL &&
+	    methods->sourceip(clientinfo, &sourceip) == ISC_R_SUCCESS &&
+	    sourceip != NULL)
+	{
+		isc_netaddr_fromsockaddr(&netaddr, sourceip);
+		ecsaddr = &netaddr;
+	}
+
+	return find(db, name, version, type, options, now, nodep, foundname,
+		    ecsaddr, rdataset, sigrdataset DNS__DB_FLARG_PASS);
+}
+
 static isc_result_t
 seek_ns_headers(qpc_search_t *search, qpcnode_t *node, dns_dbnode_t **nodep,
 		dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset,
@@ -2922,6 +3098,99 @@ expire_ttl_headers(qpcache_t *qpdb, unsigned int locknum,
 		   isc_rwlocktype_t *nlocktypep, isc_rwlocktype_t *tlocktypep,
 		   isc_stdtime_t now DNS__DB_FLARG);
 
+/*
+ * Add the slab 'newheader', whose owner name with its original case is
+ * 'name', to 'qpnode'.  The header must already have its expiry time,
+ * trust and attributes set.
+ */
+static isc_result_t
+addheader(qpcache_t *qpdb, qpcnode_t *qpnode, dns_name_t *name,
+	  dns_slabheader_t *newheader, unsigned int options,
+	  dns_rdataset_t *addedrdataset, isc_stdtime_t now DNS__DB_FLARG) {
+	isc_result_t result;
+	dns_rdatatype_t rdtype = DNS_TYPEPAIR_TYPE(newheader->type);
+	bool delegating = false;
+	bool newnsec = false;
+	isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
+	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	isc_rwlock_t *nlock = NULL;
+
+	nlock = &qpdb->buckets[qpnode->locknum].lock;
+
+	/*
+	 * If we're adding a delegation type (which would be an NS or DNAME
+	 * for a zone, but only DNAME counts for a cache), we need to set
+	 * the callback bit on the node.
+	 */
+	if (rdtype == dns_rdatatype_dname) {
+		delegating = true;
+	}
+
+	/*
+	 * Add to the auxiliary NSEC tree if we're adding an NSEC record.
+	 */
+	if (rdtype == dns_rdatatype_nsec) {
+		NODE_RDLOCK(nlock, &nlocktype);
+		if (!qpnode->havensec) {
+			newnsec = true;
+		}
+		NODE_UNLOCK(nlock, &nlocktype);
+	}
+
+	/*
+	 * If we're adding a delegation type or adding to the auxiliary
+	 * NSEC tree, hold an exclusive lock on the tree.
+	 */
+	if (delegating || newnsec) {
+		TREE_WRLOCK(&qpdb->tree_lock, &tlocktype);
+	}
+
+	NODE_WRLOCK(nlock, &nlocktype);
+
+	if (qpdb->rrsetstats != NULL) {
+		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_STATCOUNT);
+		update_rrsetstats(qpdb->rrsetstats, newheader->type,
+				  atomic_load_acquire(&newheader->attributes),
+				  true);
+	}
+
+	expire_ttl_headers(qpdb, qpnode->locknum, &nlocktype, &tlocktype,
+			   now DNS__DB_FLARG_PASS);
+
+	if (newnsec && !qpnode->havensec) {
+		qpcnode_t *nsecnode = NULL;
+
+		result = dns_qp_getname(qpdb->nsec, name, DNS_DBNAMESPACE_NSEC,
+					(void **)&nsecnode, NULL);
+		if (result != ISC_R_SUCCESS) {
+			INSIST(nsecnode == NULL);
+			nsecnode = new_qpcnode(qpdb, name,
+					       DNS_DBNAMESPACE_NSEC);
+			result = dns_qp_insert(qpdb->nsec, nsecnode, 0);
+			INSIST(result == ISC_R_SUCCESS);
+			qpcnode_detach(&nsecnode);
+		}
+		qpnode->havensec = true;
+	}
+
+	result = add(qpdb, qpnode, name, newheader, options, addedrdataset, now,
+		     nlocktype, tlocktype DNS__DB_FLARG_PASS);
+
+	if (result == ISC_R_SUCCESS && delegating) {
+		qpnode->delegating = 1;
+	}
+
+	NODE_UNLOCK(nlock, &nlocktype);
+
+	if (tlocktype != isc_rwlocktype_none) {
+		TREE_UNLOCK(&qpdb->tree_lock, &tlocktype);
+	}
+
+	INSIST(tlocktype == isc_rwlocktype_none);
+
+	return result;
+}
+
 static isc_result_t
 qpcache_addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 		    isc_stdtime_t __now, dns_rdataset_t *rdataset,
@@ -2932,11 +3201,6 @@ qpcache_addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	isc_region_t region;
 	dns_slabheader_t *newheader = NULL;
 	isc_result_t result;
-	bool delegating = false;
-	bool newnsec = false;
-	isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
-	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
-	isc_rwlock_t *nlock = NULL;
 	dns_fixedname_t fixed;
 	dns_name_t *name = NULL;
 	isc_stdtime_t now = __now ? __now : isc_stdtime_now();
@@ -3003,77 +3267,186 @@ qpcache_addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 		}
 	}
 
-	nlock = &qpdb->buckets[qpnode->locknum].lock;
+	return addheader(qpdb, qpnode, name, newheader, options, addedrdataset,
+			 now DNS__DB_FLARG_PASS);
+}
 
-	/*
-	 * If we're adding a delegation type (which would be an NS or DNAME
-	 * for a zone, but only DNAME counts for a cache), we need to set
-	 * the callback bit on the node.
-	 */
-	if (rdataset->type == dns_rdatatype_dname) {
-		delegating = true;
+/*
+ * Caller must be holding the node write lock.
+ */
+static isc_result_t
+ecs_add(qpcache_t *qpdb, qpcnode_t *qpnode, const dns_ecs_t *prefix,
+	dns_slabheader_t *newheader, unsigned int options,
+	dns_rdataset_t *addedrdataset, isc_stdtime_t now,
+	isc_rwlocktype_t *nlocktypep,
+	isc_rwlocktype_t *tlocktypep DNS__DB_FLARG) {
+	qpc_ecsindex_t *index = qpnode->ecs;
+	qpc_ecsentry_t *slot = NULL;
+	dns_trust_t trust;
+
+	if ((options & DNS_DBADD_FORCE) != 0) {
+		trust = dns_trust_ultimate;
+	} else {
+		trust = newheader->trust;
 	}
 
-	/*
-	 * Add to the auxiliary NSEC tree if we're adding an NSEC record.
-	 */
-	if (rdataset->type == dns_rdatatype_nsec) {
-		NODE_RDLOCK(nlock, &nlocktype);
-		if (!qpnode->havensec) {
-			newnsec = true;
+	if (index == NULL) {
+		index = isc_mem_get(qpnode->mctx, sizeof(*index));
+		*index = (qpc_ecsindex_t){ 0 };
+		qpnode->ecs = index;
+	}
+
+	for (unsigned int i = 0; i < index->count; i++) {
+		qpc_ecsentry_t *entry = &index->entries[i];
+
+		if (entry->header->type == newheader->type &&
+		    dns_ecs_equals(&entry->prefix, prefix))
+		{
+			slot = entry;
+			break;
+		}
+	}
+
+	if (slot != NULL) {
+		dns_slabheader_t *header = slot->header;
+
+		/*
+		 * As with global data, lower trust data doesn't replace
+		 * active data.
+		 */
+		if (trust < header->trust && EXISTS(header) &&
+		    !ANCIENT(header) && ACTIVE(header, now))
+		{
+			dns_slabheader_destroy(&newheader);
+			if (addedrdataset != NULL) {
+				bindrdataset(qpdb, qpnode, header, now,
+					     *nlocktypep, *tlocktypep,
+					     addedrdataset DNS__DB_FLARG_PASS);
+			}
+			return DNS_R_UNCHANGED;
+		}
+	} else if (index->count < QPCACHE_ECS_MAXENTRIES) {
+		slot = &index->entries[index->count++];
+		*slot = (qpc_ecsentry_t){ 0 };
+	} else {
+		/*
+		 * The index is full; replace the entry closest to expiry
+		 * (ancient entries have already expired).
+		 */
+		slot = &index->entries[0];
+		for (unsigned int i = 1; i < index->count; i++) {
+			if (index->entries[i].header->expire <
+			    slot->header->expire)
+			{
+				slot = &index->entries[i];
+			}
 		}
-		NODE_UNLOCK(nlock, &nlocktype);
 	}
 
 	/*
-	 * If we're adding a delegation type or adding to the auxiliary
-	 * NSEC tree, hold an exclusive lock on the tree.
+	 * The replaced header may still be bound to rdatasets; it is
+	 * freed when the node is cleaned.
 	 */
-	if (delegating || newnsec) {
-		TREE_WRLOCK(&qpdb->tree_lock, &tlocktype);
+	if (slot->header != NULL) {
+		newheader->down = slot->header;
+		mark_ancient(slot->header);
 	}
+	slot->prefix = *prefix;
+	slot->header = newheader;
 
-	NODE_WRLOCK(nlock, &nlocktype);
+	qpcache_miss(qpdb, newheader, nlocktypep, tlocktypep DNS__DB_FLARG_PASS);
 
-	if (qpdb->rrsetstats != NULL) {
-		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_STATCOUNT);
-		update_rrsetstats(qpdb->rrsetstats, newheader->type,
-				  atomic_load_acquire(&newheader->attributes),
-				  true);
+	if (addedrdataset != NULL) {
+		bindrdataset(qpdb, qpnode, newheader, now, *nlocktypep,
+			     *tlocktypep, addedrdataset DNS__DB_FLARG_PASS);
 	}
 
-	expire_ttl_headers(qpdb, qpnode->locknum, &nlocktype, &tlocktype,
-			   now DNS__DB_FLARG_PASS);
+	return ISC_R_SUCCESS;
+}
 
-	if (newnsec && !qpnode->havensec) {
-		qpcnode_t *nsecnode = NULL;
+static isc_result_t
+qpcache_addecsrdataset(dns_db_t *db, dns_dbnode_t *node, isc_stdtime_t __now,
+		       const dns_ecs_t *ecs, dns_rdataset_t *rdataset,
+		       unsigned int options,
+		       dns_rdataset_t *addedrdataset DNS__DB_FLARG) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+	qpcnode_t *qpnode = (qpcnode_t *)node;
+	isc_region_t region;
+	dns_slabheader_t *newheader = NULL;
+	isc_result_t result;
+	isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
+	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	isc_rwlock_t *nlock = NULL;
+	dns_ecs_t prefix;
+	isc_stdtime_t now = __now ? __now : isc_stdtime_now();
 
-		result = dns_qp_getname(qpdb->nsec, name, DNS_DBNAMESPACE_NSEC,
-					(void **)&nsecnode, NULL);
-		if (result != ISC_R_SUCCESS) {
-			INSIST(nsecnode == NULL);
-			nsecnode = new_qpcnode(qpdb, name,
-					       DNS_DBNAMESPACE_NSEC);
-			result = dns_qp_insert(qpdb->nsec, nsecnode, 0);
-			INSIST(result == ISC_R_SUCCESS);
-			qpcnode_detach(&nsecnode);
+	REQUIRE(VALID_QPDB(qpdb));
+
+	/*
+	 * Negative answers and delegations are only cached globally.
+	 */
+	if (rdataset->attributes.negative ||
+	    rdataset->type == dns_rdatatype_dname ||
+	    rdataset->type == dns_rdatatype_ns)
+	{
+		return ISC_R_NOTIMPLEMENTED;
+	}
+
+	result = dns_rdataslab_fromrdataset(rdataset, qpdb->common.mctx,
+					    &region, qpdb->maxrrperset);
+	if (result != ISC_R_SUCCESS) {
+		if (result == DNS_R_TOOMANYRECORDS) {
+			dns__db_logtoomanyrecords((dns_db_t *)qpdb,
+						  &qpnode->name, rdataset->type,
+						  "adding", qpdb->maxrrperset);
 		}
-		qpnode->havensec = true;
+		return result;
 	}
 
-	result = add(qpdb, qpnode, name, newheader, options, addedrdataset, now,
-		     nlocktype, tlocktype DNS__DB_FLARG_PASS);
+	newheader = (dns_slabheader_t *)region.base;
+	dns_slabheader_reset(newheader, db, node);
 
-	if (result == ISC_R_SUCCESS && delegating) {
-		qpnode->delegating = 1;
+	setttl(newheader, rdataset->ttl + now);
+	if (rdataset->ttl == 0U) {
+		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_ZEROTTL);
 	}
 
-	NODE_UNLOCK(nlock, &nlocktype);
-
-	if (tlocktype != isc_rwlocktype_none) {
-		TREE_UNLOCK(&qpdb->tree_lock, &tlocktype);
+	atomic_init(&newheader->count,
+		    atomic_fetch_add_relaxed(&init_count, 1));
+	if (rdataset->attributes.prefetch) {
+		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_PREFETCH);
+	}
+	if (rdataset->attributes.noqname) {
+		result = addnoqname(qpdb->common.mctx, newheader,
+				    qpdb->maxrrperset, rdataset);
+		if (result != ISC_R_SUCCESS) {
+			dns_slabheader_destroy(&newheader);
+			return result;
+		}
+	}
+	if (rdataset->attributes.closest) {
+		result = addclosest(qpdb->common.mctx, newheader,
+				    qpdb->maxrrperset, rdataset);
+		if (result != ISC_R_SUCCESS) {
+			dns_slabheader_destroy(&newheader);
+			return result;
+		}
 	}
 
+	dns_ecs_fromnetaddr(&prefix, &ecs->addr, ecs->scope);
+
+	nlock = &qpdb->buckets[qpnode->locknum].lock;
+	NODE_WRLOCK(nlock, &nlocktype);
+
+	expire_ttl_headers(qpdb, qpnode->locknum, &nlocktype, &tlocktype,
+			   now DNS__DB_FLARG_PASS);
+
+	result = ecs_add(qpdb, qpnode, &prefix, newheader, options,
+			 addedrdataset, now, &nlocktype,
+			 &tlocktype DNS__DB_FLARG_PASS);
+
+	NODE_UNLOCK(nlock, &nlocktype);
+
 	INSIST(tlocktype == isc_rwlocktype_none);
 
 	return result;
@@ -3093,8 +3466,23 @@ qpcache_deleterdataset(dns_db_t *db, dns_dbnode_t *node,
 	REQUIRE(VALID_QPDB(qpdb));
 	REQUIRE(version == NULL);
 
+	nlock = &qpdb->buckets[qpnode->locknum].lock;
+
+	/*
+	 * Client subnet scoped data is not visible to the rdataset
+	 * iterator; deleting ANY drops all of it.
+	 */
 	if (type == dns_rdatatype_any) {
-		return ISC_R_NOTIMPLEMENTED;
+		result = DNS_R_UNCHANGED;
+		NODE_WRLOCK(nlock, &nlocktype);
+		for (unsigned int i = 0;
+		     qpnode->ecs != NULL && i < qpnode->ecs->count; i++)
+		{
+			mark_ancient(qpnode->ecs->entries[i].header);
+			result = ISC_R_SUCCESS;
+		}
+		NODE_UNLOCK(nlock, &nlocktype);
+		return result;
 	}
 	if (type == dns_rdatatype_rrsig && covers == 0) {
 		return ISC_R_NOTIMPLEMENTED;
@@ -3105,8 +3493,14 @@ qpcache_deleterdataset(dns_db_t *db, dns_dbnode_t *node,
 	setttl(newheader, 0);
 	atomic_init(&newheader->attributes, DNS_SLABHEADERATTR_NONEXISTENT);
 
-	nlock = &qpdb->buckets[qpnode->locknum].lock;
 	NODE_WRLOCK(nlock, &nlocktype);
+	for (unsigned int i = 0; qpnode->ecs != NULL && i < qpnode->ecs->count;
+	     i++)
+	{
+		if (qpnode->ecs->entries[i].header->type == newheader->type) {
+			mark_ancient(qpnode->ecs->entries[i].header);
+		}
+	}
 	result = add(qpdb, qpnode, NULL, newheader, DNS_DBADD_FORCE, NULL, 0,
 		     nlocktype, isc_rwlocktype_none DNS__DB_FLARG_PASS);
 	NODE_UNLOCK(nlock, &nlocktype);
@@ -3114,6 +3508,504 @@ qpcache_deleterdataset(dns_db_t *db, dns_dbnode_t *node,
 	return result;
 }
 
+/*
+ * Cache snapshots.
+ *
+ * A snapshot starts with a fixed header holding a magic number, the
+ * format version, the class of the cache and the time the snapshot was
+ * written.  It is followed by a sequence of sections, each prefixed by
+ * its length in octets and the number of nodes it holds, and terminated
+ * by an empty section.  Sections are self-contained so that they can be
+ * loaded in parallel.
+ *
+ * A node is stored as its owner name in uncompressed wire format and the
+ * number of rdatasets that follow; each rdataset is stored as its type
+ * pair, trust, attributes, absolute expiry time, owner name case and raw
+ * slab.  All integers are in network byte order.
+ *
+ * Only the top header of each type is saved, and only while it can still
+ * be served (possibly as stale data).  Rdatasets carrying noqname or
+ * closest encloser proofs and client subnet scoped data are not saved.
+ */
+#define QPCACHE_SNAPSHOT_MAGIC	 ISC_MAGIC('Q', 'P', 'C', 'S')
+#define QPCACHE_SNAPSHOT_VERSION 1
+#define QPCACHE_SNAPSHOT_HDRLEN	 16
+#define QPCACHE_SNAPSHOT_SECTLEN 8
+#define QPCACHE_SNAPSHOT_RDSLEN	 (4 + 1 + 2 + 4 + 32 + 4)
+#define QPCACHE_SNAPSHOT_NODES	 4096 /* nodes per section */
+#define QPCACHE_SNAPSHOT_ATTRS                                       \
+	(DNS_SLABHEADERATTR_NXDOMAIN | DNS_SLABHEADERATTR_OPTOUT |    \
+	 DNS_SLABHEADERATTR_NEGATIVE | DNS_SLABHEADERATTR_PREFETCH |  \
+	 DNS_SLABHEADERATTR_CASESET | DNS_SLABHEADERATTR_ZEROTTL |    \
+	 DNS_SLABHEADERATTR_CASEFULLYLOWER)
+
+typedef struct qpc_snapsection {
+	off_t offset;
+	uint32_t length;
+} qpc_snapsection_t;
+
+typedef struct qpc_snapload {
+	qpcache_t *qpdb;
+	const char *filename;
+	isc_stdtime_t now;
+	qpc_snapsection_t *sections;
+	size_t nsections;
+	atomic_uint_fast32_t next;
+} qpc_snapload_t;
+
+typedef struct qpc_snapworker {
+	qpc_snapload_t *load;
+	isc_thread_t thread;
+	isc_result_t result;
+	uint64_t count;
+} qpc_snapworker_t;
+
+static bool
+snapshot_usable(qpcache_t *qpdb, dns_slabheader_t *header, isc_stdtime_t now) {
+	return EXISTS(header) && !ANCIENT(header) && header->noqname == NULL &&
+	       header->closest == NULL &&
+	       header->expire + STALE_TTL(header, qpdb) > now;
+}
+
+static unsigned int
+snapshot_putnode(qpcache_t *qpdb, qpcnode_t *node, isc_stdtime_t now,
+		 isc_buffer_t *b) {
+	isc_rwlock_t *nlock = &qpdb->buckets[node->locknum].lock;
+	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+	unsigned int start = isc_buffer_usedlength(b);
+	unsigned int count = 0;
+	isc_buffer_t countbuf;
+	isc_region_t r;
+
+	dns_name_toregion(&node->name, &r);
+	isc_buffer_putmem(b, r.base, r.length);
+	isc_buffer_putuint16(b, 0);
+
+	NODE_RDLOCK(nlock, &nlocktype);
+	for (dns_slabheader_t *header = node->data; header != NULL;
+	     header = header->next)
+	{
+		unsigned int length;
+
+		if (!snapshot_usable(qpdb, header, now)) {
+			continue;
+		}
+
+		length = dns_rdataslab_size(header) - sizeof(*header);
+		isc_buffer_putuint32(b, header->type);
+		isc_buffer_putuint8(b, header->trust);
+		isc_buffer_putuint16(b, DNS_SLABHEADER_GETATTR(
+						header, QPCACHE_SNAPSHOT_ATTRS));
+		isc_buffer_putuint32(b, header->expire);
+		isc_buffer_putmem(b, header->upper, sizeof(header->upper));
+		isc_buffer_putuint32(b, length);
+		isc_buffer_putmem(b, dns_slabheader_raw(header), length);
+		count++;
+	}
+	NODE_UNLOCK(nlock, &nlocktype);
+
+	if (count == 0) {
+		isc_buffer_subtract(b, isc_buffer_usedlength(b) - start);
+		return 0;
+	}
+
+	isc_buffer_init(&countbuf, (unsigned char *)isc_buffer_base(b) + start +
+					   r.length,
+			2);
+	isc_buffer_putuint16(&countbuf, count);
+
+	return count;
+}
+
+static isc_result_t
+snapshot_flush(FILE *fp, isc_buffer_t *b, unsigned int nodes) {
+	isc_result_t result;
+	unsigned char data[QPCACHE_SNAPSHOT_SECTLEN];
+	isc_buffer_t hdr;
+	isc_region_t r;
+
+	isc_buffer_init(&hdr, data, sizeof(data));
+	isc_buffer_putuint32(&hdr, isc_buffer_usedlength(b));
+	isc_buffer_putuint32(&hdr, nodes);
+
+	result = isc_stdio_write(data, sizeof(data), 1, fp, NULL);
+	if (result == ISC_R_SUCCESS && isc_buffer_usedlength(b) > 0) {
+		isc_buffer_usedregion(b, &r);
+		result = isc_stdio_write(r.base, r.length, 1, fp, NULL);
+	}
+	isc_buffer_clear(b);
+
+	return result;
+}
+
+static isc_result_t
+qpcache_savesnapshot(dns_db_t *db, FILE *fp, uint64_t *countp) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+	isc_result_t result;
+	dns_dbiterator_t *dbiter = NULL;
+	isc_buffer_t *b = NULL;
+	unsigned char data[QPCACHE_SNAPSHOT_HDRLEN];
+	isc_buffer_t hdr;
+	isc_stdtime_t now = isc_stdtime_now();
+	unsigned int nodes = 0;
+	uint64_t count = 0;
+
+	REQUIRE(VALID_QPDB(qpdb));
+
+	isc_buffer_init(&hdr, data, sizeof(data));
+	isc_buffer_putuint32(&hdr, QPCACHE_SNAPSHOT_MAGIC);
+	isc_buffer_putuint16(&hdr, QPCACHE_SNAPSHOT_VERSION);
+	isc_buffer_putuint16(&hdr, qpdb->common.rdclass);
+	isc_buffer_putuint32(&hdr, now);
+	isc_buffer_putuint32(&hdr, 0); /* reserved */
+	CHECK(isc_stdio_write(data, sizeof(data), 1, fp, NULL));
+
+	CHECK(dns_db_createiterator(db, 0, &dbiter));
+	isc_buffer_allocate(qpdb->common.mctx, &b, 65536);
+
+	for (result = dns_dbiterator_first(dbiter); result == ISC_R_SUCCESS;
+	     result = dns_dbiterator_next(dbiter))
+	{
+		dns_dbnode_t *node = NULL;
+		unsigned int n;
+
+		CHECK(dns_dbiterator_current(dbiter, &node, NULL));
+		RUNTIME_CHECK(dns_dbiterator_pause(dbiter) == ISC_R_SUCCESS);
+
+		n = snapshot_putnode(qpdb, (qpcnode_t *)node, now, b);
+		dns_db_detachnode(db, &node);
+		if (n == 0) {
+			continue;
+		}
+
+		count += n;
+		if (++nodes == QPCACHE_SNAPSHOT_NODES) {
+			CHECK(snapshot_flush(fp, b, nodes));
+			nodes = 0;
+		}
+	}
+	if (result != ISC_R_NOMORE) {
+		goto failure;
+	}
+
+	if (nodes > 0) {
+		CHECK(snapshot_flush(fp, b, nodes));
+	}
+	CHECK(snapshot_flush(fp, b, 0));
+
+	*countp = count;
+
+failure:
+	if (b != NULL) {
+		isc_buffer_free(&b);
+	}
+	if (dbiter != NULL) {
+		dns_dbiterator_destroy(&dbiter);
+	}
+
+	return result;
+}
+
+static isc_result_t
+snapshot_read(FILE *fp, void *data, size_t length) {
+	isc_result_t result = isc_stdio_read(data, length, 1, fp, NULL);
+
+	return result == ISC_R_EOF ? ISC_R_UNEXPECTEDEND : result;
+}
+
+/*
+ * Check that 'length' octets at 'raw' hold a well-formed slab.
+ */
+static bool
+snapshot_checkslab(unsigned char *raw, uint32_t length) {
+	isc_buffer_t b;
+	uint16_t count;
+
+	isc_buffer_init(&b, raw, length);
+	isc_buffer_add(&b, length);
+
+	if (isc_buffer_remaininglength(&b) < 2) {
+		return false;
+	}
+	count = isc_buffer_getuint16(&b);
+	while (count-- > 0) {
+		uint16_t itemlen;
+
+		if (isc_buffer_remaininglength(&b) < 2) {
+			return false;
+		}
+		itemlen = isc_buffer_getuint16(&b);
+		if (isc_buffer_remaininglength(&b) < itemlen) {
+			return false;
+		}
+		isc_buffer_forward(&b, itemlen);
+	}
+
+	return isc_buffer_remaininglength(&b) == 0;
+}
+
+static isc_result_t
+snapshot_loadnode(qpcache_t *qpdb, isc_buffer_t *b, isc_stdtime_t now,
+		  uint64_t *countp) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	dns_dbnode_t *node = NULL;
+	unsigned int count;
+
+	CHECK(dns_name_fromwire(name, b, DNS_DECOMPRESS_NEVER, NULL));
+	if (isc_buffer_remaininglength(b) < 2) {
+		CHECK(ISC_R_UNEXPECTEDEND);
+	}
+	count = isc_buffer_getuint16(b);
+
+	while (count-- > 0) {
+		dns_slabheader_t *newheader = NULL;
+		dns_typepair_t type;
+		dns_trust_t trust;
+		uint_least16_t attributes;
+		isc_stdtime_t expire;
+		dns_ttl_t stale_ttl;
+		unsigned char *upper = NULL, *raw = NULL;
+		uint32_t length;
+
+		if (isc_buffer_remaininglength(b) < QPCACHE_SNAPSHOT_RDSLEN) {
+			CHECK(ISC_R_UNEXPECTEDEND);
+		}
+		type = isc_buffer_getuint32(b);
+		trust = isc_buffer_getuint8(b);
+		attributes = isc_buffer_getuint16(b) & QPCACHE_SNAPSHOT_ATTRS;
+		expire = isc_buffer_getuint32(b);
+		upper = isc_buffer_current(b);
+		isc_buffer_forward(b, sizeof(newheader->upper));
+		length = isc_buffer_getuint32(b);
+		if (isc_buffer_remaininglength(b) < length) {
+			CHECK(ISC_R_UNEXPECTEDEND);
+		}
+		raw = isc_buffer_current(b);
+		isc_buffer_forward(b, length);
+
+		if (trust > dns_trust_ultimate ||
+		    !snapshot_checkslab(raw, length))
+		{
+			CHECK(DNS_R_BADDB);
+		}
+
+		/*
+		 * Skip data that can no longer be served, not even as
+		 * stale data.
+		 */
+		stale_ttl = (attributes & DNS_SLABHEADERATTR_NXDOMAIN) != 0
+				    ? 0
+				    : qpdb->common.serve_stale_ttl;
+		if (expire + stale_ttl <= now) {
+			continue;
+		}
+
+		if (node == NULL) {
+			CHECK(qpcache_findnode((dns_db_t *)qpdb, name, true,
+					       &node DNS__DB_FILELINE));
+		}
+
+		newheader = isc_mem_get(qpdb->common.mctx,
+					sizeof(*newheader) + length);
+		*newheader = (dns_slabheader_t){
+			.type = type,
+			.trust = trust,
+			.expire = expire,
+			.link = ISC_LINK_INITIALIZER,
+		};
+		dns_slabheader_reset(newheader, (dns_db_t *)qpdb, node);
+		memmove(newheader->upper, upper, sizeof(newheader->upper));
+		memmove(dns_slabheader_raw(newheader), raw, length);
+		DNS_SLABHEADER_SETATTR(newheader, attributes);
+		atomic_init(&newheader->count,
+			    atomic_fetch_add_relaxed(&init_count, 1));
+
+		result = addheader(qpdb, (qpcnode_t *)node, name, newheader, 0,
+				   NULL, now DNS__DB_FILELINE);
+		if (result == ISC_R_SUCCESS) {
+			(*countp)++;
+		} else if (result != DNS_R_UNCHANGED) {
+			goto failure;
+		}
+	}
+
+	result = ISC_R_SUCCESS;
+
+failure:
+	if (node != NULL) {
+		qpcache_detachnode((dns_db_t *)qpdb, &node DNS__DB_FILELINE);
+	}
+
+	return result;
+}
+
+static isc_result_t
+snapshot_loadsection(qpc_snapload_t *load, FILE *fp, qpc_snapsection_t *section,
+		     uint64_t *countp) {
+	isc_mem_t *mctx = load->qpdb->common.mctx;
+	isc_result_t result;
+	unsigned char *data = NULL;
+	isc_buffer_t b;
+
+	CHECK(isc_stdio_seek(fp, section->offset, SEEK_SET));
+
+	data = isc_mem_get(mctx, section->length);
+	CHECK(snapshot_read(fp, data, section->length));
+
+	isc_buffer_init(&b, data, section->length);
+	isc_buffer_add(&b, section->length);
+	while (isc_buffer_remaininglength(&b) > 0) {
+		CHECK(snapshot_loadnode(load->qpdb, &b, load->now, countp));
+	}
+
+failure:
+	if (data != NULL) {
+		isc_mem_put(mctx, data, section->length);
+	}
+
+	return result;
+}
+
+static void *
+snapshot_loadworker(void *arg) {
+	qpc_snapworker_t *worker = arg;
+	qpc_snapload_t *load = worker->load;
+	FILE *fp = NULL;
+	size_t i;
+
+	worker->result = isc_stdio_open(load->filename, "rb", &fp);
+	if (worker->result != ISC_R_SUCCESS) {
+		return NULL;
+	}
+
+	while ((i = atomic_fetch_add_relaxed(&load->next, 1)) <
+	       load->nsections)
+	{
+		worker->result = snapshot_loadsection(load, fp,
+						      &load->sections[i],
+						      &worker->count);
+		if (worker->result != ISC_R_SUCCESS) {
+			break;
+		}
+	}
+
+	(void)isc_stdio_close(fp);
+
+	return NULL;
+}
+
+static isc_result_t
+qpcache_loadsnapshot(dns_db_t *db, const char *filename, unsigned int nthreads,
+		     uint64_t *countp) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+	isc_result_t result;
+	FILE *fp = NULL;
+	unsigned char data[QPCACHE_SNAPSHOT_HDRLEN];
+	isc_buffer_t b;
+	off_t offset = QPCACHE_SNAPSHOT_HDRLEN;
+	size_t allocated = 0;
+	qpc_snapworker_t *workers = NULL;
+	qpc_snapload_t load = {
+		.qpdb = qpdb,
+		.filename = filename,
+		.now = isc_stdtime_now(),
+	};
+	uint64_t count = 0;
+
+	REQUIRE(VALID_QPDB(qpdb));
+	REQUIRE(filename != NULL);
+
+	CHECK(isc_stdio_open(filename, "rb", &fp));
+
+	CHECK(snapshot_read(fp, data, sizeof(data)));
+	isc_buffer_init(&b, data, sizeof(data));
+	isc_buffer_add(&b, sizeof(data));
+	if (isc_buffer_getuint32(&b) != QPCACHE_SNAPSHOT_MAGIC ||
+	    isc_buffer_getuint16(&b) != QPCACHE_SNAPSHOT_VERSION)
+	{
+		CHECK(ISC_R_NOTIMPLEMENTED);
+	}
+	if (isc_buffer_getuint16(&b) != qpdb->common.rdclass) {
+		CHECK(DNS_R_BADCLASS);
+	}
+
+	/*
+	 * Find the sections; they are loaded by the workers below.
+	 */
+	for (;;) {
+		uint32_t length;
+
+		CHECK(snapshot_read(fp, data, QPCACHE_SNAPSHOT_SECTLEN));
+		isc_buffer_init(&b, data, QPCACHE_SNAPSHOT_SECTLEN);
+		isc_buffer_add(&b, QPCACHE_SNAPSHOT_SECTLEN);
+		length = isc_buffer_getuint32(&b);
+		if (length == 0) {
+			break;
+		}
+		offset += QPCACHE_SNAPSHOT_SECTLEN;
+
+		if (load.nsections == allocated) {
+			size_t newalloc = ISC_MAX(allocated * 2, 64);
+			load.sections = isc_mem_creget(
+				qpdb->common.mctx, load.sections, allocated,
+				newalloc, sizeof(load.sections[0]));
+			allocated = newalloc;
+		}
+		load.sections[load.nsections++] = (qpc_snapsection_t){
+			.offset = offset,
+			.length = length,
+		};
+
+		offset += length;
+		CHECK(isc_stdio_seek(fp, offset, SEEK_SET));
+	}
+
+	nthreads = ISC_MAX(ISC_MIN(nthreads, load.nsections), 1);
+	workers = isc_mem_cget(qpdb->common.mctx, nthreads, sizeof(workers[0]));
+	for (unsigned int i = 0; i < nthreads; i++) {
+		workers[i].load = &load;
+	}
+
+	/*
+	 * The calling thread takes a share of the work too.
+	 */
+	for (unsigned int i = 1; i < nthreads; i++) {
+		isc_thread_create(snapshot_loadworker, &workers[i],
+				  &workers[i].thread);
+	}
+	(void)snapshot_loadworker(&workers[0]);
+
+	result = ISC_R_SUCCESS;
+	for (unsigned int i = 0; i < nthreads; i++) {
+		if (i > 0) {
+			isc_thread_join(workers[i].thread, NULL);
+		}
+		if (result == ISC_R_SUCCESS) {
+			result = workers[i].result;
+		}
+		count += workers[i].count;
+	}
+
+	*countp = count;
+
+failure:
+	if (workers != NULL) {
+		isc_mem_cput(qpdb->common.mctx, workers, nthreads,
+			     sizeof(workers[0]));
+	}
+	if (load.sections != NULL) {
+		isc_mem_cput(qpdb->common.mctx, load.sections, allocated,
+			     sizeof(load.sections[0]));
+	}
+	if (fp != NULL) {
+		(void)isc_stdio_close(fp);
+	}
+
+	return result;
+}
+
 static unsigned int
 nodecount(dns_db_t *db, dns_dbtree_t tree) {
 	qpcache_t *qpdb = (qpcache_t *)db;
@@ -3804,6 +4696,10 @@ static dns_dbmethods_t qpdb_cachemethods = {
 	.deletedata = deletedata,
 	.setmaxrrperset = setmaxrrperset,
 	.setmaxtypepername = setmaxtypepername,
+	.findext = qpcache_findext,
+	.addecsrdataset = qpcache_addecsrdataset,
+	.savesnapshot = qpcache_savesnapshot,
+	.loadsnapshot = qpcache_loadsnapshot,
 };
 
 static void
@@ -3823,6 +4719,15 @@ qpcnode_destroy(qpcnode_t *data) {
 		dns_slabheader_destroy(&current);
 	}
 
+	if (data->ecs != NULL) {
+		for (unsigned int i = 0; i < data->ecs->count; i++) {
+			current = data->ecs->entries[i].header;
+			clean_stale_headers(current);
+			dns_slabheader_destroy(&current);
+		}
+		isc_mem_put(data->mctx, data->ecs, sizeof(*data->ecs));
+	}
+
 	dns_name_free(&data->name, data->mctx);
 	isc_mem_putanddetach(&data->mctx, data, sizeof(qpcnode_t));
 }
@@ -21,6 +21,7 @@
 #include <isc/ascii.h>
 #include <isc/async.h>
 #include <isc/atomic.h>
+#include <isc/endian.h>
 #include <isc/file.h>
 #include <isc/heap.h>
 #include <isc/hex.h>
@@ -2166,9 +2167,8 @@ addwildcards(qpzonedb_t *qpdb, dns_qp_t *qp, const dns_name_t *name,
 }
 
 static isc_result_t
-loading_addrdataset(void *arg, const dns_name_t *name,
-		    dns_rdataset_t *rdataset DNS__DB_FLARG) {
-	qpz_load_t *loadctx = arg;
+loading_add(qpz_load_t *loadctx, const dns_name_t *name,
+	    dns_rdataset_t *rdataset, const isc_region_t *slab DNS__DB_FLARG) {
 	qpzonedb_t *qpdb = (qpzonedb_t *)loadctx->db;
 	qpznode_t *node = NULL;
 	isc_result_t result = ISC_R_SUCCESS;
@@ -2213,9 +2213,30 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 			      DNS_DBNAMESPACE_NORMAL);
 	}
 
-	loading_addnode(loadctx, name, rdataset->type, rdataset->covers, &node);
-	result = dns_rdataslab_fromrdataset(rdataset, qpdb->common.mctx,
-					    &region, qpdb->maxrrperset);
+	if (slab != NULL && qpdb->maxrrperset > 0 &&
+	    (uint32_t)ISC_U8TO16_BE(slab->base) > qpdb->maxrrperset)
+	{
+		result = DNS_R_TOOMANYRECORDS;
+	} else if (slab != NULL) {
+		/*
+		 * The loader has checked the rdata in the slab image, and
+		 * that they are sorted and free of duplicates; just copy it.
+		 */
+		region.length = sizeof(dns_slabheader_t) + slab->length;
+		region.base = isc_mem_get(qpdb->common.mctx, region.length);
+		memmove(region.base + sizeof(dns_slabheader_t), slab->base,
+			slab->length);
+		*(dns_slabheader_t *)region.base = (dns_slabheader_t){
+			.type = DNS_TYPEPAIR_VALUE(rdataset->type,
+						   rdataset->covers),
+			.link = ISC_LINK_INITIALIZER,
+		};
+		result = ISC_R_SUCCESS;
+	} else {
+		result = dns_rdataslab_fromrdataset(rdataset,
+						    qpdb->common.mctx, &region,
+						    qpdb->maxrrperset);
+	}
 	if (result != ISC_R_SUCCESS) {
 		if (result == DNS_R_TOOMANYRECORDS) {
 			dns__db_logtoomanyrecords((dns_db_t *)qpdb, name,
@@ -2225,6 +2246,8 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 		return result;
 	}
 
+	loading_addnode(loadctx, name, rdataset->type, rdataset->covers, &node);
+
 	newheader = (dns_slabheader_t *)region.base;
 	dns_slabheader_reset(newheader, (dns_db_t *)qpdb, (dns_dbnode_t *)node);
 
@@ -2260,6 +2283,18 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	return result;
 }
 
+static isc_result_t
+loading_addrdataset(void *arg, const dns_name_t *name,
+		    dns_rdataset_t *rdataset DNS__DB_FLARG) {
+	return loading_add(arg, name, rdataset, NULL DNS__DB_FLARG_PASS);
+}
+
+static isc_result_t
+loading_addslab(void *arg, const dns_name_t *name, dns_rdataset_t *rdataset,
+		const isc_region_t *slab DNS__DB_FLARG) {
+	return loading_add(arg, name, rdataset, slab DNS__DB_FLARG_PASS);
+}
+
 static void
 loading_setup(void *arg) {
 	qpz_load_t *loadctx = arg;
@@ -2300,6 +2335,7 @@ beginload(dns_db_t *db, dns_rdatacallbacks_t *callbacks) {
 	RWUNLOCK(&qpdb->lock, isc_rwlocktype_write);
 
 	callbacks->add = loading_addrdataset;
+	callbacks->addslab = loading_addslab;
 	callbacks->setup = loading_setup;
 	callbacks->commit = loading_commit;
 	callbacks->add_private = loadctx;
@@ -2335,6 +2371,7 @@ endload(dns_db_t *db, dns_rdatacallbacks_t *callbacks) {
 	}
 
 	callbacks->add = NULL;
+	callbacks->addslab = NULL;
 	callbacks->setup = NULL;
 	callbacks->commit = NULL;
 	callbacks->add_private = NULL;
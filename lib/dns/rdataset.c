@@ -224,6 +224,34 @@ swap_rdata(dns_rdata_t *in, unsigned int a, unsigned int b) {
 	in[b] = rdata;
 }
 
+/*
+ * Types whose rdata contains no domain names, and whose wire format is
+ * therefore exactly the stored rdata.  These can be copied out verbatim
+ * without going through dns_rdata_towire() and the compression context.
+ */
+static bool
+verbatim_rdata(const dns_rdataset_t *rdataset) {
+	switch (rdataset->type) {
+	case dns_rdatatype_a:
+		/* A in class CH contains a domain name */
+		return rdataset->rdclass == dns_rdataclass_in;
+	case dns_rdatatype_aaaa:
+	case dns_rdatatype_caa:
+	case dns_rdatatype_cdnskey:
+	case dns_rdatatype_cds:
+	case dns_rdatatype_dnskey:
+	case dns_rdatatype_ds:
+	case dns_rdatatype_nsec3:
+	case dns_rdatatype_nsec3param:
+	case dns_rdatatype_sshfp:
+	case dns_rdatatype_tlsa:
+	case dns_rdatatype_txt:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static isc_result_t
 towire(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
        dns_compress_t *cctx, isc_buffer_t *target, bool partial,
@@ -236,6 +264,7 @@ towire(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
 	unsigned int headlen;
 	bool question = false;
 	bool shuffle = false;
+	bool verbatim = false;
 	bool want_random, want_cyclic;
 	dns_rdata_t in_fixed[MAX_SHUFFLE];
 	dns_rdata_t *in = in_fixed;
@@ -345,6 +374,13 @@ towire(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
 		}
 	}
 
+	/*
+	 * With the owner name turned into a compression pointer by
+	 * dns_name_towire() after the first record, every record of a
+	 * verbatim rdataset is then a fixed header plus a plain copy.
+	 */
+	verbatim = !question && verbatim_rdata(rdataset);
+
 	savedbuffer = *target;
 	i = 0;
 	added = 0;
@@ -398,9 +434,20 @@ towire(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
 				dns_rdata_reset(&rdata);
 				dns_rdataset_current(rdataset, &rdata);
 			}
-			result = dns_rdata_towire(&rdata, cctx, target);
-			if (result != ISC_R_SUCCESS) {
-				goto rollback;
+			if (verbatim) {
+				if (isc_buffer_availablelength(target) <
+				    rdata.length)
+				{
+					result = ISC_R_NOSPACE;
+					goto rollback;
+				}
+				isc_buffer_putmem(target, rdata.data,
+						  rdata.length);
+			} else {
+				result = dns_rdata_towire(&rdata, cctx, target);
+				if (result != ISC_R_SUCCESS) {
+					goto rollback;
+				}
 			}
 			INSIST((target->used >= rdlen.used + 2) &&
 			       (target->used - rdlen.used - 2 < 65536));
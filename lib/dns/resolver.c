@@ -48,6 +48,7 @@
 #include <dns/dns64.h>
 #include <dns/dnstap.h>
 #include <dns/ds.h>
+#include <dns/ecs.h>
 #include <dns/ede.h>
 #include <dns/edns.h>
 #include <dns/forward.h>
@@ -246,6 +247,20 @@ STATIC_ASSERT(NS_PROCESSING_LIMIT > NS_RR_LIMIT,
 #define RES_DOMAIN_HASH_BITS 12
 #endif /* ifndef RES_DOMAIN_HASH_BITS */
 
+/*
+ * The fetch contexts and the zone counters are spread over
+ * RES_SHARDS independently locked hash tables, picked by the hash
+ * value, so that loops working on unrelated names do not serialize
+ * on a single lock.
+ */
+#ifndef RES_SHARD_BITS
+#define RES_SHARD_BITS 6
+#endif /* ifndef RES_SHARD_BITS */
+#define RES_SHARDS (1U << RES_SHARD_BITS)
+
+STATIC_ASSERT(RES_SHARD_BITS < RES_DOMAIN_HASH_BITS,
+	      "RES_SHARD_BITS must be smaller than RES_DOMAIN_HASH_BITS");
+
 /*%
  * Maximum EDNS0 input packet size.
  */
@@ -337,6 +352,16 @@ struct fctxcount {
 	isc_stdtime_t logged;
 };
 
+typedef struct res_shard {
+	isc_rwlock_t lock;
+	isc_hashmap_t *table;
+
+	/* Padding to prevent false sharing between locks. */
+	uint8_t __padding[ISC_OS_CACHELINE_SIZE -
+			  (sizeof(isc_rwlock_t) + sizeof(isc_hashmap_t *)) %
+				  ISC_OS_CACHELINE_SIZE];
+} res_shard_t;
+
 struct fetchctx {
 	/*% Not locked. */
 	unsigned int magic;
@@ -480,6 +505,13 @@ struct fetchctx {
 	unsigned int depth;
 	char clientstr[ISC_SOCKADDR_FORMATSIZE];
 
+	/*%
+	 * EDNS Client Subnet sent with the queries (source 0 if none),
+	 * and the scope returned with the response being processed.
+	 */
+	dns_ecs_t ecs;
+	uint8_t ecsscope;
+
 	isc_counter_t *nvalidations;
 	isc_counter_t *nfails;
 };
@@ -560,11 +592,8 @@ struct dns_resolver {
 	dns_dispatchset_t *dispatches4;
 	dns_dispatchset_t *dispatches6;
 
-	isc_hashmap_t *fctxs;
-	isc_rwlock_t fctxs_lock;
-
-	isc_hashmap_t *counters;
-	isc_rwlock_t counters_lock;
+	res_shard_t *fctxs;    /* RES_SHARDS fetch context tables */
+	res_shard_t *counters; /* RES_SHARDS zone counter tables */
 
 	uint32_t lame_ttl;
 	ISC_LIST(alternate_t) alternates;
@@ -601,9 +630,6 @@ struct dns_resolver {
 	dns_fetch_t *primefetch;
 
 	uint32_t nloops;
-
-	isc_mempool_t **namepools;
-	isc_mempool_t **rdspools;
 };
 
 #define RES_MAGIC	    ISC_MAGIC('R', 'e', 's', '!')
@@ -622,6 +648,13 @@ enum {
 	FCTX_ADDRINFO_NOEDNS0 = 1 << 6,
 };
 
+STATIC_ASSERT((FCTX_ADDRINFO_EDNSOK & DNS_ADB_SNAPSHOTFLAGS) != 0 &&
+		      (FCTX_ADDRINFO_NOEDNS0 & DNS_ADB_SNAPSHOTFLAGS) != 0,
+	      "EDNS flags must be saved in ADB snapshots");
+STATIC_ASSERT(((DNS_FETCHOPT_EDNSVERSIONSET | DNS_FETCHOPT_EDNSVERSIONMASK) &
+	       ~DNS_ADB_SNAPSHOTFLAGS) == 0,
+	      "EDNS version must be saved in ADB snapshots");
+
 #define UNMARKED(a)    (((a)->flags & FCTX_ADDRINFO_MARK) == 0)
 #define ISFORWARDER(a) (((a)->flags & FCTX_ADDRINFO_FORWARDER) != 0)
 #define NOCOOKIE(a)    (((a)->flags & FCTX_ADDRINFO_NOCOOKIE) != 0)
@@ -961,6 +994,51 @@ set_stats(dns_resolver_t *res, isc_statscounter_t counter, uint64_t val) {
 	}
 }
 
+static res_shard_t *
+shard_get(res_shard_t *shards, uint32_t hashval) {
+	return &shards[hashval & (RES_SHARDS - 1)];
+}
+
+/*%
+ * Lock a table shard, counting the times we had to wait for it.
+ */
+static void
+shard_lock(dns_resolver_t *res, res_shard_t *shard,
+	   isc_rwlocktype_t locktype) {
+	if (isc_rwlock_trylock(&shard->lock, locktype) != ISC_R_SUCCESS) {
+		inc_stats(res, dns_resstatscounter_lockcontended);
+		RWLOCK(&shard->lock, locktype);
+	}
+}
+
+static void
+shards_create(isc_mem_t *mctx, res_shard_t **shardsp) {
+	res_shard_t *shards = isc_mem_cget(mctx, RES_SHARDS, sizeof(*shards));
+
+	for (size_t i = 0; i < RES_SHARDS; i++) {
+		isc_hashmap_create(mctx, RES_DOMAIN_HASH_BITS - RES_SHARD_BITS,
+				   &shards[i].table);
+		isc_rwlock_init(&shards[i].lock);
+	}
+
+	*shardsp = shards;
+}
+
+static void
+shards_destroy(isc_mem_t *mctx, res_shard_t **shardsp) {
+	res_shard_t *shards = *shardsp;
+
+	*shardsp = NULL;
+
+	for (size_t i = 0; i < RES_SHARDS; i++) {
+		INSIST(isc_hashmap_count(shards[i].table) == 0);
+		isc_hashmap_destroy(&shards[i].table);
+		isc_rwlock_destroy(&shards[i].lock);
+	}
+
+	isc_mem_cput(mctx, shards, RES_SHARDS, sizeof(*shards));
+}
+
 static void
 valcreate(fetchctx_t *fctx, dns_message_t *message, dns_adbaddrinfo_t *addrinfo,
 	  dns_name_t *name, dns_rdatatype_t type, dns_rdataset_t *rdataset,
@@ -1392,6 +1470,7 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 	isc_result_t result = ISC_R_SUCCESS;
 	dns_resolver_t *res = NULL;
 	fctxcount_t *counter = NULL;
+	res_shard_t *shard = NULL;
 	uint32_t hashval;
 	uint_fast32_t spill;
 	isc_rwlocktype_t locktype = isc_rwlocktype_read;
@@ -1408,9 +1487,10 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 	}
 
 	hashval = dns_name_hash(fctx->domain);
+	shard = shard_get(res->counters, hashval);
 
-	RWLOCK(&res->counters_lock, locktype);
-	result = isc_hashmap_find(res->counters, hashval, fcount_match,
+	shard_lock(res, shard, locktype);
+	result = isc_hashmap_find(shard->table, hashval, fcount_match,
 				  fctx->domain, (void **)&counter);
 	switch (result) {
 	case ISC_R_SUCCESS:
@@ -1425,10 +1505,10 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 		counter->domain = dns_fixedname_initname(&counter->dfname);
 		dns_name_copy(fctx->domain, counter->domain);
 
-		UPGRADELOCK(&res->counters_lock, locktype);
+		UPGRADELOCK(&shard->lock, locktype);
 
 		void *found = NULL;
-		result = isc_hashmap_add(res->counters, hashval, fcount_match,
+		result = isc_hashmap_add(shard->table, hashval, fcount_match,
 					 counter->domain, counter, &found);
 		if (result == ISC_R_EXISTS) {
 			isc_mutex_destroy(&counter->lock);
@@ -1458,7 +1538,7 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 		fctx->counter = counter;
 	}
 	UNLOCK(&counter->lock);
-	RWUNLOCK(&res->counters_lock, locktype);
+	RWUNLOCK(&shard->lock, locktype);
 
 	return result;
 }
@@ -1478,25 +1558,27 @@ fcount_decr(fetchctx_t *fctx) {
 	}
 	fctx->counter = NULL;
 
+	uint32_t hashval = dns_name_hash(counter->domain);
+	res_shard_t *shard = shard_get(fctx->res->counters, hashval);
+
 	/*
 	 * FIXME: This should not require a write lock, but should be
 	 * implemented using reference counting later, otherwise we would could
 	 * encounter ABA problem here - the count could go up and down when we
 	 * switch from read to write lock.
 	 */
-	RWLOCK(&fctx->res->counters_lock, isc_rwlocktype_write);
+	shard_lock(fctx->res, shard, isc_rwlocktype_write);
 
 	LOCK(&counter->lock);
 	INSIST(VALID_FCTXCOUNT(counter));
 	INSIST(counter->count > 0);
 	if (--counter->count > 0) {
 		UNLOCK(&counter->lock);
-		RWUNLOCK(&fctx->res->counters_lock, isc_rwlocktype_write);
+		RWUNLOCK(&shard->lock, isc_rwlocktype_write);
 		return;
 	}
 
-	isc_result_t result = isc_hashmap_delete(fctx->res->counters,
-						 dns_name_hash(counter->domain),
+	isc_result_t result = isc_hashmap_delete(shard->table, hashval,
 						 match_ptr, counter);
 	INSIST(result == ISC_R_SUCCESS);
 
@@ -1506,7 +1588,7 @@ fcount_decr(fetchctx_t *fctx) {
 	isc_mutex_destroy(&counter->lock);
 	isc_mem_putanddetach(&counter->mctx, counter, sizeof(*counter));
 
-	RWUNLOCK(&fctx->res->counters_lock, isc_rwlocktype_write);
+	RWUNLOCK(&shard->lock, isc_rwlocktype_write);
 }
 
 static void
@@ -1620,15 +1702,32 @@ fctx_hash(fetchctx_t *fctx) {
 	isc_hash32_hash(&hash32, fctx->name->ndata, fctx->name->length, false);
 	isc_hash32_hash(&hash32, &fctx->options, sizeof(fctx->options), true);
 	isc_hash32_hash(&hash32, &fctx->type, sizeof(fctx->type), true);
+	if (fctx->ecs.source != 0) {
+		isc_hash32_hash(&hash32, &fctx->ecs.source,
+				sizeof(fctx->ecs.source), true);
+		isc_hash32_hash(&hash32, &fctx->ecs.addr.type,
+				(fctx->ecs.source + 7) / 8, true);
+	}
 	return isc_hash32_finalize(&hash32);
 }
 
+static void
+fctx_unhash(fetchctx_t *fctx) {
+	uint32_t hashval = fctx_hash(fctx);
+	res_shard_t *shard = shard_get(fctx->res->fctxs, hashval);
+
+	shard_lock(fctx->res, shard, isc_rwlocktype_write);
+	(void)isc_hashmap_delete(shard->table, hashval, match_ptr, fctx);
+	RWUNLOCK(&shard->lock, isc_rwlocktype_write);
+}
+
 static bool
 fctx_match(void *node, const void *key) {
 	const fetchctx_t *fctx0 = node;
 	const fetchctx_t *fctx1 = key;
 
 	return fctx0->options == fctx1->options && fctx0->type == fctx1->type &&
+	       dns_ecs_equals(&fctx0->ecs, &fctx1->ecs) &&
 	       dns_name_equal(fctx0->name, fctx1->name);
 }
 
@@ -1663,10 +1762,7 @@ fctx__done(fetchctx_t *fctx, isc_result_t result, const char *func,
 	UNLOCK(&fctx->lock);
 
 	/* The fctx will get deleted either here or in get_attached_fctx() */
-	RWLOCK(&fctx->res->fctxs_lock, isc_rwlocktype_write);
-	(void)isc_hashmap_delete(fctx->res->fctxs, fctx_hash(fctx), match_ptr,
-				 fctx);
-	RWUNLOCK(&fctx->res->fctxs_lock, isc_rwlocktype_write);
+	fctx_unhash(fctx);
 
 	if (result == ISC_R_SUCCESS) {
 		if (fctx->qmin_warning != ISC_R_SUCCESS) {
@@ -2006,9 +2102,8 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 	 * remain valid until this query is canceled.
 	 */
 
-	dns_message_create(fctx->mctx, fctx->res->namepools[fctx->tid],
-			   fctx->res->rdspools[fctx->tid],
-			   DNS_MESSAGE_INTENTPARSE, &query->rmessage);
+	dns_message_create(fctx->mctx, DNS_MESSAGE_INTENTPARSE,
+			   &query->rmessage);
 	query->start = isc_time_now();
 
 	/*
@@ -2436,6 +2531,8 @@ resquery_send(resquery_t *query) {
 			bool reqzoneversion = res->view->requestzoneversion;
 			bool tcpkeepalive = false;
 			unsigned char cookie[COOKIE_BUFFER_SIZE];
+			unsigned char ecsbuf[4 + sizeof(struct in6_addr)];
+			bool sendecs = false;
 			uint16_t padding = 0;
 
 			/*
@@ -2530,6 +2627,35 @@ resquery_send(resquery_t *query) {
 				ednsopt++;
 			}
 
+			/*
+			 * Add the client subnet, but not to minimized
+			 * queries: those go to servers above the zone
+			 * that answers and would only leak it.
+			 */
+			if (fctx->ecs.source != 0 && !fctx->minimized) {
+				isc_buffer_t b;
+				uint16_t family = (fctx->ecs.addr.family ==
+						   AF_INET)
+							  ? 1
+							  : 2;
+
+				INSIST(ednsopt < DNS_EDNSOPTIONS);
+				isc_buffer_init(&b, ecsbuf, sizeof(ecsbuf));
+				isc_buffer_putuint16(&b, family);
+				isc_buffer_putuint8(&b, fctx->ecs.source);
+				isc_buffer_putuint8(&b, 0);
+				isc_buffer_putmem(
+					&b,
+					(unsigned char *)&fctx->ecs.addr.type,
+					(fctx->ecs.source + 7) / 8);
+				ednsopts[ednsopt].code = DNS_OPT_CLIENT_SUBNET;
+				ednsopts[ednsopt].length =
+					isc_buffer_usedlength(&b);
+				ednsopts[ednsopt].value = ecsbuf;
+				ednsopt++;
+				sendecs = true;
+			}
+
 			/* Add TCP keepalive option if appropriate */
 			if ((peer != NULL) && tcp) {
 				(void)dns_peer_gettcpkeepalive(peer,
@@ -2567,6 +2693,11 @@ resquery_send(resquery_t *query) {
 					query->options |=
 						DNS_FETCHOPT_WANTZONEVERSION;
 				}
+				if (sendecs) {
+					query->options |= DNS_FETCHOPT_WANTECS;
+					inc_stats(fctx->res,
+						  dns_resstatscounter_ecsout);
+				}
 			} else if (result != ISC_R_SUCCESS) {
 				/*
 				 * We couldn't add the OPT, but we'll
@@ -4557,6 +4688,43 @@ log_ns_ttl(fetchctx_t *fctx, const char *where) {
 		      where, namebuf, domainbuf, fctx->ns_ttl_ok, fctx->ns_ttl);
 }
 
+/*
+ * Work out the client subnet to send with queries for 'name' made on
+ * behalf of 'client', when 'name' is at or below one of the view's
+ * "ecs-zones".  Otherwise 'ecs' is left with a source prefix length
+ * of zero.
+ */
+static void
+fctx_clientsubnet(dns_resolver_t *res, const dns_name_t *name,
+		  const isc_sockaddr_t *client, dns_ecs_t *ecs) {
+	isc_netaddr_t netaddr;
+
+	*ecs = (dns_ecs_t){ 0 };
+
+	if (client == NULL ||
+	    !dns_nametree_covered(res->view->ecszones, name, NULL, 0))
+	{
+		return;
+	}
+
+	isc_netaddr_fromsockaddr(&netaddr, client);
+	if (netaddr.family == AF_INET6 &&
+	    IN6_IS_ADDR_V4MAPPED(&netaddr.type.in6))
+	{
+		isc_netaddr_t v6 = netaddr;
+		isc_netaddr_fromv4mapped(&netaddr, &v6);
+	}
+	if (isc_netaddr_isloopback(&netaddr) ||
+	    isc_netaddr_islinklocal(&netaddr))
+	{
+		return;
+	}
+
+	dns_ecs_fromnetaddr(ecs, &netaddr,
+			    netaddr.family == AF_INET ? ECS_MAX_V4_SCOPE
+						      : ECS_MAX_V6_SCOPE);
+}
+
 static isc_result_t
 fctx_create(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 	    dns_rdatatype_t type, const dns_name_t *domain,
@@ -4593,6 +4761,8 @@ fctx_create(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 		.loop = loop,
 	};
 
+	fctx_clientsubnet(res, name, client, &fctx->ecs);
+
 	isc_mem_attach(mctx, &fctx->mctx);
 	dns_resolver_attach(res, &fctx->res);
 
@@ -4788,9 +4958,8 @@ fctx_create(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 		goto cleanup_fcount;
 	}
 
-	dns_message_create(fctx->mctx, fctx->res->namepools[fctx->tid],
-			   fctx->res->rdspools[fctx->tid],
-			   DNS_MESSAGE_INTENTRENDER, &fctx->qmessage);
+	dns_message_create(fctx->mctx, DNS_MESSAGE_INTENTRENDER,
+			   &fctx->qmessage);
 
 	/*
 	 * Compute an expiration time for the entire fetch.
@@ -5220,6 +5389,31 @@ getrrsig(dns_name_t *name, dns_rdatatype_t type) {
 	return NULL;
 }
 
+/*
+ * Add 'rdataset' to the cache, restricted to the client subnet of the
+ * fetch if 'scoped' is set and the cache supports it.
+ */
+static isc_result_t
+cache_addrdataset(fetchctx_t *fctx, dns_dbnode_t *node, isc_stdtime_t now,
+		  bool scoped, dns_rdataset_t *rdataset, unsigned int options,
+		  dns_rdataset_t *added) {
+	isc_result_t result;
+
+	if (scoped) {
+		dns_ecs_t ecs = fctx->ecs;
+
+		ecs.scope = fctx->ecsscope;
+		result = dns_db_addecsrdataset(fctx->cache, node, now, &ecs,
+					       rdataset, options, added);
+		if (result != ISC_R_NOTIMPLEMENTED) {
+			return result;
+		}
+	}
+
+	return dns_db_addrdataset(fctx->cache, node, NULL, now, rdataset,
+				  options, added);
+}
+
 static isc_result_t
 cache_rrset(fetchctx_t *fctx, isc_stdtime_t now, dns_name_t *name,
 	    dns_rdataset_t *rdataset, dns_rdataset_t *sigrdataset,
@@ -5228,11 +5422,19 @@ cache_rrset(fetchctx_t *fctx, isc_stdtime_t now, dns_name_t *name,
 	isc_result_t result = ISC_R_SUCCESS;
 	unsigned int options = 0;
 	dns_dbnode_t *node = NULL;
+	bool scoped;
 
 	if (rdataset == NULL) {
 		return ISC_R_NOTFOUND;
 	}
 
+	/*
+	 * Only the answer itself depends on the client subnet; referrals
+	 * and other authority data are cached for everyone.
+	 */
+	scoped = fctx->ecsscope != 0 && !NEGATIVE(rdataset) &&
+		 (ANSWER(rdataset) || ANSWERSIG(rdataset));
+
 	/*
 	 * If the trust level is glue, we must be caching a referral.
 	 * New referral data always takes precedence over the existing
@@ -5264,14 +5466,14 @@ cache_rrset(fetchctx_t *fctx, isc_stdtime_t now, dns_name_t *name,
 	}
 
 	if (result == ISC_R_SUCCESS) {
-		result = dns_db_addrdataset(fctx->cache, node, NULL, now,
-					    rdataset, options, added);
+		result = cache_addrdataset(fctx, node, now, scoped, rdataset,
+					   options, added);
 	}
 	if ((result == ISC_R_SUCCESS || result == DNS_R_UNCHANGED) &&
 	    sigrdataset != NULL)
 	{
-		result = dns_db_addrdataset(fctx->cache, node, NULL, now,
-					    sigrdataset, options, addedsig);
+		result = cache_addrdataset(fctx, node, now, scoped,
+					   sigrdataset, options, addedsig);
 		if (result == DNS_R_UNCHANGED) {
 			result = ISC_R_SUCCESS;
 		}
@@ -7168,6 +7370,7 @@ resquery_response(isc_result_t eresult, isc_region_t *region, void *arg) {
 	/*
 	 * Process receive opt record.
 	 */
+	fctx->ecsscope = 0;
 	rctx->opt = dns_message_getopt(query->rmessage);
 	if (rctx->opt != NULL) {
 		rctx_opt(rctx);
@@ -7800,6 +8003,64 @@ rctx_parse(respctx_t *rctx) {
 	return ISC_R_COMPLETE;
 }
 
+/*
+ * Check the client subnet option in a response against the one that
+ * was sent, and record the scope the answer applies to.  A response
+ * for a different subnet, or a malformed option, is treated as having
+ * a scope of zero (RFC 7871, section 7.3).
+ */
+static void
+fctx_setecsscope(fetchctx_t *fctx, const unsigned char *value,
+		 uint16_t length) {
+	isc_netaddr_t addr = { 0 };
+	dns_ecs_t ecs;
+	unsigned int addrlen;
+	uint8_t source, scope;
+
+	if (length < 4) {
+		goto mismatch;
+	}
+
+	source = value[2];
+	scope = value[3];
+	addrlen = (source + 7) / 8;
+	if (length != 4 + addrlen) {
+		goto mismatch;
+	}
+
+	switch ((value[0] << 8) | value[1]) {
+	case 1:
+		if (source > 32) {
+			goto mismatch;
+		}
+		addr.family = AF_INET;
+		break;
+	case 2:
+		if (source > 128) {
+			goto mismatch;
+		}
+		addr.family = AF_INET6;
+		break;
+	default:
+		goto mismatch;
+	}
+	memmove(&addr.type, value + 4, addrlen);
+
+	dns_ecs_fromnetaddr(&ecs, &addr, source);
+	if (!dns_ecs_equals(&ecs, &fctx->ecs)) {
+		goto mismatch;
+	}
+
+	fctx->ecsscope = ISC_MIN(scope, source);
+	if (fctx->ecsscope != 0) {
+		inc_stats(fctx->res, dns_resstatscounter_ecsscoped);
+	}
+	return;
+
+mismatch:
+	inc_stats(fctx->res, dns_resstatscounter_ecsmismatch);
+}
+
 /*
  * rctx_opt():
  * Process the OPT record in the response.
@@ -7814,6 +8075,7 @@ rctx_opt(respctx_t *rctx) {
 	bool seen_cookie = false;
 	bool seen_nsid = false;
 	bool seen_zoneversion = false;
+	bool seen_ecs = false;
 	unsigned char *nsid = NULL;
 	uint16_t nsidlen = 0;
 	unsigned char *zoneversion = NULL;
@@ -7890,6 +8152,16 @@ rctx_opt(respctx_t *rctx) {
 			zoneversion = isc_buffer_current(&optbuf);
 			zoneversionlen = optlen;
 			break;
+		case DNS_OPT_CLIENT_SUBNET:
+			if (seen_ecs ||
+			    (query->options & DNS_FETCHOPT_WANTECS) == 0)
+			{
+				break;
+			}
+			seen_ecs = true;
+			fctx_setecsscope(fctx, isc_buffer_current(&optbuf),
+					 optlen);
+			break;
 		default:
 			break;
 		}
@@ -9480,13 +9752,8 @@ dns_resolver__destroy(dns_resolver_t *res) {
 	isc_mutex_destroy(&res->primelock);
 	isc_mutex_destroy(&res->lock);
 
-	INSIST(isc_hashmap_count(res->fctxs) == 0);
-	isc_hashmap_destroy(&res->fctxs);
-	isc_rwlock_destroy(&res->fctxs_lock);
-
-	INSIST(isc_hashmap_count(res->counters) == 0);
-	isc_hashmap_destroy(&res->counters);
-	isc_rwlock_destroy(&res->counters_lock);
+	shards_destroy(res->mctx, &res->fctxs);
+	shards_destroy(res->mctx, &res->counters);
 
 	if (res->dispatches4 != NULL) {
 		dns_dispatchset_destroy(&res->dispatches4);
@@ -9504,14 +9771,6 @@ dns_resolver__destroy(dns_resolver_t *res) {
 
 	dns_view_weakdetach(&res->view);
 
-	for (size_t i = 0; i < res->nloops; i++) {
-		dns_message_destroypools(&res->namepools[i], &res->rdspools[i]);
-	}
-	isc_mem_cput(res->mctx, res->rdspools, res->nloops,
-		     sizeof(res->rdspools[0]));
-	isc_mem_cput(res->mctx, res->namepools, res->nloops,
-		     sizeof(res->namepools[0]));
-
 	isc_mem_putanddetach(&res->mctx, res, sizeof(*res));
 }
 
@@ -9592,11 +9851,8 @@ dns_resolver_create(dns_view_t *view, unsigned int options,
 #endif
 	isc_refcount_init(&res->references, 1);
 
-	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS, &res->fctxs);
-	isc_rwlock_init(&res->fctxs_lock);
-
-	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS, &res->counters);
-	isc_rwlock_init(&res->counters_lock);
+	shards_create(res->mctx, &res->fctxs);
+	shards_create(res->mctx, &res->counters);
 
 	if (dispatchv4 != NULL) {
 		dns_dispatchset_create(res->mctx, dispatchv4, &res->dispatches4,
@@ -9616,18 +9872,6 @@ dns_resolver_create(dns_view_t *view, unsigned int options,
 	dns_nametree_create(res->mctx, DNS_NAMETREE_BITS, "ds-digests",
 			    &res->digests);
 
-	res->namepools = isc_mem_cget(res->mctx, res->nloops,
-				      sizeof(res->namepools[0]));
-	res->rdspools = isc_mem_cget(res->mctx, res->nloops,
-				     sizeof(res->rdspools[0]));
-	for (size_t i = 0; i < res->nloops; i++) {
-		isc_loop_t *loop = isc_loop_get(i);
-		isc_mem_t *pool_mctx = isc_loop_getmctx(loop);
-
-		dns_message_createpools(pool_mctx, &res->namepools[i],
-					&res->rdspools[i]);
-	}
-
 	res->magic = RES_MAGIC;
 
 	*resp = res;
@@ -9750,26 +9994,29 @@ dns_resolver_shutdown(dns_resolver_t *res) {
 	RTRACE("shutdown");
 
 	if (atomic_compare_exchange_strong(&res->exiting, &is_false, true)) {
-		isc_hashmap_iter_t *it = NULL;
-
 		RTRACE("exiting");
 
-		RWLOCK(&res->fctxs_lock, isc_rwlocktype_write);
-		isc_hashmap_iter_create(res->fctxs, &it);
-		for (result = isc_hashmap_iter_first(it);
-		     result == ISC_R_SUCCESS;
-		     result = isc_hashmap_iter_next(it))
-		{
-			fetchctx_t *fctx = NULL;
+		for (size_t i = 0; i < RES_SHARDS; i++) {
+			res_shard_t *shard = &res->fctxs[i];
+			isc_hashmap_iter_t *it = NULL;
 
-			isc_hashmap_iter_current(it, (void **)&fctx);
-			INSIST(fctx != NULL);
+			RWLOCK(&shard->lock, isc_rwlocktype_write);
+			isc_hashmap_iter_create(shard->table, &it);
+			for (result = isc_hashmap_iter_first(it);
+			     result == ISC_R_SUCCESS;
+			     result = isc_hashmap_iter_next(it))
+			{
+				fetchctx_t *fctx = NULL;
+
+				isc_hashmap_iter_current(it, (void **)&fctx);
+				INSIST(fctx != NULL);
 
-			fetchctx_ref(fctx);
-			isc_async_run(fctx->loop, fctx_shutdown, fctx);
+				fetchctx_ref(fctx);
+				isc_async_run(fctx->loop, fctx_shutdown, fctx);
+			}
+			isc_hashmap_iter_destroy(&it);
+			RWUNLOCK(&shard->lock, isc_rwlocktype_write);
 		}
-		isc_hashmap_iter_destroy(&it);
-		RWUNLOCK(&res->fctxs_lock, isc_rwlocktype_write);
 
 		LOCK(&res->lock);
 		if (res->spillattimer != NULL) {
@@ -9932,11 +10179,16 @@ get_attached_fctx(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 	};
 	fetchctx_t *fctx = NULL;
 	isc_rwlocktype_t locktype = isc_rwlocktype_read;
-	uint32_t hashval = fctx_hash(&key);
+	res_shard_t *shard = NULL;
+	uint32_t hashval;
+
+	fctx_clientsubnet(res, name, client, &key.ecs);
+	hashval = fctx_hash(&key);
+	shard = shard_get(res->fctxs, hashval);
 
 again:
-	RWLOCK(&res->fctxs_lock, locktype);
-	result = isc_hashmap_find(res->fctxs, hashval, fctx_match, &key,
+	shard_lock(res, shard, locktype);
+	result = isc_hashmap_find(shard->table, hashval, fctx_match, &key,
 				  (void **)&fctx);
 	switch (result) {
 	case ISC_R_SUCCESS:
@@ -9945,20 +10197,20 @@ again:
 		result = fctx_create(res, loop, name, type, domain, nameservers,
 				     client, options, depth, qc, gqc, &fctx);
 		if (result != ISC_R_SUCCESS) {
-			RWUNLOCK(&res->fctxs_lock, locktype);
+			RWUNLOCK(&shard->lock, locktype);
 			return result;
 		}
 
-		UPGRADELOCK(&res->fctxs_lock, locktype);
+		UPGRADELOCK(&shard->lock, locktype);
 
 		void *found = NULL;
-		result = isc_hashmap_add(res->fctxs, hashval, fctx_match, fctx,
-					 fctx, &found);
+		result = isc_hashmap_add(shard->table, hashval, fctx_match,
+					 fctx, fctx, &found);
 		if (result == ISC_R_SUCCESS) {
 			*new_fctx = true;
 		} else {
 			/*
-			 * The fctx_done() tries to acquire the fctxs_lock.
+			 * The fctx_done() tries to acquire the shard lock.
 			 * Destroy the newly created fetchctx directly.
 			 */
 			fctx->state = fetchstate_done;
@@ -9981,7 +10233,7 @@ again:
 	 * properly initialized and started.
 	 */
 	LOCK(&fctx->lock);
-	RWUNLOCK(&res->fctxs_lock, locktype);
+	RWUNLOCK(&shard->lock, locktype);
 
 	if (SHUTTINGDOWN(fctx) || fctx->cloned) {
 		/*
@@ -9993,10 +10245,7 @@ again:
 		UNLOCK(&fctx->lock);
 
 		/* The fctx will get deleted either here or in fctx__done() */
-		RWLOCK(&res->fctxs_lock, isc_rwlocktype_write);
-		(void)isc_hashmap_delete(res->fctxs, fctx_hash(fctx), match_ptr,
-					 fctx);
-		RWUNLOCK(&res->fctxs_lock, isc_rwlocktype_write);
+		fctx_unhash(fctx);
 
 		fetchctx_detach(&fctx);
 		goto again;
@@ -10492,11 +10741,51 @@ dns_resolver_getmaxqueries(dns_resolver_t *resolver) {
 	return resolver->maxqueries;
 }
 
+static void
+dumpfetch(fetchctx_t *fctx, FILE *fp) {
+	char typebuf[DNS_RDATATYPE_FORMATSIZE];
+	char timebuf[1024];
+	unsigned int resp_count = 0, query_count = 0;
+
+	LOCK(&fctx->lock);
+	dns_name_print(fctx->name, fp);
+
+	isc_time_formatISO8601ms(&fctx->start, timebuf, sizeof(timebuf));
+
+	dns_rdatatype_format(fctx->type, typebuf, sizeof(typebuf));
+
+	fprintf(fp, "/%s (%s): started %s, ", typebuf,
+		fctx->state == fetchstate_active ? "active" : "done", timebuf);
+
+	ISC_LIST_FOREACH (fctx->resps, resp, link) {
+		resp_count++;
+	}
+
+	ISC_LIST_FOREACH (fctx->queries, query, link) {
+		query_count++;
+	}
+
+	if (isc_timer_running(fctx->timer)) {
+		strlcpy(timebuf, "expires ", sizeof(timebuf));
+		isc_time_formatISO8601ms(&fctx->expires, timebuf + 8,
+					 sizeof(timebuf) - 8);
+	} else {
+		strlcpy(timebuf, "not running", sizeof(timebuf));
+	}
+
+	fprintf(fp,
+		"fetches: %u active (%" PRIuFAST32 " allowed, %" PRIuFAST32
+		" dropped%s), queries: %u, timer %s\n",
+		resp_count, fctx->allowed, fctx->dropped,
+		fctx->spilled ? ", spilled" : "", query_count, timebuf);
+
+	UNLOCK(&fctx->lock);
+}
+
 void
 dns_resolver_dumpfetches(dns_resolver_t *res, isc_statsformat_t format,
 			 FILE *fp) {
 	isc_result_t result;
-	isc_hashmap_iter_t *it = NULL;
 
 	REQUIRE(VALID_RESOLVER(res));
 	REQUIRE(fp != NULL);
@@ -10507,74 +10796,32 @@ dns_resolver_dumpfetches(dns_resolver_t *res, isc_statsformat_t format,
 		res->spillat, res->spillatmax);
 	UNLOCK(&res->lock);
 
-	RWLOCK(&res->fctxs_lock, isc_rwlocktype_read);
-	isc_hashmap_iter_create(res->fctxs, &it);
-	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
-	     result = isc_hashmap_iter_next(it))
-	{
-		char typebuf[DNS_RDATATYPE_FORMATSIZE];
-		char timebuf[1024];
-		fetchctx_t *fctx = NULL;
-		unsigned int resp_count = 0, query_count = 0;
-
-		isc_hashmap_iter_current(it, (void **)&fctx);
-
-		LOCK(&fctx->lock);
-		dns_name_print(fctx->name, fp);
-
-		isc_time_formatISO8601ms(&fctx->start, timebuf,
-					 sizeof(timebuf));
-
-		dns_rdatatype_format(fctx->type, typebuf, sizeof(typebuf));
-
-		fprintf(fp, "/%s (%s): started %s, ", typebuf,
-			fctx->state == fetchstate_active ? "active" : "done",
-			timebuf);
-
-		ISC_LIST_FOREACH (fctx->resps, resp, link) {
-			resp_count++;
-		}
+	for (size_t i = 0; i < RES_SHARDS; i++) {
+		res_shard_t *shard = &res->fctxs[i];
+		isc_hashmap_iter_t *it = NULL;
 
-		ISC_LIST_FOREACH (fctx->queries, query, link) {
-			query_count++;
-		}
+		RWLOCK(&shard->lock, isc_rwlocktype_read);
+		isc_hashmap_iter_create(shard->table, &it);
+		for (result = isc_hashmap_iter_first(it);
+		     result == ISC_R_SUCCESS; result = isc_hashmap_iter_next(it))
+		{
+			fetchctx_t *fctx = NULL;
 
-		if (isc_timer_running(fctx->timer)) {
-			strlcpy(timebuf, "expires ", sizeof(timebuf));
-			isc_time_formatISO8601ms(&fctx->expires, timebuf + 8,
-						 sizeof(timebuf) - 8);
-		} else {
-			strlcpy(timebuf, "not running", sizeof(timebuf));
+			isc_hashmap_iter_current(it, (void **)&fctx);
+			dumpfetch(fctx, fp);
 		}
-
-		fprintf(fp,
-			"fetches: %u active (%" PRIuFAST32
-			" allowed, %" PRIuFAST32
-			" dropped%s), queries: %u, timer %s\n",
-			resp_count, fctx->allowed, fctx->dropped,
-			fctx->spilled ? ", spilled" : "", query_count, timebuf);
-
-		UNLOCK(&fctx->lock);
+		isc_hashmap_iter_destroy(&it);
+		RWUNLOCK(&shard->lock, isc_rwlocktype_read);
 	}
-	isc_hashmap_iter_destroy(&it);
-	RWUNLOCK(&res->fctxs_lock, isc_rwlocktype_read);
 }
 
-isc_result_t
-dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf) {
+static isc_result_t
+dumpquota(res_shard_t *shard, uint_fast32_t spill, isc_buffer_t **buf) {
 	isc_result_t result;
 	isc_hashmap_iter_t *it = NULL;
-	uint_fast32_t spill;
-
-	REQUIRE(VALID_RESOLVER(res));
 
-	spill = atomic_load_acquire(&res->zspill);
-	if (spill == 0) {
-		return ISC_R_SUCCESS;
-	}
-
-	RWLOCK(&res->counters_lock, isc_rwlocktype_read);
-	isc_hashmap_iter_create(res->counters, &it);
+	RWLOCK(&shard->lock, isc_rwlocktype_read);
+	isc_hashmap_iter_create(shard->table, &it);
 	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
 	     result = isc_hashmap_iter_next(it))
 	{
@@ -10613,7 +10860,26 @@ dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf) {
 
 cleanup:
 	isc_hashmap_iter_destroy(&it);
-	RWUNLOCK(&res->counters_lock, isc_rwlocktype_read);
+	RWUNLOCK(&shard->lock, isc_rwlocktype_read);
+	return result;
+}
+
+isc_result_t
+dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf) {
+	isc_result_t result = ISC_R_SUCCESS;
+	uint_fast32_t spill;
+
+	REQUIRE(VALID_RESOLVER(res));
+
+	spill = atomic_load_acquire(&res->zspill);
+	if (spill == 0) {
+		return ISC_R_SUCCESS;
+	}
+
+	for (size_t i = 0; i < RES_SHARDS && result == ISC_R_SUCCESS; i++) {
+		result = dumpquota(&res->counters[i], spill, buf);
+	}
+
 	return result;
 }
 
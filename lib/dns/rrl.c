@@ -22,7 +22,9 @@
 #include <inttypes.h>
 #include <stdbool.h>
 
+#include <isc/hash.h>
 #include <isc/log.h>
+#include <isc/loop.h>
 #include <isc/mem.h>
 #include <isc/net.h>
 #include <isc/netaddr.h>
@@ -38,9 +40,18 @@
 #include <dns/view.h>
 #include <dns/zone.h>
 
+#ifdef HAVE_JSON_C
+#include <json_object.h>
+#endif /* HAVE_JSON_C */
+
+#ifdef HAVE_LIBXML2
+#include <libxml/xmlwriter.h>
+#define ISC_XMLCHAR (const xmlChar *)
+#endif /* HAVE_LIBXML2 */
+
 static void
-log_end(dns_rrl_t *rrl, dns_rrl_entry_t *e, bool early, char *log_buf,
-	unsigned int log_buf_len);
+log_end(dns_rrl_shard_t *shard, dns_rrl_entry_t *e, bool early,
+	char *log_buf, unsigned int log_buf_len);
 
 /*
  * Get a modulus for a hash function that is tolerably likely to be
@@ -138,21 +149,22 @@ delta_rrl_time(isc_stdtime_t ts, isc_stdtime_t now) {
 }
 
 static int
-get_age(const dns_rrl_t *rrl, const dns_rrl_entry_t *e, isc_stdtime_t now) {
+get_age(const dns_rrl_shard_t *shard, const dns_rrl_entry_t *e,
+	isc_stdtime_t now) {
 	if (!e->ts_valid) {
 		return DNS_RRL_FOREVER;
 	}
-	return delta_rrl_time(e->ts + rrl->ts_bases[e->ts_gen], now);
+	return delta_rrl_time(e->ts + shard->ts_bases[e->ts_gen], now);
 }
 
 static void
-set_age(dns_rrl_t *rrl, dns_rrl_entry_t *e, isc_stdtime_t now) {
+set_age(dns_rrl_shard_t *shard, dns_rrl_entry_t *e, isc_stdtime_t now) {
 	dns_rrl_entry_t *e_old;
 	unsigned int ts_gen;
 	int i, ts;
 
-	ts_gen = rrl->ts_gen;
-	ts = now - rrl->ts_bases[ts_gen];
+	ts_gen = shard->ts_gen;
+	ts = now - shard->ts_bases[ts_gen];
 	if (ts < 0) {
 		if (ts < -DNS_RRL_MAX_TIME_TRAVEL) {
 			ts = DNS_RRL_FOREVER;
@@ -175,7 +187,7 @@ set_age(dns_rrl_t *rrl, dns_rrl_entry_t *e, isc_stdtime_t now) {
 	 */
 	if (ts >= DNS_RRL_MAX_TS) {
 		ts_gen = (ts_gen + 1) % DNS_RRL_TS_BASES;
-		for (e_old = ISC_LIST_TAIL(rrl->lru), i = 0;
+		for (e_old = ISC_LIST_TAIL(shard->lru), i = 0;
 		     e_old != NULL && (e_old->ts_gen == ts_gen ||
 				       !ISC_LINK_LINKED(e_old, hlink));
 		     e_old = ISC_LIST_PREV(e_old, lru), ++i)
@@ -188,13 +200,16 @@ set_age(dns_rrl_t *rrl, dns_rrl_entry_t *e, isc_stdtime_t now) {
 				DNS_RRL_LOG_DEBUG1,
 				"rrl new time base scanned %d entries"
 				" at %d for %d %d %d %d",
-				i, now, rrl->ts_bases[ts_gen],
-				rrl->ts_bases[(ts_gen + 1) % DNS_RRL_TS_BASES],
-				rrl->ts_bases[(ts_gen + 2) % DNS_RRL_TS_BASES],
-				rrl->ts_bases[(ts_gen + 3) % DNS_RRL_TS_BASES]);
+				i, now, shard->ts_bases[ts_gen],
+				shard->ts_bases[(ts_gen + 1) %
+						DNS_RRL_TS_BASES],
+				shard->ts_bases[(ts_gen + 2) %
+						DNS_RRL_TS_BASES],
+				shard->ts_bases[(ts_gen + 3) %
+						DNS_RRL_TS_BASES]);
 		}
-		rrl->ts_gen = ts_gen;
-		rrl->ts_bases[ts_gen] = now;
+		shard->ts_gen = ts_gen;
+		shard->ts_bases[ts_gen] = now;
 		ts = 0;
 	}
 
@@ -204,16 +219,23 @@ set_age(dns_rrl_t *rrl, dns_rrl_entry_t *e, isc_stdtime_t now) {
 }
 
 static isc_result_t
-expand_entries(dns_rrl_t *rrl, int newsize) {
+expand_entries(dns_rrl_shard_t *shard, int newsize) {
+	dns_rrl_t *rrl = shard->rrl;
 	dns_rrl_block_t *b;
 	dns_rrl_entry_t *e;
 	double rate;
-	int i;
+	int i, max_entries;
 
-	if (rrl->num_entries + newsize >= rrl->max_entries &&
-	    rrl->max_entries != 0)
-	{
-		newsize = rrl->max_entries - rrl->num_entries;
+	/*
+	 * "max-table-size" applies to the whole view and is split evenly
+	 * between the shards.
+	 */
+	max_entries = rrl->max_entries;
+	if (max_entries != 0) {
+		max_entries = (max_entries + rrl->nshards - 1) / rrl->nshards;
+	}
+	if (shard->num_entries + newsize >= max_entries && max_entries != 0) {
+		newsize = max_entries - shard->num_entries;
 		if (newsize <= 0) {
 			return ISC_R_SUCCESS;
 		}
@@ -223,17 +245,19 @@ expand_entries(dns_rrl_t *rrl, int newsize) {
 	 * Log expansions so that the user can tune max-table-size
 	 * and min-table-size.
 	 */
-	if (isc_log_wouldlog(DNS_RRL_LOG_DROP) && rrl->hash != NULL) {
-		rate = rrl->probes;
-		if (rrl->searches != 0) {
-			rate /= rrl->searches;
+	if (isc_log_wouldlog(DNS_RRL_LOG_DROP) && shard->hash != NULL) {
+		rate = shard->probes;
+		if (shard->searches != 0) {
+			rate /= shard->searches;
 		}
 		isc_log_write(DNS_LOGCATEGORY_RRL, DNS_LOGMODULE_REQUEST,
 			      DNS_RRL_LOG_DROP,
 			      "increase from %d to %d RRL entries with"
-			      " %d bins; average search length %.1f",
-			      rrl->num_entries, rrl->num_entries + newsize,
-			      rrl->hash->length, rate);
+			      " %d bins in shard %u;"
+			      " average search length %.1f",
+			      shard->num_entries, shard->num_entries + newsize,
+			      shard->hash->length,
+			      (unsigned int)(shard - rrl->shards), rate);
 	}
 
 	b = isc_mem_cget(rrl->mctx, 1, STRUCT_FLEX_SIZE(b, entries, newsize));
@@ -245,10 +269,10 @@ expand_entries(dns_rrl_t *rrl, int newsize) {
 	e = b->entries;
 	for (i = 0; i < newsize; ++i, ++e) {
 		ISC_LINK_INIT(e, hlink);
-		ISC_LIST_INITANDAPPEND(rrl->lru, e, lru);
+		ISC_LIST_INITANDAPPEND(shard->lru, e, lru);
 	}
-	rrl->num_entries += newsize;
-	ISC_LIST_INITANDAPPEND(rrl->blocks, b, link);
+	shard->num_entries += newsize;
+	ISC_LIST_INITANDAPPEND(shard->blocks, b, link);
 
 	return ISC_R_SUCCESS;
 }
@@ -260,11 +284,11 @@ get_bin(dns_rrl_hash_t *hash, unsigned int hval) {
 }
 
 static void
-free_old_hash(dns_rrl_t *rrl) {
+free_old_hash(dns_rrl_shard_t *shard) {
 	dns_rrl_hash_t *old_hash;
 	dns_rrl_bin_t *old_bin;
 
-	old_hash = rrl->old_hash;
+	old_hash = shard->old_hash;
 	for (old_bin = &old_hash->bins[0];
 	     old_bin < &old_hash->bins[old_hash->length]; ++old_bin)
 	{
@@ -273,72 +297,73 @@ free_old_hash(dns_rrl_t *rrl) {
 		}
 	}
 
-	isc_mem_put(rrl->mctx, old_hash,
+	isc_mem_put(shard->rrl->mctx, old_hash,
 		    STRUCT_FLEX_SIZE(old_hash, bins, old_hash->length));
-	rrl->old_hash = NULL;
+	shard->old_hash = NULL;
 }
 
 static isc_result_t
-expand_rrl_hash(dns_rrl_t *rrl, isc_stdtime_t now) {
+expand_rrl_hash(dns_rrl_shard_t *shard, isc_stdtime_t now) {
 	dns_rrl_hash_t *hash;
 	int old_bins, new_bins;
 	double rate;
 
-	if (rrl->old_hash != NULL) {
-		free_old_hash(rrl);
+	if (shard->old_hash != NULL) {
+		free_old_hash(shard);
 	}
 
 	/*
 	 * Most searches fail and so go to the end of the chain.
 	 * Use a small hash table load factor.
 	 */
-	old_bins = (rrl->hash == NULL) ? 0 : rrl->hash->length;
+	old_bins = (shard->hash == NULL) ? 0 : shard->hash->length;
 	new_bins = old_bins / 8 + old_bins;
-	if (new_bins < rrl->num_entries) {
-		new_bins = rrl->num_entries;
+	if (new_bins < shard->num_entries) {
+		new_bins = shard->num_entries;
 	}
 	new_bins = hash_divisor(new_bins);
 
-	rrl->hash_gen ^= 1;
-	hash = isc_mem_cget(rrl->mctx, 1,
+	shard->hash_gen ^= 1;
+	hash = isc_mem_cget(shard->rrl->mctx, 1,
 			    STRUCT_FLEX_SIZE(hash, bins, new_bins));
 	*hash = (dns_rrl_hash_t){
 		.length = new_bins,
-		.gen = rrl->hash_gen,
+		.gen = shard->hash_gen,
 	};
 
 	if (isc_log_wouldlog(DNS_RRL_LOG_DROP) && old_bins != 0) {
-		rate = rrl->probes;
-		if (rrl->searches != 0) {
-			rate /= rrl->searches;
+		rate = shard->probes;
+		if (shard->searches != 0) {
+			rate /= shard->searches;
 		}
 		isc_log_write(DNS_LOGCATEGORY_RRL, DNS_LOGMODULE_REQUEST,
 			      DNS_RRL_LOG_DROP,
 			      "increase from %d to %d RRL bins for"
 			      " %d entries; average search length %.1f",
-			      old_bins, new_bins, rrl->num_entries, rate);
+			      old_bins, new_bins, shard->num_entries, rate);
 	}
 
-	rrl->old_hash = rrl->hash;
-	if (rrl->old_hash != NULL) {
-		rrl->old_hash->check_time = now;
+	shard->old_hash = shard->hash;
+	if (shard->old_hash != NULL) {
+		shard->old_hash->check_time = now;
 	}
-	rrl->hash = hash;
+	shard->hash = hash;
 
 	return ISC_R_SUCCESS;
 }
 
 static void
-ref_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, int probes, isc_stdtime_t now) {
+ref_entry(dns_rrl_shard_t *shard, dns_rrl_entry_t *e, int probes,
+	  isc_stdtime_t now) {
 	/*
 	 * Make the entry most recently used.
 	 */
-	if (ISC_LIST_HEAD(rrl->lru) != e) {
-		if (e == rrl->last_logged) {
-			rrl->last_logged = ISC_LIST_PREV(e, lru);
+	if (ISC_LIST_HEAD(shard->lru) != e) {
+		if (e == shard->last_logged) {
+			shard->last_logged = ISC_LIST_PREV(e, lru);
 		}
-		ISC_LIST_UNLINK(rrl->lru, e, lru);
-		ISC_LIST_PREPEND(rrl->lru, e, lru);
+		ISC_LIST_UNLINK(shard->lru, e, lru);
+		ISC_LIST_PREPEND(shard->lru, e, lru);
 	}
 
 	/*
@@ -347,17 +372,17 @@ ref_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, int probes, isc_stdtime_t now) {
 	 * old hash table.  It will migrate to the new hash table the next
 	 * time it is used or be cut loose when the old hash table is destroyed.
 	 */
-	rrl->probes += probes;
-	++rrl->searches;
-	if (rrl->searches > 100 &&
-	    delta_rrl_time(rrl->hash->check_time, now) > 1)
+	shard->probes += probes;
+	++shard->searches;
+	if (shard->searches > 100 &&
+	    delta_rrl_time(shard->hash->check_time, now) > 1)
 	{
-		if (rrl->probes / rrl->searches > 2) {
-			expand_rrl_hash(rrl, now);
+		if (shard->probes / shard->searches > 2) {
+			expand_rrl_hash(shard, now);
 		}
-		rrl->hash->check_time = now;
-		rrl->probes = 0;
-		rrl->searches = 0;
+		shard->hash->check_time = now;
+		shard->probes = 0;
+		shard->searches = 0;
 	}
 }
 
@@ -488,7 +513,7 @@ response_balance(dns_rrl_t *rrl, const dns_rrl_entry_t *e, int age) {
 		rate = 1;
 	} else {
 		ratep = get_rate(rrl, e->key.s.rtype);
-		rate = ratep->scaled;
+		rate = atomic_load_relaxed(&ratep->scaled);
 	}
 
 	balance = e->responses + age * rate;
@@ -502,10 +527,11 @@ response_balance(dns_rrl_t *rrl, const dns_rrl_entry_t *e, int age) {
  * Search for an entry for a response and optionally create it.
  */
 static dns_rrl_entry_t *
-get_entry(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr, dns_zone_t *zone,
-	  dns_rdataclass_t qclass, dns_rdatatype_t qtype,
+get_entry(dns_rrl_shard_t *shard, const isc_sockaddr_t *client_addr,
+	  dns_zone_t *zone, dns_rdataclass_t qclass, dns_rdatatype_t qtype,
 	  const dns_name_t *qname, dns_rrl_rtype_t rtype, isc_stdtime_t now,
 	  bool create, char *log_buf, unsigned int log_buf_len) {
+	dns_rrl_t *rrl = shard->rrl;
 	dns_rrl_key_t key;
 	uint32_t hval;
 	dns_rrl_hash_t *hash = NULL;
@@ -518,11 +544,11 @@ get_entry(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr, dns_zone_t *zone,
 	/*
 	 * Look for the entry in the current hash table.
 	 */
-	new_bin = get_bin(rrl->hash, hval);
+	new_bin = get_bin(shard->hash, hval);
 	probes = 1;
 	ISC_LIST_FOREACH (*new_bin, e, hlink) {
 		if (key_cmp(&e->key, &key)) {
-			ref_entry(rrl, e, probes, now);
+			ref_entry(shard, e, probes, now);
 			return e;
 		}
 		++probes;
@@ -531,14 +557,14 @@ get_entry(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr, dns_zone_t *zone,
 	/*
 	 * Look in the old hash table.
 	 */
-	if (rrl->old_hash != NULL) {
-		old_bin = get_bin(rrl->old_hash, hval);
+	if (shard->old_hash != NULL) {
+		old_bin = get_bin(shard->old_hash, hval);
 		ISC_LIST_FOREACH (*old_bin, e, hlink) {
 			if (key_cmp(&e->key, &key)) {
 				ISC_LIST_UNLINK(*old_bin, e, hlink);
 				ISC_LIST_PREPEND(*new_bin, e, hlink);
-				e->hash_gen = rrl->hash_gen;
-				ref_entry(rrl, e, probes, now);
+				e->hash_gen = shard->hash_gen;
+				ref_entry(shard, e, probes, now);
 				return e;
 			}
 		}
@@ -546,9 +572,9 @@ get_entry(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr, dns_zone_t *zone,
 		/*
 		 * Discard previous hash table when all of its entries are old.
 		 */
-		age = delta_rrl_time(rrl->old_hash->check_time, now);
+		age = delta_rrl_time(shard->old_hash->check_time, now);
 		if (age > rrl->window) {
-			free_old_hash(rrl);
+			free_old_hash(shard);
 		}
 	}
 
@@ -563,12 +589,12 @@ get_entry(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr, dns_zone_t *zone,
 	 * Steal the oldest entry if we cannot create more.
 	 */
 	dns_rrl_entry_t *entry = NULL;
-	ISC_LIST_FOREACH_REV (rrl->lru, e, lru) {
+	ISC_LIST_FOREACH_REV (shard->lru, e, lru) {
 		entry = e;
 		if (!ISC_LINK_LINKED(e, hlink)) {
 			break;
 		}
-		age = get_age(rrl, e, now);
+		age = get_age(shard, e, now);
 		if (age <= 1) {
 			entry = NULL;
 			break;
@@ -579,26 +605,27 @@ get_entry(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr, dns_zone_t *zone,
 	}
 
 	if (entry == NULL) {
-		expand_entries(rrl, ISC_MIN((rrl->num_entries + 1) / 2, 1000));
-		entry = ISC_LIST_TAIL(rrl->lru);
+		expand_entries(shard,
+			       ISC_MIN((shard->num_entries + 1) / 2, 1000));
+		entry = ISC_LIST_TAIL(shard->lru);
 	}
 	if (entry->logged) {
-		log_end(rrl, entry, true, log_buf, log_buf_len);
+		log_end(shard, entry, true, log_buf, log_buf_len);
 	}
 	if (ISC_LINK_LINKED(entry, hlink)) {
-		if (entry->hash_gen == rrl->hash_gen) {
-			hash = rrl->hash;
+		if (entry->hash_gen == shard->hash_gen) {
+			hash = shard->hash;
 		} else {
-			hash = rrl->old_hash;
+			hash = shard->old_hash;
 		}
 		old_bin = get_bin(hash, hash_key(&entry->key));
 		ISC_LIST_UNLINK(*old_bin, entry, hlink);
 	}
 	ISC_LIST_PREPEND(*new_bin, entry, hlink);
-	entry->hash_gen = rrl->hash_gen;
+	entry->hash_gen = shard->hash_gen;
 	entry->key = key;
 	entry->ts_valid = false;
-	ref_entry(rrl, entry, probes, now);
+	ref_entry(shard, entry, probes, now);
 	return entry;
 }
 
@@ -618,17 +645,106 @@ debit_log(const dns_rrl_entry_t *e, int age, const char *action) {
 		      hash_key(&e->key), age_str, e->responses, action);
 }
 
+/*
+ * Scale one limit by 'scale', but not below 'min'.
+ */
+static void
+scale_rate(dns_rrl_rate_t *ratep, int min, double scale, uint_fast32_t qps) {
+	int old_rate = atomic_load_relaxed(&ratep->scaled);
+	int new_rate = ratep->r;
+
+	if (scale < 1.0 && new_rate > min) {
+		new_rate = ISC_MAX((int)(new_rate * scale), min);
+	}
+
+	if (old_rate != new_rate) {
+		isc_log_write(DNS_LOGCATEGORY_RRL, DNS_LOGMODULE_REQUEST,
+			      DNS_RRL_LOG_DEBUG1,
+			      "%d qps scaled %s by %.2f from %d to %d",
+			      (int)qps, ratep->str, ISC_MIN(scale, 1.0),
+			      old_rate, new_rate);
+		atomic_store_relaxed(&ratep->scaled, new_rate);
+	}
+}
+
+/*
+ * Count a response towards the view-wide query rate.  Once a second,
+ * compute the scaled limits from the rate.  Return true if the limits
+ * are scaled down.
+ */
+static bool
+update_scale(dns_rrl_t *rrl, isc_stdtime_t now) {
+	uint_fast32_t responses, qps, current;
+	uint_fast32_t scale_time = atomic_load_relaxed(&rrl->scale_time);
+	double scale;
+	int secs;
+
+	responses = atomic_fetch_add_relaxed(&rrl->qps_responses, 1) + 1;
+
+	/*
+	 * Only the first response of each second does the computation,
+	 * so the scaled limits always come from a single estimate.
+	 */
+	if (scale_time == now ||
+	    !atomic_compare_exchange_strong_acq_rel(&rrl->scale_time,
+						    &scale_time, now))
+	{
+		return atomic_load_acquire(&rrl->scaled);
+	}
+
+	qps = atomic_load_relaxed(&rrl->qps);
+	secs = delta_rrl_time(atomic_load_relaxed(&rrl->qps_time), now);
+	if (secs > 0) {
+		current = responses / secs;
+		if (secs >= rrl->window) {
+			if (isc_log_wouldlog(DNS_RRL_LOG_DEBUG3)) {
+				isc_log_write(DNS_LOGCATEGORY_RRL,
+					      DNS_LOGMODULE_REQUEST,
+					      DNS_RRL_LOG_DEBUG3,
+					      "%d responses/%d seconds"
+					      " = %d qps",
+					      (int)responses, secs,
+					      (int)current);
+			}
+			/*
+			 * Responses counted since 'responses' was read
+			 * carry over to the next window.
+			 */
+			atomic_fetch_sub_relaxed(&rrl->qps_responses,
+						 responses);
+			atomic_store_relaxed(&rrl->qps_time, now);
+			atomic_store_relaxed(&rrl->qps, current);
+			qps = current;
+		} else if (current > qps) {
+			qps = current;
+		}
+	}
+
+	scale = rrl->qps_scale / ISC_MAX(qps, 1);
+	scale_rate(&rrl->responses_per_second, 1, scale, qps);
+	scale_rate(&rrl->referrals_per_second, 1, scale, qps);
+	scale_rate(&rrl->nodata_per_second, 1, scale, qps);
+	scale_rate(&rrl->nxdomains_per_second, 1, scale, qps);
+	scale_rate(&rrl->errors_per_second, 1, scale, qps);
+	scale_rate(&rrl->all_per_second, 1, scale, qps);
+	scale_rate(&rrl->slip, 2, scale, qps);
+	atomic_store_release(&rrl->scaled, scale < 1.0);
+
+	return scale < 1.0;
+}
+
 static dns_rrl_result_t
-debit_rrl_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, double qps, double scale,
+debit_rrl_entry(dns_rrl_shard_t *shard, dns_rrl_entry_t *e, bool scaled,
 		const isc_sockaddr_t *client_addr, isc_stdtime_t now,
 		char *log_buf, unsigned int log_buf_len) {
-	int rate, new_rate, slip, new_slip, age, log_secs, min;
+	dns_rrl_t *rrl = shard->rrl;
+	int rate, slip, age, log_secs, min;
 	dns_rrl_rate_t *ratep;
 	dns_rrl_entry_t const *credit_e;
 
 	/*
 	 * Pick the rate counter.
-	 * Optionally adjust the rate by the estimated query/second rate.
+	 * Optionally use the rate scaled by the estimated query/second rate.
 	 */
 	ratep = get_rate(rrl, e->key.s.rtype);
 	rate = ratep->r;
@@ -636,35 +752,22 @@ debit_rrl_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, double qps, double scale,
 		return DNS_RRL_RESULT_OK;
 	}
 
-	if (scale < 1.0) {
+	if (scaled) {
 		/*
 		 * The limit for clients that have used TCP is not scaled.
 		 */
 		credit_e = get_entry(
-			rrl, client_addr, NULL, 0, dns_rdatatype_none, NULL,
+			shard, client_addr, NULL, 0, dns_rdatatype_none, NULL,
 			DNS_RRL_RTYPE_TCP, now, false, log_buf, log_buf_len);
 		if (credit_e != NULL) {
-			age = get_age(rrl, e, now);
+			age = get_age(shard, e, now);
 			if (age < rrl->window) {
-				scale = 1.0;
+				scaled = false;
 			}
 		}
 	}
-	if (scale < 1.0) {
-		new_rate = (int)(rate * scale);
-		if (new_rate < 1) {
-			new_rate = 1;
-		}
-		if (ratep->scaled != new_rate) {
-			isc_log_write(DNS_LOGCATEGORY_RRL,
-				      DNS_LOGMODULE_REQUEST, DNS_RRL_LOG_DEBUG1,
-				      "%d qps scaled %s by %.2f"
-				      " from %d to %d",
-				      (int)qps, ratep->str, scale, rate,
-				      new_rate);
-			rate = new_rate;
-			ratep->scaled = rate;
-		}
+	if (scaled) {
+		rate = atomic_load_relaxed(&ratep->scaled);
 	}
 
 	min = -rrl->window * rate;
@@ -674,7 +777,7 @@ debit_rrl_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, double qps, double scale,
 	 * Treat entries older than the window as if they were just created
 	 * Credit other entries.
 	 */
-	age = get_age(rrl, e, now);
+	age = get_age(shard, e, now);
 	if (age > 0) {
 		/*
 		 * Credit tokens earned during elapsed time.
@@ -706,7 +809,7 @@ debit_rrl_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, double qps, double scale,
 			e->log_secs = log_secs;
 		}
 	}
-	set_age(rrl, e, now);
+	set_age(shard, e, now);
 
 	/*
 	 * Debit the entry for this response.
@@ -725,22 +828,7 @@ debit_rrl_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, double qps, double scale,
 	/*
 	 * Drop this response unless it should slip or leak.
 	 */
-	slip = rrl->slip.r;
-	if (slip > 2 && scale < 1.0) {
-		new_slip = (int)(slip * scale);
-		if (new_slip < 2) {
-			new_slip = 2;
-		}
-		if (rrl->slip.scaled != new_slip) {
-			isc_log_write(DNS_LOGCATEGORY_RRL,
-				      DNS_LOGMODULE_REQUEST, DNS_RRL_LOG_DEBUG1,
-				      "%d qps scaled slip"
-				      " by %.2f from %d to %d",
-				      (int)qps, scale, slip, new_slip);
-			slip = new_slip;
-			rrl->slip.scaled = slip;
-		}
-	}
+	slip = scaled ? atomic_load_relaxed(&rrl->slip.scaled) : rrl->slip.r;
 	if (slip != 0 && e->key.s.rtype != DNS_RRL_RTYPE_ALL) {
 		if (e->slip_cnt++ == 0) {
 			if ((int)e->slip_cnt >= slip) {
@@ -762,10 +850,10 @@ debit_rrl_entry(dns_rrl_t *rrl, dns_rrl_entry_t *e, double qps, double scale,
 }
 
 static dns_rrl_qname_buf_t *
-get_qname(dns_rrl_t *rrl, const dns_rrl_entry_t *e) {
+get_qname(dns_rrl_shard_t *shard, const dns_rrl_entry_t *e) {
 	dns_rrl_qname_buf_t *qbuf;
 
-	qbuf = rrl->qnames[e->log_qname];
+	qbuf = shard->qnames[e->log_qname];
 	if (qbuf == NULL || qbuf->e != e) {
 		return NULL;
 	}
@@ -773,13 +861,13 @@ get_qname(dns_rrl_t *rrl, const dns_rrl_entry_t *e) {
 }
 
 static void
-free_qname(dns_rrl_t *rrl, dns_rrl_entry_t *e) {
+free_qname(dns_rrl_shard_t *shard, dns_rrl_entry_t *e) {
 	dns_rrl_qname_buf_t *qbuf;
 
-	qbuf = get_qname(rrl, e);
+	qbuf = get_qname(shard, e);
 	if (qbuf != NULL) {
 		qbuf->e = NULL;
-		ISC_LIST_APPEND(rrl->qname_free, qbuf, link);
+		ISC_LIST_APPEND(shard->qname_free, qbuf, link);
 	}
 }
 
@@ -804,11 +892,12 @@ add_log_str(isc_buffer_t *lb, const char *str, unsigned int str_len) {
  * Build strings for the logs
  */
 static void
-make_log_buf(dns_rrl_t *rrl, dns_rrl_entry_t *e, const char *str1,
+make_log_buf(dns_rrl_shard_t *shard, dns_rrl_entry_t *e, const char *str1,
 	     const char *str2, bool plural, const dns_name_t *qname,
 	     bool save_qname, dns_rrl_result_t rrl_result,
 	     isc_result_t resp_result, char *log_buf,
 	     unsigned int log_buf_len) {
+	dns_rrl_t *rrl = shard->rrl;
 	isc_buffer_t lb;
 	dns_rrl_qname_buf_t *qbuf;
 	isc_netaddr_t cidr;
@@ -900,23 +989,23 @@ make_log_buf(dns_rrl_t *rrl, dns_rrl_entry_t *e, const char *str1,
 	    e->key.s.rtype == DNS_RRL_RTYPE_NODATA ||
 	    e->key.s.rtype == DNS_RRL_RTYPE_NXDOMAIN)
 	{
-		qbuf = get_qname(rrl, e);
+		qbuf = get_qname(shard, e);
 		if (save_qname && qbuf == NULL && qname != NULL &&
 		    dns_name_isabsolute(qname))
 		{
 			/*
 			 * Capture the qname for the "stop limiting" message.
 			 */
-			qbuf = ISC_LIST_TAIL(rrl->qname_free);
+			qbuf = ISC_LIST_TAIL(shard->qname_free);
 			if (qbuf != NULL) {
-				ISC_LIST_UNLINK(rrl->qname_free, qbuf, link);
-			} else if (rrl->num_qnames < DNS_RRL_QNAMES) {
+				ISC_LIST_UNLINK(shard->qname_free, qbuf, link);
+			} else if (shard->num_qnames < DNS_RRL_QNAMES) {
 				qbuf = isc_mem_get(rrl->mctx, sizeof(*qbuf));
 				*qbuf = (dns_rrl_qname_buf_t){
-					.index = rrl->num_qnames,
+					.index = shard->num_qnames,
 				};
 				ISC_LINK_INIT(qbuf, link);
-				rrl->qnames[rrl->num_qnames++] = qbuf;
+				shard->qnames[shard->num_qnames++] = qbuf;
 			}
 			if (qbuf != NULL) {
 				e->log_qname = qbuf->index;
@@ -956,19 +1045,19 @@ make_log_buf(dns_rrl_t *rrl, dns_rrl_entry_t *e, const char *str1,
 }
 
 static void
-log_end(dns_rrl_t *rrl, dns_rrl_entry_t *e, bool early, char *log_buf,
-	unsigned int log_buf_len) {
+log_end(dns_rrl_shard_t *shard, dns_rrl_entry_t *e, bool early,
+	char *log_buf, unsigned int log_buf_len) {
 	if (e->logged) {
-		make_log_buf(rrl, e, early ? "*" : NULL,
-			     rrl->log_only ? "would stop limiting "
+		make_log_buf(shard, e, early ? "*" : NULL,
+			     shard->rrl->log_only ? "would stop limiting "
 					   : "stop limiting ",
 			     true, NULL, false, DNS_RRL_RESULT_OK,
 			     ISC_R_SUCCESS, log_buf, log_buf_len);
 		isc_log_write(DNS_LOGCATEGORY_RRL, DNS_LOGMODULE_REQUEST,
 			      DNS_RRL_LOG_DROP, "%s", log_buf);
-		free_qname(rrl, e);
+		free_qname(shard, e);
 		e->logged = false;
-		--rrl->num_logged;
+		--shard->num_logged;
 	}
 }
 
@@ -976,17 +1065,18 @@ log_end(dns_rrl_t *rrl, dns_rrl_entry_t *e, bool early, char *log_buf,
  * Log messages for streams that have stopped being rate limited.
  */
 static void
-log_stops(dns_rrl_t *rrl, isc_stdtime_t now, int limit, char *log_buf,
-	  unsigned int log_buf_len) {
+log_stops(dns_rrl_shard_t *shard, isc_stdtime_t now, int limit,
+	  char *log_buf, unsigned int log_buf_len) {
+	dns_rrl_t *rrl = shard->rrl;
 	dns_rrl_entry_t *e;
 	int age;
 
-	for (e = rrl->last_logged; e != NULL; e = ISC_LIST_PREV(e, lru)) {
+	for (e = shard->last_logged; e != NULL; e = ISC_LIST_PREV(e, lru)) {
 		if (!e->logged) {
 			continue;
 		}
 		if (now != 0) {
-			age = get_age(rrl, e, now);
+			age = get_age(shard, e, now);
 			if (age < DNS_RRL_STOP_LOG_SECS ||
 			    response_balance(rrl, e, age) < 0)
 			{
@@ -994,8 +1084,8 @@ log_stops(dns_rrl_t *rrl, isc_stdtime_t now, int limit, char *log_buf,
 			}
 		}
 
-		log_end(rrl, e, now == 0, log_buf, log_buf_len);
-		if (rrl->num_logged <= 0) {
+		log_end(shard, e, now == 0, log_buf, log_buf_len);
+		if (shard->num_logged <= 0) {
 			break;
 		}
 
@@ -1003,15 +1093,53 @@ log_stops(dns_rrl_t *rrl, isc_stdtime_t now, int limit, char *log_buf,
 		 * Too many messages could stall real work.
 		 */
 		if (--limit < 0) {
-			rrl->last_logged = ISC_LIST_PREV(e, lru);
+			shard->last_logged = ISC_LIST_PREV(e, lru);
 			return;
 		}
 	}
 	if (e == NULL) {
-		INSIST(rrl->num_logged == 0);
-		rrl->log_stops_time = now;
+		INSIST(shard->num_logged == 0);
+		shard->log_stops_time = now;
 	}
-	rrl->last_logged = e;
+	shard->last_logged = e;
+}
+
+/*
+ * Pick the shard for a client.  The address is masked with the configured
+ * prefix length, so that every client in a rate limited block, and every
+ * entry for that block, shares one shard.
+ */
+static dns_rrl_shard_t *
+get_shard(dns_rrl_t *rrl, const isc_sockaddr_t *client_addr) {
+	uint32_t ip[DNS_RRL_MAX_PREFIX / 32] = { 0 };
+	size_t len = sizeof(ip[0]);
+	uint32_t hval;
+	int i;
+
+	switch (client_addr->type.sa.sa_family) {
+	case AF_INET:
+		ip[0] = client_addr->type.sin.sin_addr.s_addr & rrl->ipv4_mask;
+		break;
+	case AF_INET6:
+		memmove(ip, &client_addr->type.sin6.sin6_addr, sizeof(ip));
+		for (i = 0; i < DNS_RRL_MAX_PREFIX / 32; ++i) {
+			ip[i] &= rrl->ipv6_mask[i];
+		}
+		len = sizeof(ip);
+		break;
+	}
+
+	hval = isc_hash32(ip, len, true);
+	return &rrl->shards[hval & (rrl->nshards - 1)];
+}
+
+static void
+lock_shard(dns_rrl_shard_t *shard) {
+	if (isc_mutex_trylock(&shard->lock) != ISC_R_SUCCESS) {
+		LOCK(&shard->lock);
+		++shard->contended;
+	}
+	++shard->lookups;
 }
 
 /*
@@ -1023,11 +1151,11 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 	const dns_name_t *qname, isc_result_t resp_result, isc_stdtime_t now,
 	bool wouldlog, char *log_buf, unsigned int log_buf_len) {
 	dns_rrl_t *rrl;
+	dns_rrl_shard_t *shard;
 	dns_rrl_rtype_t rtype;
 	dns_rrl_entry_t *e;
 	isc_netaddr_t netclient;
-	int secs;
-	double qps, scale;
+	bool scaled;
 	int exempt_match;
 	isc_result_t result;
 	dns_rrl_result_t rrl_result;
@@ -1044,46 +1172,19 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 		}
 	}
 
-	LOCK(&rrl->lock);
-
 	/*
 	 * Estimate total query per second rate when scaling by qps.
 	 */
-	if (rrl->qps_scale == 0) {
-		qps = 0.0;
-		scale = 1.0;
-	} else {
-		++rrl->qps_responses;
-		secs = delta_rrl_time(rrl->qps_time, now);
-		if (secs <= 0) {
-			qps = rrl->qps;
-		} else {
-			qps = (1.0 * rrl->qps_responses) / secs;
-			if (secs >= rrl->window) {
-				if (isc_log_wouldlog(DNS_RRL_LOG_DEBUG3)) {
-					isc_log_write(DNS_LOGCATEGORY_RRL,
-						      DNS_LOGMODULE_REQUEST,
-						      DNS_RRL_LOG_DEBUG3,
-						      "%d responses/%d seconds"
-						      " = %d qps",
-						      rrl->qps_responses, secs,
-						      (int)qps);
-				}
-				rrl->qps = qps;
-				rrl->qps_responses = 0;
-				rrl->qps_time = now;
-			} else if (qps < rrl->qps) {
-				qps = rrl->qps;
-			}
-		}
-		scale = rrl->qps_scale / qps;
-	}
+	scaled = (rrl->qps_scale != 0) && update_scale(rrl, now);
+
+	shard = get_shard(rrl, client_addr);
+	lock_shard(shard);
 
 	/*
 	 * Do maintenance once per second.
 	 */
-	if (rrl->num_logged > 0 && rrl->log_stops_time != now) {
-		log_stops(rrl, now, 8, log_buf, log_buf_len);
+	if (shard->num_logged > 0 && shard->log_stops_time != now) {
+		log_stops(shard, now, 8, log_buf, log_buf_len);
 	}
 
 	/*
@@ -1091,17 +1192,17 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 	 * Do not try to rate limit TCP responses.
 	 */
 	if (is_tcp) {
-		if (scale < 1.0) {
-			e = get_entry(rrl, client_addr, NULL, 0,
+		if (scaled) {
+			e = get_entry(shard, client_addr, NULL, 0,
 				      dns_rdatatype_none, NULL,
 				      DNS_RRL_RTYPE_TCP, now, true, log_buf,
 				      log_buf_len);
 			if (e != NULL) {
 				e->responses = -(rrl->window + 1);
-				set_age(rrl, e, now);
+				set_age(shard, e, now);
 			}
 		}
-		UNLOCK(&rrl->lock);
+		UNLOCK(&shard->lock);
 		return DNS_RRL_RESULT_OK;
 	}
 
@@ -1126,10 +1227,10 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 		rtype = DNS_RRL_RTYPE_ERROR;
 		break;
 	}
-	e = get_entry(rrl, client_addr, zone, qclass, qtype, qname, rtype, now,
-		      true, log_buf, log_buf_len);
+	e = get_entry(shard, client_addr, zone, qclass, qtype, qname, rtype,
+		      now, true, log_buf, log_buf_len);
 	if (e == NULL) {
-		UNLOCK(&rrl->lock);
+		UNLOCK(&shard->lock);
 		return DNS_RRL_RESULT_OK;
 	}
 
@@ -1138,14 +1239,14 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 		 * Do not worry about speed or releasing the lock.
 		 * This message appears before messages from debit_rrl_entry().
 		 */
-		make_log_buf(rrl, e, "consider limiting ", NULL, false, qname,
+		make_log_buf(shard, e, "consider limiting ", NULL, false, qname,
 			     false, DNS_RRL_RESULT_OK, resp_result, log_buf,
 			     log_buf_len);
 		isc_log_write(DNS_LOGCATEGORY_RRL, DNS_LOGMODULE_REQUEST,
 			      DNS_RRL_LOG_DEBUG1, "%s", log_buf);
 	}
 
-	rrl_result = debit_rrl_entry(rrl, e, qps, scale, client_addr, now,
+	rrl_result = debit_rrl_entry(shard, e, scaled, client_addr, now,
 				     log_buf, log_buf_len);
 
 	if (rrl->all_per_second.r != 0) {
@@ -1160,21 +1261,21 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 		dns_rrl_entry_t *e_all;
 		dns_rrl_result_t rrl_all_result;
 
-		e_all = get_entry(rrl, client_addr, zone, 0, dns_rdatatype_none,
-				  NULL, DNS_RRL_RTYPE_ALL, now, true, log_buf,
-				  log_buf_len);
+		e_all = get_entry(shard, client_addr, zone, 0,
+				  dns_rdatatype_none, NULL, DNS_RRL_RTYPE_ALL,
+				  now, true, log_buf, log_buf_len);
 		if (e_all == NULL) {
-			UNLOCK(&rrl->lock);
+			UNLOCK(&shard->lock);
 			return DNS_RRL_RESULT_OK;
 		}
-		rrl_all_result = debit_rrl_entry(rrl, e_all, qps, scale,
+		rrl_all_result = debit_rrl_entry(shard, e_all, scaled,
 						 client_addr, now, log_buf,
 						 log_buf_len);
 		if (rrl_all_result != DNS_RRL_RESULT_OK) {
 			e = e_all;
 			rrl_result = rrl_all_result;
 			if (isc_log_wouldlog(DNS_RRL_LOG_DEBUG1)) {
-				make_log_buf(rrl, e,
+				make_log_buf(shard, e,
 					     "prefer all-per-second limiting ",
 					     NULL, true, qname, false,
 					     DNS_RRL_RESULT_OK, resp_result,
@@ -1188,7 +1289,7 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 	}
 
 	if (rrl_result == DNS_RRL_RESULT_OK) {
-		UNLOCK(&rrl->lock);
+		UNLOCK(&shard->lock);
 		return DNS_RRL_RESULT_OK;
 	}
 
@@ -1198,14 +1299,14 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 	if ((!e->logged || e->log_secs >= DNS_RRL_MAX_LOG_SECS) &&
 	    isc_log_wouldlog(DNS_RRL_LOG_DROP))
 	{
-		make_log_buf(rrl, e, rrl->log_only ? "would " : NULL,
+		make_log_buf(shard, e, rrl->log_only ? "would " : NULL,
 			     e->logged ? "continue limiting " : "limit ", true,
 			     qname, true, DNS_RRL_RESULT_OK, resp_result,
 			     log_buf, log_buf_len);
 		if (!e->logged) {
 			e->logged = true;
-			if (++rrl->num_logged <= 1) {
-				rrl->last_logged = e;
+			if (++shard->num_logged <= 1) {
+				shard->last_logged = e;
 			}
 		}
 		e->log_secs = 0;
@@ -1214,7 +1315,7 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 		 * Avoid holding the lock.
 		 */
 		if (!wouldlog) {
-			UNLOCK(&rrl->lock);
+			UNLOCK(&shard->lock);
 			e = NULL;
 		}
 		isc_log_write(DNS_LOGCATEGORY_RRL, DNS_LOGMODULE_REQUEST,
@@ -1225,7 +1326,7 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 	 * Make a log message for the caller.
 	 */
 	if (wouldlog) {
-		make_log_buf(rrl, e,
+		make_log_buf(shard, e,
 			     rrl->log_only ? "would rate limit "
 					   : "rate limit ",
 			     NULL, false, qname, false, rrl_result, resp_result,
@@ -1238,63 +1339,75 @@ dns_rrl(dns_view_t *view, dns_zone_t *zone, const isc_sockaddr_t *client_addr,
 		 * the ending log message.
 		 */
 		if (!e->logged) {
-			free_qname(rrl, e);
+			free_qname(shard, e);
 		}
-		UNLOCK(&rrl->lock);
+		UNLOCK(&shard->lock);
 	}
 
 	return rrl_result;
 }
 
-void
-dns_rrl_view_destroy(dns_view_t *view) {
-	dns_rrl_t *rrl = NULL;
+static void
+destroy_shard(dns_rrl_shard_t *shard) {
+	dns_rrl_t *rrl = shard->rrl;
 	dns_rrl_hash_t *h = NULL;
 	char log_buf[DNS_RRL_LOG_BUF_LEN];
 	int i;
 
-	rrl = view->rrl;
-	if (rrl == NULL) {
-		return;
-	}
-	view->rrl = NULL;
-
-	/*
-	 * Assume the caller takes care of locking the view and anything else.
-	 */
-
-	if (rrl->num_logged > 0) {
-		log_stops(rrl, 0, INT32_MAX, log_buf, sizeof(log_buf));
+	if (shard->num_logged > 0) {
+		log_stops(shard, 0, INT32_MAX, log_buf, sizeof(log_buf));
 	}
 
 	for (i = 0; i < DNS_RRL_QNAMES; ++i) {
-		if (rrl->qnames[i] == NULL) {
+		if (shard->qnames[i] == NULL) {
 			break;
 		}
-		isc_mem_put(rrl->mctx, rrl->qnames[i], sizeof(*rrl->qnames[i]));
-	}
-
-	if (rrl->exempt != NULL) {
-		dns_acl_detach(&rrl->exempt);
+		isc_mem_put(rrl->mctx, shard->qnames[i],
+			    sizeof(*shard->qnames[i]));
 	}
 
-	isc_mutex_destroy(&rrl->lock);
+	isc_mutex_destroy(&shard->lock);
 
-	ISC_LIST_FOREACH (rrl->blocks, b, link) {
-		ISC_LIST_UNLINK(rrl->blocks, b, link);
+	ISC_LIST_FOREACH (shard->blocks, b, link) {
+		ISC_LIST_UNLINK(shard->blocks, b, link);
 		isc_mem_put(rrl->mctx, b,
 			    STRUCT_FLEX_SIZE(b, entries, b->count));
 	}
 
-	h = rrl->hash;
+	h = shard->hash;
 	if (h != NULL) {
 		isc_mem_put(rrl->mctx, h, STRUCT_FLEX_SIZE(h, bins, h->length));
 	}
 
-	h = rrl->old_hash;
+	h = shard->old_hash;
 	if (h != NULL) {
 		isc_mem_put(rrl->mctx, h, STRUCT_FLEX_SIZE(h, bins, h->length));
 	}
+}
+
+void
+dns_rrl_view_destroy(dns_view_t *view) {
+	dns_rrl_t *rrl = NULL;
+
+	rrl = view->rrl;
+	if (rrl == NULL) {
+		return;
+	}
+	view->rrl = NULL;
+
+	/*
+	 * Assume the caller takes care of locking the view and anything else.
+	 */
+
+	for (unsigned int i = 0; i < rrl->nshards; i++) {
+		destroy_shard(&rrl->shards[i]);
+	}
+	isc_mem_cput(rrl->mctx, rrl->shards, rrl->nshards,
+		     sizeof(rrl->shards[0]));
+
+	if (rrl->exempt != NULL) {
+		dns_acl_detach(&rrl->exempt);
+	}
 
 	isc_mem_putanddetach(&rrl->mctx, rrl, sizeof(*rrl));
 }
@@ -1303,29 +1416,196 @@ isc_result_t
 dns_rrl_init(dns_rrl_t **rrlp, dns_view_t *view, int min_entries) {
 	dns_rrl_t *rrl;
 	isc_result_t result;
+	isc_stdtime_t now = isc_stdtime_now();
+	unsigned int nshards, i;
 
 	*rrlp = NULL;
 
+	/*
+	 * Use a power of two number of shards, a few per loop, so that
+	 * clients handled by different loops rarely share a lock.
+	 */
+	nshards = 1;
+	while (nshards < isc_loopmgr_nloops() * DNS_RRL_SHARDS_PER_LOOP &&
+	       nshards < DNS_RRL_MAX_SHARDS)
+	{
+		nshards <<= 1;
+	}
+
 	rrl = isc_mem_get(view->mctx, sizeof(*rrl));
 	*rrl = (dns_rrl_t){
-		.ts_bases[0] = isc_stdtime_now(),
+		.nshards = nshards,
+		.qps = 1,
+		.qps_time = now,
 	};
 	isc_mem_attach(view->mctx, &rrl->mctx);
-	isc_mutex_init(&rrl->lock);
+	rrl->shards = isc_mem_cget(rrl->mctx, nshards, sizeof(rrl->shards[0]));
+	for (i = 0; i < nshards; i++) {
+		dns_rrl_shard_t *shard = &rrl->shards[i];
+
+		*shard = (dns_rrl_shard_t){
+			.rrl = rrl,
+			.ts_bases[0] = now,
+		};
+		isc_mutex_init(&shard->lock);
+	}
 
 	view->rrl = rrl;
 
-	result = expand_entries(rrl, min_entries);
-	if (result != ISC_R_SUCCESS) {
-		dns_rrl_view_destroy(view);
-		return result;
-	}
-	result = expand_rrl_hash(rrl, 0);
-	if (result != ISC_R_SUCCESS) {
-		dns_rrl_view_destroy(view);
-		return result;
+	/*
+	 * "min-table-size" is split evenly between the shards.
+	 */
+	min_entries = (min_entries + nshards - 1) / nshards;
+	for (i = 0; i < nshards; i++) {
+		result = expand_entries(&rrl->shards[i], min_entries);
+		if (result != ISC_R_SUCCESS) {
+			dns_rrl_view_destroy(view);
+			return result;
+		}
+		result = expand_rrl_hash(&rrl->shards[i], 0);
+		if (result != ISC_R_SUCCESS) {
+			dns_rrl_view_destroy(view);
+			return result;
+		}
 	}
 
 	*rrlp = rrl;
 	return ISC_R_SUCCESS;
 }
+
+typedef struct rrl_stats {
+	uint64_t shards;
+	uint64_t entries;
+	uint64_t lookups;
+	uint64_t contended;
+	uint64_t lookups_min;
+	uint64_t lookups_max;
+	uint64_t imbalance;
+} rrl_stats_t;
+
+static void
+getstats(dns_rrl_t *rrl, rrl_stats_t *stats) {
+	*stats = (rrl_stats_t){
+		.shards = rrl->nshards,
+		.lookups_min = UINT64_MAX,
+	};
+
+	for (unsigned int i = 0; i < rrl->nshards; i++) {
+		dns_rrl_shard_t *shard = &rrl->shards[i];
+
+		LOCK(&shard->lock);
+		stats->entries += shard->num_entries;
+		stats->lookups += shard->lookups;
+		stats->contended += shard->contended;
+		stats->lookups_min = ISC_MIN(stats->lookups_min,
+					     shard->lookups);
+		stats->lookups_max = ISC_MAX(stats->lookups_max,
+					     shard->lookups);
+		UNLOCK(&shard->lock);
+	}
+
+	/*
+	 * The busiest shard's share of the lookups as a percentage of an
+	 * even share: 100 is perfectly balanced, and nshards * 100 means
+	 * every lookup went to the same shard.
+	 */
+	if (stats->lookups != 0) {
+		stats->imbalance = stats->lookups_max * rrl->nshards * 100 /
+				   stats->lookups;
+	}
+}
+
+#ifdef HAVE_LIBXML2
+#define TRY0(a)                     \
+	do {                        \
+		xmlrc = (a);        \
+		if (xmlrc < 0)      \
+			goto error; \
+	} while (0)
+static int
+renderstat(const char *name, uint64_t value, xmlTextWriterPtr writer) {
+	int xmlrc;
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "counter"));
+	TRY0(xmlTextWriterWriteAttribute(writer, ISC_XMLCHAR "name",
+					 ISC_XMLCHAR name));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64 "", value));
+	TRY0(xmlTextWriterEndElement(writer)); /* counter */
+
+error:
+	return xmlrc;
+}
+
+int
+dns_rrl_renderxml(dns_rrl_t *rrl, void *writer0) {
+	rrl_stats_t stats;
+	int xmlrc;
+	xmlTextWriterPtr writer = (xmlTextWriterPtr)writer0;
+
+	REQUIRE(rrl != NULL);
+
+	getstats(rrl, &stats);
+	TRY0(renderstat("Shards", stats.shards, writer));
+	TRY0(renderstat("Entries", stats.entries, writer));
+	TRY0(renderstat("Lookups", stats.lookups, writer));
+	TRY0(renderstat("LockContended", stats.contended, writer));
+	TRY0(renderstat("ShardLookupsMin", stats.lookups_min, writer));
+	TRY0(renderstat("ShardLookupsMax", stats.lookups_max, writer));
+	TRY0(renderstat("ShardImbalance", stats.imbalance, writer));
+error:
+	return xmlrc;
+}
+#endif /* ifdef HAVE_LIBXML2 */
+
+#ifdef HAVE_JSON_C
+#define CHECKMEM(m)                              \
+	do {                                     \
+		if (m == NULL) {                 \
+			result = ISC_R_NOMEMORY; \
+			goto error;              \
+		}                                \
+	} while (0)
+
+isc_result_t
+dns_rrl_renderjson(dns_rrl_t *rrl, void *rstats0) {
+	isc_result_t result = ISC_R_SUCCESS;
+	rrl_stats_t stats;
+	json_object *obj;
+	json_object *rstats = (json_object *)rstats0;
+
+	REQUIRE(rrl != NULL);
+
+	getstats(rrl, &stats);
+
+	obj = json_object_new_int64(stats.shards);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "Shards", obj);
+
+	obj = json_object_new_int64(stats.entries);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "Entries", obj);
+
+	obj = json_object_new_int64(stats.lookups);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "Lookups", obj);
+
+	obj = json_object_new_int64(stats.contended);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "LockContended", obj);
+
+	obj = json_object_new_int64(stats.lookups_min);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "ShardLookupsMin", obj);
+
+	obj = json_object_new_int64(stats.lookups_max);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "ShardLookupsMax", obj);
+
+	obj = json_object_new_int64(stats.imbalance);
+	CHECKMEM(obj);
+	json_object_object_add(rstats, "ShardImbalance", obj);
+
+error:
+	return result;
+}
+#endif /* ifdef HAVE_JSON_C */
@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/atomic.h>
+#include <isc/buffer.h>
+#include <isc/hash.h>
+#include <isc/loop.h>
+#include <isc/md.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/result.h>
+#include <isc/serial.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdataset.h>
+#include <dns/rdatastruct.h>
+#include <dns/sigcache.h>
+
+#include <dst/dst.h>
+
+#define SIGCACHE_MAGIC	  ISC_MAGIC('S', 'g', 'C', 'a')
+#define VALID_SIGCACHE(m) ISC_MAGIC_VALID(m, SIGCACHE_MAGIC)
+
+#define SIGCACHE_INIT_SIZE (1 << 10) /* Must be power of 2 */
+#define SIGCACHE_MIN_SIZE  (1 << 8)  /* Must be power of 2 */
+
+#define CHECK(op)                            \
+	do {                                 \
+		result = (op);               \
+		if (result != ISC_R_SUCCESS) \
+			goto cleanup;        \
+	} while (0)
+
+typedef struct dns_scentry dns_scentry_t;
+
+/*
+ * The entries are spread over one LRU list per loop by their hash value,
+ * so the lists are rarely contended; the lookups don't touch them at all.
+ */
+typedef struct dns_sclru {
+	isc_mutex_t lock;
+	struct cds_list_head head;
+	size_t count;
+} dns_sclru_t;
+
+struct dns_sigcache {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	struct cds_lfht *ht;
+	dns_sclru_t *lru;
+	uint32_t nlru;
+	size_t maxperlru;
+};
+
+struct dns_scentry {
+	isc_mem_t *mctx;
+
+	/*
+	 * Set when the entry is found, cleared when the entry is given
+	 * a second chance instead of being evicted.
+	 */
+	atomic_bool used;
+
+	struct cds_lfht_node ht_node;
+	struct rcu_head rcu_head;
+	struct cds_list_head lru_head;
+
+	dns_sigcachekey_t key;
+	isc_result_t result;
+	dns_name_t wild;
+};
+
+static void
+scentry_destroy(struct rcu_head *rcu_head);
+
+dns_sigcache_t *
+dns_sigcache_new(isc_mem_t *mctx, size_t maxentries) {
+	uint32_t nlru = ISC_MAX(isc_loopmgr_nloops(), 1);
+
+	REQUIRE(maxentries > 0);
+
+	dns_sigcache_t *sc = isc_mem_get(mctx, sizeof(*sc));
+	*sc = (dns_sigcache_t){
+		.magic = SIGCACHE_MAGIC,
+		.nlru = nlru,
+		.maxperlru = ISC_MAX(maxentries / nlru, 1),
+	};
+
+	sc->ht = cds_lfht_new(SIGCACHE_INIT_SIZE, SIGCACHE_MIN_SIZE, 0,
+			      CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING, NULL);
+	INSIST(sc->ht != NULL);
+
+	sc->lru = isc_mem_cget(mctx, sc->nlru, sizeof(sc->lru[0]));
+	for (size_t i = 0; i < sc->nlru; i++) {
+		isc_mutex_init(&sc->lru[i].lock);
+		CDS_INIT_LIST_HEAD(&sc->lru[i].head);
+	}
+
+	isc_mem_attach(mctx, &sc->mctx);
+
+	return sc;
+}
+
+void
+dns_sigcache_destroy(dns_sigcache_t **scp) {
+	REQUIRE(scp != NULL && *scp != NULL);
+	REQUIRE(VALID_SIGCACHE(*scp));
+
+	dns_sigcache_t *sc = *scp;
+	*scp = NULL;
+	sc->magic = 0;
+
+	dns_scentry_t *entry = NULL;
+	struct cds_lfht_iter iter;
+	cds_lfht_for_each_entry(sc->ht, &iter, entry, ht_node) {
+		INSIST(!cds_lfht_del(sc->ht, &entry->ht_node));
+		scentry_destroy(&entry->rcu_head);
+	}
+	RUNTIME_CHECK(!cds_lfht_destroy(sc->ht, NULL));
+
+	for (size_t i = 0; i < sc->nlru; i++) {
+		isc_mutex_destroy(&sc->lru[i].lock);
+	}
+	isc_mem_cput(sc->mctx, sc->lru, sc->nlru, sizeof(sc->lru[0]));
+
+	isc_mem_putanddetach(&sc->mctx, sc, sizeof(dns_sigcache_t));
+}
+
+static int
+rdata_compare_wrapper(const void *rdata1, const void *rdata2) {
+	return dns_rdata_compare((const dns_rdata_t *)rdata1,
+				 (const dns_rdata_t *)rdata2);
+}
+
+static isc_result_t
+md_putuint16(isc_md_t *md, uint16_t val) {
+	unsigned char buf[2] = { val >> 8, val & 0xff };
+
+	return isc_md_update(md, buf, sizeof(buf));
+}
+
+isc_result_t
+dns_sigcache_key(const dns_name_t *name, dns_rdataset_t *rdataset,
+		 dst_key_t *key, dns_rdata_t *sigrdata, isc_mem_t *mctx,
+		 dns_sigcachekey_t *skey) {
+	isc_result_t result;
+	dns_rdata_rrsig_t sig;
+	dns_fixedname_t fixed;
+	dns_name_t *owner = dns_fixedname_initname(&fixed);
+	unsigned char keydata[DST_KEY_MAXSIZE];
+	isc_buffer_t keybuf;
+	isc_region_t r;
+	dns_rdataset_t clone;
+	dns_rdata_t *rdatas = NULL;
+	unsigned int nrdata, i = 0;
+	unsigned int digestlen = sizeof(skey->digest);
+	isc_md_t *md = NULL;
+
+	REQUIRE(name != NULL);
+	REQUIRE(DNS_RDATASET_VALID(rdataset));
+	REQUIRE(key != NULL);
+	REQUIRE(sigrdata != NULL && sigrdata->type == dns_rdatatype_rrsig);
+	REQUIRE(skey != NULL);
+
+	result = dns_rdata_tostruct(sigrdata, &sig, NULL);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	isc_buffer_init(&keybuf, keydata, sizeof(keydata));
+	result = dst_key_todns(key, &keybuf);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	/*
+	 * The rdata are digested in canonical order, so the same RRset
+	 * is recognized whatever the order it was received in.
+	 */
+	nrdata = dns_rdataset_count(rdataset);
+	INSIST(nrdata > 0);
+	rdatas = isc_mem_cget(mctx, nrdata, sizeof(rdatas[0]));
+
+	dns_rdataset_init(&clone);
+	dns_rdataset_clone(rdataset, &clone);
+	DNS_RDATASET_FOREACH (&clone) {
+		INSIST(i < nrdata);
+		dns_rdata_init(&rdatas[i]);
+		dns_rdataset_current(&clone, &rdatas[i++]);
+	}
+	dns_rdataset_disassociate(&clone);
+	qsort(rdatas, i, sizeof(rdatas[0]), rdata_compare_wrapper);
+
+	md = isc_md_new();
+	CHECK(isc_md_init(md, ISC_MD_SHA256));
+
+	CHECK(md_putuint16(md, rdataset->rdclass));
+	CHECK(md_putuint16(md, rdataset->type));
+
+	RUNTIME_CHECK(dns_name_downcase(name, owner) == ISC_R_SUCCESS);
+	dns_name_toregion(owner, &r);
+	CHECK(isc_md_update(md, r.base, r.length));
+
+	CHECK(md_putuint16(md, i));
+	for (unsigned int j = 0; j < i; j++) {
+		CHECK(md_putuint16(md, rdatas[j].length));
+		CHECK(isc_md_update(md, rdatas[j].data, rdatas[j].length));
+	}
+
+	dns_rdata_toregion(sigrdata, &r);
+	CHECK(md_putuint16(md, r.length));
+	CHECK(isc_md_update(md, r.base, r.length));
+
+	isc_buffer_usedregion(&keybuf, &r);
+	CHECK(md_putuint16(md, r.length));
+	CHECK(isc_md_update(md, r.base, r.length));
+
+	CHECK(isc_md_final(md, skey->digest, &digestlen));
+	INSIST(digestlen == sizeof(skey->digest));
+
+	skey->timesigned = sig.timesigned;
+	skey->timeexpire = sig.timeexpire;
+
+cleanup:
+	isc_md_free(md);
+	isc_mem_cput(mctx, rdatas, nrdata, sizeof(rdatas[0]));
+
+	return result;
+}
+
+static int
+scentry_match(struct cds_lfht_node *ht_node, const void *key0) {
+	const dns_sigcachekey_t *key = key0;
+	dns_scentry_t *entry = caa_container_of(ht_node, dns_scentry_t,
+						ht_node);
+
+	return memcmp(entry->key.digest, key->digest, sizeof(key->digest)) ==
+	       0;
+}
+
+static uint32_t
+scentry_hash(const dns_sigcachekey_t *key) {
+	return isc_hash32(key->digest, sizeof(key->digest), true);
+}
+
+static dns_scentry_t *
+scentry_new(isc_mem_t *mctx, const dns_sigcachekey_t *skey,
+	    isc_result_t result, const dns_name_t *wild) {
+	dns_scentry_t *entry = isc_mem_get(mctx, sizeof(*entry));
+	*entry = (dns_scentry_t){
+		.key = *skey,
+		.result = result,
+		.lru_head = CDS_LIST_HEAD_INIT(entry->lru_head),
+	};
+
+	isc_mem_attach(mctx, &entry->mctx);
+
+	dns_name_init(&entry->wild);
+	if (result == DNS_R_FROMWILDCARD) {
+		dns_name_dup(wild, mctx, &entry->wild);
+	}
+
+	return entry;
+}
+
+static void
+scentry_destroy(struct rcu_head *rcu_head) {
+	dns_scentry_t *entry = caa_container_of(rcu_head, dns_scentry_t,
+						rcu_head);
+
+	if (dns_name_dynamic(&entry->wild)) {
+		dns_name_free(&entry->wild, entry->mctx);
+	}
+	isc_mem_putanddetach(&entry->mctx, entry, sizeof(*entry));
+}
+
+/*
+ * Evict the least recently used entry of the list, giving the entries
+ * that have been found since they were last considered a second chance.
+ * The list must be locked.
+ */
+static void
+scentry_evict(struct cds_lfht *ht, dns_sclru_t *lru) {
+	dns_scentry_t *entry = NULL;
+
+	for (size_t chances = lru->count; chances > 0; chances--) {
+		entry = cds_list_first_entry(&lru->head, dns_scentry_t,
+					     lru_head);
+		if (!atomic_exchange_relaxed(&entry->used, false)) {
+			break;
+		}
+		cds_list_move_tail(&entry->lru_head, &lru->head);
+	}
+
+	entry = cds_list_first_entry(&lru->head, dns_scentry_t, lru_head);
+	cds_list_del(&entry->lru_head);
+	lru->count--;
+
+	INSIST(!cds_lfht_del(ht, &entry->ht_node));
+	call_rcu(&entry->rcu_head, scentry_destroy);
+}
+
+isc_result_t
+dns_sigcache_find(dns_sigcache_t *sc, const dns_sigcachekey_t *skey,
+		  isc_stdtime_t now, dns_name_t *wild) {
+	REQUIRE(VALID_SIGCACHE(sc));
+	REQUIRE(skey != NULL);
+
+	/*
+	 * Let dns_dnssec_verify() report the temporal errors.
+	 */
+	if (isc_serial_lt((uint32_t)now, skey->timesigned) ||
+	    isc_serial_lt(skey->timeexpire, (uint32_t)now))
+	{
+		return ISC_R_NOTFOUND;
+	}
+
+	isc_result_t result = ISC_R_NOTFOUND;
+	uint32_t hashval = scentry_hash(skey);
+	struct cds_lfht_iter iter;
+
+	rcu_read_lock();
+	struct cds_lfht *ht = rcu_dereference(sc->ht);
+	INSIST(ht != NULL);
+
+	cds_lfht_lookup(ht, hashval, scentry_match, skey, &iter);
+	dns_scentry_t *found = cds_lfht_entry(cds_lfht_iter_get_node(&iter),
+					      dns_scentry_t, ht_node);
+	if (found != NULL) {
+		/* Avoid dirtying the cache line when it's already set */
+		if (!atomic_load_relaxed(&found->used)) {
+			atomic_store_relaxed(&found->used, true);
+		}
+		if (found->result == DNS_R_FROMWILDCARD && wild != NULL) {
+			dns_name_copy(&found->wild, wild);
+		}
+		result = found->result;
+	}
+
+	rcu_read_unlock();
+
+	return result;
+}
+
+void
+dns_sigcache_add(dns_sigcache_t *sc, const dns_sigcachekey_t *skey,
+		 isc_result_t result, const dns_name_t *wild) {
+	REQUIRE(VALID_SIGCACHE(sc));
+	REQUIRE(skey != NULL);
+	REQUIRE(result == ISC_R_SUCCESS || result == DNS_R_FROMWILDCARD);
+	REQUIRE(result != DNS_R_FROMWILDCARD || wild != NULL);
+
+	uint32_t hashval = scentry_hash(skey);
+	dns_sclru_t *lru = &sc->lru[hashval % sc->nlru];
+	dns_scentry_t *entry = scentry_new(sc->mctx, skey, result, wild);
+
+	rcu_read_lock();
+	struct cds_lfht *ht = rcu_dereference(sc->ht);
+	INSIST(ht != NULL);
+
+	struct cds_lfht_node *ht_node = cds_lfht_add_unique(
+		ht, hashval, scentry_match, skey, &entry->ht_node);
+	if (ht_node != &entry->ht_node) {
+		/* Someone else verified the same signature */
+		rcu_read_unlock();
+		scentry_destroy(&entry->rcu_head);
+		return;
+	}
+
+	LOCK(&lru->lock);
+	cds_list_add_tail(&entry->lru_head, &lru->head);
+	lru->count++;
+
+	while (lru->count > sc->maxperlru) {
+		scentry_evict(ht, lru);
+	}
+	UNLOCK(&lru->lock);
+
+	rcu_read_unlock();
+}
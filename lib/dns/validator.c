@@ -35,6 +35,7 @@
 #include <dns/dnssec.h>
 #include <dns/ds.h>
 #include <dns/ede.h>
+#include <dns/keycache.h>
 #include <dns/keytable.h>
 #include <dns/keyvalues.h>
 #include <dns/message.h>
@@ -45,7 +46,9 @@
 #include <dns/rdataset.h>
 #include <dns/rdatatype.h>
 #include <dns/resolver.h>
+#include <dns/sigcache.h>
 #include <dns/validator.h>
+#include <dns/verifyqueue.h>
 #include <dns/view.h>
 
 /*! \file
@@ -1024,6 +1027,44 @@ create_validator(dns_validator_t *val, dns_name_t *name, dns_rdatatype_t type,
 	return result;
 }
 
+static void
+resolver_incstats(dns_validator_t *val, isc_statscounter_t counter) {
+	if (val->view->resolver != NULL) {
+		dns_resolver_incstats(val->view->resolver, counter);
+	}
+}
+
+/*%
+ * Build a dst_key_t from the DNSKEY 'rdata' owned by 'name', reusing
+ * the one in the view's key cache if the key has been seen before.
+ */
+static isc_result_t
+keyfromrdata(dns_validator_t *val, const dns_name_t *name,
+	     const dns_rdata_t *rdata, dst_key_t **keyp) {
+	dns_keycache_t *keycache = val->view->keycache;
+	isc_result_t result;
+
+	if (keycache == NULL) {
+		return dns_dnssec_keyfromrdata(name, rdata, val->view->mctx,
+					       keyp);
+	}
+
+	result = dns_keycache_find(keycache, name, rdata, keyp);
+	if (result == ISC_R_SUCCESS) {
+		resolver_incstats(val, dns_resstatscounter_keycachehit);
+		return ISC_R_SUCCESS;
+	}
+
+	resolver_incstats(val, dns_resstatscounter_keycachemiss);
+
+	result = dns_dnssec_keyfromrdata(name, rdata, val->view->mctx, keyp);
+	if (result == ISC_R_SUCCESS) {
+		dns_keycache_add(keycache, name, rdata, *keyp);
+	}
+
+	return result;
+}
+
 /*%
  * Try to find a key that could have signed val->siginfo among those in
  * 'rdataset'.  If found, build a dst_key_t for it and point val->key at
@@ -1072,8 +1113,8 @@ select_signing_key(dns_validator_t *val, dns_rdataset_t *rdataset) {
 			continue;
 		}
 
-		result = dns_dnssec_keyfromrdata(&siginfo->signer, &rdata,
-						 val->view->mctx, &val->key);
+		result = keyfromrdata(val, &siginfo->signer, &rdata,
+				      &val->key);
 		if (result == ISC_R_SUCCESS) {
 			/* found the key we wanted */
 			break;
@@ -1351,8 +1392,7 @@ selfsigned_dnskey(dns_validator_t *val) {
 				return ISC_R_SUCCESS;
 			}
 
-			result = dns_dnssec_keyfromrdata(name, &keyrdata, mctx,
-							 &dstkey);
+			result = keyfromrdata(val, name, &keyrdata, &dstkey);
 			if (result != ISC_R_SUCCESS) {
 				continue;
 			}
@@ -1427,10 +1467,35 @@ verify(dns_validator_t *val, dst_key_t *key, dns_rdata_t *rdata,
 	isc_result_t result;
 	dns_fixedname_t fixed;
 	bool ignore = false;
+	bool cached = false;
 	dns_name_t *wild;
+	dns_sigcache_t *sigcache = val->view->sigcache;
+	dns_sigcachekey_t skey = { 0 };
 
 	val->attributes |= VALATTR_TRIEDVERIFY;
 	wild = dns_fixedname_initname(&fixed);
+
+	/*
+	 * If this RRSIG has already been verified over the same RRset
+	 * with the same key, there is no need to do it again.
+	 */
+	if (sigcache != NULL &&
+	    dns_sigcache_key(val->name, val->rdataset, key, rdata,
+			     val->view->mctx, &skey) != ISC_R_SUCCESS)
+	{
+		sigcache = NULL;
+	}
+	if (sigcache != NULL) {
+		result = dns_sigcache_find(sigcache, &skey, isc_stdtime_now(),
+					   wild);
+		if (result != ISC_R_NOTFOUND) {
+			resolver_incstats(val, dns_resstatscounter_sigcachehit);
+			cached = true;
+			goto verified;
+		}
+		resolver_incstats(val, dns_resstatscounter_sigcachemiss);
+	}
+
 	if (over_max_validations(val)) {
 		return ISC_R_QUOTA;
 	}
@@ -1444,7 +1509,19 @@ again:
 		goto again;
 	}
 
-	if (ignore && (result == ISC_R_SUCCESS || result == DNS_R_FROMWILDCARD))
+	if (sigcache != NULL && !ignore &&
+	    (result == ISC_R_SUCCESS || result == DNS_R_FROMWILDCARD))
+	{
+		dns_sigcache_add(sigcache, &skey, result, wild);
+	}
+
+verified:
+	if (cached) {
+		validator_log(val, ISC_LOG_DEBUG(3),
+			      "verify rdataset (keyid=%u): %s (cached)", keyid,
+			      isc_result_totext(result));
+	} else if (ignore &&
+		   (result == ISC_R_SUCCESS || result == DNS_R_FROMWILDCARD))
 	{
 		validator_log(val, ISC_LOG_INFO,
 			      "accepted expired %sRRSIG (keyid=%u)",
@@ -1492,7 +1569,10 @@ again:
 				 NULL);
 		break;
 	case ISC_R_SUCCESS:
-		consume_validation(val);
+		/* A cached verification doesn't cost anything */
+		if (!cached) {
+			consume_validation(val);
+		}
 		break;
 	default:
 		consume_validation(val);
@@ -1839,7 +1919,11 @@ validate_async_run(dns_validator_t *val, isc_job_cb cb) {
 static isc_result_t
 validate_helper_run(dns_validator_t *val, isc_job_cb cb) {
 	val->attributes |= VALATTR_OFFLOADED;
-	isc_helper_run(val->loop, cb, val);
+	if (val->view->verifyqueue != NULL) {
+		dns_verifyqueue_run(val->view->verifyqueue, val->tid, cb, val);
+	} else {
+		isc_helper_run(val->loop, cb, val);
+	}
 	return DNS_R_WAIT;
 }
 
@@ -1888,8 +1972,8 @@ check_signer(dns_validator_t *val, dns_rdata_t *keyrdata, uint16_t keyid,
 			continue;
 		}
 		if (dstkey == NULL) {
-			result = dns_dnssec_keyfromrdata(
-				val->name, keyrdata, val->view->mctx, &dstkey);
+			result = keyfromrdata(val, val->name, keyrdata,
+					      &dstkey);
 			if (result != ISC_R_SUCCESS) {
 				/*
 				 * This really shouldn't happen, but...
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <stdbool.h>
+
+#include <isc/helper.h>
+#include <isc/histo.h>
+#include <isc/list.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/refcount.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/stats.h>
+#include <dns/verifyqueue.h>
+
+#define VERIFYQUEUE_MAGIC    ISC_MAGIC('V', 'f', 'y', 'Q')
+#define VALID_VERIFYQUEUE(m) ISC_MAGIC_VALID(m, VERIFYQUEUE_MAGIC)
+
+typedef struct dns_vqjob dns_vqjob_t;
+typedef struct dns_vqworker dns_vqworker_t;
+
+struct dns_vqjob {
+	isc_job_cb cb;
+	void *cbarg;
+	isc_nanosecs_t queued;
+	ISC_LINK(dns_vqjob_t) link;
+};
+
+/*
+ * The helper of a loop; it serves the queue from the moment it is woken
+ * up until it finds the queue empty.
+ */
+struct dns_vqworker {
+	dns_verifyqueue_t *vq;
+	isc_loop_t *loop;
+	bool serving; /* protected by vq->lock */
+
+	/* Only updated by the helper, read by the statistics */
+	isc_histo_t *latency;
+};
+
+struct dns_verifyqueue {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+
+	isc_mutex_t lock;
+	ISC_LIST(dns_vqjob_t) jobs;
+	size_t depth;
+	uint32_t serving;
+
+	uint32_t nworkers;
+	dns_vqworker_t *workers;
+};
+
+dns_verifyqueue_t *
+dns_verifyqueue_new(isc_mem_t *mctx) {
+	uint32_t nworkers = isc_loopmgr_nloops();
+
+	REQUIRE(mctx != NULL);
+
+	dns_verifyqueue_t *vq = isc_mem_get(mctx, sizeof(*vq));
+	*vq = (dns_verifyqueue_t){
+		.magic = VERIFYQUEUE_MAGIC,
+		.references = ISC_REFCOUNT_INITIALIZER(1),
+		.jobs = ISC_LIST_INITIALIZER,
+		.nworkers = nworkers,
+	};
+
+	isc_mutex_init(&vq->lock);
+
+	vq->workers = isc_mem_cget(mctx, vq->nworkers, sizeof(vq->workers[0]));
+	for (size_t i = 0; i < vq->nworkers; i++) {
+		vq->workers[i] = (dns_vqworker_t){
+			.vq = vq,
+			.loop = isc_loop_get(i),
+		};
+		isc_histo_create(mctx, DNS_LATENCYHISTO_SIGBITS,
+				 &vq->workers[i].latency);
+	}
+
+	isc_mem_attach(mctx, &vq->mctx);
+
+	return vq;
+}
+
+static void
+verifyqueue_destroy(dns_verifyqueue_t *vq) {
+	REQUIRE(ISC_LIST_EMPTY(vq->jobs));
+	REQUIRE(vq->serving == 0);
+
+	vq->magic = 0;
+
+	for (size_t i = 0; i < vq->nworkers; i++) {
+		isc_histo_destroy(&vq->workers[i].latency);
+	}
+	isc_mem_cput(vq->mctx, vq->workers, vq->nworkers,
+		     sizeof(vq->workers[0]));
+
+	isc_mutex_destroy(&vq->lock);
+	isc_mem_putanddetach(&vq->mctx, vq, sizeof(*vq));
+}
+
+ISC_REFCOUNT_IMPL(dns_verifyqueue, verifyqueue_destroy);
+
+/*
+ * Run on the helper thread: take the jobs from the queue in batches
+ * until it is empty.  Each serving helper takes its share of the
+ * queued jobs, so a batch doesn't hold back jobs another helper could
+ * be running.
+ */
+static void
+verifyqueue_serve(void *arg) {
+	dns_vqworker_t *worker = arg;
+	dns_verifyqueue_t *vq = worker->vq;
+
+	LOCK(&vq->lock);
+	while (!ISC_LIST_EMPTY(vq->jobs)) {
+		ISC_LIST(dns_vqjob_t) batch = ISC_LIST_INITIALIZER;
+		size_t share = (vq->depth + vq->serving - 1) / vq->serving;
+		size_t n = ISC_MIN(share, DNS_VERIFYQUEUE_BATCH);
+
+		for (size_t i = 0; i < n; i++) {
+			dns_vqjob_t *job = ISC_LIST_HEAD(vq->jobs);
+			ISC_LIST_UNLINK(vq->jobs, job, link);
+			ISC_LIST_APPEND(batch, job, link);
+		}
+		vq->depth -= n;
+		UNLOCK(&vq->lock);
+
+		ISC_LIST_FOREACH (batch, job, link) {
+			isc_nanosecs_t wait = isc_time_monotonic() -
+					      job->queued;
+
+			isc_histo_inc(worker->latency, wait / NS_PER_US);
+
+			ISC_LIST_UNLINK(batch, job, link);
+			job->cb(job->cbarg);
+			isc_mem_put(vq->mctx, job, sizeof(*job));
+		}
+
+		LOCK(&vq->lock);
+	}
+	worker->serving = false;
+	vq->serving--;
+	UNLOCK(&vq->lock);
+
+	dns_verifyqueue_detach(&vq);
+}
+
+void
+dns_verifyqueue_run(dns_verifyqueue_t *vq, isc_tid_t tid, isc_job_cb cb,
+		    void *cbarg) {
+	REQUIRE(VALID_VERIFYQUEUE(vq));
+	REQUIRE(tid >= 0 && (uint32_t)tid < vq->nworkers);
+	REQUIRE(cb != NULL);
+
+	dns_vqworker_t *worker = NULL;
+	dns_vqjob_t *job = isc_mem_get(vq->mctx, sizeof(*job));
+	*job = (dns_vqjob_t){
+		.cb = cb,
+		.cbarg = cbarg,
+		.queued = isc_time_monotonic(),
+		.link = ISC_LINK_INITIALIZER,
+	};
+
+	LOCK(&vq->lock);
+	ISC_LIST_APPEND(vq->jobs, job, link);
+	vq->depth++;
+
+	/*
+	 * Wake up a helper that isn't serving the queue yet, starting
+	 * with our own; when they all are, the job waits for the next
+	 * batch.
+	 */
+	for (size_t i = 0; vq->serving < vq->nworkers && i < vq->nworkers;
+	     i++)
+	{
+		dns_vqworker_t *w = &vq->workers[(tid + i) % vq->nworkers];
+		if (!w->serving) {
+			w->serving = true;
+			vq->serving++;
+			worker = w;
+			break;
+		}
+	}
+	UNLOCK(&vq->lock);
+
+	if (worker != NULL) {
+		dns_verifyqueue_ref(vq);
+		isc_helper_run(worker->loop, verifyqueue_serve, worker);
+	}
+}
+
+size_t
+dns_verifyqueue_depth(dns_verifyqueue_t *vq) {
+	size_t depth;
+
+	REQUIRE(VALID_VERIFYQUEUE(vq));
+
+	LOCK(&vq->lock);
+	depth = vq->depth;
+	UNLOCK(&vq->lock);
+
+	return depth;
+}
+
+void
+dns_verifyqueue_latency(dns_verifyqueue_t *vq, isc_histo_t **hgp) {
+	REQUIRE(VALID_VERIFYQUEUE(vq));
+	REQUIRE(hgp != NULL);
+
+	for (size_t i = 0; i < vq->nworkers; i++) {
+		isc_histo_merge(hgp, vq->workers[i].latency);
+	}
+}
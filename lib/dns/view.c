@@ -23,13 +23,16 @@
 
 #include <isc/async.h>
 #include <isc/atomic.h>
+#include <isc/buffer.h>
 #include <isc/dir.h>
 #include <isc/file.h>
 #include <isc/hash.h>
+#include <isc/histo.h>
 #include <isc/lex.h>
 #include <isc/md.h>
 #include <isc/result.h>
 #include <isc/stats.h>
+#include <isc/stdio.h>
 #include <isc/string.h>
 #include <isc/urcu.h>
 #include <isc/util.h>
@@ -44,6 +47,7 @@
 #include <dns/dns64.h>
 #include <dns/dnssec.h>
 #include <dns/forward.h>
+#include <dns/keycache.h>
 #include <dns/keytable.h>
 #include <dns/keyvalues.h>
 #include <dns/master.h>
@@ -55,6 +59,7 @@
 #include <dns/rdataset.h>
 #include <dns/request.h>
 #include <dns/resolver.h>
+#include <dns/sigcache.h>
 #include <dns/rpz.h>
 #include <dns/rrl.h>
 #include <dns/stats.h>
@@ -62,6 +67,7 @@
 #include <dns/transport.h>
 #include <dns/tsig.h>
 #include <dns/unreachcache.h>
+#include <dns/verifyqueue.h>
 #include <dns/view.h>
 #include <dns/zone.h>
 #include <dns/zt.h>
@@ -132,6 +138,10 @@ dns_view_create(isc_mem_t *mctx, dns_dispatchmgr_t *dispatchmgr,
 	isc_refcount_init(&view->references, 1);
 	isc_refcount_init(&view->weakrefs, 1);
 
+	result = isc_file_sanitize(NULL, name, "adb", buffer, sizeof(buffer));
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	view->adb_file = isc_mem_strdup(mctx, buffer);
+
 	dns_fixedname_init(&view->redirectfixed);
 
 	ISC_LIST_INIT(view->dlz_searched);
@@ -156,6 +166,12 @@ dns_view_create(isc_mem_t *mctx, dns_dispatchmgr_t *dispatchmgr,
 
 	view->failcache = dns_badcache_new(view->mctx);
 
+	view->keycache = dns_keycache_new(view->mctx, DNS_KEYCACHE_SIZE);
+
+	view->sigcache = dns_sigcache_new(view->mctx, DNS_SIGCACHE_SIZE);
+
+	view->verifyqueue = dns_verifyqueue_new(view->mctx);
+
 	view->unreachcache = dns_unreachcache_new(
 		view->mctx, UNREACH_HOLD_TIME_INITIAL_SEC,
 		UNREACH_HOLD_TIME_MAX_SEC, UNREACH_BACKOFF_ELIGIBLE_SEC);
@@ -320,6 +336,9 @@ destroy(dns_view_t *view) {
 	if (view->answernames_exclude != NULL) {
 		dns_nametree_detach(&view->answernames_exclude);
 	}
+	if (view->ecszones != NULL) {
+		dns_nametree_detach(&view->ecszones);
+	}
 	if (view->sfd != NULL) {
 		dns_nametree_detach(&view->sfd);
 	}
@@ -369,12 +388,30 @@ destroy(dns_view_t *view) {
 	if (view->unreachcache != NULL) {
 		dns_unreachcache_destroy(&view->unreachcache);
 	}
+	if (view->keycache != NULL) {
+		dns_keycache_destroy(&view->keycache);
+	}
+	if (view->sigcache != NULL) {
+		dns_sigcache_destroy(&view->sigcache);
+	}
+	if (view->verifyqueue != NULL) {
+		dns_verifyqueue_detach(&view->verifyqueue);
+	}
 	isc_mutex_destroy(&view->new_zone_lock);
 	isc_mutex_destroy(&view->lock);
 	isc_refcount_destroy(&view->references);
 	isc_refcount_destroy(&view->weakrefs);
 	isc_mem_free(view->mctx, view->nta_file);
+	isc_mem_free(view->mctx, view->adb_file);
 	isc_mem_free(view->mctx, view->name);
+	for (size_t t = 0; t < DNS_TRANSPORT_COUNT; t++) {
+		for (size_t o = 0; o < dns_latencyoutcome_max; o++) {
+			if (view->latencystats[t][o] != NULL) {
+				isc_histomulti_destroy(
+					&view->latencystats[t][o]);
+			}
+		}
+	}
 	if (view->hooktable != NULL && view->hooktable_free != NULL) {
 		view->hooktable_free(view->mctx, &view->hooktable);
 	}
@@ -2113,6 +2150,87 @@ cleanup:
 	return result;
 }
 
+isc_result_t
+dns_view_saveadb(dns_view_t *view, isc_buffer_t *snapshot) {
+	isc_result_t result, tresult;
+	char tempname[PATH_MAX];
+	isc_region_t r;
+	FILE *fp = NULL;
+
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(ISC_BUFFER_VALID(snapshot));
+
+	/*
+	 * Write to a temporary file and rename it into place, so that
+	 * a previous snapshot is never replaced by a partial one.
+	 */
+	result = isc_file_mktemplate(view->adb_file, tempname,
+				     sizeof(tempname));
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+	result = isc_file_openunique(tempname, &fp);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	isc_buffer_usedregion(snapshot, &r);
+	result = isc_stdio_write(r.base, r.length, 1, fp, NULL);
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_flush(fp);
+	}
+	tresult = isc_stdio_close(fp);
+	if (result == ISC_R_SUCCESS) {
+		result = tresult;
+	}
+	if (result == ISC_R_SUCCESS) {
+		result = isc_file_rename(tempname, view->adb_file);
+	}
+	if (result != ISC_R_SUCCESS) {
+		(void)isc_file_remove(tempname);
+	}
+
+	return result;
+}
+
+isc_result_t
+dns_view_readadb(dns_view_t *view, isc_buffer_t **bufferp) {
+	isc_result_t result;
+	isc_buffer_t *b = NULL;
+	off_t size;
+	FILE *fp = NULL;
+
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(bufferp != NULL && *bufferp == NULL);
+
+	if (!isc_file_exists(view->adb_file)) {
+		return ISC_R_FILENOTFOUND;
+	}
+
+	result = isc_stdio_open(view->adb_file, "rb", &fp);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+	CHECK(isc_file_getsizefd(fileno(fp), &size));
+	if (size == 0 || size > UINT_MAX) {
+		CHECK(ISC_R_RANGE);
+	}
+
+	isc_buffer_allocate(view->mctx, &b, (unsigned int)size);
+	CHECK(isc_stdio_read(isc_buffer_base(b), (size_t)size, 1, fp, NULL));
+	isc_buffer_add(b, (unsigned int)size);
+
+	*bufferp = b;
+	b = NULL;
+
+cleanup:
+	if (b != NULL) {
+		isc_buffer_free(&b);
+	}
+	(void)isc_stdio_close(fp);
+	return result;
+}
+
 void
 dns_view_setviewcommit(dns_view_t *view) {
 	dns_zone_t *redirect = NULL, *managed_keys = NULL;
@@ -2373,6 +2491,33 @@ dns_view_getadb(dns_view_t *view, dns_adb_t **adbp) {
 	rcu_read_unlock();
 }
 
+void
+dns_view_createlatencystats(dns_view_t *view) {
+	REQUIRE(DNS_VIEW_VALID(view));
+
+	for (size_t t = DNS_TRANSPORT_UDP; t < DNS_TRANSPORT_COUNT; t++) {
+		for (size_t o = 0; o < dns_latencyoutcome_max; o++) {
+			REQUIRE(view->latencystats[t][o] == NULL);
+			isc_histomulti_create(view->mctx,
+					      DNS_LATENCYHISTO_SIGBITS,
+					      &view->latencystats[t][o]);
+		}
+	}
+}
+
+void
+dns_view_latency(dns_view_t *view, dns_transport_type_t transport,
+		 unsigned int outcome, uint64_t usecs) {
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(transport < DNS_TRANSPORT_COUNT);
+	REQUIRE(outcome < dns_latencyoutcome_max);
+
+	if (view->latencystats[transport][outcome] != NULL) {
+		isc_histomulti_inc(view->latencystats[transport][outcome],
+				   usecs);
+	}
+}
+
 void
 dns_view_setmaxrestarts(dns_view_t *view, uint8_t max_restarts) {
 	REQUIRE(DNS_VIEW_VALID(view));
@@ -23,6 +23,7 @@
 #include <isc/random.h>
 #include <isc/result.h>
 #include <isc/string.h>
+#include <isc/time.h>
 #include <isc/util.h>
 #include <isc/work.h>
 
@@ -137,6 +138,8 @@ struct dns_xfrin {
 	bool diff_running;
 	struct __cds_wfcq_head diff_head;
 	struct cds_wfcq_tail diff_tail;
+	atomic_uint diff_queued; /*%< Number of queued diffs */
+	bool recv_paused;	 /*%< Waiting for the queue to drain */
 
 	_Atomic xfrin_state_t state;
 	uint32_t expireopt;
@@ -149,12 +152,17 @@ struct dns_xfrin {
 	 * all store and load operations that affect XFR are done on the same
 	 * thread and only the statistics channel thread could perform a load
 	 * operation from a different thread and it's ok to not be precise in
-	 * the statistics.
+	 * the statistics.  The 'napplied' and 'apply_ns' are only stored by
+	 * the offloaded work applying the diffs, which never runs twice at
+	 * the same time.
 	 */
-	atomic_uint nmsg;	     /*%< Number of messages recvd */
-	atomic_uint nrecs;	     /*%< Number of records recvd */
-	atomic_uint_fast64_t nbytes; /*%< Number of bytes received */
-	_Atomic(isc_time_t) start;   /*%< Start time of the transfer */
+	atomic_uint nmsg;	       /*%< Number of messages recvd */
+	atomic_uint nrecs;	       /*%< Number of records recvd */
+	atomic_uint_fast64_t nbytes;   /*%< Number of bytes received */
+	atomic_uint napplied;	       /*%< Number of records applied */
+	atomic_uint_fast64_t parse_ns; /*%< Time spent parsing responses */
+	atomic_uint_fast64_t apply_ns; /*%< Time spent applying diffs */
+	_Atomic(isc_time_t) start;     /*%< Start time of the transfer */
 	atomic_uint_fast64_t rate_bytes_per_second;
 	_Atomic(dns_transport_type_t) soa_transport_type;
 	atomic_uint_fast32_t end_serial;
@@ -214,6 +222,21 @@ typedef struct xfrin_work {
 	dns_xfrin_t *xfr;
 } xfrin_work_t;
 
+typedef struct xfrin_apply_data {
+	dns_diff_t diff; /*%< Pending database changes */
+	struct cds_wfcq_node wfcq_node;
+} xfrin_apply_data_t;
+
+/*%
+ * The AXFR data is handed over to the database in batches of at least
+ * XFRIN_AXFR_BATCH records, ending at a name boundary.  The batches are
+ * loaded by the offloaded work while the next responses are received
+ * and parsed; once XFRIN_AXFR_MAXQUEUE batches are waiting, reading
+ * from the primary pauses until the work catches up.
+ */
+#define XFRIN_AXFR_BATCH    128
+#define XFRIN_AXFR_MAXQUEUE 256
+
 /**************************************************************************/
 /*
  * Forward declarations.
@@ -261,6 +284,8 @@ static void
 xfrin_send_done(isc_result_t eresult, isc_region_t *region, void *arg);
 static void
 xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg);
+static isc_result_t
+xfrin_recv_next(dns_xfrin_t *xfr);
 
 static void
 xfrin_end(dns_xfrin_t *xfr, isc_result_t result);
@@ -311,7 +336,7 @@ failure:
 }
 
 static void
-axfr_apply(void *arg);
+axfr_queue(dns_xfrin_t *xfr);
 
 static isc_result_t
 axfr_putdata(dns_xfrin_t *xfr, dns_diffop_t op, dns_name_t *name, dns_ttl_t ttl,
@@ -325,16 +350,10 @@ axfr_putdata(dns_xfrin_t *xfr, dns_diffop_t op, dns_name_t *name, dns_ttl_t ttl,
 	}
 
 	CHECK(dns_zone_checknames(xfr->zone, name, rdata));
-	if (dns_diff_size(&xfr->diff) > 128 &&
+	if (dns_diff_size(&xfr->diff) > XFRIN_AXFR_BATCH &&
 	    dns_diff_is_boundary(&xfr->diff, name))
 	{
-		xfrin_work_t work = (xfrin_work_t){
-			.magic = XFRIN_WORK_MAGIC,
-			.result = ISC_R_UNSET,
-			.xfr = xfr,
-		};
-		axfr_apply((void *)&work);
-		CHECK(work.result);
+		axfr_queue(xfr);
 	}
 
 	dns_difftuple_create(xfr->diff.mctx, op, name, ttl, rdata, &tuple);
@@ -346,7 +365,32 @@ failure:
 }
 
 /*
- * Store a set of AXFR RRs in the database.
+ * Store a batch of AXFR RRs in the database.
+ */
+static isc_result_t
+axfr_apply_one(dns_xfrin_t *xfr, xfrin_apply_data_t *data) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_nanosecs_t start = isc_time_monotonic();
+	uint64_t records;
+
+	CHECK(dns_diff_load(&data->diff, &xfr->axfr));
+	if (xfr->maxrecords != 0U) {
+		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
+		if (result == ISC_R_SUCCESS && records > xfr->maxrecords) {
+			result = DNS_R_TOOMANYRECORDS;
+			goto failure;
+		}
+	}
+	atomic_fetch_add_relaxed(&xfr->napplied, dns_diff_size(&data->diff));
+
+	result = ISC_R_SUCCESS;
+failure:
+	atomic_fetch_add_relaxed(&xfr->apply_ns, isc_time_monotonic() - start);
+	return result;
+}
+
+/*
+ * Store the queued batches of AXFR RRs in the database.
  */
 static void
 axfr_apply(void *arg) {
@@ -357,46 +401,99 @@ axfr_apply(void *arg) {
 	REQUIRE(VALID_XFRIN(xfr));
 
 	isc_result_t result = ISC_R_SUCCESS;
-	uint64_t records;
 
-	if (atomic_load(&xfr->shuttingdown)) {
-		result = ISC_R_SHUTTINGDOWN;
-		goto failure;
-	}
+	struct __cds_wfcq_head diff_head;
+	struct cds_wfcq_tail diff_tail;
 
-	CHECK(dns_diff_load(&xfr->diff, &xfr->axfr));
-	if (xfr->maxrecords != 0U) {
-		result = dns_db_getsize(xfr->db, xfr->ver, &records, NULL);
-		if (result == ISC_R_SUCCESS && records > xfr->maxrecords) {
-			result = DNS_R_TOOMANYRECORDS;
-			goto failure;
+	/* Initialize local wfcqueue */
+	__cds_wfcq_init(&diff_head, &diff_tail);
+
+	enum cds_wfcq_ret ret = __cds_wfcq_splice_blocking(
+		&diff_head, &diff_tail, &xfr->diff_head, &xfr->diff_tail);
+	INSIST(ret == CDS_WFCQ_RET_DEST_EMPTY);
+
+	struct cds_wfcq_node *node, *next;
+	__cds_wfcq_for_each_blocking_safe(&diff_head, &diff_tail, node, next) {
+		xfrin_apply_data_t *data =
+			caa_container_of(node, xfrin_apply_data_t, wfcq_node);
+
+		if (atomic_load(&xfr->shuttingdown)) {
+			result = ISC_R_SHUTTINGDOWN;
 		}
+
+		/* Apply only until first failure */
+		if (result == ISC_R_SUCCESS) {
+			result = axfr_apply_one(xfr, data);
+		}
+
+		/* We need to clear and free all data chunks */
+		dns_diff_clear(&data->diff);
+		isc_mem_put(xfr->mctx, data, sizeof(*data));
+		atomic_fetch_sub(&xfr->diff_queued, 1);
 	}
 
-failure:
-	dns_diff_clear(&xfr->diff);
 	work->result = result;
 }
 
+/*
+ * Resume reading the responses once the queued batches are loaded.
+ */
+static void
+axfr_resume(dns_xfrin_t *xfr) {
+	isc_interval_t interval;
+	isc_result_t result;
+
+	if (!xfr->recv_paused) {
+		return;
+	}
+	xfr->recv_paused = false;
+
+	/*
+	 * Restart the minimum transfer rate check, which was stopped
+	 * while paused; xfrin_recv_next() restarts the idle timer.
+	 */
+	xfr->nbytes_saved = atomic_load_relaxed(&xfr->nbytes);
+	isc_interval_set(&interval, dns_zone_getminxfrratesecondsin(xfr->zone),
+			 0);
+	isc_timer_start(xfr->min_rate_timer, isc_timertype_ticker, &interval);
+
+	result = xfrin_recv_next(xfr);
+	if (result != ISC_R_SUCCESS) {
+		xfrin_fail(xfr, result, "failed while receiving responses");
+		/* The reference held for the read */
+		dns_xfrin_unref(xfr);
+	}
+}
+
 static void
 axfr_apply_done(void *arg) {
 	xfrin_work_t *work = arg;
-	dns_xfrin_t *xfr = work->xfr;
-	isc_result_t result = work->result;
+	REQUIRE(VALID_XFRIN_WORK(work));
 
+	dns_xfrin_t *xfr = work->xfr;
 	REQUIRE(VALID_XFRIN(xfr));
-	REQUIRE(VALID_XFRIN_WORK(work));
+
+	isc_result_t result = work->result;
 
 	if (atomic_load(&xfr->shuttingdown)) {
 		result = ISC_R_SHUTTINGDOWN;
 	}
 
-	if (result == ISC_R_SUCCESS) {
+	if (result != ISC_R_SUCCESS) {
+		goto failure;
+	}
+
+	/* Reschedule */
+	if (!cds_wfcq_empty(&xfr->diff_head, &xfr->diff_tail)) {
+		isc_work_enqueue(xfr->loop, axfr_apply, axfr_apply_done, work);
+		axfr_resume(xfr);
+		return;
+	}
+
+	if (atomic_load(&xfr->state) == XFRST_AXFR_END) {
 		CHECK(dns_db_endload(xfr->db, &xfr->axfr));
 		CHECK(dns_zone_verifydb(xfr->zone, xfr->db, NULL));
 		CHECK(axfr_finalize(xfr));
-	} else {
-		(void)dns_db_endload(xfr->db, &xfr->axfr);
 	}
 
 failure:
@@ -407,26 +504,66 @@ failure:
 	if (result == ISC_R_SUCCESS) {
 		if (atomic_load(&xfr->state) == XFRST_AXFR_END) {
 			xfrin_end(xfr, result);
+		} else {
+			axfr_resume(xfr);
 		}
 	} else {
+		if (xfr->axfr.add_private != NULL) {
+			(void)dns_db_endload(xfr->db, &xfr->axfr);
+		}
 		xfrin_fail(xfr, result, "failed while processing responses");
 	}
 
 	dns_xfrin_detach(&xfr);
 }
 
+/*
+ * Queue the pending AXFR RRs to be stored in the database, and start
+ * the work storing them unless it is already running.
+ */
+static void
+axfr_queue(dns_xfrin_t *xfr) {
+	xfrin_apply_data_t *data = isc_mem_get(xfr->mctx, sizeof(*data));
+
+	*data = (xfrin_apply_data_t){ 0 };
+	cds_wfcq_node_init(&data->wfcq_node);
+
+	dns_diff_init(xfr->mctx, &data->diff);
+	dns_diff_move(&data->diff, &xfr->diff);
+
+	atomic_fetch_add(&xfr->diff_queued, 1);
+	(void)cds_wfcq_enqueue(&xfr->diff_head, &xfr->diff_tail,
+			       &data->wfcq_node);
+
+	if (!xfr->diff_running) {
+		xfrin_work_t *work = isc_mem_get(xfr->mctx, sizeof(*work));
+		*work = (xfrin_work_t){
+			.magic = XFRIN_WORK_MAGIC,
+			.result = ISC_R_UNSET,
+			.xfr = dns_xfrin_ref(xfr),
+		};
+		xfr->diff_running = true;
+		isc_work_enqueue(xfr->loop, axfr_apply, axfr_apply_done, work);
+	}
+}
+
+/*
+ * Queue the last AXFR RRs; the database is finalized when all the
+ * batches have been stored.
+ */
 static void
 axfr_commit(dns_xfrin_t *xfr) {
-	REQUIRE(!xfr->diff_running);
+	axfr_queue(xfr);
+}
 
-	xfrin_work_t *work = isc_mem_get(xfr->mctx, sizeof(*work));
-	*work = (xfrin_work_t){
-		.magic = XFRIN_WORK_MAGIC,
-		.result = ISC_R_UNSET,
-		.xfr = dns_xfrin_ref(xfr),
-	};
-	xfr->diff_running = true;
-	isc_work_enqueue(xfr->loop, axfr_apply, axfr_apply_done, work);
+/*
+ * Whether the reading of the responses should wait for the queued
+ * batches to be stored in the database.
+ */
+static bool
+axfr_backlogged(dns_xfrin_t *xfr) {
+	return xfr->diff_running &&
+	       atomic_load(&xfr->diff_queued) >= XFRIN_AXFR_MAXQUEUE;
 }
 
 static isc_result_t
@@ -445,11 +582,6 @@ axfr_finalize(dns_xfrin_t *xfr) {
  * IXFR handling
  */
 
-typedef struct ixfr_apply_data {
-	dns_diff_t diff; /*%< Pending database changes */
-	struct cds_wfcq_node wfcq_node;
-} ixfr_apply_data_t;
-
 static isc_result_t
 ixfr_init(dns_xfrin_t *xfr) {
 	isc_result_t result;
@@ -522,7 +654,7 @@ failure:
 }
 
 static isc_result_t
-ixfr_apply_one(dns_xfrin_t *xfr, ixfr_apply_data_t *data) {
+ixfr_apply_one(dns_xfrin_t *xfr, xfrin_apply_data_t *data) {
 	isc_result_t result = ISC_R_SUCCESS;
 	uint64_t records;
 
@@ -571,8 +703,8 @@ ixfr_apply(void *arg) {
 
 	struct cds_wfcq_node *node, *next;
 	__cds_wfcq_for_each_blocking_safe(&diff_head, &diff_tail, node, next) {
-		ixfr_apply_data_t *data =
-			caa_container_of(node, ixfr_apply_data_t, wfcq_node);
+		xfrin_apply_data_t *data =
+			caa_container_of(node, xfrin_apply_data_t, wfcq_node);
 
 		if (atomic_load(&xfr->shuttingdown)) {
 			result = ISC_R_SHUTTINGDOWN;
@@ -580,8 +712,18 @@ ixfr_apply(void *arg) {
 
 		/* Apply only until first failure */
 		if (result == ISC_R_SUCCESS) {
+			isc_nanosecs_t start = isc_time_monotonic();
+
 			/* This also checks for shuttingdown condition */
 			result = ixfr_apply_one(xfr, data);
+
+			atomic_fetch_add_relaxed(&xfr->apply_ns,
+						 isc_time_monotonic() - start);
+			if (result == ISC_R_SUCCESS) {
+				atomic_fetch_add_relaxed(
+					&xfr->napplied,
+					dns_diff_size(&data->diff));
+			}
 		}
 
 		/* We need to clear and free all data chunks */
@@ -643,9 +785,9 @@ failure:
 static isc_result_t
 ixfr_commit(dns_xfrin_t *xfr) {
 	isc_result_t result = ISC_R_SUCCESS;
-	ixfr_apply_data_t *data = isc_mem_get(xfr->mctx, sizeof(*data));
+	xfrin_apply_data_t *data = isc_mem_get(xfr->mctx, sizeof(*data));
 
-	*data = (ixfr_apply_data_t){ 0 };
+	*data = (xfrin_apply_data_t){ 0 };
 	cds_wfcq_node_init(&data->wfcq_node);
 
 	if (xfr->ver == NULL) {
@@ -653,8 +795,7 @@ ixfr_commit(dns_xfrin_t *xfr) {
 	}
 
 	dns_diff_init(xfr->mctx, &data->diff);
-	/* FIXME: Should we add dns_diff_move() */
-	ISC_LIST_MOVE(data->diff.tuples, xfr->diff.tuples);
+	dns_diff_move(&data->diff, &xfr->diff);
 
 	(void)cds_wfcq_enqueue(&xfr->diff_head, &xfr->diff_tail,
 			       &data->wfcq_node);
@@ -1054,9 +1195,16 @@ dns_xfrin_getendserial(dns_xfrin_t *xfr) {
 	return atomic_load_relaxed(&xfr->end_serial);
 }
 
+static uint64_t
+xfrin_stagerate(uint64_t records, uint64_t ns) {
+	return ns > 0 ? records * NS_PER_SEC / ns : 0;
+}
+
 void
 dns_xfrin_getstats(dns_xfrin_t *xfr, unsigned int *nmsgp, unsigned int *nrecsp,
-		   uint64_t *nbytesp, uint64_t *ratep) {
+		   uint64_t *nbytesp, uint64_t *ratep, unsigned int *nappliedp,
+		   uint64_t *parseratep, uint64_t *applyratep,
+		   unsigned int *queuedp) {
 	REQUIRE(VALID_XFRIN(xfr));
 	REQUIRE(nmsgp != NULL && nrecsp != NULL && nbytesp != NULL);
 
@@ -1079,6 +1227,14 @@ dns_xfrin_getstats(dns_xfrin_t *xfr, unsigned int *nmsgp, unsigned int *nrecsp,
 	SET_IF_NOT_NULL(nrecsp, atomic_load_relaxed(&xfr->nrecs));
 	SET_IF_NOT_NULL(nbytesp, atomic_load_relaxed(&xfr->nbytes));
 	SET_IF_NOT_NULL(ratep, rate);
+	SET_IF_NOT_NULL(nappliedp, atomic_load_relaxed(&xfr->napplied));
+	SET_IF_NOT_NULL(parseratep,
+			xfrin_stagerate(atomic_load_relaxed(&xfr->nrecs),
+					atomic_load_relaxed(&xfr->parse_ns)));
+	SET_IF_NOT_NULL(applyratep,
+			xfrin_stagerate(atomic_load_relaxed(&xfr->napplied),
+					atomic_load_relaxed(&xfr->apply_ns)));
+	SET_IF_NOT_NULL(queuedp, atomic_load_relaxed(&xfr->diff_queued));
 }
 
 const isc_sockaddr_t *
@@ -1214,6 +1370,12 @@ xfrin_fail(dns_xfrin_t *xfr, isc_result_t result, const char *msg) {
 
 		xfrin_cancelio(xfr);
 
+		/* No read will complete to release its reference */
+		if (xfr->recv_paused) {
+			xfr->recv_paused = false;
+			dns_xfrin_unref(xfr);
+		}
+
 		xfrin_end(xfr, result);
 	}
 
@@ -1601,8 +1763,7 @@ xfrin_send_request(dns_xfrin_t *xfr) {
 	LIBDNS_XFRIN_RECV_SEND_REQUEST(xfr, xfr->info);
 
 	/* Create the request message */
-	dns_message_create(xfr->mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &msg);
+	dns_message_create(xfr->mctx, DNS_MESSAGE_INTENTRENDER, &msg);
 	CHECK(dns_message_settsigkey(msg, xfr->tsigkey));
 
 	/* Create a name for the question section. */
@@ -1795,6 +1956,7 @@ xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg) {
 	dns_message_t *msg = NULL;
 	const dns_name_t *tsigowner = NULL;
 	isc_buffer_t buffer;
+	isc_nanosecs_t start = isc_time_monotonic();
 
 	REQUIRE(VALID_XFRIN(xfr));
 
@@ -1811,8 +1973,7 @@ xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg) {
 
 	xfrin_log(xfr, ISC_LOG_DEBUG(7), "received %u bytes", region->length);
 
-	dns_message_create(xfr->mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &msg);
+	dns_message_create(xfr->mctx, DNS_MESSAGE_INTENTPARSE, &msg);
 
 	CHECK(dns_message_settsigkey(msg, xfr->tsigkey));
 	dns_message_setquerytsig(msg, xfr->lasttsig);
@@ -1869,8 +2030,12 @@ xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg) {
 			result = DNS_R_UNEXPECTEDID;
 		}
 
+		/*
+		 * The transfer can't be restarted while the data received
+		 * so far is still being applied.
+		 */
 		if (xfr->reqtype == dns_rdatatype_axfr ||
-		    xfr->reqtype == dns_rdatatype_soa)
+		    xfr->reqtype == dns_rdatatype_soa || xfr->diff_running)
 		{
 			goto failure;
 		}
@@ -2030,6 +2195,7 @@ xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg) {
 	 */
 	atomic_fetch_add_relaxed(&xfr->nmsg, 1);
 	atomic_fetch_add_relaxed(&xfr->nbytes, buffer.used);
+	atomic_fetch_add_relaxed(&xfr->parse_ns, isc_time_monotonic() - start);
 
 	/*
 	 * Take the context back.
@@ -2057,21 +2223,29 @@ xfrin_recv_done(isc_result_t result, isc_region_t *region, void *arg) {
 		xfrin_cancelio(xfr);
 		break;
 	default:
+		dns_message_detach(&msg);
+
 		/*
-		 * Read the next message.
+		 * Let the database catch up before reading the next
+		 * message; axfr_apply_done() resumes the reading, and
+		 * keeps the reference until then.
 		 */
-		dns_message_detach(&msg);
-		result = dns_dispatch_getnext(xfr->dispentry);
-		if (result != ISC_R_SUCCESS) {
-			goto failure;
+		if (axfr_backlogged(xfr)) {
+			/*
+			 * The primary is not sending anything while we
+			 * wait, so neither the idle time nor the transfer
+			 * rate can be held against it.
+			 */
+			isc_timer_stop(xfr->max_idle_timer);
+			isc_timer_stop(xfr->min_rate_timer);
+			xfr->recv_paused = true;
+			return;
 		}
 
-		isc_interval_t interval;
-		isc_interval_set(&interval, dns_zone_getidlein(xfr->zone), 0);
-		isc_timer_start(xfr->max_idle_timer, isc_timertype_once,
-				&interval);
-
-		LIBDNS_XFRIN_READ(xfr, xfr->info, result);
+		/*
+		 * Read the next message.
+		 */
+		CHECK(xfrin_recv_next(xfr));
 		return;
 	}
 
@@ -2087,6 +2261,23 @@ failure:
 	LIBDNS_XFRIN_RECV_DONE(xfr, xfr->info, result);
 }
 
+static isc_result_t
+xfrin_recv_next(dns_xfrin_t *xfr) {
+	isc_result_t result;
+	isc_interval_t interval;
+
+	result = dns_dispatch_getnext(xfr->dispentry);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	isc_interval_set(&interval, dns_zone_getidlein(xfr->zone), 0);
+	isc_timer_start(xfr->max_idle_timer, isc_timertype_once, &interval);
+
+	LIBDNS_XFRIN_READ(xfr, xfr->info, result);
+	return result;
+}
+
 static void
 xfrin_destroy(dns_xfrin_t *xfr) {
 	uint64_t msecs, persec;
@@ -2140,8 +2331,8 @@ xfrin_destroy(dns_xfrin_t *xfr) {
 	struct cds_wfcq_node *node, *next;
 	__cds_wfcq_for_each_blocking_safe(&xfr->diff_head, &xfr->diff_tail,
 					  node, next) {
-		ixfr_apply_data_t *data =
-			caa_container_of(node, ixfr_apply_data_t, wfcq_node);
+		xfrin_apply_data_t *data =
+			caa_container_of(node, xfrin_apply_data_t, wfcq_node);
 		/* We need to clear and free all data chunks */
 		dns_diff_clear(&data->diff);
 		isc_mem_put(xfr->mctx, data, sizeof(*data));
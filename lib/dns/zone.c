@@ -44,6 +44,7 @@
 #include <isc/timer.h>
 #include <isc/tls.h>
 #include <isc/util.h>
+#include <isc/work.h>
 
 #include <dns/acl.h>
 #include <dns/adb.h>
@@ -182,6 +183,7 @@ typedef ISC_LIST(dns_forward_t) dns_forwardlist_t;
 typedef struct dns_keymgmt dns_keymgmt_t;
 typedef struct dns_signing dns_signing_t;
 typedef ISC_LIST(dns_signing_t) dns_signinglist_t;
+typedef struct signrun signrun_t;
 typedef struct dns_nsec3chain dns_nsec3chain_t;
 typedef ISC_LIST(dns_nsec3chain_t) dns_nsec3chainlist_t;
 typedef struct dns_nsfetch dns_nsfetch_t;
@@ -452,6 +454,8 @@ struct dns_zone {
 	uint32_t signatures;
 	uint32_t nodes;
 	dns_rdatatype_t privatetype;
+	uint32_t signthreads;
+	signrun_t *signrun; /*%< signatures computed for zone_sign() */
 
 	/*%
 	 * True if added by "rndc addzone"
@@ -744,6 +748,7 @@ struct dns_signing {
 	uint16_t keyid;
 	bool deleteit;
 	bool done;
+	bool pending; /*%< complete once the last batch is added */
 	ISC_LINK(dns_signing_t) link;
 };
 
@@ -978,6 +983,8 @@ forward_callback(void *arg);
 static void
 zone_saveunique(dns_zone_t *zone, const char *path, const char *templat);
 static void
+signrun_destroy(signrun_t **runp);
+static void
 zone_maintenance(dns_zone_t *zone);
 static void
 zone_notify(dns_zone_t *zone, isc_time_t *now);
@@ -1157,6 +1164,7 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx, isc_tid_t tid) {
 		.signatures = 10,
 		.nodes = 100,
 		.privatetype = (dns_rdatatype_t)0xffffU,
+		.signthreads = 1,
 		.rpz_num = DNS_RPZ_INVALID_NUM,
 		.requestixfr = true,
 		.ixfr_ratio = 100,
@@ -1254,6 +1262,10 @@ zone_free(dns_zone_t *zone) {
 		isc_mem_put(zone->mctx, signing, sizeof *signing);
 	}
 
+	if (zone->signrun != NULL) {
+		signrun_destroy(&zone->signrun);
+	}
+
 	ISC_LIST_FOREACH (zone->nsec3chain, nsec3chain, link) {
 		ISC_LIST_UNLINK(zone->nsec3chain, nsec3chain, link);
 		dns_db_detach(&nsec3chain->db);
@@ -2803,6 +2815,12 @@ zone_startload(dns_db_t *db, dns_zone_t *zone, isc_time_t loadtime) {
 	dns_rdatacallbacks_init(&load->callbacks);
 	load->callbacks.rawdata = zone_setrawdata;
 	zone_iattach(zone, &load->callbacks.zone);
+	if (zone->zmgr != NULL) {
+		/*
+		 * Large raw files are decoded by up to one thread per loop.
+		 */
+		load->callbacks.nthreads = zone->zmgr->workers;
+	}
 
 	result = dns_db_beginload(db, &load->callbacks);
 	if (result != ISC_R_SUCCESS) {
@@ -7254,6 +7272,395 @@ failure:
 	return result;
 }
 
+/*%
+ * Signing batches.
+ *
+ * When a zone has more than one signing thread, the RRSIGs that
+ * zone_sign() adds for a new key are not computed as the RRsets are
+ * visited.  Each RRset and key pair is queued in a batch instead.  Once
+ * the quantum is committed, the batch is handed to helpers from the
+ * isc_work thread pool and the zone's loop goes on with other work.  When
+ * the last helper is done, signrun_done() schedules zone_sign(), which
+ * adds the new RRSIGs to its version before it visits more nodes, so that
+ * the database still has a single writer.
+ *
+ * An RRset may change while its signature is computed; the signature is
+ * then dropped, as it is when the RRset got signed by the same key in the
+ * meantime.  zone_resigninc() and dns__zone_updatesigs() replace
+ * signatures within a single version, so they still sign on the loop.
+ */
+typedef struct signjob {
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	dns_rdataset_t rdataset;
+	dst_key_t *key;
+	isc_stdtime_t inception;
+	isc_stdtime_t expire;
+	isc_result_t result;
+	dns_rdata_t rdata;
+	unsigned char data[1024];
+} signjob_t;
+
+/*%
+ * The jobs of a batch.  While the helpers compute the signatures, the run
+ * keeps the version that the RRsets were taken from open, and holds a
+ * reference to the zone.
+ */
+struct signrun {
+	isc_mem_t *mctx;
+	dns_zone_t *zone;
+	dns_db_t *db;
+	dns_dbversion_t *version;
+	signjob_t *jobs;
+	unsigned int njobs;
+	unsigned int size;
+	unsigned int helpers; /*%< helpers still running */
+	atomic_uint_fast32_t next;
+};
+
+typedef struct signbatch {
+	isc_mem_t *mctx;
+	unsigned int nthreads;
+	signrun_t *run;
+} signbatch_t;
+
+static void
+signbatch_init(dns_zone_t *zone, signbatch_t *batch) {
+	*batch = (signbatch_t){
+		.mctx = zone->mctx,
+		.nthreads = (zone->loop != NULL) ? zone->signthreads : 1,
+	};
+}
+
+static bool
+signbatch_active(const signbatch_t *batch) {
+	return batch != NULL && batch->nthreads > 1;
+}
+
+static void
+signbatch_add(signbatch_t *batch, const dns_name_t *name,
+	      dns_rdataset_t *rdataset, dst_key_t *key,
+	      isc_stdtime_t inception, isc_stdtime_t expire) {
+	signrun_t *run = batch->run;
+	signjob_t *job = NULL;
+
+	if (run == NULL) {
+		run = isc_mem_get(batch->mctx, sizeof(*run));
+		*run = (signrun_t){ 0 };
+		isc_mem_attach(batch->mctx, &run->mctx);
+		batch->run = run;
+	}
+
+	if (run->njobs == run->size) {
+		unsigned int size = ISC_MAX(16, run->size * 2);
+		run->jobs = isc_mem_creget(run->mctx, run->jobs, run->size,
+					   size, sizeof(run->jobs[0]));
+		run->size = size;
+	}
+
+	job = &run->jobs[run->njobs++];
+	*job = (signjob_t){
+		.rdataset = DNS_RDATASET_INIT,
+		.inception = inception,
+		.expire = expire,
+		.rdata = DNS_RDATA_INIT,
+	};
+	job->name = dns_fixedname_initname(&job->fname);
+	dns_name_copy(name, job->name);
+	dns_rdataset_clone(rdataset, &job->rdataset);
+	dst_key_attach(key, &job->key);
+}
+
+/*%
+ * Return true if a signature of 'name'/'type' by 'key' is queued.  The
+ * queued signatures by other keys of the same algorithm are added to
+ * '*count'.  If 'key' is NULL, return true if any signature of
+ * 'name'/'type' is queued.
+ */
+static bool
+signbatch_find(const signbatch_t *batch, const dns_name_t *name,
+	       dns_rdatatype_t type, const dst_key_t *key, int *count) {
+	if (batch == NULL || batch->run == NULL) {
+		return false;
+	}
+
+	for (unsigned int i = 0; i < batch->run->njobs; i++) {
+		const signjob_t *job = &batch->run->jobs[i];
+
+		if (job->rdataset.type != type ||
+		    !dns_name_equal(job->name, name))
+		{
+			continue;
+		}
+		if (key == NULL) {
+			return true;
+		}
+		if (dst_key_alg(job->key) != dst_key_alg(key)) {
+			continue;
+		}
+		if (dst_key_id(job->key) == dst_key_id(key)) {
+			return true;
+		}
+		SET_IF_NOT_NULL(count, *count + 1);
+	}
+
+	return false;
+}
+
+static void
+signrun_destroy(signrun_t **runp) {
+	signrun_t *run = *runp;
+
+	*runp = NULL;
+	INSIST(run->helpers == 0);
+
+	for (unsigned int i = 0; i < run->njobs; i++) {
+		dns_rdataset_disassociate(&run->jobs[i].rdataset);
+		dst_key_free(&run->jobs[i].key);
+	}
+	if (run->version != NULL) {
+		dns_db_closeversion(run->db, &run->version, false);
+	}
+	if (run->db != NULL) {
+		dns_db_detach(&run->db);
+	}
+	if (run->jobs != NULL) {
+		isc_mem_cput(run->mctx, run->jobs, run->size,
+			     sizeof(run->jobs[0]));
+	}
+	isc_mem_putanddetach(&run->mctx, run, sizeof(*run));
+}
+
+static void
+signrun_work(void *arg) {
+	signrun_t *run = arg;
+	uint_fast32_t i;
+
+	while ((i = atomic_fetch_add_relaxed(&run->next, 1)) < run->njobs) {
+		signjob_t *job = &run->jobs[i];
+		isc_buffer_t buffer;
+
+		isc_buffer_init(&buffer, job->data, sizeof(job->data));
+		job->result = dns_dnssec_sign(job->name, &job->rdataset,
+					      job->key, &job->inception,
+					      &job->expire, run->mctx, &buffer,
+					      &job->rdata);
+	}
+}
+
+/*%
+ * Called on the zone's loop when a helper is done.  After the last one,
+ * get zone_sign() to add the signatures.
+ */
+static void
+signrun_done(void *arg) {
+	signrun_t *run = arg;
+	dns_zone_t *zone = run->zone;
+	bool free_needed = false;
+
+	INSIST(run->helpers > 0);
+	if (--run->helpers > 0) {
+		return;
+	}
+
+	LOCK_ZONE(zone);
+	if (!DNS_ZONE_FLAG(zone, DNS_ZONEFLG_EXITING)) {
+		isc_time_t now = isc_time_now();
+
+		zone->signingtime = now;
+		zone_settimer(zone, &now);
+	}
+	run->zone = NULL;
+	isc_refcount_decrement(&zone->irefs);
+	free_needed = exit_check(zone);
+	UNLOCK_ZONE(zone);
+	if (free_needed) {
+		zone_free(zone);
+	}
+}
+
+/*%
+ * Hand the queued jobs to the helpers.  Must be called on the zone's loop
+ * once the version that the RRsets were taken from has been closed.
+ */
+static void
+signbatch_dispatch(dns_zone_t *zone, signbatch_t *batch, dns_db_t *db) {
+	signrun_t *run = batch->run;
+
+	REQUIRE(zone->signrun == NULL);
+
+	batch->run = NULL;
+
+	/*
+	 * The RRsets were taken from the version that has just been
+	 * closed, so the current version keeps them alive.
+	 */
+	dns_db_attach(db, &run->db);
+	dns_db_currentversion(db, &run->version);
+
+	LOCK_ZONE(zone);
+	zone_iattach(zone, &run->zone);
+	UNLOCK_ZONE(zone);
+
+	zone->signrun = run;
+	run->helpers = ISC_MIN(batch->nthreads, run->njobs);
+	for (unsigned int i = 0; i < run->helpers; i++) {
+		isc_work_enqueue(zone->loop, signrun_work, signrun_done, run);
+	}
+}
+
+/*%
+ * Release the queued jobs without computing their signatures.
+ */
+static void
+signbatch_clear(signbatch_t *batch) {
+	if (batch->run != NULL) {
+		signrun_destroy(&batch->run);
+	}
+}
+
+static void
+zone_signstats(dns_zone_t *zone, dst_key_t *key) {
+	dns_stats_t *dnssecsignstats = dns_zone_getdnssecsignstats(zone);
+
+	if (dnssecsignstats != NULL) {
+		/* Generated a new signature. */
+		dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
+					      (uint8_t)ALG(key),
+					      dns_dnssecsignstats_sign);
+		/* This is a refresh. */
+		dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
+					      (uint8_t)ALG(key),
+					      dns_dnssecsignstats_refresh);
+	}
+}
+
+/*%
+ * Return true if the RRset of 'job' is unchanged in 'version', and has not
+ * been signed by the job's key yet.
+ */
+static bool
+signjob_current(dns_db_t *db, dns_dbversion_t *version,
+		const signjob_t *job) {
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset = DNS_RDATASET_INIT;
+	dns_rdataset_t sigset = DNS_RDATASET_INIT;
+	dns_rdatatype_t type = job->rdataset.type;
+	dns_rdata_rrsig_t rrsig;
+	bool current = false;
+	isc_result_t result;
+
+	if (type == dns_rdatatype_nsec3) {
+		result = dns_db_findnsec3node(db, job->name, false, &node);
+	} else {
+		result = dns_db_findnode(db, job->name, false, &node);
+	}
+	if (result != ISC_R_SUCCESS) {
+		return false;
+	}
+
+	result = dns_db_findrdataset(db, node, version, type, 0, 0, &rdataset,
+				     NULL);
+	if (result != ISC_R_SUCCESS || rdataset.ttl != job->rdataset.ttl ||
+	    !dns_rdataset_equals(&rdataset, &job->rdataset))
+	{
+		goto done;
+	}
+
+	current = true;
+	result = dns_db_findrdataset(db, node, version, dns_rdatatype_rrsig,
+				     type, 0, &sigset, NULL);
+	if (result != ISC_R_SUCCESS) {
+		goto done;
+	}
+	DNS_RDATASET_FOREACH (&sigset) {
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+
+		dns_rdataset_current(&sigset, &rdata);
+		result = dns_rdata_tostruct(&rdata, &rrsig, NULL);
+		INSIST(result == ISC_R_SUCCESS);
+		if (rrsig.keyid == dst_key_id(job->key) &&
+		    dst_algorithm_fromdata(rrsig.algorithm, rrsig.signature,
+					   rrsig.siglen) == dst_key_alg(job->key))
+		{
+			current = false;
+			break;
+		}
+	}
+
+done:
+	if (dns_rdataset_isassociated(&sigset)) {
+		dns_rdataset_disassociate(&sigset);
+	}
+	if (dns_rdataset_isassociated(&rdataset)) {
+		dns_rdataset_disassociate(&rdataset);
+	}
+	dns_db_detachnode(db, &node);
+	return current;
+}
+
+/*%
+ * Add the signatures computed by the helpers to 'version' and 'diff'.
+ * Must be called on the zone's loop.
+ */
+static isc_result_t
+signrun_apply(dns_zone_t *zone, dns_db_t *db, dns_dbversion_t *version,
+	      dns_diff_t *diff) {
+	signrun_t *run = zone->signrun;
+	isc_result_t result = ISC_R_SUCCESS;
+	unsigned int generated = 0;
+
+	REQUIRE(run != NULL && run->helpers == 0);
+
+	zone->signrun = NULL;
+
+	/*
+	 * If the zone was reloaded, its signings are started afresh.
+	 */
+	if (run->db != db) {
+		goto failure;
+	}
+
+	for (unsigned int i = 0; i < run->njobs; i++) {
+		signjob_t *job = &run->jobs[i];
+
+		CHECK(job->result);
+		if (!signjob_current(db, version, job)) {
+			continue;
+		}
+
+		/* XXX inefficient - will cause dataset merging */
+		CHECK(update_one_rr(db, version, diff, DNS_DIFFOP_ADDRESIGN,
+				    job->name, job->rdataset.ttl, &job->rdata));
+		zone_signstats(zone, job->key);
+		generated++;
+	}
+
+failure:
+	if (zone->stats != NULL && generated > 0) {
+		isc_stats_add(zone->stats, dns_zonestatscounter_sigsgenerated,
+			      generated);
+		isc_stats_add(zone->stats, dns_zonestatscounter_sigsoffloaded,
+			      generated);
+	}
+	signrun_destroy(&run);
+	return result;
+}
+
+/*%
+ * Get the limits of a signing quantum.  Each signing thread adds a full
+ * 'sig-signing-nodes' and 'sig-signing-signatures' worth of work, so
+ * that a quantum takes about the same time whatever the parallelism.
+ */
+static void
+zone_quantum(dns_zone_t *zone, uint32_t *nodes, int32_t *signatures) {
+	uint64_t n = (uint64_t)zone->nodes * zone->signthreads;
+	uint64_t s = (uint64_t)zone->signatures * zone->signthreads;
+
+	*nodes = (uint32_t)ISC_MIN(n, UINT32_MAX);
+	*signatures = (int32_t)ISC_MIN(s, INT32_MAX);
+}
+
 static isc_result_t
 add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name, dns_zone_t *zone,
 	 dns_rdatatype_t type, dns_diff_t *diff, dst_key_t **keys,
@@ -7261,7 +7668,6 @@ add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name, dns_zone_t *zone,
 	 isc_stdtime_t inception, isc_stdtime_t expire) {
 	isc_result_t result;
 	dns_dbnode_t *node = NULL;
-	dns_stats_t *dnssecsignstats;
 	dns_rdataset_t rdataset;
 	dns_rdata_t sig_rdata = DNS_RDATA_INIT;
 	unsigned char data[1024]; /* XXX */
@@ -7436,19 +7842,8 @@ add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name, dns_zone_t *zone,
 		isc_buffer_init(&buffer, data, sizeof(data));
 
 		/* Update DNSSEC sign statistics. */
-		dnssecsignstats = dns_zone_getdnssecsignstats(zone);
-		if (dnssecsignstats != NULL) {
-			/* Generated a new signature. */
-			dns_dnssecsignstats_increment(dnssecsignstats,
-						      ID(keys[i]),
-						      (uint8_t)ALG(keys[i]),
-						      dns_dnssecsignstats_sign);
-			/* This is a refresh. */
-			dns_dnssecsignstats_increment(
-				dnssecsignstats, ID(keys[i]),
-				(uint8_t)ALG(keys[i]),
-				dns_dnssecsignstats_refresh);
-		}
+		zone_signstats(zone, keys[i]);
+		inc_stats(zone, dns_zonestatscounter_sigsgenerated);
 	}
 
 failure:
@@ -7767,37 +8162,48 @@ failure:
 
 static bool
 signed_with_good_key(dns_zone_t *zone, dns_db_t *db, dns_dbnode_t *node,
-		     dns_dbversion_t *version, dns_rdatatype_t type,
-		     dst_key_t *key) {
+		     const dns_name_t *name, dns_dbversion_t *version,
+		     dns_rdatatype_t type, dst_key_t *key,
+		     const signbatch_t *batch) {
 	isc_result_t result;
 	dns_rdataset_t rdataset;
 	dns_rdata_rrsig_t rrsig;
 	int count = 0;
 	dns_kasp_t *kasp = zone->kasp;
 
+	/*
+	 * Signatures still queued in the batch count as present.
+	 */
+	if (signbatch_find(batch, name, type, key, &count)) {
+		return true;
+	}
+
 	dns_rdataset_init(&rdataset);
 	result = dns_db_findrdataset(db, node, version, dns_rdatatype_rrsig,
 				     type, 0, &rdataset, NULL);
 	if (result != ISC_R_SUCCESS) {
 		INSIST(!dns_rdataset_isassociated(&rdataset));
-		return false;
-	}
-	DNS_RDATASET_FOREACH (&rdataset) {
-		dns_rdata_t rdata = DNS_RDATA_INIT;
-		dns_rdataset_current(&rdataset, &rdata);
-		result = dns_rdata_tostruct(&rdata, &rrsig, NULL);
-		INSIST(result == ISC_R_SUCCESS);
-		dst_algorithm_t algorithm;
-		algorithm = dst_algorithm_fromdata(
-			rrsig.algorithm, rrsig.signature, rrsig.siglen);
-		if (algorithm == dst_key_alg(key) &&
-		    rrsig.keyid == dst_key_id(key))
-		{
-			dns_rdataset_disassociate(&rdataset);
-			return true;
+		if (count == 0) {
+			return false;
 		}
-		if (algorithm == dst_key_alg(key)) {
-			count++;
+	} else {
+		DNS_RDATASET_FOREACH (&rdataset) {
+			dns_rdata_t rdata = DNS_RDATA_INIT;
+			dns_rdataset_current(&rdataset, &rdata);
+			result = dns_rdata_tostruct(&rdata, &rrsig, NULL);
+			INSIST(result == ISC_R_SUCCESS);
+			dst_algorithm_t algorithm;
+			algorithm = dst_algorithm_fromdata(
+				rrsig.algorithm, rrsig.signature, rrsig.siglen);
+			if (algorithm == dst_key_alg(key) &&
+			    rrsig.keyid == dst_key_id(key))
+			{
+				dns_rdataset_disassociate(&rdataset);
+				return true;
+			}
+			if (algorithm == dst_key_alg(key)) {
+				count++;
+			}
 		}
 	}
 
@@ -7828,11 +8234,15 @@ signed_with_good_key(dns_zone_t *zone, dns_db_t *db, dns_dbnode_t *node,
 			approved = (zsk_count == count);
 		}
 
-		dns_rdataset_disassociate(&rdataset);
+		if (dns_rdataset_isassociated(&rdataset)) {
+			dns_rdataset_disassociate(&rdataset);
+		}
 		return approved;
 	}
 
-	dns_rdataset_disassociate(&rdataset);
+	if (dns_rdataset_isassociated(&rdataset)) {
+		dns_rdataset_disassociate(&rdataset);
+	}
 	return false;
 }
 
@@ -7903,12 +8313,12 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 	    bool build_nsec, dst_key_t *key, isc_stdtime_t now,
 	    isc_stdtime_t inception, isc_stdtime_t expire, dns_ttl_t nsecttl,
 	    bool both, bool is_ksk, bool is_zsk, bool is_bottom_of_zone,
-	    dns_diff_t *diff, int32_t *signatures, isc_mem_t *mctx) {
+	    dns_diff_t *diff, int32_t *signatures, isc_mem_t *mctx,
+	    signbatch_t *batch) {
 	isc_result_t result;
 	dns_rdatasetiter_t *iterator = NULL;
 	dns_rdataset_t rdataset = DNS_RDATASET_INIT;
 	dns_rdata_t rdata = DNS_RDATA_INIT;
-	dns_stats_t *dnssecsignstats;
 	bool offlineksk = false;
 	isc_buffer_t buffer;
 	unsigned char data[1024];
@@ -8012,8 +8422,8 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 		{
 			continue;
 		}
-		if (signed_with_good_key(zone, db, node, version, rdataset.type,
-					 key))
+		if (signed_with_good_key(zone, db, node, name, version,
+					 rdataset.type, key, batch))
 		{
 			continue;
 		}
@@ -8028,6 +8438,11 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 			}
 			CHECK(dns_skrbundle_getsig(bundle, key, rdataset.type,
 						   &rdata));
+		} else if (signbatch_active(batch)) {
+			signbatch_add(batch, name, &rdataset, key, inception,
+				      expire);
+			(*signatures)--;
+			continue;
 		} else {
 			CHECK(dns_dnssec_sign(name, &rdataset, key, &inception,
 					      &expire, mctx, &buffer, &rdata));
@@ -8040,17 +8455,8 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 		dns_rdata_reset(&rdata);
 
 		/* Update DNSSEC sign statistics. */
-		dnssecsignstats = dns_zone_getdnssecsignstats(zone);
-		if (dnssecsignstats != NULL) {
-			/* Generated a new signature. */
-			dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
-						      ALG(key),
-						      dns_dnssecsignstats_sign);
-			/* This is a refresh. */
-			dns_dnssecsignstats_increment(
-				dnssecsignstats, ID(key), ALG(key),
-				dns_dnssecsignstats_refresh);
-		}
+		zone_signstats(zone, key);
+		inc_stats(zone, dns_zonestatscounter_sigsgenerated);
 
 		(*signatures)--;
 	}
@@ -9714,6 +10120,43 @@ failure:
 	return false;
 }
 
+/*
+ * The zone has been signed with the key of 'signing': update the records
+ * that say so.
+ */
+static isc_result_t
+zone_signing_complete(dns_zone_t *zone, dns_signing_t *signing,
+		      dns_db_t *db, dns_dbversion_t *version, bool build_nsec,
+		      bool build_nsec3, unsigned int nkeys,
+		      dns_diff_t *post_diff) {
+	isc_result_t result;
+
+	if (nkeys != 0 && build_nsec) {
+		/*
+		 * We have finished regenerating the zone with a zone
+		 * signing key.  The NSEC chain is now complete and there
+		 * is a full set of signatures for the zone.  We can now
+		 * clear the OPT bit from the NSEC record.
+		 */
+		result = updatesecure(db, version, &zone->origin,
+				      zone_nsecttl(zone), false, post_diff);
+		if (result != ISC_R_SUCCESS) {
+			dnssec_log(zone, ISC_LOG_ERROR, "updatesecure -> %s",
+				   isc_result_totext(result));
+			return result;
+		}
+	}
+
+	result = updatesignwithkey(zone, signing, version, build_nsec3,
+				   zone_nsecttl(zone), post_diff);
+	if (result != ISC_R_SUCCESS) {
+		dnssec_log(zone, ISC_LOG_ERROR, "updatesignwithkey -> %s",
+			   isc_result_totext(result));
+	}
+
+	return result;
+}
+
 /*
  * Incrementally sign the zone using the keys requested.
  * Builds the NSEC chain if required.
@@ -9748,9 +10191,21 @@ zone_sign(dns_zone_t *zone) {
 	unsigned int i, j;
 	unsigned int nkeys = 0;
 	uint32_t nodes;
+	signbatch_t batch;
 
 	ENTER;
 
+	/*
+	 * The signatures queued in the last quantum are still being
+	 * computed.  signrun_done() schedules the signing again.
+	 */
+	if (zone->signrun != NULL && zone->signrun->helpers > 0) {
+		LOCK_ZONE(zone);
+		isc_time_settoepoch(&zone->signingtime);
+		UNLOCK_ZONE(zone);
+		return;
+	}
+
 	dns_rdataset_init(&rdataset);
 	name = dns_fixedname_initname(&fixed);
 	nextname = dns_fixedname_initname(&nextfixed);
@@ -9758,6 +10213,7 @@ zone_sign(dns_zone_t *zone) {
 	dns_diff_init(zone->mctx, &post_diff);
 	zonediff_init(&zonediff, &_sig_diff);
 	ISC_LIST_INIT(cleanup);
+	signbatch_init(zone, &batch);
 
 	/*
 	 * Updates are disabled.  Pause for 1 minute.
@@ -9785,6 +10241,19 @@ zone_sign(dns_zone_t *zone) {
 		goto cleanup;
 	}
 
+	/*
+	 * Add the signatures queued in the last quantum first.
+	 */
+	if (zone->signrun != NULL) {
+		result = signrun_apply(zone, db, version, zonediff.diff);
+		if (result != ISC_R_SUCCESS) {
+			dnssec_log(zone, ISC_LOG_ERROR,
+				   "zone_sign:signrun_apply -> %s",
+				   isc_result_totext(result));
+			goto cleanup;
+		}
+	}
+
 	now = isc_stdtime_now();
 
 	result = dns_zone_findkeys(zone, db, version, now, zone->mctx,
@@ -9806,8 +10275,7 @@ zone_sign(dns_zone_t *zone) {
 	 * we have no more nodes to pull off or we reach the limits
 	 * for this quantum.
 	 */
-	nodes = zone->nodes;
-	signatures = zone->signatures;
+	zone_quantum(zone, &nodes, &signatures);
 	signing = ISC_LIST_HEAD(zone->signing);
 	first = true;
 
@@ -9863,6 +10331,24 @@ zone_sign(dns_zone_t *zone) {
 			goto next_signing;
 		}
 
+		if (signing->pending) {
+			/*
+			 * Its last signatures have been added above.
+			 */
+			signing->pending = false;
+			ISC_LIST_UNLINK(zone->signing, signing, link);
+			ISC_LIST_APPEND(cleanup, signing, link);
+			result = zone_signing_complete(zone, signing, db,
+						       version, build_nsec,
+						       build_nsec3, nkeys,
+						       &post_diff);
+			if (result != ISC_R_SUCCESS) {
+				goto cleanup;
+			}
+			build_nsec = false;
+			goto next_signing;
+		}
+
 		is_bottom_of_zone = false;
 
 		if (first && signing->deleteit) {
@@ -10030,7 +10516,7 @@ zone_sign(dns_zone_t *zone) {
 				build_nsec, zone_keys[i], now, inception,
 				expire, zone_nsecttl(zone), both, is_ksk,
 				is_zsk, is_bottom_of_zone, zonediff.diff,
-				&signatures, zone->mctx));
+				&signatures, zone->mctx, &batch));
 			/*
 			 * If we are adding we are done.  Look for other keys
 			 * of the same algorithm if deleting.
@@ -10055,37 +10541,25 @@ zone_sign(dns_zone_t *zone) {
 		do {
 			result = dns_dbiterator_next(signing->dbiterator);
 			if (result == ISC_R_NOMORE) {
-				ISC_LIST_UNLINK(zone->signing, signing, link);
-				ISC_LIST_APPEND(cleanup, signing, link);
 				dns_dbiterator_pause(signing->dbiterator);
-				if (nkeys != 0 && build_nsec) {
+				if (batch.run != NULL) {
 					/*
-					 * We have finished regenerating the
-					 * zone with a zone signing key.
-					 * The NSEC chain is now complete and
-					 * there is a full set of signatures
-					 * for the zone.  We can now clear the
-					 * OPT bit from the NSEC record.
+					 * The records updated when the signing
+					 * is complete may have signatures
+					 * queued: end the quantum, and
+					 * complete it in the next one.
 					 */
-					result = updatesecure(
-						db, version, &zone->origin,
-						zone_nsecttl(zone), false,
-						&post_diff);
-					if (result != ISC_R_SUCCESS) {
-						dnssec_log(zone, ISC_LOG_ERROR,
-							   "updatesecure -> %s",
-							   isc_result_totext(
-								   result));
-						goto cleanup;
-					}
+					signing->pending = true;
+					result = ISC_R_SUCCESS;
+					nodes = 0;
+					break;
 				}
-				result = updatesignwithkey(
-					zone, signing, version, build_nsec3,
-					zone_nsecttl(zone), &post_diff);
+				ISC_LIST_UNLINK(zone->signing, signing, link);
+				ISC_LIST_APPEND(cleanup, signing, link);
+				result = zone_signing_complete(
+					zone, signing, db, version, build_nsec,
+					build_nsec3, nkeys, &post_diff);
 				if (result != ISC_R_SUCCESS) {
-					dnssec_log(zone, ISC_LOG_ERROR,
-						   "updatesignwithkey -> %s",
-						   isc_result_totext(result));
 					goto cleanup;
 				}
 				build_nsec = false;
@@ -10192,6 +10666,14 @@ pauseall:
 	 */
 	dns_db_closeversion(db, &version, commit);
 
+	/*
+	 * Now that the version is closed, the queued signatures can be
+	 * computed in the background.
+	 */
+	if (batch.run != NULL) {
+		signbatch_dispatch(zone, &batch, db);
+	}
+
 	/*
 	 * Everything succeeded so we can clean these up now.
 	 */
@@ -10234,6 +10716,21 @@ cleanup:
 		dns_dbiterator_pause(s->dbiterator);
 	}
 
+	/*
+	 * Likewise, restart the signings that were waiting for their last
+	 * signatures if these are lost.
+	 */
+	if (result != ISC_R_SUCCESS && zone->signrun == NULL) {
+		ISC_LIST_FOREACH (zone->signing, s, link) {
+			if (s->pending) {
+				s->pending = false;
+				dns_dbiterator_first(s->dbiterator);
+				dns_dbiterator_pause(s->dbiterator);
+			}
+		}
+	}
+
+	signbatch_clear(&batch);
 	dns_diff_clear(&_sig_diff);
 	dns_diff_clear(&post_diff);
 
@@ -10253,7 +10750,10 @@ cleanup:
 	}
 
 	LOCK_ZONE(zone);
-	if (ISC_LIST_HEAD(zone->signing) != NULL) {
+	if (zone->signrun != NULL && zone->signrun->helpers > 0) {
+		/* signrun_done() schedules the signing again */
+		isc_time_settoepoch(&zone->signingtime);
+	} else if (ISC_LIST_HEAD(zone->signing) != NULL) {
 		isc_interval_t interval;
 		if (zone->update_disabled || result != ISC_R_SUCCESS) {
 			isc_interval_set(&interval, 60, 0); /* 1 minute */
@@ -11885,8 +12385,8 @@ zone_journal_rollforward(dns_zone_t *zone, dns_db_t *db, bool *needdump,
 		options = 0;
 	}
 
-	result = dns_journal_open(zone->mctx, zone->journal, DNS_JOURNAL_READ,
-				  &journal);
+	result = dns_journal_open(zone->mctx, zone->journal,
+				  DNS_JOURNAL_READ | DNS_JOURNAL_MAP, &journal);
 	if (result == ISC_R_NOTFOUND) {
 		dns_zone_logc(zone, DNS_LOGCATEGORY_ZONELOAD, ISC_LOG_DEBUG(3),
 			      "no journal file, but that's OK ");
@@ -13341,8 +13841,7 @@ create_query(dns_zone_t *zone, dns_rdatatype_t rdtype, dns_name_t *name,
 	dns_name_t *qname = NULL;
 	dns_rdataset_t *qrdataset = NULL;
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &message);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTRENDER, &message);
 
 	message->opcode = dns_opcode_query;
 	message->rdclass = zone->rdclass;
@@ -13491,8 +13990,7 @@ stub_glue_response(void *arg) {
 		goto cleanup;
 	}
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &msg);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTPARSE, &msg);
 	result = dns_request_getresponse(request, msg, 0);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_log(zone, ISC_LOG_INFO,
@@ -13919,8 +14417,7 @@ stub_callback(void *arg) {
 		goto next_primary;
 	}
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &msg);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTPARSE, &msg);
 
 	result = dns_request_getresponse(request, msg, 0);
 	if (result != ISC_R_SUCCESS) {
@@ -14293,8 +14790,7 @@ refresh_callback(void *arg) {
 		goto next_primary;
 	}
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &msg);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTPARSE, &msg);
 	result = dns_request_getresponse(request, msg, 0);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_logc(zone, DNS_LOGCATEGORY_XFER_IN, ISC_LOG_INFO,
@@ -15562,8 +16058,7 @@ notify_createmessage(dns_zone_t *zone, unsigned int flags,
 	REQUIRE(DNS_ZONE_VALID(zone));
 	REQUIRE(messagep != NULL && *messagep == NULL);
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &message);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTRENDER, &message);
 
 	message->opcode = dns_opcode_notify;
 	message->flags |= DNS_MESSAGEFLAG_AA;
@@ -16490,8 +16985,8 @@ notify_done(void *arg) {
 
 	isc_buffer_init(&buf, rcode, sizeof(rcode));
 	isc_sockaddr_format(&notify->dst, addrbuf, sizeof(addrbuf));
-	dns_message_create(notify->zone->mctx, NULL, NULL,
-			   DNS_MESSAGE_INTENTPARSE, &message);
+	dns_message_create(notify->zone->mctx, DNS_MESSAGE_INTENTPARSE,
+			   &message);
 
 	result = dns_request_getresult(request);
 	if (result != ISC_R_SUCCESS) {
@@ -19021,8 +19516,7 @@ forward_callback(void *arg) {
 		goto next_primary;
 	}
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &msg);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTPARSE, &msg);
 
 	result = dns_request_getresponse(request, msg,
 					 DNS_MESSAGEPARSE_PRESERVEORDER |
@@ -20359,6 +20853,24 @@ dns_zone_getsignatures(dns_zone_t *zone) {
 	return zone->signatures;
 }
 
+void
+dns_zone_setsignthreads(dns_zone_t *zone, uint32_t threads) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	if (threads > DNS_ZONE_MAXSIGNTHREADS) {
+		threads = DNS_ZONE_MAXSIGNTHREADS;
+	} else if (threads == 0) {
+		threads = 1;
+	}
+	zone->signthreads = threads;
+}
+
+uint32_t
+dns_zone_getsignthreads(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	return zone->signthreads;
+}
+
 void
 dns_zone_setprivatetype(dns_zone_t *zone, dns_rdatatype_t type) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -20388,6 +20900,7 @@ zone_signwithkey(dns_zone_t *zone, dst_algorithm_t algorithm, uint16_t keyid,
 	signing->keyid = keyid;
 	signing->deleteit = deleteit;
 	signing->done = false;
+	signing->pending = false;
 
 	now = isc_time_now();
 
@@ -21048,8 +21561,7 @@ checkds_done(void *arg) {
 	dns_zone_log(zone, ISC_LOG_DEBUG(1), "checkds: DS query to %s: done",
 		     addrbuf);
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
-			   &message);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTPARSE, &message);
 	INSIST(message != NULL);
 
 	CHECK(dns_request_getresult(request));
@@ -21286,8 +21798,7 @@ checkds_createmessage(dns_zone_t *zone, dns_message_t **messagep) {
 	REQUIRE(DNS_ZONE_VALID(zone));
 	REQUIRE(messagep != NULL && *messagep == NULL);
 
-	dns_message_create(zone->mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &message);
+	dns_message_create(zone->mctx, DNS_MESSAGE_INTENTRENDER, &message);
 
 	message->opcode = dns_opcode_query;
 	message->rdclass = zone->rdclass;
@@ -81,6 +81,8 @@ typedef enum { METHOD_UNKNOWN = 0, METHOD_GET = 1, METHOD_POST = 2 } method_t;
 struct isc_httpdurl {
 	char *url;
 	isc_httpdaction_t *action;
+	isc_httpdstream_t *stream;
+	const char *mimetype;
 	void *action_arg;
 	bool isstatic;
 	isc_time_t loadtime;
@@ -195,6 +197,16 @@ typedef struct isc_httpd_sendreq {
 	isc_httpdfree_t *freecb;
 	void *freecb_arg;
 
+	/*%
+	 * Streamed response state.  'stream' is set while the response
+	 * is rendered piecewise by a streaming action; each piece is
+	 * rendered into 'chunkbuffer' and framed into 'sendbuffer'.
+	 */
+	const isc_httpdurl_t *stream;
+	void *stream_state;
+	isc_buffer_t *chunkbuffer;
+	bool chunked;
+	bool stream_done;
 } isc_httpd_sendreq_t;
 
 static isc_result_t
@@ -575,9 +587,19 @@ ISC_REFCOUNT_IMPL(isc_httpd, httpd_free);
 
 static void
 isc__httpd_sendreq_free(isc_httpd_sendreq_t *req) {
+	/* Let an unfinished streaming action release its state */
+	if (req->stream != NULL && !req->stream_done) {
+		(void)req->stream->stream(req->httpd, req->stream,
+					  req->stream->action_arg,
+					  &req->stream_state, NULL);
+	}
+
 	/* Clean up buffers */
 
 	isc_buffer_free(&req->sendbuffer);
+	if (req->chunkbuffer != NULL) {
+		isc_buffer_free(&req->chunkbuffer);
+	}
 
 	isc_mem_putanddetach(&req->mctx, req, sizeof(*req));
 }
@@ -754,6 +776,85 @@ httpd_compress(isc_httpd_sendreq_t *req) {
 }
 #endif /* ifdef HAVE_ZLIB */
 
+/*
+ * Call the streaming action for the next piece of the response; it is
+ * rendered into req->chunkbuffer.
+ */
+static isc_result_t
+httpd_stream_render(isc_httpd_sendreq_t *req, const isc_httpdurl_t *url) {
+	isc_result_t result;
+
+	isc_buffer_clear(req->chunkbuffer);
+	result = url->stream(req->httpd, url, url->action_arg,
+			     &req->stream_state, req->chunkbuffer);
+	if (result == ISC_R_NOMORE) {
+		req->stream_done = true;
+		result = ISC_R_SUCCESS;
+	}
+
+	return result;
+}
+
+/*
+ * Append the piece in req->chunkbuffer to req->sendbuffer, framed as a
+ * chunk if chunked transfer encoding is in use.
+ */
+static void
+httpd_putchunk(isc_httpd_sendreq_t *req) {
+	unsigned int len = isc_buffer_usedlength(req->chunkbuffer);
+	isc_result_t result = ISC_R_SUCCESS;
+
+	if (!req->chunked) {
+		isc_buffer_putmem(req->sendbuffer,
+				  isc_buffer_base(req->chunkbuffer), len);
+		return;
+	}
+
+	/* A zero-length chunk would terminate the body, so skip it */
+	if (len > 0) {
+		result = isc_buffer_printf(req->sendbuffer, "%x\r\n", len);
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+		isc_buffer_putmem(req->sendbuffer,
+				  isc_buffer_base(req->chunkbuffer), len);
+		result = isc_buffer_printf(req->sendbuffer, "\r\n");
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+	if (req->stream_done) {
+		result = isc_buffer_printf(req->sendbuffer, "0\r\n\r\n");
+		RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	}
+}
+
+/*
+ * Start a streamed response: HTTP/1.1 clients get chunked transfer
+ * encoding, for HTTP/1.0 the end of the body is marked by closing the
+ * connection.
+ */
+static isc_result_t
+httpd_stream_begin(isc_httpd_sendreq_t *req, const isc_httpdurl_t *url) {
+	isc_httpd_t *httpd = req->httpd;
+	isc_result_t result;
+
+	isc_buffer_allocate(req->mctx, &req->chunkbuffer, ISC_HTTPD_CHUNKLEN);
+
+	result = httpd_stream_render(req, url);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	req->stream = url;
+	req->chunked = (httpd->minor_version > 0);
+	if (!req->chunked) {
+		httpd->flags &= ~CONNECTION_KEEP_ALIVE;
+		httpd->flags |= CONNECTION_CLOSE;
+	}
+	req->retcode = 200;
+	req->retmsg = "OK";
+	req->mimetype = url->mimetype;
+
+	return ISC_R_SUCCESS;
+}
+
 static void
 prepare_response(void *arg) {
 	isc_httpd_sendreq_t *req = arg;
@@ -791,6 +892,8 @@ prepare_response(void *arg) {
 					 &req->retmsg, &req->mimetype,
 					 &req->bodybuffer, &req->freecb,
 					 &req->freecb_arg);
+	} else if (url->stream != NULL) {
+		result = httpd_stream_begin(req, url);
 	} else {
 		result = url->action(httpd, url, url->action_arg, &req->retcode,
 				     &req->retmsg, &req->mimetype,
@@ -806,7 +909,7 @@ prepare_response(void *arg) {
 	}
 
 #ifdef HAVE_ZLIB
-	if ((httpd->flags & ACCEPT_DEFLATE) != 0) {
+	if ((httpd->flags & ACCEPT_DEFLATE) != 0 && req->stream == NULL) {
 		result = httpd_compress(req);
 		if (result == ISC_R_SUCCESS) {
 			is_compressed = true;
@@ -839,7 +942,11 @@ prepare_response(void *arg) {
 
 	httpd_addheader(req, "Server: libisc", NULL);
 
-	if (is_compressed) {
+	if (req->stream != NULL) {
+		if (req->chunked) {
+			httpd_addheader(req, "Transfer-Encoding", "chunked");
+		}
+	} else if (is_compressed) {
 		httpd_addheader(req, "Content-Encoding", "deflate");
 		httpd_addheaderuint(req, "Content-Length",
 				    isc_buffer_usedlength(req->compbuffer));
@@ -853,8 +960,11 @@ prepare_response(void *arg) {
 	/*
 	 * Append either the compressed or the non-compressed response body to
 	 * the response headers and store the result in httpd->sendbuffer.
+	 * A streamed response starts with its first piece.
 	 */
-	if (is_compressed) {
+	if (req->stream != NULL) {
+		httpd_putchunk(req);
+	} else if (is_compressed) {
 		isc_buffer_putmem(req->sendbuffer,
 				  isc_buffer_base(req->compbuffer),
 				  isc_buffer_usedlength(req->compbuffer));
@@ -895,6 +1005,42 @@ prepare_response_done(void *arg) {
 	isc_nm_send(httpd->handle, &r, httpd_senddone, req);
 }
 
+static void
+prepare_chunk(void *arg) {
+	isc_httpd_sendreq_t *req = arg;
+	isc_result_t result;
+
+	isc_buffer_clear(req->sendbuffer);
+
+	result = httpd_stream_render(req, req->stream);
+	if (result != ISC_R_SUCCESS) {
+		/* The action has already released its state */
+		req->stream = NULL;
+		return;
+	}
+
+	httpd_putchunk(req);
+}
+
+static void
+prepare_chunk_done(void *arg) {
+	isc_httpd_sendreq_t *req = arg;
+	isc_httpd_t *httpd = req->httpd;
+
+	if (req->stream == NULL) {
+		/*
+		 * The headers are long gone, so the only way to tell the
+		 * client the response is incomplete is to drop the
+		 * connection.  Without chunked transfer encoding
+		 * (HTTP/1.0) this looks the same as the end of the body.
+		 */
+		httpd_senddone(httpd->handle, ISC_R_UNEXPECTED, req);
+		return;
+	}
+
+	prepare_response_done(req);
+}
+
 static void
 httpd_request(isc_nmhandle_t *handle, isc_result_t eresult,
 	      isc_region_t *region, void *arg) {
@@ -1047,6 +1193,18 @@ httpd_senddone(isc_nmhandle_t *handle, isc_result_t eresult, void *arg) {
 		goto detach;
 	}
 
+	/*
+	 * Render and send the next piece of a streamed response; the
+	 * handle reference is kept until the last piece has been sent.
+	 */
+	if (eresult == ISC_R_SUCCESS && req->stream != NULL &&
+	    !req->stream_done)
+	{
+		isc_work_enqueue(isc_loop(), prepare_chunk, prepare_chunk_done,
+				 req);
+		return;
+	}
+
 	if (eresult == ISC_R_SUCCESS && (httpd->flags & CONNECTION_CLOSE) != 0)
 	{
 		eresult = ISC_R_EOF;
@@ -1080,6 +1238,8 @@ isc_httpdmgr_addurl(isc_httpdmgr_t *httpdmgr, const char *url, bool isstatic,
 	item->url = isc_mem_strdup(httpdmgr->mctx, url);
 
 	item->action = func;
+	item->stream = NULL;
+	item->mimetype = NULL;
 	item->action_arg = arg;
 	item->isstatic = isstatic;
 	item->loadtime = isc_time_now();
@@ -1093,6 +1253,34 @@ isc_httpdmgr_addurl(isc_httpdmgr_t *httpdmgr, const char *url, bool isstatic,
 	return ISC_R_SUCCESS;
 }
 
+isc_result_t
+isc_httpdmgr_addstream(isc_httpdmgr_t *httpdmgr, const char *url,
+		       const char *mimetype, isc_httpdstream_t *func,
+		       void *arg) {
+	isc_httpdurl_t *item;
+
+	REQUIRE(VALID_HTTPDMGR(httpdmgr));
+	REQUIRE(url != NULL);
+	REQUIRE(mimetype != NULL);
+	REQUIRE(func != NULL);
+
+	item = isc_mem_get(httpdmgr->mctx, sizeof(isc_httpdurl_t));
+	*item = (isc_httpdurl_t){
+		.url = isc_mem_strdup(httpdmgr->mctx, url),
+		.stream = func,
+		.mimetype = mimetype,
+		.action_arg = arg,
+		.loadtime = isc_time_now(),
+		.link = ISC_LINK_INITIALIZER,
+	};
+
+	LOCK(&httpdmgr->lock);
+	ISC_LIST_APPEND(httpdmgr->urls, item, link);
+	UNLOCK(&httpdmgr->lock);
+
+	return ISC_R_SUCCESS;
+}
+
 void
 isc_httpd_setfinishhook(void (*fn)(void)) {
 #if ENABLE_AFL
@@ -1116,3 +1304,18 @@ const isc_time_t *
 isc_httpd_if_modified_since(const isc_httpd_t *httpd) {
 	return (const isc_time_t *)&httpd->if_modified_since;
 }
+
+const char *
+isc_httpd_query(const isc_httpd_t *httpd, size_t *lenp) {
+	REQUIRE(VALID_HTTPD(httpd));
+	REQUIRE(lenp != NULL);
+
+	if (httpd->path == NULL ||
+	    (httpd->up.field_set & (1 << ISC_UF_QUERY)) == 0)
+	{
+		return NULL;
+	}
+
+	*lenp = httpd->up.field_data[ISC_UF_QUERY].len;
+	return &httpd->path[httpd->up.field_data[ISC_UF_QUERY].off];
+}
@@ -19,6 +19,19 @@
 
 #include <isc/endian.h>
 
+/*
+ * 16-byte vectors are part of the baseline instruction set on x86-64
+ * (SSE2) and AArch64 (NEON), so they can be used without any runtime
+ * CPU detection. Everything else falls back to the SWAR code below.
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ISC_ASCII_VECTOR 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ISC_ASCII_VECTOR 1
+#endif
+
 /*
  * ASCII case conversion
  */
@@ -40,11 +53,90 @@ isc__ascii_tolower1(uint8_t c) {
 	return c + ('a' - 'A') * ('A' <= c && c <= 'Z');
 }
 
+#ifdef ISC_ASCII_VECTOR
+/*
+ * Vector helpers: load, lower-case and store 16 bytes, and find the
+ * first byte that differs between two vectors (16 if they are equal).
+ */
+#if defined(__SSE2__)
+typedef __m128i isc__ascii_vec_t;
+
+static inline isc__ascii_vec_t
+isc__ascii_load16(const uint8_t *ptr) {
+	return _mm_loadu_si128((const __m128i *)ptr);
+}
+
+static inline void
+isc__ascii_store16(uint8_t *ptr, isc__ascii_vec_t v) {
+	_mm_storeu_si128((__m128i *)ptr, v);
+}
+
+/*
+ * There are only signed byte comparisons in SSE2, so shift the range
+ * 'A'..'Z' down to the bottom of the signed range and compare once.
+ */
+static inline isc__ascii_vec_t
+isc__ascii_tolower16(isc__ascii_vec_t v) {
+	__m128i shifted = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A')));
+	__m128i is_upper = _mm_cmplt_epi8(shifted,
+					  _mm_set1_epi8((char)(0x80 + 26)));
+	return _mm_or_si128(v, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+}
+
+static inline unsigned int
+isc__ascii_diff16(isc__ascii_vec_t a, isc__ascii_vec_t b) {
+	unsigned int ne = ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+	return ne == 0 ? 16 : (unsigned int)__builtin_ctz(ne);
+}
+#else  /* __aarch64__ && __ARM_NEON */
+typedef uint8x16_t isc__ascii_vec_t;
+
+static inline isc__ascii_vec_t
+isc__ascii_load16(const uint8_t *ptr) {
+	return vld1q_u8(ptr);
+}
+
+static inline void
+isc__ascii_store16(uint8_t *ptr, isc__ascii_vec_t v) {
+	vst1q_u8(ptr, v);
+}
+
+static inline isc__ascii_vec_t
+isc__ascii_tolower16(isc__ascii_vec_t v) {
+	uint8x16_t is_upper = vcltq_u8(vsubq_u8(v, vdupq_n_u8('A')),
+				       vdupq_n_u8(26));
+	return vorrq_u8(v, vandq_u8(is_upper, vdupq_n_u8(0x20)));
+}
+
+/*
+ * NEON has no movemask; narrowing the comparison result gives four
+ * bits per byte in a 64-bit word instead.
+ */
+static inline unsigned int
+isc__ascii_diff16(isc__ascii_vec_t a, isc__ascii_vec_t b) {
+	uint8x16_t ne = vmvnq_u8(vceqq_u8(a, b));
+	uint64_t mask = vget_lane_u64(
+		vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(ne), 4)),
+		0);
+	return mask == 0 ? 16 : (unsigned int)__builtin_ctzll(mask) / 4;
+}
+#endif /* __SSE2__ */
+#endif /* ISC_ASCII_VECTOR */
+
 /*
  * Copy `len` bytes from `src` to `dst`, converting to lower case.
  */
 static inline void
 isc_ascii_lowercopy(uint8_t *dst, const uint8_t *src, unsigned int len) {
+#ifdef ISC_ASCII_VECTOR
+	while (len >= 16) {
+		isc__ascii_store16(dst,
+				   isc__ascii_tolower16(isc__ascii_load16(src)));
+		len -= 16;
+		dst += 16;
+		src += 16;
+	}
+#endif /* ISC_ASCII_VECTOR */
 	while (len-- > 0) {
 		*dst++ = isc__ascii_tolower1(*src++);
 	}
@@ -63,9 +155,8 @@ isc_ascii_strtolower(char *str) {
  * Convert 8 bytes to lower case, using SWAR tricks (SIMD within a register).
  * Based on "Hacker's Delight" by Henry S. Warren, "searching for a value in a
  * given range", p. 95. Eight bytes is wider than many labels in DNS names, so
- * it does not seem worth dealing with the portability issues of wide vector
- * registers. If there was a vector string load instruction (analogous to
- * memove() below) the balance might be different.
+ * it is used for the short tails; longer runs use the 16-byte vectors above
+ * where the baseline instruction set has them.
  */
 static inline uint64_t
 isc_ascii_tolower8(uint64_t octets) {
@@ -134,6 +225,29 @@ static inline bool
 isc_ascii_lowerequal(const uint8_t *restrict a, const uint8_t *restrict b,
 		     unsigned int len) {
 	uint64_t a8 = 0, b8 = 0;
+#ifdef ISC_ASCII_VECTOR
+	if (len >= 16) {
+		const uint8_t *a_tail = a + len - 16;
+		const uint8_t *b_tail = b + len - 16;
+		while (len >= 16) {
+			isc__ascii_vec_t a16 =
+				isc__ascii_tolower16(isc__ascii_load16(a));
+			isc__ascii_vec_t b16 =
+				isc__ascii_tolower16(isc__ascii_load16(b));
+			if (isc__ascii_diff16(a16, b16) != 16) {
+				return false;
+			}
+			len -= 16;
+			a += 16;
+			b += 16;
+		}
+
+		return isc__ascii_diff16(
+			       isc__ascii_tolower16(isc__ascii_load16(a_tail)),
+			       isc__ascii_tolower16(
+				       isc__ascii_load16(b_tail))) == 16;
+	}
+#endif /* ISC_ASCII_VECTOR */
 	if (len >= 8) {
 		const uint8_t *a_tail = a + len - 8;
 		const uint8_t *b_tail = b + len - 8;
@@ -170,6 +284,25 @@ isc_ascii_lowerequal(const uint8_t *restrict a, const uint8_t *restrict b,
 static inline int
 isc_ascii_lowercmp(const uint8_t *a, const uint8_t *b, unsigned int len) {
 	uint64_t a8 = 0, b8 = 0;
+#ifdef ISC_ASCII_VECTOR
+	/*
+	 * The vector comparison only finds the first differing byte; the
+	 * order is then decided by that byte alone.
+	 */
+	while (len >= 16) {
+		unsigned int i = isc__ascii_diff16(
+			isc__ascii_tolower16(isc__ascii_load16(a)),
+			isc__ascii_tolower16(isc__ascii_load16(b)));
+		if (i != 16) {
+			a8 = isc_ascii_tolower(a[i]);
+			b8 = isc_ascii_tolower(b[i]);
+			goto ret;
+		}
+		len -= 16;
+		a += 16;
+		b += 16;
+	}
+#endif /* ISC_ASCII_VECTOR */
 	while (len >= 8) {
 		a8 = isc_ascii_tolower8(htobe64(isc__ascii_load8(a)));
 		b8 = isc_ascii_tolower8(htobe64(isc__ascii_load8(b)));
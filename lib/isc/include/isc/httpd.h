@@ -32,6 +32,35 @@ typedef isc_result_t(isc_httpdaction_t)(
 	unsigned int *retcode, const char **retmsg, const char **mimetype,
 	isc_buffer_t *body, isc_httpdfree_t **freecb, void **freecb_args);
 
+/*%
+ * Soft upper bound on the amount of data a streaming action should
+ * render per call.
+ */
+#define ISC_HTTPD_CHUNKLEN (64 * 1024)
+
+typedef isc_result_t(isc_httpdstream_t)(
+	const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo, void *arg,
+	void **statep, isc_buffer_t *chunk);
+/*%<
+ * A streaming action renders its response body piecewise, so that a
+ * large response never has to be held in memory at once.  It is
+ * called with '*statep' == NULL for the first piece of the response;
+ * the request (e.g. isc_httpd_query()) may only be inspected during
+ * this first call.  Each call appends roughly #ISC_HTTPD_CHUNKLEN
+ * bytes or less to 'chunk', and the piece is sent to the client
+ * before the next call is made.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS	more of the response follows.
+ *\li	#ISC_R_NOMORE	this was the last piece of the response.
+ *\li	anything else	the response could not be rendered.
+ *
+ * The action must release '*statep' before it returns anything other
+ * than #ISC_R_SUCCESS.  If the response is abandoned early (e.g. the
+ * client went away), the action is called once more with 'chunk'
+ * == NULL so it can release its state.
+ */
+
 typedef bool(isc_httpdclientok_t)(const isc_sockaddr_t *, void *);
 
 isc_result_t
@@ -47,6 +76,20 @@ isc_result_t
 isc_httpdmgr_addurl(isc_httpdmgr_t *httpdmgr, const char *url, bool isstatic,
 		    isc_httpdaction_t *func, void *arg);
 
+isc_result_t
+isc_httpdmgr_addstream(isc_httpdmgr_t *httpdmgr, const char *url,
+		       const char *mimetype, isc_httpdstream_t *func,
+		       void *arg);
+/*%<
+ * Register a streaming action for 'url'.  The response is sent with
+ * chunked transfer encoding to HTTP/1.1 clients, and is delimited by
+ * closing the connection for HTTP/1.0 clients.
+ *
+ * If the action fails after the first piece, the connection is closed.
+ * An HTTP/1.1 client then misses the terminating chunk, but an HTTP/1.0
+ * client cannot tell the truncated response from a complete one.
+ */
+
 void
 isc_httpd_setfinishhook(void (*fn)(void));
 
@@ -58,3 +101,11 @@ isc_httpdurl_loadtime(const isc_httpdurl_t *url);
 
 const isc_time_t *
 isc_httpd_if_modified_since(const isc_httpd_t *httpd);
+
+const char *
+isc_httpd_query(const isc_httpd_t *httpd, size_t *lenp);
+/*%<
+ * Return the query part of the request URL (without the leading '?')
+ * and store its length in '*lenp', or return NULL if the URL has no
+ * query.  The returned string is not NUL-terminated.
+ */
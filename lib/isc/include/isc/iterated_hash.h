@@ -31,6 +31,29 @@ isc_iterated_hash(unsigned char *out, const unsigned int hashalg,
 		  const int saltlength, const unsigned char *in,
 		  const int inlength);
 
+/*
+ * Number of hash chains computed side by side by isc_iterated_hash_batch().
+ */
+#define ISC_ITERATED_HASH_LANES 8
+
+int
+isc_iterated_hash_batch(unsigned char *const out[], const unsigned int hashalg,
+			const int iterations, const unsigned char *salt,
+			const int saltlength, const unsigned char *const in[],
+			const int inlength[], const unsigned int count);
+/*
+ * Compute the iterated hashes of 'count' independent inputs sharing the
+ * same algorithm, salt and number of iterations, as if by calling
+ * isc_iterated_hash() for each of them: 'out[i]' is set to the hash of
+ * 'in[i]' of length 'inlength[i]'.
+ *
+ * The SHA-1 chains are computed ISC_ITERATED_HASH_LANES at a time using
+ * vector instructions (AVX2 when the CPU supports it), falling back to
+ * isc_iterated_hash() where that is not available.
+ *
+ * Returns the length of each hash, or 0 on failure.
+ */
+
 /*
  * Private
  */
@@ -378,6 +378,14 @@ isc__mempool_create(isc_mem_t *restrict mctx, const size_t element_size,
  * Defaults:
  *\li	freemax = 1
  *\li	fillcount = 1
+ *
+ * Notes:
+ *\li	The pool adapts its limits to the observed demand: when it keeps
+ *	refilling and draining its free list, freemax and fillcount grow
+ *	up to eight times their configured values; when items sit unused
+ *	on the free list, some are returned to the memory context and the
+ *	limits shrink again.  Per-pool hit, miss and refill counters are
+ *	reported by isc_mem_renderxml() and isc_mem_renderjson().
  */
 
 #define isc_mempool_destroy(mp) isc__mempool_destroy((mp)_ISC_MEM_FILELINE)
@@ -406,13 +414,15 @@ isc__mempool_destroy(isc_mempool_t **restrict mpctxp _ISC_MEM_FLARG);
 unsigned int
 isc_mempool_getfreemax(isc_mempool_t *restrict mpctx);
 /*%<
- * Returns the maximum allowed size of the free list.
+ * Returns the current maximum allowed size of the free list, which
+ * may differ from the configured one (see isc_mempool_create()).
  */
 
 void
 isc_mempool_setfreemax(isc_mempool_t *restrict mpctx, const unsigned int limit);
 /*%<
- * Sets the maximum allowed size of the free list.
+ * Sets the maximum allowed size of the free list, and the baseline
+ * the pool adapts around.
  */
 
 unsigned int
@@ -430,15 +440,15 @@ isc_mempool_getallocated(isc_mempool_t *restrict mpctx);
 unsigned int
 isc_mempool_getfillcount(isc_mempool_t *restrict mpctx);
 /*%<
- * Returns the number of items allocated as a block from the parent
- * memory context when the free list is empty.
+ * Returns the number of items currently allocated as a block from the
+ * parent memory context when the free list is empty.
  */
 
 void
 isc_mempool_setfillcount(isc_mempool_t *restrict mpctx,
 			 const unsigned int limit);
 /*%<
- * Sets the fillcount.
+ * Sets the fillcount, and the baseline the pool adapts around.
  *
  * Additional requirements:
  *\li	limit > 0
@@ -37,6 +37,12 @@
 #define ISC_NM_LISTEN_ALL 0
 #define ISC_NM_LISTEN_ONE 1
 
+/*
+ * Upper limit for the number of UDP responses sent in a single batch,
+ * see isc_nm_setudpsendbatch().
+ */
+#define ISC_NM_UDP_SENDBATCH_MAX 64
+
 /*
  * Replacement for isc_sockettype_t provided by socket.h.
  */
@@ -301,6 +307,57 @@ isc_nm_udpconnect(isc_sockaddr_t *local, isc_sockaddr_t *peer, isc_nm_cb_t cb,
  * 'cb'.
  */
 
+isc_result_t
+isc_nm_udpbind(isc_sockaddr_t *local, isc_nm_recv_cb_t cb, void *cbarg,
+	       isc_nmhandle_t **handlep);
+/*%<
+ * Open an unconnected UDP socket on the current loop, bind it to 'local'
+ * and start reading from it.  'cb' is called with 'cbarg' for every
+ * datagram received, with a handle whose peer address is the sender
+ * of the datagram.
+ *
+ * On success, '*handlep' is set to a handle that can be used to send
+ * datagrams to any peer with isc_nm_udpsendto().  The socket is closed
+ * when this handle and all the handles passed to 'cb' are detached.
+ *
+ * Returns ISC_R_SHUTTINGDOWN if the network manager is shutting down,
+ * or the error from opening or binding the socket.
+ */
+
+void
+isc_nm_udpsendto(isc_nmhandle_t *handle, const isc_sockaddr_t *peer,
+		 isc_region_t *region, isc_nm_cb_t cb, void *cbarg);
+/*%<
+ * Send the data in 'region' to 'peer' via a socket opened with
+ * isc_nm_udpbind().  Afterward, the callback 'cb' is called with the
+ * argument 'cbarg' and a new handle, which 'cb' must detach (as with
+ * isc_nm_send(), where the caller attaches the handle to send with).
+ *
+ * 'region' is not copied; it has to be allocated beforehand and freed
+ * in 'cb'.
+ */
+
+void
+isc_nm_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+	     unsigned int count, isc_nm_cb_t cb, void *cbarg);
+/*%<
+ * Send the data in the 'count' entries of 'regions' via 'handle' with a
+ * single gather write.  Afterward, the callback 'cb' is called once with
+ * the argument 'cbarg'.
+ *
+ * On a stream DNS handle every region is a separate DNS message, which
+ * is sent with its own two-byte length prefix; on a TCP handle the
+ * regions are simply sent back to back.
+ *
+ * The 'regions' array itself may be reused as soon as the function
+ * returns, but the data it describes is not copied when the transport
+ * is plain TCP; it has to be allocated beforehand and freed in 'cb'.
+ *
+ * Requires:
+ * \li	'handle' is a valid TCP or stream DNS netmgr handle.
+ * \li	'count' is greater than zero.
+ */
+
 isc_result_t
 isc_nm_routeconnect(isc_nm_cb_t cb, void *cbarg);
 /*%<
@@ -576,6 +633,24 @@ isc_nm_setnetbuffers(int32_t recv_tcp, int32_t send_tcp, int32_t recv_udp,
  * \li	'mgr' is a valid netmgr.
  */
 
+void
+isc_nm_setudpsendbatch(uint32_t maxbatch);
+uint32_t
+isc_nm_getudpsendbatch(void);
+/*%<
+ * Set and get the maximum number of UDP responses that are queued on
+ * a listening socket while a recvmmsg(2) batch is being processed.
+ * Queued responses are transmitted with a single sendmmsg(2) call (and
+ * coalesced with UDP GSO where consecutive responses go to the same
+ * peer) when the receive batch ends or when the queue is full.  A
+ * value of 0 disables the batching and each response is sent on its
+ * own.  Values larger than ISC_NM_UDP_SENDBATCH_MAX are silently
+ * reduced.
+ *
+ * Requires:
+ * \li	'mgr' is a valid netmgr.
+ */
+
 bool
 isc_nm_getloadbalancesockets(void);
 void
@@ -945,6 +1020,22 @@ isc_nmhandle_set_tcp_nodelay(isc_nmhandle_t *handle, const bool value);
  * \li 'handle' is a valid netmgr handle object.
  */
 
+isc_result_t
+isc_nmhandle_set_tcp_cork(isc_nmhandle_t *handle, const bool value);
+/*%<
+ * Enables/Disables corking of the TCP socket backing 'handle': while
+ * corked, the kernel only transmits full-sized segments, so that the
+ * tail of one write is coalesced with the head of the next one.
+ * Uncorking flushes any data still held back.
+ *
+ * Returns ISC_R_NOTIMPLEMENTED if the transport or the operating
+ * system does not support corking.
+ *
+ * Requires:
+ *
+ * \li 'handle' is a valid netmgr handle object.
+ */
+
 isc_sockaddr_t
 isc_nmsocket_getaddr(isc_nmsocket_t *sock);
 /*%<
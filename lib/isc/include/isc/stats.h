@@ -80,6 +80,15 @@ enum {
 	isc_sockstatscounter_tcp4clients,
 	isc_sockstatscounter_tcp6clients,
 
+	isc_sockstatscounter_udp4sendbatch,
+	isc_sockstatscounter_udp6sendbatch,
+
+	isc_sockstatscounter_udp4sendbatched,
+	isc_sockstatscounter_udp6sendbatched,
+
+	isc_sockstatscounter_udp4sendgso,
+	isc_sockstatscounter_udp6sendgso,
+
 	isc_sockstatscounter_max,
 };
 
@@ -105,6 +114,44 @@ isc_stats_create(isc_mem_t *mctx, isc_stats_t **statsp, int ncounters);
  *\li	'statsp' != NULL && '*statsp' == NULL.
  */
 
+void
+isc_stats_create_perloop(isc_mem_t *mctx, isc_stats_t **statsp,
+			 int ncounters);
+/*%<
+ * Like isc_stats_create(), but each loop thread counts into a private
+ * slab of counters, which are summed when the counters are read, so
+ * counters that are updated by all loops don't contend with each other.
+ *
+ * Each loop that counts into the statistics allocates a slab of
+ * 'ncounters' counters, rounded up to the cache line size, so this is
+ * meant for the few server-wide statistics that are updated for every
+ * query, not for per-zone or per-view statistics.  If the loops were not
+ * set up (isc_tid_count() == 0), this is the same as isc_stats_create().
+ *
+ * Requires:
+ *\li	'mctx' must be a valid memory context.
+ *
+ *\li	'statsp' != NULL && '*statsp' == NULL.
+ */
+
+void
+isc_stats_setshared(isc_stats_t *stats, isc_statscounter_t counter);
+/*%<
+ * Count the counter-th counter of statistics created with
+ * isc_stats_create_perloop() in the shared array rather than in the
+ * per-loop slabs.  This is needed for gauges (counters that are
+ * decremented, set or updated with isc_stats_update_if_greater()) and
+ * for counters whose value is used by isc_stats_increment() callers.
+ * This has no effect on statistics created with isc_stats_create().
+ *
+ * Requires:
+ *\li	'stats' is a valid isc_stats_t, and the counter has not been used
+ *	yet.
+ *
+ *\li	counter is less than the maximum available ID for the stats specified
+ *	on creation.
+ */
+
 void
 isc_stats_attach(isc_stats_t *stats, isc_stats_t **statsp);
 /*%<
@@ -139,6 +186,22 @@ isc_statscounter_t
 isc_stats_increment(isc_stats_t *stats, isc_statscounter_t counter);
 /*%<
  * Increment the counter-th counter of stats and return the old value.
+ * For counters that are counted in per-loop slabs, the old value is that
+ * of the calling loop's share of the counter, not of the total; use
+ * isc_stats_setshared() for counters whose value is needed.
+ *
+ * Requires:
+ *\li	'stats' is a valid isc_stats_t.
+ *
+ *\li	counter is less than the maximum available ID for the stats specified
+ *	on creation.
+ */
+
+void
+isc_stats_add(isc_stats_t *stats, isc_statscounter_t counter,
+	      isc_statscounter_t value);
+/*%<
+ * Add 'value' to the counter-th counter of stats.
  *
  * Requires:
  *\li	'stats' is a valid isc_stats_t.
@@ -154,6 +217,9 @@ isc_stats_decrement(isc_stats_t *stats, isc_statscounter_t counter);
  *
  * Requires:
  *\li	'stats' is a valid isc_stats_t.
+ *
+ *\li	the counter is not counted in per-loop slabs (see
+ *	isc_stats_setshared()).
  */
 
 void
@@ -176,6 +242,9 @@ isc_stats_set(isc_stats_t *stats, uint64_t val, isc_statscounter_t counter);
  *
  * Requires:
  *\li	'stats' is a valid isc_stats_t.
+ *
+ *\li	the counter is not counted in per-loop slabs (see
+ *	isc_stats_setshared()).
  */
 
 void
@@ -185,6 +254,9 @@ isc_stats_set(isc_stats_t *stats, uint64_t val, isc_statscounter_t counter);
  *
  * Requires:
  *\li	'stats' is a valid isc_stats_t.
+ *
+ *\li	the counter is not counted in per-loop slabs (see
+ *	isc_stats_setshared()).
  */
 
 void
@@ -198,6 +270,9 @@ isc_stats_update_if_greater(isc_stats_t *stats, isc_statscounter_t counter,
  *
  *\li	counter is less than the maximum available ID for the stats specified
  *	on creation.
+ *
+ *\li	the counter is not counted in per-loop slabs (see
+ *	isc_stats_setshared()).
  */
 
 isc_statscounter_t
@@ -12,12 +12,15 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <openssl/err.h>
 #include <openssl/opensslv.h>
 
 #include <isc/crypto.h>
+#include <isc/endian.h>
 #include <isc/iterated_hash.h>
 #include <isc/thread.h>
 #include <isc/util.h>
@@ -171,3 +174,282 @@ isc__iterated_hash_shutdown(void) {
 }
 
 #endif /* HAVE_SHA1_INIT */
+
+/*
+ * Multi-buffer SHA-1: ISC_ITERATED_HASH_LANES independent chains are kept
+ * in the lanes of vector registers, so that each SHA-1 round is computed
+ * for all of the chains at once.  After the first iteration every chain
+ * hashes a message of the same shape (previous digest, salt, padding),
+ * so the digest words are fed straight back into the message schedule
+ * without going through memory.
+ */
+
+/*
+ * Also returned by isc_iterated_hash_batch() when the vector path is not
+ * compiled in.
+ */
+#define MB_DIGESTLENGTH 20
+
+#if defined(__GNUC__)
+
+#define LANES ISC_ITERATED_HASH_LANES
+
+/*
+ * The longest first-iteration message that is hashed in the vector
+ * path: a DNS name in wire format followed by the longest salt.
+ */
+#define MB_MAXMESSAGE	 (255 + 255)
+#define MB_BLOCKS(len)	 (((len) + 8) / 64 + 1)
+#define MB_MAXBLOCKS	 MB_BLOCKS(MB_MAXMESSAGE)
+#define MB_TAILBLOCKS	 MB_BLOCKS(MB_DIGESTLENGTH + 255)
+
+typedef uint32_t u32xN_t __attribute__((vector_size(LANES * sizeof(uint32_t))));
+
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define SHA1_ROUND(f, k)                                           \
+	{                                                          \
+		u32xN_t t = ROL(a, 5) + (f) + e + (uint32_t)(k) +  \
+			    w[i & 15];                             \
+		e = d;                                             \
+		d = c;                                             \
+		c = ROL(b, 30);                                    \
+		b = a;                                             \
+		a = t;                                             \
+	}
+
+#define SHA1_SCHEDULE()                                                   \
+	if (i >= 16) {                                                    \
+		w[i & 15] = ROL(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^      \
+					w[(i + 2) & 15] ^ w[i & 15],      \
+				1);                                       \
+	}
+
+/*
+ * Add one block to the state of every lane whose bits are set in 'mask'.
+ */
+static inline __attribute__((always_inline)) void
+sha1_mb_compress(u32xN_t h[5], const u32xN_t block[16], const u32xN_t *mask) {
+	u32xN_t w[16];
+	u32xN_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+	int i = 0;
+
+	memmove(w, block, sizeof(w));
+
+	for (; i < 20; i++) {
+		SHA1_SCHEDULE();
+		SHA1_ROUND((b & c) | (~b & d), 0x5a827999);
+	}
+	for (; i < 40; i++) {
+		SHA1_SCHEDULE();
+		SHA1_ROUND(b ^ c ^ d, 0x6ed9eba1);
+	}
+	for (; i < 60; i++) {
+		SHA1_SCHEDULE();
+		SHA1_ROUND((b & c) | (b & d) | (c & d), 0x8f1bbcdc);
+	}
+	for (; i < 80; i++) {
+		SHA1_SCHEDULE();
+		SHA1_ROUND(b ^ c ^ d, 0xca62c1d6);
+	}
+
+	h[0] += a & *mask;
+	h[1] += b & *mask;
+	h[2] += c & *mask;
+	h[3] += d & *mask;
+	h[4] += e & *mask;
+}
+
+static inline __attribute__((always_inline)) void
+sha1_mb_init(u32xN_t h[5]) {
+	for (size_t l = 0; l < LANES; l++) {
+		h[0][l] = 0x67452301;
+		h[1][l] = 0xefcdab89;
+		h[2][l] = 0x98badcfe;
+		h[3][l] = 0x10325476;
+		h[4][l] = 0xc3d2e1f0;
+	}
+}
+
+/*
+ * Pad 'len' bytes of message already in 'buf' to a whole number of blocks.
+ */
+static size_t
+sha1_pad(unsigned char *buf, size_t len) {
+	size_t blocks = MB_BLOCKS(len);
+	uint64_t bits = (uint64_t)len * 8;
+
+	buf[len] = 0x80;
+	memset(buf + len + 1, 0, blocks * 64 - len - 1);
+	for (size_t i = 0; i < 8; i++) {
+		buf[blocks * 64 - 1 - i] = (unsigned char)(bits >> (i * 8));
+	}
+
+	return blocks;
+}
+
+static inline __attribute__((always_inline)) void
+iterated_hash_mb(unsigned char *const out[], const int iterations,
+		 const unsigned char *salt, const int saltlength,
+		 const unsigned char *const in[], const int inlength[],
+		 const unsigned int count) {
+	unsigned char msg[LANES][MB_MAXBLOCKS * 64];
+	size_t blocks[LANES], maxblocks = 0;
+	u32xN_t h[5], block[16], mask;
+	u32xN_t tail[MB_TAILBLOCKS][16];
+	size_t tailblocks;
+
+	/*
+	 * First iteration: H(in || salt).  The messages differ in length,
+	 * so lanes that run out of blocks early are masked off.
+	 */
+	for (size_t l = 0; l < LANES; l++) {
+		size_t len = 0;
+
+		if (l < count) {
+			memmove(msg[l], in[l], inlength[l]);
+			len = inlength[l];
+		}
+		memmove(msg[l] + len, salt, saltlength);
+		blocks[l] = sha1_pad(msg[l], len + saltlength);
+		maxblocks = ISC_MAX(maxblocks, blocks[l]);
+	}
+
+	sha1_mb_init(h);
+	for (size_t b = 0; b < maxblocks; b++) {
+		for (size_t l = 0; l < LANES; l++) {
+			const unsigned char *p = msg[l];
+
+			if (b < blocks[l]) {
+				p += b * 64;
+				mask[l] = 0xffffffff;
+			} else {
+				mask[l] = 0;
+			}
+			for (size_t t = 0; t < 16; t++) {
+				block[t][l] = ISC_U8TO32_BE(p + t * 4);
+			}
+		}
+		sha1_mb_compress(h, block, &mask);
+	}
+
+	/*
+	 * Further iterations: H(digest || salt).  Every lane has the same
+	 * salt and padding, so those words are broadcast once.
+	 */
+	memset(msg[0], 0, MB_DIGESTLENGTH);
+	memmove(msg[0] + MB_DIGESTLENGTH, salt, saltlength);
+	tailblocks = sha1_pad(msg[0], MB_DIGESTLENGTH + saltlength);
+	for (size_t b = 0; b < tailblocks; b++) {
+		for (size_t t = 0; t < 16; t++) {
+			uint32_t word = ISC_U8TO32_BE(msg[0] + b * 64 + t * 4);
+			for (size_t l = 0; l < LANES; l++) {
+				tail[b][t][l] = word;
+			}
+		}
+	}
+	for (size_t l = 0; l < LANES; l++) {
+		mask[l] = 0xffffffff;
+	}
+
+	for (int n = 0; n < iterations; n++) {
+		memmove(tail[0], h, sizeof(h));
+		sha1_mb_init(h);
+		for (size_t b = 0; b < tailblocks; b++) {
+			sha1_mb_compress(h, tail[b], &mask);
+		}
+	}
+
+	for (size_t l = 0; l < count; l++) {
+		for (size_t t = 0; t < 5; t++) {
+			ISC_U32TO8_BE(out[l] + t * 4, h[t][l]);
+		}
+	}
+}
+
+static void
+iterated_hash_mb_generic(unsigned char *const out[], const int iterations,
+			 const unsigned char *salt, const int saltlength,
+			 const unsigned char *const in[], const int inlength[],
+			 const unsigned int count) {
+	iterated_hash_mb(out, iterations, salt, saltlength, in, inlength,
+			 count);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_MB_AVX2 1
+
+__attribute__((target("avx2"))) static void
+iterated_hash_mb_avx2(unsigned char *const out[], const int iterations,
+		      const unsigned char *salt, const int saltlength,
+		      const unsigned char *const in[], const int inlength[],
+		      const unsigned int count) {
+	iterated_hash_mb(out, iterations, salt, saltlength, in, inlength,
+			 count);
+}
+#endif /* defined(__x86_64__) || defined(__i386__) */
+
+#endif /* defined(__GNUC__) */
+
+int
+isc_iterated_hash_batch(unsigned char *const out[], const unsigned int hashalg,
+			const int iterations, const unsigned char *salt,
+			const int saltlength, const unsigned char *const in[],
+			const int inlength[], const unsigned int count) {
+	unsigned int i = 0;
+
+	REQUIRE(out != NULL);
+	REQUIRE(in != NULL);
+	REQUIRE(inlength != NULL);
+
+	if (hashalg != 1) {
+		return 0;
+	}
+
+#if defined(__GNUC__)
+	if (saltlength >= 0 && saltlength <= 255 && iterations >= 0) {
+		void (*fn)(unsigned char *const *, const int,
+			   const unsigned char *, const int,
+			   const unsigned char *const *, const int *,
+			   const unsigned int) = iterated_hash_mb_generic;
+#ifdef HAVE_MB_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			fn = iterated_hash_mb_avx2;
+		}
+#endif /* HAVE_MB_AVX2 */
+
+		/*
+		 * A single leftover chain is cheaper on the scalar path.
+		 */
+		while (count - i > 1) {
+			unsigned int n = ISC_MIN(count - i, LANES);
+			bool fits = true;
+
+			for (unsigned int l = i; l < i + n; l++) {
+				if (inlength[l] < 0 ||
+				    inlength[l] + saltlength > MB_MAXMESSAGE)
+				{
+					fits = false;
+				}
+			}
+			if (!fits) {
+				break;
+			}
+
+			fn(out + i, iterations, salt, saltlength, in + i,
+			   inlength + i, n);
+			i += n;
+		}
+	}
+#endif /* defined(__GNUC__) */
+
+	for (; i < count; i++) {
+		if (isc_iterated_hash(out[i], hashalg, iterations, salt,
+				      saltlength, in[i], inlength[i]) == 0)
+		{
+			return 0;
+		}
+	}
+
+	return MB_DIGESTLENGTH;
+}
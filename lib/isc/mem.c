@@ -164,12 +164,40 @@ struct isc_mempool {
 	size_t freecount;	      /*%< # of items on reserved list */
 	size_t freemax;		      /*%< # of items allowed on free list */
 	size_t fillcount;	      /*%< # of items to fetch on each fill */
-	/*%< Stats only. */
-	size_t gets; /*%< # of requests to this pool */
+	/*%< Adaptive sizing, see mempool_adapt(). */
+	size_t basefreemax;   /*%< freemax as configured */
+	size_t basefillcount; /*%< fillcount as configured */
+	size_t epochgets;     /*%< # of requests in this epoch */
+	size_t epochmisses;   /*%< # of fills in this epoch */
+	size_t epochreleases; /*%< # of items returned to mctx in this epoch */
+	size_t epochlowfree;  /*%< shortest free list in this epoch */
+	/*%< Stats only, written by the owner and read by the renderers. */
+	atomic_size_t gets;	/*%< # of requests to this pool */
+	atomic_size_t misses;	/*%< # of requests that found no free item */
+	atomic_size_t refilled; /*%< # of items fetched from mctx */
+	atomic_size_t released; /*%< # of items returned to mctx */
+	atomic_size_t curfreemax;
+	atomic_size_t curfillcount;
 	/*%< Debugging only. */
 	char *name; /*%< printed name in stats reports */
 };
 
+/*%
+ * Every MEMPOOL_EPOCH requests, the pool looks at what happened since
+ * the last look and moves its free list limits within
+ * [base / MEMPOOL_ADAPTRANGE, base * MEMPOOL_ADAPTRANGE].
+ */
+#define MEMPOOL_EPOCH	   1024
+#define MEMPOOL_ADAPTRANGE 8
+
+/*%
+ * Update a pool statistics counter; only the owner of the pool ever
+ * writes, so there is no need for an atomic read-modify-write.
+ */
+#define MEMPOOL_STAT_ADD(m, c, n)                        \
+	atomic_store_relaxed(&(m)->c,                    \
+			     atomic_load_relaxed(&(m)->c) + (n))
+
 /*
  * Private Inline-able.
  */
@@ -696,16 +724,18 @@ isc_mem_stats(isc_mem_t *ctx, FILE *out) {
 	 */
 	if (!ISC_LIST_EMPTY(ctx->pools)) {
 		fprintf(out, "[Pool statistics]\n");
-		fprintf(out, "%15s %10s %10s %10s %10s %10s %10s %1s\n", "name",
-			"size", "allocated", "freecount", "freemax",
-			"fillcount", "gets", "L");
+		fprintf(out, "%15s %10s %10s %10s %10s %10s %10s %10s %1s\n",
+			"name", "size", "allocated", "freecount", "freemax",
+			"fillcount", "gets", "misses", "L");
 	}
 	ISC_LIST_FOREACH (ctx->pools, pool, link) {
 		fprintf(out,
-			"%15s %10zu %10zu %10zu %10zu %10zu %10zu %10zu %s\n",
+			"%15s %10zu %10zu %10zu %10zu %10zu %10zu %10zu %10zu "
+			"%s\n",
 			pool->name, pool->size, (size_t)0, pool->allocated,
 			pool->freecount, pool->freemax, pool->fillcount,
-			pool->gets, "N");
+			atomic_load_relaxed(&pool->gets),
+			atomic_load_relaxed(&pool->misses), "N");
 	}
 
 #if ISC_MEM_TRACKLINES
@@ -987,6 +1017,10 @@ isc__mempool_create(isc_mem_t *restrict mctx, const size_t element_size,
 		.size = size,
 		.freemax = 1,
 		.fillcount = 1,
+		.basefreemax = 1,
+		.basefillcount = 1,
+		.curfreemax = 1,
+		.curfillcount = 1,
 		.name = strdup(name),
 	};
 
@@ -1065,6 +1099,75 @@ isc__mempool_destroy(isc_mempool_t **restrict mpctxp FLARG) {
 	isc_mem_putanddetach(&mpctx->mctx, mpctx, sizeof(isc_mempool_t));
 }
 
+static void
+mempool_release(isc_mempool_t *restrict mpctx, void *mem) {
+	mem_putstats(mpctx->mctx, mpctx->size);
+	mem_put(mpctx->mctx, mem, mpctx->size, 0);
+	mpctx->epochreleases++;
+	MEMPOOL_STAT_ADD(mpctx, released, 1);
+}
+
+/*
+ * Called by the owner of the pool at the end of each epoch.
+ *
+ * If the pool both had to fill its free list and had to return items
+ * to the memory context in the same epoch, the working set swings wider
+ * than the free list: keep more items around.  Repeated fills make the
+ * fills larger.  If the pool never missed, the items that stayed on the
+ * free list for the whole epoch are dead weight: give half of them back
+ * and let the limits decay towards the configured values.
+ */
+static void
+mempool_adapt(isc_mempool_t *restrict mpctx) {
+	const size_t freemax_hi = mpctx->basefreemax * MEMPOOL_ADAPTRANGE;
+	const size_t freemax_lo = mpctx->basefreemax / MEMPOOL_ADAPTRANGE;
+	const size_t fillcount_hi = mpctx->basefillcount * MEMPOOL_ADAPTRANGE;
+
+	if (mpctx->epochmisses > 0 && mpctx->epochreleases > 0) {
+		mpctx->freemax = ISC_MIN(ISC_MAX(mpctx->freemax * 2, 1),
+					 freemax_hi);
+	}
+
+	if (mpctx->epochmisses > 1) {
+		mpctx->fillcount = ISC_MIN(mpctx->fillcount * 2, fillcount_hi);
+	} else if (mpctx->epochmisses == 0) {
+		mpctx->fillcount = ISC_MAX(mpctx->fillcount / 2,
+					   mpctx->basefillcount);
+	}
+
+	if (mpctx->epochmisses == 0 && mpctx->epochreleases == 0) {
+		size_t trim = mpctx->epochlowfree / 2;
+
+		for (size_t i = 0; i < trim; i++) {
+			element *item = mpctx->items;
+
+			INSIST(item != NULL && mpctx->freecount > 0);
+			mpctx->items = item->next;
+			mpctx->freecount--;
+			mempool_release(mpctx, item);
+		}
+
+		if (mpctx->freemax > mpctx->basefreemax) {
+			mpctx->freemax = ISC_MAX(mpctx->freemax - trim,
+						 mpctx->basefreemax);
+		} else if (trim > 0) {
+			mpctx->freemax = ISC_MAX(mpctx->freemax - trim,
+						 freemax_lo);
+		}
+	} else if (mpctx->freemax < mpctx->basefreemax) {
+		mpctx->freemax = ISC_MIN(mpctx->freemax * 2,
+					 mpctx->basefreemax);
+	}
+
+	atomic_store_relaxed(&mpctx->curfreemax, mpctx->freemax);
+	atomic_store_relaxed(&mpctx->curfillcount, mpctx->fillcount);
+
+	mpctx->epochgets = 0;
+	mpctx->epochmisses = 0;
+	mpctx->epochreleases = 0;
+	mpctx->epochlowfree = mpctx->freecount;
+}
+
 void *
 isc__mempool_get(isc_mempool_t *restrict mpctx FLARG) {
 	element *restrict item = NULL;
@@ -1090,6 +1193,9 @@ isc__mempool_get(isc_mempool_t *restrict mpctx FLARG) {
 			mpctx->items = item;
 			mpctx->freecount++;
 		}
+		mpctx->epochmisses++;
+		MEMPOOL_STAT_ADD(mpctx, misses, 1);
+		MEMPOOL_STAT_ADD(mpctx, refilled, fillcount);
 	}
 
 	INSIST(mpctx->items != NULL);
@@ -1099,7 +1205,14 @@ isc__mempool_get(isc_mempool_t *restrict mpctx FLARG) {
 
 	INSIST(mpctx->freecount > 0);
 	mpctx->freecount--;
-	mpctx->gets++;
+	MEMPOOL_STAT_ADD(mpctx, gets, 1);
+
+	if (mpctx->freecount < mpctx->epochlowfree) {
+		mpctx->epochlowfree = mpctx->freecount;
+	}
+	if (++mpctx->epochgets == MEMPOOL_EPOCH) {
+		mempool_adapt(mpctx);
+	}
 
 	ADD_TRACE(mpctx->mctx, item, mpctx->size, func, file, line);
 
@@ -1114,7 +1227,6 @@ isc__mempool_put(isc_mempool_t *restrict mpctx, void *mem FLARG) {
 	REQUIRE(VALID_MEMPOOL(mpctx));
 	REQUIRE(mem != NULL);
 
-	isc_mem_t *mctx = mpctx->mctx;
 	const size_t freecount = mpctx->freecount;
 #if !__SANITIZE_ADDRESS__
 	const size_t freemax = mpctx->freemax;
@@ -1125,14 +1237,13 @@ isc__mempool_put(isc_mempool_t *restrict mpctx, void *mem FLARG) {
 	INSIST(mpctx->allocated > 0);
 	mpctx->allocated--;
 
-	DELETE_TRACE(mctx, mem, mpctx->size, func, file, line);
+	DELETE_TRACE(mpctx->mctx, mem, mpctx->size, func, file, line);
 
 	/*
 	 * If our free list is full, return this to the mctx directly.
 	 */
 	if (freecount >= freemax) {
-		mem_putstats(mctx, mpctx->size);
-		mem_put(mctx, mem, mpctx->size, 0);
+		mempool_release(mpctx, mem);
 		return;
 	}
 
@@ -1154,6 +1265,8 @@ isc_mempool_setfreemax(isc_mempool_t *restrict mpctx,
 		       const unsigned int limit) {
 	REQUIRE(VALID_MEMPOOL(mpctx));
 	mpctx->freemax = limit;
+	mpctx->basefreemax = limit;
+	atomic_store_relaxed(&mpctx->curfreemax, limit);
 }
 
 unsigned int
@@ -1184,6 +1297,8 @@ isc_mempool_setfillcount(isc_mempool_t *restrict mpctx,
 	REQUIRE(limit > 0);
 
 	mpctx->fillcount = limit;
+	mpctx->basefillcount = limit;
+	atomic_store_relaxed(&mpctx->curfillcount, limit);
 }
 
 unsigned int
@@ -1248,6 +1363,45 @@ isc_mem_references(isc_mem_t *ctx) {
 		if (xmlrc < 0)      \
 			goto error; \
 	} while (0)
+static int
+xml_renderpool(isc_mempool_t *pool, xmlTextWriterPtr writer) {
+	size_t gets = atomic_load_relaxed(&pool->gets);
+	size_t misses = atomic_load_relaxed(&pool->misses);
+	struct {
+		const char *name;
+		size_t value;
+	} counters[] = {
+		{ "size", pool->size },
+		{ "gets", gets },
+		{ "hits", gets - ISC_MIN(gets, misses) },
+		{ "misses", misses },
+		{ "refilled", atomic_load_relaxed(&pool->refilled) },
+		{ "released", atomic_load_relaxed(&pool->released) },
+		{ "freemax", atomic_load_relaxed(&pool->curfreemax) },
+		{ "fillcount", atomic_load_relaxed(&pool->curfillcount) },
+	};
+	int xmlrc;
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "mempool"));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "name"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%s", pool->name));
+	TRY0(xmlTextWriterEndElement(writer)); /* name */
+
+	for (size_t i = 0; i < ARRAY_SIZE(counters); i++) {
+		TRY0(xmlTextWriterStartElement(writer,
+					       ISC_XMLCHAR counters[i].name));
+		TRY0(xmlTextWriterWriteFormatString(
+			writer, "%" PRIu64 "", (uint64_t)counters[i].value));
+		TRY0(xmlTextWriterEndElement(writer));
+	}
+
+	TRY0(xmlTextWriterEndElement(writer)); /* mempool */
+
+error:
+	return xmlrc;
+}
+
 static int
 xml_renderctx(isc_mem_t *ctx, size_t *inuse, xmlTextWriterPtr writer) {
 	REQUIRE(VALID_CONTEXT(ctx));
@@ -1301,6 +1455,14 @@ xml_renderctx(isc_mem_t *ctx, size_t *inuse, xmlTextWriterPtr writer) {
 		(uint64_t)atomic_load_relaxed(&ctx->lo_water)));
 	TRY0(xmlTextWriterEndElement(writer)); /* lowater */
 
+	if (!ISC_LIST_EMPTY(ctx->pools)) {
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "mempools"));
+		ISC_LIST_FOREACH (ctx->pools, pool, link) {
+			TRY0(xml_renderpool(pool, writer));
+		}
+		TRY0(xmlTextWriterEndElement(writer)); /* mempools */
+	}
+
 	TRY0(xmlTextWriterEndElement(writer)); /* context */
 
 error:
@@ -1351,6 +1513,41 @@ error:
 #ifdef HAVE_JSON_C
 #define CHECKMEM(m) RUNTIME_CHECK(m != NULL)
 
+static void
+json_renderpool(isc_mempool_t *pool, json_object *array) {
+	size_t gets = atomic_load_relaxed(&pool->gets);
+	size_t misses = atomic_load_relaxed(&pool->misses);
+	struct {
+		const char *name;
+		size_t value;
+	} counters[] = {
+		{ "size", pool->size },
+		{ "gets", gets },
+		{ "hits", gets - ISC_MIN(gets, misses) },
+		{ "misses", misses },
+		{ "refilled", atomic_load_relaxed(&pool->refilled) },
+		{ "released", atomic_load_relaxed(&pool->released) },
+		{ "freemax", atomic_load_relaxed(&pool->curfreemax) },
+		{ "fillcount", atomic_load_relaxed(&pool->curfillcount) },
+	};
+	json_object *poolobj, *obj;
+
+	poolobj = json_object_new_object();
+	CHECKMEM(poolobj);
+
+	obj = json_object_new_string(pool->name);
+	CHECKMEM(obj);
+	json_object_object_add(poolobj, "name", obj);
+
+	for (size_t i = 0; i < ARRAY_SIZE(counters); i++) {
+		obj = json_object_new_int64(counters[i].value);
+		CHECKMEM(obj);
+		json_object_object_add(poolobj, counters[i].name, obj);
+	}
+
+	json_object_array_add(array, poolobj);
+}
+
 static isc_result_t
 json_renderctx(isc_mem_t *ctx, size_t *inuse, json_object *array) {
 	REQUIRE(VALID_CONTEXT(ctx));
@@ -1401,6 +1598,17 @@ json_renderctx(isc_mem_t *ctx, size_t *inuse, json_object *array) {
 	CHECKMEM(obj);
 	json_object_object_add(ctxobj, "lowater", obj);
 
+	if (!ISC_LIST_EMPTY(ctx->pools)) {
+		json_object *poolarray = json_object_new_array();
+		CHECKMEM(poolarray);
+
+		ISC_LIST_FOREACH (ctx->pools, pool, link) {
+			json_renderpool(pool, poolarray);
+		}
+
+		json_object_object_add(ctxobj, "mempools", poolarray);
+	}
+
 	MCTXUNLOCK(ctx);
 	json_object_array_add(array, ctxobj);
 	return ISC_R_SUCCESS;
@@ -299,6 +299,9 @@ struct isc__nm_uvreq {
 	char tcplen[2];	       /* The TCP DNS message length */
 	uv_buf_t uvbuf;	       /* translated isc_region_t, to be
 				* sent or received */
+	uv_buf_t *uvbufs;      /* gather list for vectored sends */
+	unsigned int nuvbufs;  /* number of entries in 'uvbufs' */
+	uint16_t *tcplens;     /* DNS message lengths for 'uvbufs' */
 	isc_sockaddr_t local;  /* local address */
 	isc_sockaddr_t peer;   /* peer address */
 	isc__nm_cb_t cb;       /* callback */
@@ -330,6 +333,12 @@ typedef struct isc__netmgr {
 
 	atomic_uint_fast32_t maxudp;
 
+	/*
+	 * Maximum number of UDP responses queued for a single sendmmsg(2)
+	 * call; 0 means the batching is disabled.
+	 */
+	atomic_uint_fast32_t udp_sendbatch;
+
 	bool load_balance_sockets;
 
 	/*
@@ -404,7 +413,10 @@ typedef enum {
 	STATID_RECVFAIL = 9,
 	STATID_ACTIVE = 10,
 	STATID_CLIENTS = 11,
-	STATID_MAX = 12,
+	STATID_SENDBATCH = 12,
+	STATID_SENDBATCHED = 13,
+	STATID_SENDGSO = 14,
+	STATID_MAX = 15,
 } isc__nm_statid_t;
 
 typedef struct isc_nmsocket_tls_send_req {
@@ -681,6 +693,17 @@ struct isc_nmsocket {
 	 */
 	bool keepalive;
 
+	/*%
+	 * UDP responses queued while a recvmmsg(2) batch is being
+	 * processed; they are flushed with sendmmsg(2) at the end of the
+	 * batch.  'udp_nogso' is set when the kernel rejected a UDP GSO
+	 * send on this socket and coalescing must not be tried again.
+	 */
+	ISC_LIST(isc__nm_uvreq_t) udp_sendq;
+	size_t udp_sendq_len;
+	bool udp_batching;
+	bool udp_nogso;
+
 	/*%
 	 * 'spare' handles for that can be reused to avoid allocations, for UDP.
 	 */
@@ -954,6 +977,22 @@ isc__nm_tcp_senddns(isc_nmhandle_t *handle, const isc_region_t *region,
  * ahead of data (two bytes (16 bit) in big-endian format).
  */
 
+void
+isc__nm_tcp_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+		  unsigned int count, isc_nm_cb_t cb, void *cbarg);
+/*%<
+ * Back-end implementation of isc_nm_sendv() for TCP handles.
+ */
+
+void
+isc__nm_tcp_senddnsv(isc_nmhandle_t *handle, const isc_region_t *regions,
+		     unsigned int count, isc_nm_cb_t cb, void *cbarg);
+/*%<
+ * The same as 'isc__nm_tcp_sendv()', but every region is a DNS message
+ * that is sent with its length ahead of it (two bytes (16 bit) in
+ * big-endian format).
+ */
+
 void
 isc__nm_tls_send(isc_nmhandle_t *handle, const isc_region_t *region,
 		 isc_nm_cb_t cb, void *cbarg);
@@ -1143,6 +1182,10 @@ void
 isc__nm_streamdns_send(isc_nmhandle_t *handle, const isc_region_t *region,
 		       isc_nm_cb_t cb, void *cbarg);
 
+void
+isc__nm_streamdns_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+			unsigned int count, isc_nm_cb_t cb, void *cbarg);
+
 void
 isc__nm_streamdns_close(isc_nmsocket_t *sock);
 
@@ -1374,6 +1417,14 @@ isc__nm_socket_tcp_nodelay(const uv_os_sock_t fd, bool value);
  * 'value' equals 'true' or vice versa).
  */
 
+isc_result_t
+isc__nm_socket_tcp_cork(uv_os_sock_t fd, bool value);
+/*%<
+ * Enables/Disables coalescing of partial segments on a TCP socket (sets
+ * TCP_CORK, or TCP_NOPUSH where that is the equivalent, if 'value' equals
+ * 'true' or vice versa).  Clearing the option flushes any pending data.
+ */
+
 isc_result_t
 isc__nm_socket_tcp_maxseg(uv_os_sock_t fd, int size);
 /*%<
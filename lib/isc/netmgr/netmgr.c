@@ -66,6 +66,9 @@ static const isc_statscounter_t udp4statsindex[] = {
 	isc_sockstatscounter_udp4recvfail,
 	isc_sockstatscounter_udp4active,
 	-1,
+	isc_sockstatscounter_udp4sendbatch,
+	isc_sockstatscounter_udp4sendbatched,
+	isc_sockstatscounter_udp4sendgso,
 };
 
 static const isc_statscounter_t udp6statsindex[] = {
@@ -81,6 +84,9 @@ static const isc_statscounter_t udp6statsindex[] = {
 	isc_sockstatscounter_udp6recvfail,
 	isc_sockstatscounter_udp6active,
 	-1,
+	isc_sockstatscounter_udp6sendbatch,
+	isc_sockstatscounter_udp6sendbatched,
+	isc_sockstatscounter_udp6sendgso,
 };
 
 static const isc_statscounter_t tcp4statsindex[] = {
@@ -90,6 +96,9 @@ static const isc_statscounter_t tcp4statsindex[] = {
 	isc_sockstatscounter_tcp4acceptfail,  isc_sockstatscounter_tcp4accept,
 	isc_sockstatscounter_tcp4sendfail,    isc_sockstatscounter_tcp4recvfail,
 	isc_sockstatscounter_tcp4active,      isc_sockstatscounter_tcp4clients,
+	-1,
+	-1,
+	-1,
 };
 
 static const isc_statscounter_t tcp6statsindex[] = {
@@ -99,6 +108,9 @@ static const isc_statscounter_t tcp6statsindex[] = {
 	isc_sockstatscounter_tcp6acceptfail,  isc_sockstatscounter_tcp6accept,
 	isc_sockstatscounter_tcp6sendfail,    isc_sockstatscounter_tcp6recvfail,
 	isc_sockstatscounter_tcp6active,      isc_sockstatscounter_tcp6clients,
+	-1,
+	-1,
+	-1,
 };
 
 static void
@@ -180,6 +192,7 @@ isc_netmgr_create(isc_mem_t *mctx) {
 	isc_mem_attach(mctx, &netmgr->mctx);
 	isc_refcount_init(&netmgr->references, 1);
 	atomic_init(&netmgr->maxudp, 0);
+	atomic_init(&netmgr->udp_sendbatch, 0);
 	atomic_init(&netmgr->shuttingdown, false);
 	atomic_init(&netmgr->recv_tcp_buffer_size, 0);
 	atomic_init(&netmgr->send_tcp_buffer_size, 0);
@@ -353,6 +366,24 @@ isc_nm_setnetbuffers(int32_t recv_tcp, int32_t send_tcp, int32_t recv_udp,
 	atomic_store_relaxed(&isc__netmgr->send_udp_buffer_size, send_udp);
 }
 
+void
+isc_nm_setudpsendbatch(uint32_t maxbatch) {
+	REQUIRE(VALID_NM(isc__netmgr));
+
+	if (maxbatch > ISC_NM_UDP_SENDBATCH_MAX) {
+		maxbatch = ISC_NM_UDP_SENDBATCH_MAX;
+	}
+
+	atomic_store_relaxed(&isc__netmgr->udp_sendbatch, maxbatch);
+}
+
+uint32_t
+isc_nm_getudpsendbatch(void) {
+	REQUIRE(VALID_NM(isc__netmgr));
+
+	return atomic_load_relaxed(&isc__netmgr->udp_sendbatch);
+}
+
 bool
 isc_nm_getloadbalancesockets(void) {
 	REQUIRE(VALID_NM(isc__netmgr));
@@ -703,6 +734,7 @@ isc___nmsocket_init(isc_nmsocket_t *sock, isc__networker_t *worker,
 		.active_handles = ISC_LIST_INITIALIZER,
 		.active_handles_max = ISC_NETMGR_MAX_STREAM_CLIENTS_PER_CONN,
 		.active_link = ISC_LINK_INITIALIZER,
+		.udp_sendq = ISC_LIST_INITIALIZER,
 		.active = true,
 	};
 
@@ -1634,6 +1666,15 @@ isc___nm_uvreq_put(isc__nm_uvreq_t **reqp FLARG) {
 #endif
 	}
 
+	if (req->uvbufs != NULL) {
+		isc_mem_cput(sock->worker->mctx, req->uvbufs, req->nuvbufs,
+			     sizeof(req->uvbufs[0]));
+	}
+	if (req->tcplens != NULL) {
+		isc_mem_cput(sock->worker->mctx, req->tcplens,
+			     req->nuvbufs / 2, sizeof(req->tcplens[0]));
+	}
+
 	isc_mempool_put(sock->worker->uvreq_pool, req);
 
 	isc___nmsocket_detach(&sock FLARG_PASS);
@@ -1674,6 +1715,24 @@ isc_nm_send(isc_nmhandle_t *handle, isc_region_t *region, isc_nm_cb_t cb,
 	}
 }
 
+void
+isc_nm_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+	     unsigned int count, isc_nm_cb_t cb, void *cbarg) {
+	REQUIRE(VALID_NMHANDLE(handle));
+	REQUIRE(regions != NULL && count > 0);
+
+	switch (handle->sock->type) {
+	case isc_nm_tcpsocket:
+		isc__nm_tcp_sendv(handle, regions, count, cb, cbarg);
+		break;
+	case isc_nm_streamdnssocket:
+		isc__nm_streamdns_sendv(handle, regions, count, cb, cbarg);
+		break;
+	default:
+		UNREACHABLE();
+	}
+}
+
 void
 isc__nm_senddns(isc_nmhandle_t *handle, isc_region_t *region, isc_nm_cb_t cb,
 		void *cbarg) {
@@ -2850,6 +2909,40 @@ isc_nmhandle_set_tcp_nodelay(isc_nmhandle_t *handle, const bool value) {
 	return result;
 }
 
+isc_result_t
+isc_nmhandle_set_tcp_cork(isc_nmhandle_t *handle, const bool value) {
+	REQUIRE(VALID_NMHANDLE(handle));
+	REQUIRE(VALID_NMSOCK(handle->sock));
+
+	isc_result_t result = ISC_R_NOTIMPLEMENTED;
+	isc_nmsocket_t *sock = handle->sock;
+
+	switch (sock->type) {
+	case isc_nm_tcpsocket: {
+		uv_os_fd_t tcp_fd = (uv_os_fd_t)-1;
+		(void)uv_fileno((uv_handle_t *)&sock->uv_handle.tcp, &tcp_fd);
+		RUNTIME_CHECK(tcp_fd != (uv_os_fd_t)-1);
+		result = isc__nm_socket_tcp_cork((uv_os_sock_t)tcp_fd, value);
+	} break;
+	case isc_nm_streamdnssocket:
+	case isc_nm_tlssocket:
+	case isc_nm_proxystreamsocket:
+		/*
+		 * These are layered on top of another stream transport;
+		 * cork the socket underneath.
+		 */
+		if (sock->outerhandle != NULL) {
+			result = isc_nmhandle_set_tcp_cork(sock->outerhandle,
+							   value);
+		}
+		break;
+	default:
+		break;
+	};
+
+	return result;
+}
+
 isc_sockaddr_t
 isc_nmsocket_getaddr(isc_nmsocket_t *sock) {
 	REQUIRE(VALID_NMSOCK(sock));
@@ -331,6 +331,34 @@ isc__nm_socket_tcp_nodelay(uv_os_sock_t fd, bool value) {
 #endif
 }
 
+isc_result_t
+isc__nm_socket_tcp_cork(uv_os_sock_t fd, bool value) {
+#if defined(TCP_CORK) || defined(TCP_NOPUSH)
+#if defined(TCP_CORK)
+	const int name = TCP_CORK;
+#else
+	const int name = TCP_NOPUSH;
+#endif
+	int ret;
+
+	if (value) {
+		ret = setsockopt_on(fd, IPPROTO_TCP, name);
+	} else {
+		ret = setsockopt_off(fd, IPPROTO_TCP, name);
+	}
+
+	if (ret == -1) {
+		return ISC_R_FAILURE;
+	} else {
+		return ISC_R_SUCCESS;
+	}
+#else
+	UNUSED(fd);
+	UNUSED(value);
+	return ISC_R_NOTIMPLEMENTED;
+#endif
+}
+
 isc_result_t
 isc__nm_socket_tcp_maxseg(uv_os_sock_t fd, int size) {
 #ifdef TCP_MAXSEG
@@ -67,6 +67,7 @@ typedef struct streamdns_send_req {
 	isc_nm_cb_t cb;		   /* send callback */
 	void *cbarg;		   /* send callback argument */
 	isc_nmhandle_t *dnshandle; /* Stream DNS socket handle */
+	isc_region_t data;	   /* framed copy of a vectored send */
 } streamdns_send_req_t;
 
 static streamdns_send_req_t *
@@ -615,6 +616,11 @@ streamdns_get_send_req(isc_nmsocket_t *sock, isc_mem_t *mctx,
 static void
 streamdns_put_send_req(isc_mem_t *mctx, streamdns_send_req_t *send_req,
 		       const bool force_destroy) {
+	if (send_req->data.base != NULL) {
+		isc_mem_put(mctx, send_req->data.base, send_req->data.length);
+		send_req->data = (isc_region_t){ 0 };
+	}
+
 	/*
 	 * Attempt to put the object for reuse later if we are not
 	 * wrapping up.
@@ -986,6 +992,73 @@ isc__nm_streamdns_send(isc_nmhandle_t *handle, const isc_region_t *region,
 	isc__nm_uvreq_put(&uvreq);
 }
 
+void
+isc__nm_streamdns_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+			unsigned int count, isc_nm_cb_t cb, void *cbarg) {
+	isc__nm_uvreq_t *uvreq = NULL;
+	isc_nmsocket_t *sock = NULL;
+	streamdns_send_req_t *send_req;
+	isc_mem_t *mctx;
+	isc_buffer_t b;
+	size_t len = 0;
+
+	REQUIRE(VALID_NMHANDLE(handle));
+	REQUIRE(VALID_NMSOCK(handle->sock));
+	REQUIRE(regions != NULL && count > 0);
+
+	sock = handle->sock;
+
+	REQUIRE(sock->type == isc_nm_streamdnssocket);
+	REQUIRE(sock->tid == isc_tid());
+
+	uvreq = isc__nm_uvreq_get(sock);
+	isc_nmhandle_attach(handle, &uvreq->handle);
+	uvreq->cb.send = cb;
+	uvreq->cbarg = cbarg;
+
+	if (streamdns_closing(sock)) {
+		isc__nm_failed_send_cb(sock, uvreq, ISC_R_CANCELED, true);
+		return;
+	}
+
+	mctx = sock->worker->mctx;
+	send_req = streamdns_get_send_req(sock, mctx, uvreq);
+
+	/*
+	 * Plain TCP can write the messages straight from the caller's
+	 * buffers, with the length prefixes in the gather list.
+	 */
+	if (sock->outerhandle->sock->type == isc_nm_tcpsocket) {
+		isc__nm_tcp_senddnsv(sock->outerhandle, regions, count,
+				     streamdns_writecb, (void *)send_req);
+		isc__nm_uvreq_put(&uvreq);
+		return;
+	}
+
+	/*
+	 * The other stream transports copy the data into their own
+	 * buffers (TLS has to encrypt it anyway), so frame the messages
+	 * into a single buffer and hand that over in one go.
+	 */
+	for (unsigned int i = 0; i < count; i++) {
+		REQUIRE(regions[i].length <= UINT16_MAX);
+		len += 2 + regions[i].length;
+	}
+
+	send_req->data.base = isc_mem_get(mctx, len);
+	send_req->data.length = len;
+	isc_buffer_init(&b, send_req->data.base, len);
+	for (unsigned int i = 0; i < count; i++) {
+		isc_buffer_putuint16(&b, regions[i].length);
+		isc_buffer_putmem(&b, regions[i].base, regions[i].length);
+	}
+
+	isc_nm_send(sock->outerhandle, &send_req->data, streamdns_writecb,
+		    (void *)send_req);
+
+	isc__nm_uvreq_put(&uvreq);
+}
+
 static void
 streamdns_close_direct(isc_nmsocket_t *sock) {
 	REQUIRE(VALID_NMSOCK(sock));
@@ -1021,6 +1021,33 @@ failure:
 	return result;
 }
 
+static void
+tcp_send_uvreq(isc_nmhandle_t *handle, isc__nm_uvreq_t *uvreq,
+	       isc_nm_cb_t cb, void *cbarg) {
+	isc_nmsocket_t *sock = handle->sock;
+	isc_result_t result;
+
+	isc_nmhandle_attach(handle, &uvreq->handle);
+
+	uvreq->cb.send = cb;
+	uvreq->cbarg = cbarg;
+
+	if (sock->write_timeout == 0) {
+		sock->write_timeout =
+			sock->keepalive
+				? atomic_load_relaxed(&isc__netmgr->keepalive)
+				: atomic_load_relaxed(&isc__netmgr->idle);
+	}
+
+	result = tcp_send_direct(sock, uvreq);
+	if (result != ISC_R_SUCCESS) {
+		isc__nm_incstats(sock, STATID_SENDFAIL);
+		isc__nm_failed_send_cb(sock, uvreq, result, true);
+	}
+
+	return;
+}
+
 static void
 tcp_send(isc_nmhandle_t *handle, const isc_region_t *region, isc_nm_cb_t cb,
 	 void *cbarg, const bool dnsmsg) {
@@ -1028,7 +1055,6 @@ tcp_send(isc_nmhandle_t *handle, const isc_region_t *region, isc_nm_cb_t cb,
 	REQUIRE(VALID_NMSOCK(handle->sock));
 
 	isc_nmsocket_t *sock = handle->sock;
-	isc_result_t result;
 	isc__nm_uvreq_t *uvreq = NULL;
 
 	REQUIRE(sock->type == isc_nm_tcpsocket);
@@ -1041,25 +1067,48 @@ tcp_send(isc_nmhandle_t *handle, const isc_region_t *region, isc_nm_cb_t cb,
 	uvreq->uvbuf.base = (char *)region->base;
 	uvreq->uvbuf.len = region->length;
 
-	isc_nmhandle_attach(handle, &uvreq->handle);
+	tcp_send_uvreq(handle, uvreq, cb, cbarg);
+}
 
-	uvreq->cb.send = cb;
-	uvreq->cbarg = cbarg;
+static void
+tcp_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+	  unsigned int count, isc_nm_cb_t cb, void *cbarg, const bool dnsmsg) {
+	REQUIRE(VALID_NMHANDLE(handle));
+	REQUIRE(VALID_NMSOCK(handle->sock));
+	REQUIRE(regions != NULL && count > 0);
 
-	if (sock->write_timeout == 0) {
-		sock->write_timeout =
-			sock->keepalive
-				? atomic_load_relaxed(&isc__netmgr->keepalive)
-				: atomic_load_relaxed(&isc__netmgr->idle);
+	isc_nmsocket_t *sock = handle->sock;
+	isc__nm_uvreq_t *uvreq = NULL;
+	uv_buf_t *bufs = NULL;
+
+	REQUIRE(sock->type == isc_nm_tcpsocket);
+	REQUIRE(sock->tid == isc_tid());
+
+	/*
+	 * The gather list points straight into the caller's buffers;
+	 * only the length prefixes are stored in the request itself.
+	 */
+	uvreq = isc__nm_uvreq_get(sock);
+	uvreq->nuvbufs = dnsmsg ? count * 2 : count;
+	uvreq->uvbufs = isc_mem_cget(sock->worker->mctx, uvreq->nuvbufs,
+				     sizeof(uvreq->uvbufs[0]));
+	if (dnsmsg) {
+		uvreq->tcplens = isc_mem_cget(sock->worker->mctx, count,
+					      sizeof(uvreq->tcplens[0]));
 	}
 
-	result = tcp_send_direct(sock, uvreq);
-	if (result != ISC_R_SUCCESS) {
-		isc__nm_incstats(sock, STATID_SENDFAIL);
-		isc__nm_failed_send_cb(sock, uvreq, result, true);
+	bufs = uvreq->uvbufs;
+	for (unsigned int i = 0; i < count; i++) {
+		if (dnsmsg) {
+			REQUIRE(regions[i].length <= UINT16_MAX);
+			uvreq->tcplens[i] = htons(regions[i].length);
+			*bufs++ = uv_buf_init((char *)&uvreq->tcplens[i], 2);
+		}
+		*bufs++ = uv_buf_init((char *)regions[i].base,
+				      regions[i].length);
 	}
 
-	return;
+	tcp_send_uvreq(handle, uvreq, cb, cbarg);
 }
 
 void
@@ -1074,6 +1123,18 @@ isc__nm_tcp_senddns(isc_nmhandle_t *handle, const isc_region_t *region,
 	tcp_send(handle, region, cb, cbarg, true);
 }
 
+void
+isc__nm_tcp_sendv(isc_nmhandle_t *handle, const isc_region_t *regions,
+		  unsigned int count, isc_nm_cb_t cb, void *cbarg) {
+	tcp_sendv(handle, regions, count, cb, cbarg, false);
+}
+
+void
+isc__nm_tcp_senddnsv(isc_nmhandle_t *handle, const isc_region_t *regions,
+		     unsigned int count, isc_nm_cb_t cb, void *cbarg) {
+	tcp_sendv(handle, regions, count, cb, cbarg, true);
+}
+
 static void
 tcp_maybe_restart_reading(isc_nmsocket_t *sock) {
 	if (!sock->client && sock->reading &&
@@ -1134,6 +1195,28 @@ tcp_send_cb(uv_write_t *req, int status) {
 	tcp_maybe_restart_reading(sock);
 }
 
+/*
+ * Skip the first 'n' bytes of a gather list that have already been
+ * written by uv_try_write(); 'n' must be less than the total length.
+ */
+static void
+tcp_consume_bufs(uv_buf_t **bufsp, size_t *nbufsp, size_t n) {
+	uv_buf_t *bufs = *bufsp;
+	size_t nbufs = *nbufsp;
+
+	while (n >= bufs->len) {
+		n -= bufs->len;
+		bufs++;
+		nbufs--;
+		INSIST(nbufs > 0);
+	}
+	bufs->base += n;
+	bufs->len -= n;
+
+	*bufsp = bufs;
+	*nbufsp = nbufs;
+}
+
 static isc_result_t
 tcp_send_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *req) {
 	REQUIRE(VALID_NMSOCK(sock));
@@ -1144,14 +1227,37 @@ tcp_send_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *req) {
 	int r;
 	uv_buf_t bufs[2] = { { 0 }, { 0 } }; /* ugly, but required for old GCC
 						versions */
+	uv_buf_t *wbufs = bufs;
 	size_t nbufs = 1;
 
 	if (isc__nmsocket_closing(sock)) {
 		return ISC_R_CANCELED;
 	}
 
-	/* Check if we are not trying to send a DNS message */
-	if (*(uint16_t *)req->tcplen == 0) {
+	if (req->uvbufs != NULL) {
+		/* Vectored send, see tcp_sendv() */
+		size_t total = 0;
+
+		wbufs = req->uvbufs;
+		nbufs = req->nuvbufs;
+		for (size_t i = 0; i < nbufs; i++) {
+			total += wbufs[i].len;
+		}
+
+		r = uv_try_write(&sock->uv_handle.stream, wbufs, nbufs);
+
+		if (r >= 0 && (size_t)r == total) {
+			/* Wrote everything */
+			isc__nm_sendcb(sock, req, ISC_R_SUCCESS, true);
+			tcp_maybe_restart_reading(sock);
+			return ISC_R_SUCCESS;
+		} else if (r > 0) {
+			tcp_consume_bufs(&wbufs, &nbufs, (size_t)r);
+		} else if (!(r == UV_ENOSYS || r == UV_EAGAIN)) {
+			return isc_uverr2result(r);
+		}
+	} else if (*(uint16_t *)req->tcplen == 0) {
+		/* We are not trying to send a DNS message */
 		bufs[0].base = req->uvbuf.base;
 		bufs[0].len = req->uvbuf.len;
 
@@ -1208,7 +1314,7 @@ tcp_send_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *req) {
 				  ? "throttling TCP connection, "
 				  : "");
 
-	r = uv_write(&req->uv_req.write, &sock->uv_handle.stream, bufs, nbufs,
+	r = uv_write(&req->uv_req.write, &sock->uv_handle.stream, wbufs, nbufs,
 		     tcp_send_cb);
 	if (r < 0) {
 		return isc_uverr2result(r);
@@ -11,6 +11,8 @@
  * information regarding copyright ownership.
  */
 
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <unistd.h>
 
 #include <isc/async.h>
@@ -60,12 +62,42 @@
 #endif /* if defined(HAVE_LINUX_NETLINK_H) && defined(HAVE_LINUX_RTNETLINK_H) \
 	*/
 
+/*
+ * Responses to the datagrams received in a single recvmmsg(2) batch are
+ * queued on the socket and sent with sendmmsg(2) when the batch ends.
+ */
+#if HAVE_SENDMMSG && HAVE_DECL_UV_UDP_MMSG_CHUNK
+#define USE_UDP_SENDBATCH 1
+#endif
+
+/*
+ * UDP GSO is only used for responses that fit into the IPv6 minimum MTU,
+ * so the coalesced segments never exceed the egress device MTU.  The
+ * kernel rejects GSO sends whose total payload does not fit into a single
+ * IPv4 datagram (65535 minus the UDP and IPv4 headers).
+ */
+#if defined(UDP_SEGMENT) && defined(SOL_UDP)
+#define USE_UDP_GSO	     1
+#define UDP_GSO_MAX_SEGSIZE  1232
+#define UDP_GSO_MAX_SEGMENTS 64
+#define UDP_GSO_MAX_TOTAL    (UINT16_MAX - 8 - 20)
+#endif
+
 static void
 udp_send_cb(uv_udp_send_t *req, int status);
 
 static void
 udp_close_cb(uv_handle_t *handle);
 
+static void
+udp_send_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *uvreq,
+		const struct sockaddr *sa);
+
+#if USE_UDP_SENDBATCH
+static void
+udp_sendq_flush(isc_nmsocket_t *sock);
+#endif /* USE_UDP_SENDBATCH */
+
 static uv_os_sock_t
 isc__nm_udp_lb_socket(sa_family_t sa_family) {
 	isc_result_t result;
@@ -485,6 +517,16 @@ isc__nm_udp_read_cb(uv_udp_t *handle, ssize_t nrecv, const uv_buf_t *buf,
 	if ((flags & UV_UDP_MMSG_FREE) == UV_UDP_MMSG_FREE) {
 		INSIST(nrecv == 0);
 		INSIST(addr == NULL);
+#if USE_UDP_SENDBATCH
+		/*
+		 * The recvmmsg(2) batch is over, send the responses that
+		 * were queued while processing it.
+		 */
+		if (sock->udp_batching) {
+			sock->udp_batching = false;
+			udp_sendq_flush(sock);
+		}
+#endif /* USE_UDP_SENDBATCH */
 		goto free;
 	}
 #else
@@ -575,6 +617,19 @@ isc__nm_udp_read_cb(uv_udp_t *handle, ssize_t nrecv, const uv_buf_t *buf,
 		isc__nmsocket_clearcb(sock);
 	}
 
+#if USE_UDP_SENDBATCH
+	/*
+	 * The datagram is a part of a recvmmsg(2) batch, which is always
+	 * terminated by a final callback with the UV_UDP_MMSG_FREE flag
+	 * set, so the responses can be queued until then.
+	 */
+	if (!sock->client && (flags & UV_UDP_MMSG_CHUNK) != 0 &&
+	    atomic_load_relaxed(&isc__netmgr->udp_sendbatch) > 0)
+	{
+		sock->udp_batching = true;
+	}
+#endif /* USE_UDP_SENDBATCH */
+
 	REQUIRE(!sock->processing);
 	sock->processing = true;
 	isc__nm_readcb(sock, req, ISC_R_SUCCESS, false);
@@ -659,7 +714,6 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 	isc__nm_uvreq_t *uvreq = NULL;
 	isc__networker_t *worker = NULL;
 	uint32_t maxudp;
-	int r;
 	isc_result_t result;
 
 	REQUIRE(VALID_NMSOCK(sock));
@@ -702,6 +756,37 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 		goto fail;
 	}
 
+#if USE_UDP_SENDBATCH
+	if (sock->udp_batching) {
+		uvreq->peer = *peer;
+		ISC_LIST_APPEND(sock->udp_sendq, uvreq, link);
+		sock->udp_sendq_len++;
+
+		if (sock->udp_sendq_len >=
+		    atomic_load_relaxed(&isc__netmgr->udp_sendbatch))
+		{
+			udp_sendq_flush(sock);
+		}
+		return;
+	}
+#endif /* USE_UDP_SENDBATCH */
+
+	udp_send_direct(sock, uvreq, sa);
+	return;
+fail:
+	isc__nm_failed_send_cb(sock, uvreq, result, true);
+}
+
+/*
+ * Send a single UDP message, the request must have been fully initialized
+ * by isc__nm_udp_send().
+ */
+static void
+udp_send_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *uvreq,
+		const struct sockaddr *sa) {
+	isc_result_t result;
+	int r;
+
 	if (uv_udp_get_send_queue_size(&sock->uv_handle.udp) >
 	    ISC_NETMGR_UDP_SENDBUF_SIZE)
 	{
@@ -723,7 +808,7 @@ isc__nm_udp_send(isc_nmhandle_t *handle, const isc_region_t *region,
 			goto fail;
 		}
 
-		RUNTIME_CHECK(r == (int)region->length);
+		RUNTIME_CHECK(r == (int)uvreq->uvbuf.len);
 		isc__nm_sendcb(sock, uvreq, ISC_R_SUCCESS, true);
 
 	} else {
@@ -741,6 +826,201 @@ fail:
 	isc__nm_failed_send_cb(sock, uvreq, result, true);
 }
 
+#if USE_UDP_SENDBATCH
+#if USE_UDP_GSO
+/*
+ * Return the number of queued responses starting at 'reqs[0]' that can be
+ * coalesced into a single UDP GSO send: they must go to the same peer and
+ * all but the last one must have the same size.
+ */
+static size_t
+udp_gso_segments(isc__nm_uvreq_t **reqs, size_t nreqs) {
+	size_t segsize = reqs[0]->uvbuf.len;
+	size_t total = segsize;
+	size_t n = 1;
+
+	if (segsize == 0 || segsize > UDP_GSO_MAX_SEGSIZE) {
+		return 1;
+	}
+
+	while (n < nreqs && n < UDP_GSO_MAX_SEGMENTS) {
+		size_t len = reqs[n]->uvbuf.len;
+
+		if (len == 0 || len > segsize || total + len > UDP_GSO_MAX_TOTAL ||
+		    !isc_sockaddr_equal(&reqs[0]->peer, &reqs[n]->peer))
+		{
+			break;
+		}
+
+		total += len;
+		n++;
+
+		if (len < segsize) {
+			/* A shorter segment must be the last one. */
+			break;
+		}
+	}
+
+	return n;
+}
+#endif /* USE_UDP_GSO */
+
+/*
+ * Send all the responses queued on the socket using as few sendmmsg(2)
+ * calls as possible.  The messages that can't be sent right away (the
+ * socket buffer is full) are handed over to libuv one by one.
+ */
+static void
+udp_sendq_flush(isc_nmsocket_t *sock) {
+	isc__nm_uvreq_t *reqs[ISC_NM_UDP_SENDBATCH_MAX];
+	struct iovec iovs[ISC_NM_UDP_SENDBATCH_MAX];
+	struct mmsghdr msgs[ISC_NM_UDP_SENDBATCH_MAX];
+	size_t nsegs[ISC_NM_UDP_SENDBATCH_MAX];
+#if USE_UDP_GSO
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		struct cmsghdr align;
+	} cmsgs[ISC_NM_UDP_SENDBATCH_MAX];
+#endif /* USE_UDP_GSO */
+	size_t nreqs = 0, nmsgs = 0, first = 0;
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->tid == isc_tid());
+
+	ISC_LIST_FOREACH (sock->udp_sendq, uvreq, link) {
+		ISC_LIST_UNLINK(sock->udp_sendq, uvreq, link);
+		INSIST(nreqs < ARRAY_SIZE(reqs));
+		reqs[nreqs++] = uvreq;
+	}
+	sock->udp_sendq_len = 0;
+
+	if (nreqs == 0) {
+		return;
+	}
+
+	if (isc__nmsocket_closing(sock)) {
+		for (size_t i = 0; i < nreqs; i++) {
+			isc__nm_failed_send_cb(sock, reqs[i], ISC_R_CANCELED,
+					       true);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < nreqs; i++) {
+		iovs[i] = (struct iovec){
+			.iov_base = reqs[i]->uvbuf.base,
+			.iov_len = reqs[i]->uvbuf.len,
+		};
+	}
+
+	for (size_t i = 0; i < nreqs; i += nsegs[nmsgs++]) {
+		struct msghdr *msg = &msgs[nmsgs].msg_hdr;
+
+		*msg = (struct msghdr){
+			.msg_name = &reqs[i]->peer.type.sa,
+			.msg_namelen = reqs[i]->peer.length,
+			.msg_iov = &iovs[i],
+			.msg_iovlen = 1,
+		};
+		nsegs[nmsgs] = 1;
+
+#if USE_UDP_GSO
+		if (!sock->udp_nogso) {
+			nsegs[nmsgs] = udp_gso_segments(&reqs[i], nreqs - i);
+		}
+		if (nsegs[nmsgs] > 1) {
+			struct cmsghdr *cmsg = NULL;
+			uint16_t segsize = reqs[i]->uvbuf.len;
+
+			msg->msg_iovlen = nsegs[nmsgs];
+			msg->msg_control = cmsgs[nmsgs].buf;
+			msg->msg_controllen = sizeof(cmsgs[nmsgs].buf);
+
+			cmsg = CMSG_FIRSTHDR(msg);
+			cmsg->cmsg_level = SOL_UDP;
+			cmsg->cmsg_type = UDP_SEGMENT;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(segsize));
+			memmove(CMSG_DATA(cmsg), &segsize, sizeof(segsize));
+		}
+#endif /* USE_UDP_GSO */
+	}
+
+	for (size_t m = 0; m < nmsgs;) {
+		int r = sendmmsg(sock->fd, &msgs[m], nmsgs - m, MSG_DONTWAIT);
+		int err = errno;
+
+		if (r > 0) {
+			isc__nm_incstats(sock, STATID_SENDBATCH);
+
+			for (size_t end = m + r; m < end; m++) {
+				if (nsegs[m] > 1) {
+					isc__nm_incstats(sock, STATID_SENDGSO);
+				}
+				for (size_t j = 0; j < nsegs[m]; j++) {
+					isc__nm_incstats(sock,
+							 STATID_SENDBATCHED);
+					isc__nm_sendcb(sock, reqs[first++],
+						       ISC_R_SUCCESS, true);
+				}
+			}
+			continue;
+		} else if (r == 0) {
+			break;
+		}
+
+		switch (err) {
+		case EINTR:
+			continue;
+		case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+		case EWOULDBLOCK:
+#endif
+		case ENOBUFS:
+			/*
+			 * Let libuv queue the rest of the responses until
+			 * the socket becomes writable again.
+			 */
+			break;
+#if USE_UDP_GSO
+		case EINVAL:
+		case EIO:
+		case ENOPROTOOPT:
+		case EOPNOTSUPP:
+			if (nsegs[m] > 1) {
+				/*
+				 * The kernel or the egress device doesn't
+				 * support UDP GSO, don't try it again on
+				 * this socket.
+				 */
+				sock->udp_nogso = true;
+				break;
+			}
+			FALLTHROUGH;
+#endif /* USE_UDP_GSO */
+		default:
+			/*
+			 * The first message failed, report the error for
+			 * its requests and carry on with the rest.
+			 */
+			isc__nm_incstats(sock, STATID_SENDFAIL);
+			for (size_t j = 0; j < nsegs[m]; j++) {
+				isc__nm_failed_send_cb(
+					sock, reqs[first++],
+					isc_errno_toresult(err), true);
+			}
+			m++;
+			continue;
+		}
+		break;
+	}
+
+	while (first < nreqs) {
+		isc__nm_uvreq_t *uvreq = reqs[first++];
+		udp_send_direct(sock, uvreq, &uvreq->peer.type.sa);
+	}
+}
+#endif /* USE_UDP_SENDBATCH */
+
 static isc_result_t
 udp_connect_direct(isc_nmsocket_t *sock, isc__nm_uvreq_t *req) {
 	int uv_bind_flags = 0;
@@ -871,6 +1151,120 @@ isc_nm_udpconnect(isc_sockaddr_t *local, isc_sockaddr_t *peer, isc_nm_cb_t cb,
 	isc__nmsocket_detach(&sock);
 }
 
+isc_result_t
+isc_nm_udpbind(isc_sockaddr_t *local, isc_nm_recv_cb_t cb, void *cbarg,
+	       isc_nmhandle_t **handlep) {
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_nmsocket_t *sock = NULL;
+	sa_family_t sa_family;
+	isc__networker_t *worker = isc__networker_current();
+	uv_os_sock_t fd = -1;
+	int uv_bind_flags = 0;
+	int r;
+
+	REQUIRE(local != NULL);
+	REQUIRE(cb != NULL);
+	REQUIRE(handlep != NULL && *handlep == NULL);
+
+	if (isc__nm_closing(worker)) {
+		return ISC_R_SHUTTINGDOWN;
+	}
+
+	sa_family = local->type.sa.sa_family;
+
+	result = isc__nm_socket(sa_family, SOCK_DGRAM, 0, &fd);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	/* Initialize the new socket */
+	sock = isc_mempool_get(worker->nmsocket_pool);
+	isc__nmsocket_init(sock, worker, isc_nm_udpsocket, local, NULL);
+
+	sock->recv_cb = cb;
+	sock->recv_cbarg = cbarg;
+	sock->inactive_handles_max = ISC_NM_NMHANDLES_MAX;
+
+	sock->fd = fd;
+
+	(void)isc__nm_socket_disable_pmtud(sock->fd, sa_family);
+
+	(void)isc__nm_socket_min_mtu(sock->fd, sa_family);
+
+	r = uv_udp_init(&worker->loop->loop, &sock->uv_handle.udp);
+	UV_RUNTIME_CHECK(uv_udp_init, r);
+	uv_handle_set_data(&sock->uv_handle.handle, sock);
+
+	r = uv_timer_init(&worker->loop->loop, &sock->read_timer);
+	UV_RUNTIME_CHECK(uv_timer_init, r);
+	uv_handle_set_data((uv_handle_t *)&sock->read_timer, sock);
+
+	r = uv_udp_open(&sock->uv_handle.udp, sock->fd);
+	if (r != 0) {
+		isc__nm_closesocket(sock->fd);
+		isc__nm_incstats(sock, STATID_OPENFAIL);
+		result = isc_uverr2result(r);
+		goto fail;
+	}
+	isc__nm_incstats(sock, STATID_OPEN);
+
+	/*
+	 * uv_udp_open() enables REUSE_ADDR, we need to disable it again,
+	 * the port must belong to this socket only.
+	 */
+	result = isc__nm_socket_reuse(sock->fd, 0);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	if (sa_family == AF_INET6) {
+		uv_bind_flags |= UV_UDP_IPV6ONLY;
+	}
+
+	r = uv_udp_bind(&sock->uv_handle.udp, &sock->iface.type.sa,
+			uv_bind_flags);
+	if (r != 0) {
+		isc__nm_incstats(sock, STATID_BINDFAIL);
+		result = isc_uverr2result(r);
+		goto fail;
+	}
+
+	isc__nm_set_network_buffers(&sock->uv_handle.handle);
+
+	result = isc__nm_start_reading(sock);
+	if (result != ISC_R_SUCCESS) {
+		goto fail;
+	}
+
+	*handlep = isc__nmhandle_get(sock, NULL, &sock->iface);
+	isc__nmsocket_detach(&sock);
+
+	return ISC_R_SUCCESS;
+
+fail:
+	sock->active = false;
+	isc__nmsocket_detach(&sock);
+	return result;
+}
+
+void
+isc_nm_udpsendto(isc_nmhandle_t *handle, const isc_sockaddr_t *peer,
+		 isc_region_t *region, isc_nm_cb_t cb, void *cbarg) {
+	isc_nmsocket_t *sock = NULL;
+
+	REQUIRE(VALID_NMHANDLE(handle));
+	REQUIRE(peer != NULL);
+
+	sock = handle->sock;
+
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->type == isc_nm_udpsocket);
+	REQUIRE(!sock->client && sock->parent == NULL);
+	REQUIRE(sock->tid == isc_tid());
+
+	/* The new handle is passed to (and detached by) the callback */
+	isc__nm_udp_send(isc__nmhandle_get(sock, peer, &sock->iface), region,
+			 cb, cbarg);
+}
+
 void
 isc__nm_udp_failed_read_cb(isc_nmsocket_t *sock, isc_result_t result,
 			   bool async) {
@@ -986,6 +1380,12 @@ isc__nm_udp_close(isc_nmsocket_t *sock) {
 
 	sock->closing = true;
 
+#if USE_UDP_SENDBATCH
+	/* Cancel the responses that are still waiting for the batch end */
+	sock->udp_batching = false;
+	udp_sendq_flush(sock);
+#endif /* USE_UDP_SENDBATCH */
+
 	isc__nmsocket_clearcb(sock);
 	isc__nmsocket_timer_stop(sock);
 	isc__nm_stop_reading(sock);
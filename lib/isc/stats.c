@@ -14,14 +14,17 @@
 /*! \file */
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include <isc/atomic.h>
 #include <isc/buffer.h>
 #include <isc/magic.h>
 #include <isc/mem.h>
+#include <isc/os.h>
 #include <isc/refcount.h>
 #include <isc/stats.h>
+#include <isc/tid.h>
 #include <isc/util.h>
 
 #define ISC_STATS_MAGIC	   ISC_MAGIC('S', 't', 'a', 't')
@@ -37,14 +40,144 @@
 STATIC_ASSERT(sizeof(isc_statscounter_t) <= sizeof(uint64_t),
 	      "Exported statistics must fit into the statistic counter size");
 
+/*
+ * Counters that are bumped by every loop would bounce their cache lines
+ * between CPUs if they were shared, so in statistics created with
+ * isc_stats_create_perloop() each loop thread counts into its own slab
+ * of counters and the slabs are only summed when the counters are read.
+ * Threads that are not loops (and all threads before the loops are set
+ * up) count into the shared 'counters' array.
+ *
+ * The table of slabs and the slabs themselves are allocated when a loop
+ * first counts into them.  Only the owning loop writes to its slab, so
+ * it doesn't need atomic read-modify-write operations.
+ *
+ * Gauges, and counters whose value is used when they are incremented,
+ * need the total, so they are marked with isc_stats_setshared() and
+ * always counted in the shared array.
+ */
+typedef atomic_ptr(isc_atomic_statscounter_t) stats_slab_t;
+
 struct isc_stats {
 	unsigned int magic;
 	isc_mem_t *mctx;
 	isc_refcount_t references;
 	int ncounters;
 	isc_atomic_statscounter_t *counters;
+	size_t nslabs;
+	atomic_ptr(stats_slab_t) slabs;
+	bool *shared;
 };
 
+/*
+ * Whether 'counter' is counted in the per-loop slabs.
+ */
+static bool
+perloop(isc_stats_t *stats, isc_statscounter_t counter) {
+	return stats->nslabs > 0 && !stats->shared[counter];
+}
+
+static size_t
+slab_size(int ncounters) {
+	return ISC_ALIGN(ncounters * sizeof(isc_atomic_statscounter_t),
+			 ISC_OS_CACHELINE_SIZE);
+}
+
+static void
+slabs_free(isc_stats_t *stats) {
+	stats_slab_t *slabs = atomic_load_acquire(&stats->slabs);
+
+	if (slabs == NULL) {
+		return;
+	}
+
+	for (size_t tid = 0; tid < stats->nslabs; tid++) {
+		isc_atomic_statscounter_t *slab =
+			atomic_load_acquire(&slabs[tid]);
+		if (slab != NULL) {
+			isc_mem_put(stats->mctx, slab,
+				    slab_size(stats->ncounters));
+		}
+	}
+	isc_mem_cput(stats->mctx, slabs, stats->nslabs, sizeof(slabs[0]));
+	atomic_store_release(&stats->slabs, NULL);
+}
+
+/*
+ * Return the calling loop's slab, allocating it if needed, or NULL if
+ * the caller has to use the shared counters.
+ */
+static isc_atomic_statscounter_t *
+slab_get(isc_stats_t *stats) {
+	isc_tid_t tid = isc_tid();
+	stats_slab_t *slabs = NULL;
+	isc_atomic_statscounter_t *slab = NULL;
+
+	if (tid < 0 || (size_t)tid >= stats->nslabs) {
+		return NULL;
+	}
+
+	slabs = atomic_load_acquire(&stats->slabs);
+	if (slabs == NULL) {
+		stats_slab_t *newslabs = isc_mem_cget(
+			stats->mctx, stats->nslabs, sizeof(newslabs[0]));
+		for (size_t i = 0; i < stats->nslabs; i++) {
+			atomic_init(&newslabs[i], NULL);
+		}
+		if (atomic_compare_exchange_strong_acq_rel(&stats->slabs,
+							   &slabs, newslabs))
+		{
+			slabs = newslabs;
+		} else {
+			/* Another loop got there first */
+			isc_mem_cput(stats->mctx, newslabs, stats->nslabs,
+				     sizeof(newslabs[0]));
+		}
+	}
+
+	slab = atomic_load_relaxed(&slabs[tid]);
+	if (slab == NULL) {
+		size_t size = slab_size(stats->ncounters);
+
+		slab = isc_mem_get(stats->mctx, size);
+		for (size_t i = 0; i < size / sizeof(slab[0]); i++) {
+			atomic_init(&slab[i], 0);
+		}
+		atomic_store_release(&slabs[tid], slab);
+	}
+
+	return slab;
+}
+
+/*
+ * Sum of the per-loop slabs for 'counter', excluding the shared array.
+ */
+static isc_statscounter_t
+slabs_sum(isc_stats_t *stats, isc_statscounter_t counter) {
+	stats_slab_t *slabs = atomic_load_acquire(&stats->slabs);
+	isc_statscounter_t sum = 0;
+
+	if (slabs == NULL) {
+		return 0;
+	}
+
+	for (size_t tid = 0; tid < stats->nslabs; tid++) {
+		isc_atomic_statscounter_t *slab =
+			atomic_load_acquire(&slabs[tid]);
+		if (slab != NULL) {
+			sum += atomic_load_relaxed(&slab[counter]);
+		}
+	}
+
+	return sum;
+}
+
+static isc_statscounter_t
+counter_get(isc_stats_t *stats, isc_statscounter_t counter) {
+	return atomic_load_acquire(&stats->counters[counter]) +
+	       slabs_sum(stats, counter);
+}
+
 void
 isc_stats_attach(isc_stats_t *stats, isc_stats_t **statsp) {
 	REQUIRE(ISC_STATS_VALID(stats));
@@ -65,6 +198,11 @@ isc_stats_detach(isc_stats_t **statsp) {
 
 	if (isc_refcount_decrement(&stats->references) == 1) {
 		isc_refcount_destroy(&stats->references);
+		slabs_free(stats);
+		if (stats->shared != NULL) {
+			isc_mem_cput(stats->mctx, stats->shared,
+				     stats->ncounters, sizeof(bool));
+		}
 		isc_mem_cput(stats->mctx, stats->counters, stats->ncounters,
 			     sizeof(isc_atomic_statscounter_t));
 		isc_mem_putanddetach(&stats->mctx, stats, sizeof(*stats));
@@ -78,8 +216,9 @@ isc_stats_ncounters(isc_stats_t *stats) {
 	return stats->ncounters;
 }
 
-void
-isc_stats_create(isc_mem_t *mctx, isc_stats_t **statsp, int ncounters) {
+static void
+stats_create(isc_mem_t *mctx, isc_stats_t **statsp, int ncounters,
+	     size_t nslabs) {
 	REQUIRE(statsp != NULL && *statsp == NULL);
 
 	isc_stats_t *stats = isc_mem_get(mctx, sizeof(*stats));
@@ -93,22 +232,82 @@ isc_stats_create(isc_mem_t *mctx, isc_stats_t **statsp, int ncounters) {
 	stats->mctx = NULL;
 	isc_mem_attach(mctx, &stats->mctx);
 	stats->ncounters = ncounters;
+	stats->nslabs = nslabs;
+	atomic_init(&stats->slabs, NULL);
+	stats->shared = NULL;
+	if (nslabs > 0) {
+		stats->shared = isc_mem_cget(mctx, ncounters, sizeof(bool));
+	}
 	stats->magic = ISC_STATS_MAGIC;
 	*statsp = stats;
 }
 
+void
+isc_stats_create(isc_mem_t *mctx, isc_stats_t **statsp, int ncounters) {
+	stats_create(mctx, statsp, ncounters, 0);
+}
+
+void
+isc_stats_create_perloop(isc_mem_t *mctx, isc_stats_t **statsp,
+			 int ncounters) {
+	stats_create(mctx, statsp, ncounters, isc_tid_count());
+}
+
+void
+isc_stats_setshared(isc_stats_t *stats, isc_statscounter_t counter) {
+	REQUIRE(ISC_STATS_VALID(stats));
+	REQUIRE(counter < stats->ncounters);
+
+	if (stats->shared != NULL) {
+		stats->shared[counter] = true;
+	}
+}
+
 isc_statscounter_t
 isc_stats_increment(isc_stats_t *stats, isc_statscounter_t counter) {
+	isc_atomic_statscounter_t *slab = NULL;
+
 	REQUIRE(ISC_STATS_VALID(stats));
 	REQUIRE(counter < stats->ncounters);
 
+	if (perloop(stats, counter)) {
+		slab = slab_get(stats);
+	}
+	if (slab != NULL) {
+		isc_statscounter_t value = atomic_load_relaxed(&slab[counter]);
+		atomic_store_relaxed(&slab[counter], value + 1);
+		return value;
+	}
+
 	return atomic_fetch_add_relaxed(&stats->counters[counter], 1);
 }
 
+void
+isc_stats_add(isc_stats_t *stats, isc_statscounter_t counter,
+	      isc_statscounter_t value) {
+	isc_atomic_statscounter_t *slab = NULL;
+
+	REQUIRE(ISC_STATS_VALID(stats));
+	REQUIRE(counter < stats->ncounters);
+
+	if (perloop(stats, counter)) {
+		slab = slab_get(stats);
+	}
+	if (slab != NULL) {
+		atomic_store_relaxed(&slab[counter],
+				     atomic_load_relaxed(&slab[counter]) +
+					     value);
+		return;
+	}
+
+	atomic_fetch_add_relaxed(&stats->counters[counter], value);
+}
+
 void
 isc_stats_decrement(isc_stats_t *stats, isc_statscounter_t counter) {
 	REQUIRE(ISC_STATS_VALID(stats));
 	REQUIRE(counter < stats->ncounters);
+	REQUIRE(!perloop(stats, counter));
 #if ISC_STATS_CHECKUNDERFLOW
 	REQUIRE(atomic_fetch_sub_release(&stats->counters[counter], 1) > 0);
 #else
@@ -124,8 +323,7 @@ isc_stats_dump(isc_stats_t *stats, isc_stats_dumper_t dump_fn, void *arg,
 	REQUIRE(ISC_STATS_VALID(stats));
 
 	for (i = 0; i < stats->ncounters; i++) {
-		isc_statscounter_t counter =
-			atomic_load_acquire(&stats->counters[i]);
+		isc_statscounter_t counter = counter_get(stats, i);
 		if ((options & ISC_STATSDUMP_VERBOSE) == 0 && counter == 0) {
 			continue;
 		}
@@ -137,6 +335,7 @@ void
 isc_stats_set(isc_stats_t *stats, uint64_t val, isc_statscounter_t counter) {
 	REQUIRE(ISC_STATS_VALID(stats));
 	REQUIRE(counter < stats->ncounters);
+	REQUIRE(!perloop(stats, counter));
 
 	atomic_store_release(&stats->counters[counter], val);
 }
@@ -146,6 +345,7 @@ isc_stats_update_if_greater(isc_stats_t *stats, isc_statscounter_t counter,
 			    isc_statscounter_t value) {
 	REQUIRE(ISC_STATS_VALID(stats));
 	REQUIRE(counter < stats->ncounters);
+	REQUIRE(!perloop(stats, counter));
 
 	isc_statscounter_t curr_value =
 		atomic_load_acquire(&stats->counters[counter]);
@@ -162,7 +362,7 @@ isc_stats_get_counter(isc_stats_t *stats, isc_statscounter_t counter) {
 	REQUIRE(ISC_STATS_VALID(stats));
 	REQUIRE(counter < stats->ncounters);
 
-	return atomic_load_acquire(&stats->counters[counter]);
+	return counter_get(stats, counter);
 }
 
 void
@@ -187,10 +387,17 @@ isc_stats_resize(isc_stats_t **statsp, int ncounters) {
 	for (int i = 0; i < ncounters; i++) {
 		atomic_init(&newcounters[i], 0);
 	}
+	/* The per-loop slabs are folded into the new shared counters */
 	for (int i = 0; i < stats->ncounters; i++) {
-		uint32_t counter = atomic_load_acquire(&stats->counters[i]);
+		isc_statscounter_t counter = counter_get(stats, i);
 		atomic_store_release(&newcounters[i], counter);
 	}
+	slabs_free(stats);
+	if (stats->shared != NULL) {
+		stats->shared = isc_mem_creget(stats->mctx, stats->shared,
+					       stats->ncounters, ncounters,
+					       sizeof(bool));
+	}
 	isc_mem_cput(stats->mctx, stats->counters, stats->ncounters,
 		     sizeof(isc_atomic_statscounter_t));
 	stats->counters = newcounters;
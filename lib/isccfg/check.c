@@ -1182,6 +1182,7 @@ check_options(const cfg_obj_t *options, const cfg_obj_t *config,
 	 * (scale * value) <= UINT32_MAX
 	 */
 	static intervaltable intervals[] = {
+		{ "adb-snapshot-interval", 60, 28 * 24 * 60 }, /* 28 days */
 		{ "interface-interval", 60, 28 * 24 * 60 },    /* 28 days */
 		{ "max-transfer-idle-in", 60, 28 * 24 * 60 },  /* 28 days */
 		{ "max-transfer-idle-out", 60, 28 * 24 * 60 }, /* 28 days */
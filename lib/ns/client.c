@@ -59,6 +59,7 @@
 #include <ns/client.h>
 #include <ns/interfacemgr.h>
 #include <ns/notify.h>
+#include <ns/respcache.h>
 #include <ns/server.h>
 #include <ns/stats.h>
 #include <ns/update.h>
@@ -477,6 +478,53 @@ client_sendpkg(ns_client_t *client, isc_buffer_t *buffer) {
 	isc_nm_send(client->inner.handle, &r, client_senddone, client);
 }
 
+static void
+client_sizestats(ns_client_t *client, size_t respsize) {
+	ns_server_t *sctx = client->manager->sctx;
+	isc_histomulti_t *histo = NULL;
+
+	switch (isc_sockaddr_pf(&client->inner.peeraddr)) {
+	case AF_INET:
+		histo = TCP_CLIENT(client) ? sctx->tcpoutstats4
+					   : sctx->udpoutstats4;
+		break;
+	case AF_INET6:
+		histo = TCP_CLIENT(client) ? sctx->tcpoutstats6
+					   : sctx->udpoutstats6;
+		break;
+	default:
+		UNREACHABLE();
+	}
+
+	isc_histomulti_inc(histo, DNS_SIZEHISTO_BUCKETOUT(respsize));
+}
+
+/*
+ * Record the query latency; 'flags' are the header flags of the
+ * response, which may have been rendered for an earlier query.
+ */
+static void
+client_latencystats(ns_client_t *client, unsigned int flags) {
+	unsigned int outcome;
+	isc_nanosecs_t elapsed;
+
+	if (client->inner.view == NULL) {
+		return;
+	}
+
+	if ((client->query.attributes & NS_QUERYATTR_RECURSED) != 0) {
+		outcome = dns_latencyoutcome_recursion;
+	} else if ((flags & DNS_MESSAGEFLAG_AA) != 0) {
+		outcome = dns_latencyoutcome_auth;
+	} else {
+		outcome = dns_latencyoutcome_cache;
+	}
+
+	elapsed = isc_time_monotonic() - client->inner.recvtime;
+	dns_view_latency(client->inner.view, ns_client_transport_type(client),
+			 outcome, elapsed / NS_PER_US);
+}
+
 void
 ns_client_sendraw(ns_client_t *client, dns_message_t *message) {
 	isc_result_t result;
@@ -546,6 +594,93 @@ done:
 	ns_client_drop(client, result);
 }
 
+isc_result_t
+ns_client_sendwire(ns_client_t *client, const isc_region_t *wire) {
+	isc_result_t result;
+	unsigned char *data = NULL;
+	isc_buffer_t buffer;
+	isc_region_t r, qr;
+	dns_name_t *qname = NULL;
+	size_t respsize;
+#ifdef HAVE_DNSTAP
+	dns_transport_type_t transport_type;
+	dns_dtmsgtype_t dtmsgtype;
+#endif
+
+	REQUIRE(NS_CLIENT_VALID(client));
+	REQUIRE(wire != NULL && wire->length >= DNS_MESSAGE_HEADERLEN);
+
+	CTRACE("sendwire");
+
+	client_allocsendbuf(client, &buffer, &data);
+
+	if (wire->length > isc_buffer_length(&buffer)) {
+		if (client->inner.tcpbuf != NULL) {
+			client_put_tcp_buffer(client);
+		}
+		return ISC_R_NOSPACE;
+	}
+
+	/*
+	 * Copy the response to the buffer, then fix up the id and the
+	 * question name, which must be returned in the case it was sent.
+	 */
+	isc_buffer_availableregion(&buffer, &r);
+	result = isc_buffer_copyregion(&buffer, wire);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+	r.base[0] = (client->message->id >> 8) & 0xff;
+	r.base[1] = client->message->id & 0xff;
+
+	qname = ISC_LIST_HEAD(client->message->sections[DNS_SECTION_QUESTION]);
+	dns_name_toregion(qname, &qr);
+	INSIST(wire->length >= DNS_MESSAGE_HEADERLEN + qr.length);
+	memmove(r.base + DNS_MESSAGE_HEADERLEN, qr.base, qr.length);
+
+#ifdef HAVE_DNSTAP
+	if (client->inner.view != NULL) {
+		transport_type = ns_client_transport_type(client);
+
+		if ((client->message->flags & DNS_MESSAGEFLAG_RD) != 0) {
+			dtmsgtype = DNS_DTTYPE_CR;
+		} else {
+			dtmsgtype = DNS_DTTYPE_AR;
+		}
+		dns_dt_send(client->inner.view, dtmsgtype,
+			    &client->inner.peeraddr,
+			    &client->inner.destsockaddr, transport_type, NULL,
+			    &client->inner.requesttime, NULL, &buffer);
+	}
+#endif
+
+	/*
+	 * Record the latency before sending, because client_sendpkg()
+	 * may leave client->view set to NULL.
+	 */
+	client_latencystats(client, (r.base[2] << 8) | r.base[3]);
+
+	respsize = isc_buffer_usedlength(&buffer);
+
+	if (client->inner.sendcb != NULL) {
+		client->inner.sendcb(&buffer);
+	} else {
+		client_sendpkg(client, &buffer);
+		client_sizestats(client, respsize);
+	}
+
+	ns_stats_increment(client->manager->sctx->nsstats,
+			   ns_statscounter_response);
+	dns_rcodestats_increment(client->manager->sctx->rcodestats,
+				 client->message->rcode);
+	if (client->inner.ednsversion >= 0) {
+		ns_stats_increment(client->manager->sctx->nsstats,
+				   ns_statscounter_edns0out);
+	}
+
+	client->query.attributes |= NS_QUERYATTR_ANSWERED;
+
+	return ISC_R_SUCCESS;
+}
+
 void
 ns_client_send(ns_client_t *client) {
 	isc_result_t result;
@@ -708,6 +843,10 @@ renderend:
 		goto cleanup;
 	}
 
+	if ((client->query.attributes & NS_QUERYATTR_RESPCACHE) != 0) {
+		ns_respcache_add(client, &buffer);
+	}
+
 #ifdef HAVE_DNSTAP
 	memset(&zr, 0, sizeof(zr));
 	if (((client->message->flags & DNS_MESSAGEFLAG_AA) != 0) &&
@@ -740,6 +879,12 @@ renderend:
 		dns_compress_invalidate(&cctx);
 	}
 
+	/*
+	 * Record the latency before sending, because client_sendpkg()
+	 * may leave client->view set to NULL.
+	 */
+	client_latencystats(client, client->message->flags);
+
 	if (client->inner.sendcb != NULL) {
 		client->inner.sendcb(&buffer);
 	} else if (TCP_CLIENT(client)) {
@@ -758,18 +903,7 @@ renderend:
 
 		client_sendpkg(client, &buffer);
 
-		switch (isc_sockaddr_pf(&client->inner.peeraddr)) {
-		case AF_INET:
-			isc_histomulti_inc(client->manager->sctx->tcpoutstats4,
-					   DNS_SIZEHISTO_BUCKETOUT(respsize));
-			break;
-		case AF_INET6:
-			isc_histomulti_inc(client->manager->sctx->tcpoutstats6,
-					   DNS_SIZEHISTO_BUCKETOUT(respsize));
-			break;
-		default:
-			UNREACHABLE();
-		}
+		client_sizestats(client, respsize);
 	} else {
 #ifdef HAVE_DNSTAP
 		/*
@@ -789,18 +923,7 @@ renderend:
 
 		client_sendpkg(client, &buffer);
 
-		switch (isc_sockaddr_pf(&client->inner.peeraddr)) {
-		case AF_INET:
-			isc_histomulti_inc(client->manager->sctx->udpoutstats4,
-					   DNS_SIZEHISTO_BUCKETOUT(respsize));
-			break;
-		case AF_INET6:
-			isc_histomulti_inc(client->manager->sctx->udpoutstats6,
-					   DNS_SIZEHISTO_BUCKETOUT(respsize));
-			break;
-		default:
-			UNREACHABLE();
-		}
+		client_sizestats(client, respsize);
 	}
 
 	/* update statistics (XXXJT: is it okay to access message->xxxkey?) */
@@ -1923,6 +2046,7 @@ ns_client_request(isc_nmhandle_t *handle, isc_result_t eresult,
 	client->inner.state = NS_CLIENTSTATE_WORKING;
 
 	client->inner.requesttime = isc_time_now();
+	client->inner.recvtime = isc_time_monotonic();
 	client->inner.tnow = client->inner.requesttime;
 	client->inner.now = isc_time_seconds(&client->inner.tnow);
 
@@ -2586,8 +2710,6 @@ ns__client_setup(ns_client_t *client, ns_clientmgr_t *mgr, bool new) {
 		ns_clientmgr_attach(mgr, &client->manager);
 
 		dns_message_create(client->manager->mctx,
-				   client->manager->namepool,
-				   client->manager->rdspool,
 				   DNS_MESSAGE_INTENTPARSE, &client->message);
 
 		/*
@@ -2645,9 +2767,11 @@ clientmgr_destroy_cb(void *arg) {
 
 	isc_mutex_destroy(&manager->reclock);
 
-	ns_server_detach(&manager->sctx);
+	if (manager->respcache != NULL) {
+		ns_respcache_destroy(&manager->respcache);
+	}
 
-	dns_message_destroypools(&manager->rdspool, &manager->namepool);
+	ns_server_detach(&manager->sctx);
 
 	isc_mem_putanddetach(&manager->mctx, manager, sizeof(*manager));
 }
@@ -2680,8 +2804,6 @@ ns_clientmgr_create(ns_server_t *sctx, dns_aclenv_t *aclenv, isc_tid_t tid,
 	isc_refcount_init(&manager->references, 1);
 	ns_server_attach(sctx, &manager->sctx);
 
-	dns_message_createpools(mctx, &manager->namepool, &manager->rdspool);
-
 	manager->magic = MANAGER_MAGIC;
 
 	MTRACE("create");
@@ -144,9 +144,6 @@ struct ns_clientmgr {
 	unsigned int magic;
 
 	isc_mem_t     *mctx;
-	isc_mempool_t *namepool;
-	isc_mempool_t *rdspool;
-
 	ns_server_t   *sctx;
 	isc_refcount_t references;
 	isc_tid_t      tid;
@@ -158,6 +155,8 @@ struct ns_clientmgr {
 	isc_mutex_t   reclock;
 	client_list_t recursing; /*%< Recursing clients */
 
+	ns_respcache_t *respcache; /*%< Rendered response cache */
+
 	uint8_t tcp_buffer[NS_CLIENT_TCP_BUFFER_SIZE];
 };
 
@@ -186,6 +185,7 @@ struct ns_client {
 		uint16_t	additionaldepth;
 		void (*cleanup)(ns_client_t *);
 		isc_time_t    requesttime;
+		isc_nanosecs_t recvtime; /*%< Monotonic, for latency stats */
 		isc_stdtime_t now;
 		isc_time_t    tnow;
 		dns_name_t    signername; /*%< [T]SIG key name */
@@ -306,6 +306,20 @@ ns_client_sendraw(ns_client_t *client, dns_message_t *msg);
  * send msg as a response using client->message->id for the id.
  */
 
+isc_result_t
+ns_client_sendwire(ns_client_t *client, const isc_region_t *wire);
+/*%<
+ * Finish processing the current client request by sending the
+ * pre-rendered response 'wire', using client->message->id for the id
+ * and the question name of client->message in place of the one in
+ * 'wire' (which must be equal to it but for case).
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOSPACE	'wire' doesn't fit the client's send buffer;
+ *			nothing was sent.
+ */
+
 void
 ns_client_error(ns_client_t *client, isc_result_t result);
 /*%<
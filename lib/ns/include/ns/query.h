@@ -174,6 +174,8 @@ struct ns_query {
 #define NS_QUERYATTR_RRL_CHECKED     0x010000
 #define NS_QUERYATTR_REDIRECT	     0x020000
 #define NS_QUERYATTR_ANSWERED	     0x040000
+#define NS_QUERYATTR_RESPCACHE	     0x080000
+#define NS_QUERYATTR_RECURSED	     0x100000
 
 typedef struct query_ctx query_ctx_t;
 
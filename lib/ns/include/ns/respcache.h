@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*! \file
+ * \brief
+ * Per-loop cache of rendered authoritative responses.
+ *
+ * Each client manager (one per loop) owns a small LRU cache of responses
+ * in wire format, keyed by the view, the question and the request header
+ * and EDNS bits that influence the rendered answer.  A later identical
+ * query is answered by copying the cached wire image and patching the
+ * message ID and the case of the question name, without running the
+ * query logic or the renderer.
+ *
+ * Entries are validated on every hit against the current database and
+ * SOA serial of the zone that produced them, and against the zone's
+ * "allow-query" and "allow-query-on" ACLs.  Each entry holds a reference
+ * to the database it was built from, so a database replaced by a reload
+ * or a zone transfer is only freed once its entries have been looked up
+ * again or evicted.
+ *
+ * Responses are only cached when nothing client-specific goes into them:
+ * no TSIG or SIG(0), no EDNS options (COOKIE, NSID, ECS, EXPIRE, padding,
+ * ...), and a view without response rate limiting, RPZ, DNS64,
+ * no-case-compress or plugins.
+ *
+ * The cache is accessed only from the loop which owns the client manager
+ * and is therefore not locked.
+ */
+
+#include <isc/buffer.h>
+#include <isc/region.h>
+
+#include <ns/types.h>
+
+/***
+ *** Functions
+ ***/
+
+isc_result_t
+ns_respcache_find(ns_client_t *client, isc_region_t *region);
+/*%<
+ * Look up a cached response for the query in 'client->message'.
+ *
+ * If a valid entry is found, 'region' is set to its wire image; the
+ * region remains valid until control returns to the loop.
+ *
+ * If the query is eligible for caching but no valid entry exists,
+ * NS_QUERYATTR_RESPCACHE is set on the client so that the rendered
+ * response is handed to ns_respcache_add() by ns_client_send().
+ *
+ * Requires:
+ *\li	'client' is a valid client on the loop of its manager.
+ *\li	'region' is not NULL.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS		a cached response was found
+ *\li	#ISC_R_NOTFOUND		cache miss
+ *\li	#ISC_R_DISABLED		cache disabled or query not eligible
+ */
+
+void
+ns_respcache_add(ns_client_t *client, const isc_buffer_t *buffer);
+/*%<
+ * Add the response rendered into 'buffer' to the cache, provided the
+ * response itself is eligible (authoritative NOERROR or NXDOMAIN answer
+ * from a primary or secondary zone, no truncation, no extended errors,
+ * no RRsets subject to random or cyclic ordering).
+ *
+ * Requires:
+ *\li	'client' is a valid client with NS_QUERYATTR_RESPCACHE set.
+ *\li	'buffer' is a valid buffer.
+ */
+
+void
+ns_respcache_destroy(ns_respcache_t **cachep);
+/*%<
+ * Free the cache and all of its entries.
+ *
+ * Requires:
+ *\li	'cachep' points to a valid cache.
+ */
@@ -106,6 +106,7 @@ struct ns_server {
 	bool	       interface_auto;
 	dns_tkeyctx_t *tkeyctx;
 	uint8_t	       max_restarts;
+	uint32_t       respcache_size;
 
 	/*% Server id for NSID */
 	char *server_id;
@@ -127,7 +127,10 @@ enum {
 	ns_statscounter_encryptedproxydot = 78,
 	ns_statscounter_encryptedproxydoh = 79,
 
-	ns_statscounter_max = 80,
+	ns_statscounter_respcachehit = 80,
+	ns_statscounter_respcachemiss = 81,
+
+	ns_statscounter_max = 82,
 };
 
 void
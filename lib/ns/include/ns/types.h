@@ -24,6 +24,7 @@ typedef ISC_LIST(ns_plugin_t) ns_plugins_t;
 typedef struct ns_interface    ns_interface_t;
 typedef struct ns_interfacemgr ns_interfacemgr_t;
 typedef struct ns_query	       ns_query_t;
+typedef struct ns_respcache    ns_respcache_t;
 typedef struct ns_server       ns_server_t;
 typedef struct ns_stats	       ns_stats_t;
 typedef struct ns_hookasync    ns_hookasync_t;
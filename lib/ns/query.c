@@ -44,6 +44,7 @@
 #include <dns/dns64.h>
 #include <dns/dnssec.h>
 #include <dns/ede.h>
+#include <dns/keycache.h>
 #include <dns/keytable.h>
 #include <dns/message.h>
 #include <dns/ncache.h>
@@ -70,6 +71,7 @@
 #include <ns/client.h>
 #include <ns/hooks.h>
 #include <ns/interfacemgr.h>
+#include <ns/respcache.h>
 #include <ns/server.h>
 #include <ns/stats.h>
 #include <ns/xfrout.h>
@@ -673,6 +675,48 @@ query_send(ns_client_t *client) {
 	isc_nmhandle_detach(&client->inner.reqhandle);
 }
 
+/*
+ * Send a response from the client manager's response cache, if there
+ * is one for this query.  Only authoritative answers are cached.
+ */
+static bool
+query_respcache(ns_client_t *client) {
+	isc_region_t r;
+	isc_statscounter_t counter;
+	uint16_t ancount;
+
+	if (ns_respcache_find(client, &r) != ISC_R_SUCCESS) {
+		return false;
+	}
+
+	client->message->rcode = r.base[3] & 0x0f;
+	ancount = (r.base[6] << 8) | r.base[7];
+
+	if (client->message->rcode == dns_rcode_nxdomain) {
+		counter = ns_statscounter_nxdomain;
+	} else if (ancount == 0) {
+		counter = ns_statscounter_nxrrset;
+	} else {
+		counter = ns_statscounter_success;
+	}
+
+	if (ns_client_sendwire(client, &r) != ISC_R_SUCCESS) {
+		client->message->rcode = dns_rcode_noerror;
+		return false;
+	}
+
+	inc_stats(client, ns_statscounter_authans);
+	inc_stats(client, counter);
+
+	if ((client->manager->sctx->options & NS_SERVER_LOGRESPONSES) != 0) {
+		log_response(client, client->message->rcode);
+	}
+
+	isc_nmhandle_detach(&client->inner.reqhandle);
+
+	return true;
+}
+
 static void
 query_error(ns_client_t *client, isc_result_t result, int line) {
 	int loglevel = ISC_LOG_DEBUG(3);
@@ -2353,6 +2397,36 @@ mark_secure(ns_client_t *client, dns_db_t *db, dns_name_t *name,
 	dns_db_detachnode(db, &node);
 }
 
+/*
+ * Build a dst_key_t from the DNSKEY 'rdata' owned by 'name', reusing the
+ * one in the view's key cache, which the validator fills, if the key has
+ * been seen before.
+ */
+static isc_result_t
+keyfromrdata(ns_client_t *client, const dns_name_t *name,
+	     const dns_rdata_t *rdata, dst_key_t **keyp) {
+	dns_keycache_t *keycache = client->inner.view->keycache;
+	isc_result_t result;
+
+	if (keycache == NULL) {
+		return dns_dnssec_keyfromrdata(name, rdata,
+					       client->manager->mctx, keyp);
+	}
+
+	result = dns_keycache_find(keycache, name, rdata, keyp);
+	if (result == ISC_R_SUCCESS) {
+		return ISC_R_SUCCESS;
+	}
+
+	result = dns_dnssec_keyfromrdata(name, rdata, client->inner.view->mctx,
+					 keyp);
+	if (result == ISC_R_SUCCESS) {
+		dns_keycache_add(keycache, name, rdata, *keyp);
+	}
+
+	return result;
+}
+
 /*
  * Find the secure key that corresponds to rrsig.
  * Note: 'keyrdataset' maintains state between successive calls,
@@ -2419,8 +2493,7 @@ get_key(ns_client_t *client, dns_db_t *db, dns_rdata_rrsig_t *rrsig,
 			continue;
 		}
 
-		result = dns_dnssec_keyfromrdata(&rrsig->signer, &rdata,
-						 client->manager->mctx, keyp);
+		result = keyfromrdata(client, &rrsig->signer, &rdata, keyp);
 		if (result == ISC_R_SUCCESS) {
 			secure = true;
 			break;
@@ -6255,6 +6328,7 @@ ns_query_recurse(ns_client_t *client, dns_rdatatype_t qtype, dns_name_t *qname,
 	if (!resuming) {
 		inc_stats(client, ns_statscounter_recursion);
 	}
+	client->query.attributes |= NS_QUERYATTR_RECURSED;
 
 	result = acquire_recursionquota(client);
 	if (result != ISC_R_SUCCESS) {
@@ -11786,6 +11860,13 @@ ns_query_start(ns_client_t *client, isc_nmhandle_t *handle) {
 		message->flags |= DNS_MESSAGEFLAG_AD;
 	}
 
+	/*
+	 * Answer from the per-loop response cache if we can.
+	 */
+	if (query_respcache(client)) {
+		return;
+	}
+
 	/*
 	 * Start global outgoing query count.
 	 */
@@ -0,0 +1,535 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <isc/hash.h>
+#include <isc/hashmap.h>
+#include <isc/list.h>
+#include <isc/mem.h>
+#include <isc/result.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+#include <dns/view.h>
+#include <dns/zone.h>
+
+#include <ns/client.h>
+#include <ns/query.h>
+#include <ns/respcache.h>
+#include <ns/server.h>
+#include <ns/stats.h>
+
+#define RESPCACHE_MAGIC	   ISC_MAGIC('R', 's', 'p', 'C')
+#define VALID_RESPCACHE(c) ISC_MAGIC_VALID(c, RESPCACHE_MAGIC)
+
+#define RESPCACHE_HASHBITS 12
+
+/*%
+ * Client attributes which put client-specific data into the response.
+ */
+#define RESPCACHE_CLIENTATTRS                                                 \
+	(NS_CLIENTATTR_MULTICAST | NS_CLIENTATTR_WANTNSID |                   \
+	 NS_CLIENTATTR_BADCOOKIE | NS_CLIENTATTR_WANTRC |                     \
+	 NS_CLIENTATTR_WANTCOOKIE | NS_CLIENTATTR_HAVECOOKIE |                \
+	 NS_CLIENTATTR_WANTEXPIRE | NS_CLIENTATTR_HAVEEXPIRE |                \
+	 NS_CLIENTATTR_HAVEECS | NS_CLIENTATTR_WANTPAD |                      \
+	 NS_CLIENTATTR_USEKEEPALIVE | NS_CLIENTATTR_NEEDTCP |                 \
+	 NS_CLIENTATTR_WANTZONEVERSION | NS_CLIENTATTR_HAVEZONEVERSION)
+
+/*%
+ * Client attributes which are part of the key.
+ */
+#define RESPCACHE_KEYATTRS \
+	(NS_CLIENTATTR_TCP | NS_CLIENTATTR_RA | NS_CLIENTATTR_WANTAD)
+
+/*%
+ * The non-name part of the lookup key.  It is hashed and compared as a
+ * block of memory, so it must be fully initialized, padding included.
+ */
+typedef struct respcache_keybits {
+	dns_view_t	*view;
+	dns_rdatatype_t	 qtype;
+	dns_rdataclass_t qclass;
+	uint16_t	 flags;
+	uint16_t	 extflags;
+	uint16_t	 udpsize;
+	int16_t		 ednsversion;
+	unsigned int	 attributes;
+} respcache_keybits_t;
+
+typedef struct respcache_key {
+	const dns_name_t   *qname;
+	respcache_keybits_t bits;
+} respcache_key_t;
+
+typedef struct respcache_entry respcache_entry_t;
+struct respcache_entry {
+	dns_fixedname_t	    fqname;
+	dns_name_t	   *qname;
+	respcache_keybits_t bits;
+	uint32_t	    hashval;
+
+	/*
+	 * Validity: the zone the answer came from, the database it was
+	 * looked up in and its SOA serial.  The database reference keeps
+	 * its address from being reused by a database loaded later.
+	 */
+	dns_zone_t *zone;
+	dns_db_t   *db;
+	uint32_t    serial;
+
+	ISC_LINK(respcache_entry_t) link;
+
+	unsigned int  length;
+	unsigned char wire[];
+};
+
+struct ns_respcache {
+	unsigned int   magic;
+	isc_mem_t     *mctx;
+	uint32_t       size;
+	isc_hashmap_t *hashmap;
+	ISC_LIST(respcache_entry_t) lru;
+};
+
+static void
+respcache_create(isc_mem_t *mctx, uint32_t size, ns_respcache_t **cachep) {
+	ns_respcache_t *cache = isc_mem_get(mctx, sizeof(*cache));
+
+	*cache = (ns_respcache_t){
+		.magic = RESPCACHE_MAGIC,
+		.size = size,
+		.lru = ISC_LIST_INITIALIZER,
+	};
+	isc_mem_attach(mctx, &cache->mctx);
+	isc_hashmap_create(mctx, RESPCACHE_HASHBITS, &cache->hashmap);
+
+	*cachep = cache;
+}
+
+static bool
+respcache_match(void *node, const void *key0) {
+	const respcache_entry_t *entry = node;
+	const respcache_key_t *key = key0;
+
+	return memcmp(&entry->bits, &key->bits, sizeof(entry->bits)) == 0 &&
+	       dns_name_equal(entry->qname, key->qname);
+}
+
+static uint32_t
+respcache_hash(const respcache_key_t *key) {
+	isc_hash32_t state;
+
+	isc_hash32_init(&state);
+	isc_hash32_hash(&state, key->qname->ndata, key->qname->length, false);
+	isc_hash32_hash(&state, &key->bits, sizeof(key->bits), true);
+	return isc_hash32_finalize(&state);
+}
+
+static void
+respcache_unlink(ns_respcache_t *cache, respcache_entry_t *entry) {
+	respcache_key_t key = { .qname = entry->qname, .bits = entry->bits };
+	isc_result_t result;
+
+	result = isc_hashmap_delete(cache->hashmap, entry->hashval,
+				    respcache_match, &key);
+	INSIST(result == ISC_R_SUCCESS);
+	ISC_LIST_UNLINK(cache->lru, entry, link);
+
+	dns_view_weakdetach(&entry->bits.view);
+	dns_zone_detach(&entry->zone);
+	dns_db_detach(&entry->db);
+	isc_mem_put(cache->mctx, entry,
+		    STRUCT_FLEX_SIZE(entry, wire, entry->length));
+}
+
+void
+ns_respcache_destroy(ns_respcache_t **cachep) {
+	ns_respcache_t *cache = NULL;
+
+	REQUIRE(cachep != NULL && VALID_RESPCACHE(*cachep));
+
+	cache = *cachep;
+	*cachep = NULL;
+
+	ISC_LIST_FOREACH (cache->lru, entry, link) {
+		respcache_unlink(cache, entry);
+	}
+	INSIST(isc_hashmap_count(cache->hashmap) == 0);
+
+	isc_hashmap_destroy(&cache->hashmap);
+	cache->magic = 0;
+	isc_mem_putanddetach(&cache->mctx, cache, sizeof(*cache));
+}
+
+/*
+ * Return the cache of the client's manager, (re)creating it if the
+ * configured size has changed since it was created.
+ */
+static ns_respcache_t *
+respcache_get(ns_clientmgr_t *manager) {
+	uint32_t size = manager->sctx->respcache_size;
+
+	if (manager->respcache != NULL && manager->respcache->size != size) {
+		ns_respcache_destroy(&manager->respcache);
+	}
+	if (manager->respcache == NULL && size != 0) {
+		respcache_create(manager->mctx, size, &manager->respcache);
+	}
+
+	return manager->respcache;
+}
+
+/*
+ * Decide whether the response to the client's query depends only on
+ * the question, the view and the request bits captured in the key.
+ */
+static bool
+respcache_eligible(ns_client_t *client) {
+	dns_message_t *message = client->message;
+	dns_view_t *view = client->inner.view;
+
+	if (view == NULL || message->opcode != dns_opcode_query ||
+	    message->counts[DNS_SECTION_QUESTION] != 1)
+	{
+		return false;
+	}
+
+	if (message->tsigkey != NULL || message->tsig != NULL ||
+	    message->sig0 != NULL)
+	{
+		return false;
+	}
+
+	if ((client->inner.attributes & RESPCACHE_CLIENTATTRS) != 0 ||
+	    client->inner.ednsversion > 0)
+	{
+		return false;
+	}
+
+	/*
+	 * Outside the authoritative-only path the answer may be built
+	 * from cache data or from several zones.
+	 */
+	if ((client->query.attributes & NS_QUERYATTR_WANTRECURSION) != 0 &&
+	    (client->query.attributes & NS_QUERYATTR_RECURSIONOK) != 0)
+	{
+		return false;
+	}
+
+	/*
+	 * Features which make the answer depend on the client address
+	 * or on state outside the zone.
+	 */
+	if (view->rrl != NULL || view->rpzs != NULL ||
+	    view->nocasecompress != NULL || view->hooktable != NULL ||
+	    !ISC_LIST_EMPTY(view->dns64))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+static void
+respcache_makekey(ns_client_t *client, respcache_key_t *key) {
+	dns_message_t *message = client->message;
+	dns_name_t *qname =
+		ISC_LIST_HEAD(message->sections[DNS_SECTION_QUESTION]);
+	dns_rdataset_t *qrdataset = ISC_LIST_HEAD(qname->list);
+
+	memset(key, 0, sizeof(*key));
+	key->qname = qname;
+	key->bits.view = client->inner.view;
+	key->bits.qtype = qrdataset->type;
+	key->bits.qclass = qrdataset->rdclass;
+	/* RD and CD are preserved from the request by dns_message_reply() */
+	key->bits.flags = message->flags &
+			  (DNS_MESSAGEFLAG_RD | DNS_MESSAGEFLAG_CD);
+	key->bits.extflags = client->inner.extflags & DNS_MESSAGEEXTFLAG_DO;
+	key->bits.udpsize = client->inner.udpsize;
+	key->bits.ednsversion = client->inner.ednsversion;
+	key->bits.attributes = client->inner.attributes & RESPCACHE_KEYATTRS;
+}
+
+/*
+ * Get the current database of 'zone' and its SOA serial.  On success,
+ * the caller has to detach '*dbp'.
+ */
+static isc_result_t
+respcache_zoneserial(dns_zone_t *zone, dns_db_t **dbp, uint32_t *serialp) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL;
+
+	result = dns_zone_getdb(zone, &db);
+	if (result != ISC_R_SUCCESS) {
+		return result;
+	}
+
+	dns_db_currentversion(db, &version);
+	result = dns_db_getsoaserial(db, version, serialp);
+	dns_db_closeversion(db, &version, false);
+
+	if (result != ISC_R_SUCCESS) {
+		dns_db_detach(&db);
+		return result;
+	}
+
+	*dbp = db;
+
+	return ISC_R_SUCCESS;
+}
+
+/*
+ * Check that the entry still describes the current contents of its zone
+ * and that the client is allowed to see them.
+ */
+static bool
+respcache_valid(ns_client_t *client, respcache_entry_t *entry) {
+	isc_result_t result;
+	dns_zone_t *zone = NULL;
+	dns_db_t *db = NULL;
+	dns_acl_t *acl = NULL;
+	uint32_t serial;
+	bool match;
+
+	result = dns_view_findzone(client->inner.view, entry->qname, 0, &zone);
+	if (result != ISC_R_SUCCESS && result != DNS_R_PARTIALMATCH) {
+		return false;
+	}
+	match = (zone == entry->zone);
+	dns_zone_detach(&zone);
+	if (!match) {
+		return false;
+	}
+
+	result = respcache_zoneserial(entry->zone, &db, &serial);
+	if (result != ISC_R_SUCCESS) {
+		return false;
+	}
+	match = (db == entry->db && serial == entry->serial);
+	dns_db_detach(&db);
+	if (!match) {
+		return false;
+	}
+
+	acl = dns_zone_getqueryacl(entry->zone);
+	if (acl == NULL) {
+		acl = client->inner.view->queryacl;
+	}
+	result = ns_client_checkaclsilent(client, NULL, acl, true);
+	if (result != ISC_R_SUCCESS) {
+		return false;
+	}
+
+	acl = dns_zone_getqueryonacl(entry->zone);
+	if (acl == NULL) {
+		acl = client->inner.view->queryonacl;
+	}
+	result = ns_client_checkaclsilent(client, &client->inner.destaddr, acl,
+					  true);
+	return result == ISC_R_SUCCESS;
+}
+
+isc_result_t
+ns_respcache_find(ns_client_t *client, isc_region_t *region) {
+	ns_respcache_t *cache = NULL;
+	respcache_entry_t *entry = NULL;
+	respcache_key_t key;
+	isc_result_t result;
+
+	REQUIRE(NS_CLIENT_VALID(client));
+	REQUIRE(region != NULL);
+
+	cache = respcache_get(client->manager);
+	if (cache == NULL || !respcache_eligible(client)) {
+		return ISC_R_DISABLED;
+	}
+
+	client->query.attributes |= NS_QUERYATTR_RESPCACHE;
+
+	respcache_makekey(client, &key);
+	result = isc_hashmap_find(cache->hashmap, respcache_hash(&key),
+				  respcache_match, &key, (void **)&entry);
+	if (result == ISC_R_SUCCESS && !respcache_valid(client, entry)) {
+		respcache_unlink(cache, entry);
+		result = ISC_R_NOTFOUND;
+	}
+
+	if (result != ISC_R_SUCCESS) {
+		ns_stats_increment(client->manager->sctx->nsstats,
+				   ns_statscounter_respcachemiss);
+		return ISC_R_NOTFOUND;
+	}
+
+	ns_stats_increment(client->manager->sctx->nsstats,
+			   ns_statscounter_respcachehit);
+
+	/* Move to the head of the LRU list. */
+	ISC_LIST_UNLINK(cache->lru, entry, link);
+	ISC_LIST_PREPEND(cache->lru, entry, link);
+
+	client->query.attributes &= ~NS_QUERYATTR_RESPCACHE;
+	region->base = entry->wire;
+	region->length = entry->length;
+
+	return ISC_R_SUCCESS;
+}
+
+/*
+ * Random and cyclic "rrset-order" would be frozen by caching; only
+ * accept responses where every multi-record RRset has a fixed order.
+ */
+static bool
+respcache_ordered(dns_message_t *message) {
+	for (dns_section_t section = DNS_SECTION_ANSWER;
+	     section < DNS_SECTION_MAX; section++)
+	{
+		ISC_LIST_FOREACH (message->sections[section], name, link) {
+			ISC_LIST_FOREACH (name->list, rdataset, link) {
+				if (rdataset->attributes.order !=
+					    dns_order_none &&
+				    dns_rdataset_count(rdataset) > 1)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void
+ns_respcache_add(ns_client_t *client, const isc_buffer_t *buffer) {
+	ns_respcache_t *cache = NULL;
+	respcache_entry_t *entry = NULL;
+	respcache_key_t key;
+	dns_message_t *message = client->message;
+	dns_zone_t *zone = client->query.authzone;
+	dns_dbversion_t *version = NULL;
+	ns_dbversion_t *dbversion = NULL;
+	dns_db_t *db = NULL;
+	uint32_t serial, current;
+	isc_region_t r;
+	isc_result_t result;
+
+	REQUIRE(NS_CLIENT_VALID(client));
+	REQUIRE((client->query.attributes & NS_QUERYATTR_RESPCACHE) != 0);
+	REQUIRE(ISC_BUFFER_VALID(buffer));
+
+	client->query.attributes &= ~NS_QUERYATTR_RESPCACHE;
+
+	cache = client->manager->respcache;
+	if (cache == NULL ||
+	    cache->size != client->manager->sctx->respcache_size)
+	{
+		return;
+	}
+
+	if ((message->flags & DNS_MESSAGEFLAG_AA) == 0 ||
+	    (message->flags & DNS_MESSAGEFLAG_TC) != 0 ||
+	    (message->rcode != dns_rcode_noerror &&
+	     message->rcode != dns_rcode_nxdomain) ||
+	    client->edectx.nextede != 0 || zone == NULL ||
+	    client->query.authdb == NULL)
+	{
+		return;
+	}
+
+	switch (dns_zone_gettype(zone)) {
+	case dns_zone_primary:
+	case dns_zone_secondary:
+		break;
+	default:
+		return;
+	}
+
+	isc_buffer_usedregion(buffer, &r);
+	if (r.length > NS_CLIENT_SEND_BUFFER_SIZE ||
+	    !respcache_ordered(message))
+	{
+		return;
+	}
+
+	/*
+	 * Record the serial of the version the answer was built from,
+	 * and make sure that version is still the current one.
+	 */
+	dbversion = ns_client_findversion(client, client->query.authdb);
+	if (dbversion == NULL) {
+		return;
+	}
+	version = dbversion->version;
+	result = dns_db_getsoaserial(client->query.authdb, version, &serial);
+	if (result != ISC_R_SUCCESS) {
+		return;
+	}
+	result = respcache_zoneserial(zone, &db, &current);
+	if (result != ISC_R_SUCCESS) {
+		return;
+	}
+	if (db != client->query.authdb || current != serial) {
+		dns_db_detach(&db);
+		return;
+	}
+
+	respcache_makekey(client, &key);
+
+	entry = isc_mem_get(cache->mctx,
+			    STRUCT_FLEX_SIZE(entry, wire, r.length));
+	*entry = (respcache_entry_t){
+		.bits = key.bits,
+		.hashval = respcache_hash(&key),
+		.db = db,
+		.serial = serial,
+		.link = ISC_LINK_INITIALIZER,
+		.length = r.length,
+	};
+	memmove(entry->wire, r.base, r.length);
+	entry->qname = dns_fixedname_initname(&entry->fqname);
+	dns_name_copy(key.qname, entry->qname);
+
+	result = isc_hashmap_add(cache->hashmap, entry->hashval,
+				 respcache_match, &key, entry, NULL);
+	if (result != ISC_R_SUCCESS) {
+		/* Another client of this loop got here first. */
+		dns_db_detach(&entry->db);
+		isc_mem_put(cache->mctx, entry,
+			    STRUCT_FLEX_SIZE(entry, wire, entry->length));
+		return;
+	}
+
+	/*
+	 * The weak view reference keeps the view pointer in the key from
+	 * being reused by a view created after a reconfiguration.
+	 */
+	entry->bits.view = NULL;
+	dns_view_weakattach(key.bits.view, &entry->bits.view);
+	dns_zone_attach(zone, &entry->zone);
+	ISC_LIST_PREPEND(cache->lru, entry, link);
+
+	if (isc_hashmap_count(cache->hashmap) > cache->size) {
+		respcache_unlink(cache, ISC_LIST_TAIL(cache->lru));
+	}
+}
@@ -72,7 +72,7 @@ ns_server_create(isc_mem_t *mctx, ns_matchview_t matchingview,
 
 	ns_stats_create(mctx, ns_statscounter_max, &sctx->nsstats);
 
-	dns_rdatatypestats_create(mctx, &sctx->rcvquerystats);
+	dns_rdatatypestats_create_perloop(mctx, &sctx->rcvquerystats);
 
 	dns_opcodestats_create(mctx, &sctx->opcodestats);
 
@@ -67,7 +67,14 @@ ns_stats_create(isc_mem_t *mctx, int ncounters, ns_stats_t **statsp) {
 
 	isc_refcount_init(&stats->references, 1);
 
-	isc_stats_create(mctx, &stats->counters, ncounters);
+	/*
+	 * The server statistics are updated for every query, so they are
+	 * counted per loop, except for the gauges.
+	 */
+	isc_stats_create_perloop(mctx, &stats->counters, ncounters);
+	isc_stats_setshared(stats->counters, ns_statscounter_recursclients);
+	isc_stats_setshared(stats->counters, ns_statscounter_recurshighwater);
+	isc_stats_setshared(stats->counters, ns_statscounter_tcphighwater);
 
 	stats->magic = NS_STATS_MAGIC;
 	stats->mctx = NULL;
@@ -240,8 +240,8 @@ ixfr_rrstream_create(isc_mem_t *mctx, const char *journal_filename,
 	s->common.methods = &ixfr_rrstream_methods;
 	s->journal = NULL;
 
-	CHECK(dns_journal_open(mctx, journal_filename, DNS_JOURNAL_READ,
-			       &s->journal));
+	CHECK(dns_journal_open(mctx, journal_filename,
+			       DNS_JOURNAL_READ | DNS_JOURNAL_MAP, &s->journal));
 	CHECK(dns_journal_iter_init(s->journal, begin_serial, end_serial,
 				    sizep));
 
@@ -634,6 +634,12 @@ struct xfr_stats {
 	isc_time_t end;	  /*%< End time of the transfer */
 };
 
+/*%
+ * Maximum number of TCP messages rendered ahead and handed to the
+ * network manager with a single gather write.
+ */
+#define XFROUT_SENDV_MESSAGES 4
+
 /*%
  * An 'xfrout_ctx_t' contains the state of an outgoing AXFR or IXFR
  * in progress.
@@ -654,9 +660,13 @@ typedef struct {
 	isc_buffer_t buf;    /* Buffer for message owner
 			      * names and rdatas */
 	isc_buffer_t txbuf;  /* Transmit message buffer */
-	size_t cbytes;	     /* Length of current message */
+	size_t cbytes;	     /* Length of current messages */
 	void *txmem;
 	unsigned int txmemlen;
+	/* Rendered messages waiting to be sent */
+	isc_region_t txregions[XFROUT_SENDV_MESSAGES];
+	unsigned int ntxregions;
+	bool corked; /* TCP connection is corked */
 	dns_tsigkey_t *tsigkey; /* Key used to create TSIG */
 	isc_buffer_t *lasttsig; /* the last TSIG */
 	bool verified_tsig;	/* verified request MAC */
@@ -1263,12 +1273,12 @@ xfrout_ctx_create(isc_mem_t *mctx, ns_client_t *client, unsigned int id,
 
 	/*
 	 * Allocate another temporary buffer for the compressed
-	 * response message.
+	 * response messages, with room for a batch of them.
 	 */
-	mem = isc_mem_get(mctx, len);
+	mem = isc_mem_get(mctx, len * XFROUT_SENDV_MESSAGES);
 	isc_buffer_init(&xfr->txbuf, (char *)mem, len);
 	xfr->txmem = mem;
-	xfr->txmemlen = len;
+	xfr->txmemlen = len * XFROUT_SENDV_MESSAGES;
 
 	/*
 	 * These MUST be after the last "goto failure;" / CHECK to
@@ -1279,15 +1289,33 @@ xfrout_ctx_create(isc_mem_t *mctx, ns_client_t *client, unsigned int id,
 	*xfrp = xfr;
 }
 
+/*
+ * Cork the TCP connection while the transfer is streaming so that the
+ * tail of each batch of messages shares segments with the next one, and
+ * uncork it to flush the last one.
+ */
+static void
+xfrout_setcork(xfrout_ctx_t *xfr, bool value) {
+	if (xfr->corked == value || xfr->client->inner.handle == NULL) {
+		return;
+	}
+
+	if (isc_nmhandle_set_tcp_cork(xfr->client->inner.handle, value) ==
+	    ISC_R_SUCCESS)
+	{
+		xfr->corked = value;
+	}
+}
+
 static void
 xfrout_send(xfrout_ctx_t *xfr) {
 	const bool is_tcp =
 		((xfr->client->inner.attributes & NS_CLIENTATTR_TCP) != 0);
 
 	if (is_tcp) {
-		isc_region_t used;
+		INSIST(xfr->ntxregions > 0);
 
-		isc_buffer_usedregion(&xfr->txbuf, &used);
+		xfrout_setcork(xfr, !xfr->end_of_stream);
 
 		isc_nmhandle_attach(xfr->client->inner.handle,
 				    &xfr->client->inner.sendhandle);
@@ -1295,10 +1323,13 @@ xfrout_send(xfrout_ctx_t *xfr) {
 			isc_nmhandle_setwritetimeout(
 				xfr->client->inner.sendhandle, xfr->idletime);
 		}
-		isc_nm_send(xfr->client->inner.sendhandle, &used,
-			    xfrout_senddone, xfr);
+		xfr->cbytes = 0;
+		for (unsigned int i = 0; i < xfr->ntxregions; i++) {
+			xfr->cbytes += xfr->txregions[i].length;
+		}
+		isc_nm_sendv(xfr->client->inner.sendhandle, xfr->txregions,
+			     xfr->ntxregions, xfrout_senddone, xfr);
 		xfr->sends++;
-		xfr->cbytes = used.length;
 	} else {
 		ns_client_send(xfr->client);
 		xfr->stream->methods->pause(xfr->stream);
@@ -1368,10 +1399,20 @@ sendstream(xfrout_ctx_t *xfr) {
 	dns_compress_t cctx;
 	bool cleanup_cctx = false;
 	bool is_tcp;
+	bool render_more = false;
 	int n_rrs;
 
 	isc_buffer_clear(&xfr->buf);
-	isc_buffer_clear(&xfr->txbuf);
+
+	/*
+	 * Each message of a batch is rendered into its own slot of the
+	 * transmit buffer.
+	 */
+	INSIST(xfr->ntxregions < XFROUT_SENDV_MESSAGES);
+	isc_buffer_init(&xfr->txbuf,
+			(unsigned char *)xfr->txmem +
+				xfr->ntxregions * NS_CLIENT_TCP_BUFFER_SIZE,
+			NS_CLIENT_TCP_BUFFER_SIZE);
 
 	is_tcp = ((xfr->client->inner.attributes & NS_CLIENTATTR_TCP) != 0);
 	if (!is_tcp) {
@@ -1390,8 +1431,8 @@ sendstream(xfrout_ctx_t *xfr) {
 		 * message.
 		 */
 
-		dns_message_create(xfr->mctx, NULL, NULL,
-				   DNS_MESSAGE_INTENTRENDER, &tcpmsg);
+		dns_message_create(xfr->mctx, DNS_MESSAGE_INTENTRENDER,
+				   &tcpmsg);
 		msg = tcpmsg;
 
 		msg->id = xfr->id;
@@ -1600,7 +1641,24 @@ sendstream(xfrout_ctx_t *xfr) {
 			   "sending TCP message of %d bytes",
 			   isc_buffer_usedlength(&xfr->txbuf));
 
-		xfrout_enqueue_send(xfr);
+		isc_buffer_usedregion(&xfr->txbuf,
+				      &xfr->txregions[xfr->ntxregions++]);
+
+		/* Advance lasttsig to be the last TSIG generated */
+		CHECK(dns_message_getquerytsig(msg, xfr->mctx,
+					       &xfr->lasttsig));
+
+		/*
+		 * Render the next message of the batch before sending,
+		 * unless this was the last one.
+		 */
+		if (!xfr->end_of_stream &&
+		    xfr->ntxregions < XFROUT_SENDV_MESSAGES)
+		{
+			render_more = true;
+		} else {
+			xfrout_enqueue_send(xfr);
+		}
 	} else {
 		xfrout_log(xfr, ISC_LOG_DEBUG(8), "sending IXFR UDP response");
 
@@ -1608,9 +1666,6 @@ sendstream(xfrout_ctx_t *xfr) {
 		return;
 	}
 
-	/* Advance lasttsig to be the last TSIG generated */
-	CHECK(dns_message_getquerytsig(msg, xfr->mctx, &xfr->lasttsig));
-
 failure:
 	if (tcpmsg != NULL) {
 		dns_message_detach(&tcpmsg);
@@ -1626,6 +1681,9 @@ failure:
 	xfr->stream->methods->pause(xfr->stream);
 
 	if (result == ISC_R_SUCCESS) {
+		if (render_more) {
+			sendstream(xfr);
+		}
 		return;
 	}
 
@@ -1691,9 +1749,10 @@ xfrout_senddone(isc_nmhandle_t *handle, isc_result_t result, void *arg) {
 	 * two-byte TCP length prefix included in the number of bytes sent.
 	 */
 	if (result == ISC_R_SUCCESS) {
-		xfr->stats.nmsg++;
+		xfr->stats.nmsg += xfr->ntxregions;
 		xfr->stats.nbytes += xfr->cbytes;
 	}
+	xfr->ntxregions = 0;
 
 	if (xfr->shuttingdown) {
 		xfrout_maybe_destroy(xfr);
@@ -1744,6 +1803,8 @@ static void
 xfrout_maybe_destroy(xfrout_ctx_t *xfr) {
 	REQUIRE(xfr->shuttingdown);
 
+	xfrout_setcork(xfr, false);
+
 	ns_client_drop(xfr->client, ISC_R_CANCELED);
 	isc_nmhandle_detach(&xfr->client->inner.reqhandle);
 	xfrout_ctx_destroy(&xfr);
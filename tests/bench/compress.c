@@ -28,6 +28,9 @@
 #include <dns/fixedname.h>
 #include <dns/lib.h>
 #include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
 
 static void
 CHECKRESULT(isc_result_t result, const char *msg) {
@@ -37,6 +40,110 @@ CHECKRESULT(isc_result_t result, const char *msg) {
 	}
 }
 
+/*
+ * Render a response-like mix of RRsets (address records, which are
+ * copied verbatim, and NS records, which need name compression) many
+ * times over, to measure the throughput of dns_rdataset_towire().
+ */
+#define RENDER_RRS 8
+
+static void
+render_bench(void) {
+	static unsigned char ns[RENDER_RRS][32];
+	static unsigned char a[RENDER_RRS][4];
+	static unsigned char aaaa[RENDER_RRS][16];
+	dns_rdata_t rdata[3][RENDER_RRS];
+	dns_rdatalist_t rdatalist[3];
+	dns_rdataset_t rdataset[3];
+	dns_fixedname_t fixed;
+	dns_name_t *owner = dns_fixedname_initname(&fixed);
+	isc_result_t result;
+	unsigned int rrs = 0;
+
+	result = dns_name_fromstring(owner, "www.example.com.", dns_rootname,
+				     0, NULL);
+	CHECKRESULT(result, "dns_name_fromstring");
+
+	for (unsigned int t = 0; t < 3; t++) {
+		dns_rdatalist_init(&rdatalist[t]);
+		rdatalist[t].rdclass = dns_rdataclass_in;
+		rdatalist[t].ttl = 300;
+	}
+	rdatalist[0].type = dns_rdatatype_a;
+	rdatalist[1].type = dns_rdatatype_aaaa;
+	rdatalist[2].type = dns_rdatatype_ns;
+
+	for (unsigned int i = 0; i < RENDER_RRS; i++) {
+		isc_region_t r;
+		int n;
+
+		a[i][0] = 192;
+		a[i][3] = i;
+		aaaa[i][0] = 0x20;
+		aaaa[i][1] = 0x01;
+		aaaa[i][15] = i;
+		n = snprintf((char *)ns[i], sizeof(ns[i]),
+			     "\003ns%u\007example\003com", i);
+
+		r = (isc_region_t){ .base = a[i], .length = sizeof(a[i]) };
+		dns_rdata_init(&rdata[0][i]);
+		dns_rdata_fromregion(&rdata[0][i], dns_rdataclass_in,
+				     dns_rdatatype_a, &r);
+		r = (isc_region_t){ .base = aaaa[i],
+				    .length = sizeof(aaaa[i]) };
+		dns_rdata_init(&rdata[1][i]);
+		dns_rdata_fromregion(&rdata[1][i], dns_rdataclass_in,
+				     dns_rdatatype_aaaa, &r);
+		r = (isc_region_t){ .base = ns[i], .length = n + 1 };
+		dns_rdata_init(&rdata[2][i]);
+		dns_rdata_fromregion(&rdata[2][i], dns_rdataclass_in,
+				     dns_rdatatype_ns, &r);
+
+		for (unsigned int t = 0; t < 3; t++) {
+			ISC_LIST_APPEND(rdatalist[t].rdata, &rdata[t][i],
+					link);
+		}
+	}
+
+	for (unsigned int t = 0; t < 3; t++) {
+		dns_rdataset_init(&rdataset[t]);
+		dns_rdatalist_tordataset(&rdatalist[t], &rdataset[t]);
+	}
+
+	unsigned int repeat = 100000;
+
+	isc_time_t start;
+	start = isc_time_now_hires();
+
+	for (unsigned int n = 0; n < repeat; n++) {
+		static uint8_t wire[4 * 1024];
+		dns_compress_t cctx;
+		isc_buffer_t buf;
+
+		isc_buffer_init(&buf, wire, sizeof(wire));
+		isc_buffer_add(&buf, 12); /* message header */
+		dns_compress_init(&cctx, isc_g_mctx, 0);
+		for (unsigned int t = 0; t < 3; t++) {
+			result = dns_rdataset_towire(&rdataset[t], owner,
+						     &cctx, &buf, 0, &rrs);
+			CHECKRESULT(result, "dns_rdataset_towire");
+		}
+		dns_compress_invalidate(&cctx);
+	}
+
+	isc_time_t finish;
+	finish = isc_time_now_hires();
+
+	uint64_t microseconds = isc_time_microdiff(&finish, &start);
+	printf("render time %f / %u\n", (double)microseconds / 1000000.0,
+	       repeat);
+	printf("render %f RRs / us\n", (double)rrs / (double)microseconds);
+
+	for (unsigned int t = 0; t < 3; t++) {
+		dns_rdataset_disassociate(&rdataset[t]);
+	}
+}
+
 int
 main(void) {
 	isc_result_t result;
@@ -97,5 +204,7 @@ main(void) {
 
 	printf("names %u\n", count);
 
+	render_bench();
+
 	return 0;
 }
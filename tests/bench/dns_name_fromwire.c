@@ -11,6 +11,7 @@
  * information regarding copyright ownership.
  */
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -93,6 +94,112 @@ oldnew_bench(const uint8_t *data, size_t size) {
 	printf("  old/new %f or %f\n", t01 / t12, t12 / t01);
 }
 
+/*
+ * Byte-at-a-time versions of dns_name_equal() and dns_name_rdatacompare(),
+ * to show what the vectorized case-insensitive comparisons gain.
+ */
+static bool
+old_equal(const dns_name_t *a, const dns_name_t *b) {
+	if (a->length != b->length) {
+		return false;
+	}
+	for (unsigned int i = 0; i < a->length; i++) {
+		if (isc_ascii_tolower(a->ndata[i]) !=
+		    isc_ascii_tolower(b->ndata[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static int
+old_compare(const dns_name_t *a, const dns_name_t *b) {
+	unsigned int len = ISC_MIN(a->length, b->length);
+	for (unsigned int i = 0; i < len; i++) {
+		int diff = isc_ascii_tolower(a->ndata[i]) -
+			   isc_ascii_tolower(b->ndata[i]);
+		if (diff != 0) {
+			return diff;
+		}
+	}
+	return 0;
+}
+
+#define CMPNAMES  1000
+#define CMPREPEAT 1000
+
+static void
+compare_bench(unsigned int labels, unsigned int label_len) {
+	static uint8_t wire[2][CMPNAMES][DNS_NAME_MAXWIRE];
+	static dns_name_t names[2][CMPNAMES];
+	uint32_t matches[4] = { 0 };
+	isc_time_t t[5];
+
+	for (unsigned int n = 0; n < CMPNAMES; n++) {
+		unsigned int p = 0;
+		for (unsigned int l = 0; l < labels; l++) {
+			wire[0][n][p] = wire[1][n][p] = label_len;
+			p++;
+			for (unsigned int c = 0; c < label_len; c++, p++) {
+				uint8_t ch = 'a' + isc_random_uniform(26);
+				wire[0][n][p] = ch;
+				wire[1][n][p] = isc_random_uniform(2) == 0
+							? ch
+							: isc_ascii_toupper(ch);
+			}
+		}
+		wire[0][n][p] = wire[1][n][p] = 0;
+		p++;
+		for (unsigned int i = 0; i < 2; i++) {
+			isc_region_t r = { .base = wire[i][n], .length = p };
+			dns_name_init(&names[i][n]);
+			dns_name_fromregion(&names[i][n], &r);
+		}
+	}
+
+	t[0] = isc_time_now_hires();
+	for (unsigned int r = 0; r < CMPREPEAT; r++) {
+		for (unsigned int n = 0; n < CMPNAMES; n++) {
+			matches[0] += old_equal(&names[0][n], &names[1][n]);
+		}
+	}
+	t[1] = isc_time_now_hires();
+	for (unsigned int r = 0; r < CMPREPEAT; r++) {
+		for (unsigned int n = 0; n < CMPNAMES; n++) {
+			matches[1] += dns_name_equal(&names[0][n],
+						     &names[1][n]);
+		}
+	}
+	t[2] = isc_time_now_hires();
+	for (unsigned int r = 0; r < CMPREPEAT; r++) {
+		for (unsigned int n = 0; n < CMPNAMES; n++) {
+			matches[2] += old_compare(&names[0][n],
+						  &names[1][n]) == 0;
+		}
+	}
+	t[3] = isc_time_now_hires();
+	for (unsigned int r = 0; r < CMPREPEAT; r++) {
+		for (unsigned int n = 0; n < CMPNAMES; n++) {
+			matches[3] += dns_name_rdatacompare(&names[0][n],
+							    &names[1][n]) == 0;
+		}
+	}
+	t[4] = isc_time_now_hires();
+
+	double d[4];
+	for (unsigned int i = 0; i < 4; i++) {
+		d[i] = (double)isc_time_microdiff(&t[i + 1], &t[i]);
+	}
+	printf("%u labels of %u octets, mixed case\n", labels, label_len);
+	printf("  equal   old %u / %f ms; new %u / %f ms; old/new %f\n",
+	       matches[0], d[0] / 1000.0, matches[1], d[1] / 1000.0,
+	       d[0] / d[1]);
+	printf("  compare old %u / %f ms; new %u / %f ms; old/new %f\n",
+	       matches[2], d[2] / 1000.0, matches[3], d[3] / 1000.0,
+	       d[2] / d[3]);
+}
+
 #define NAMES 1000
 static uint8_t buf[1024 * NAMES];
 
@@ -144,4 +251,8 @@ main(void) {
 	}
 	printf("4 long sequential labels\n");
 	oldnew_bench(buf, p);
+
+	compare_bench(3, 6);
+	compare_bench(4, 20);
+	compare_bench(4, 62);
 }
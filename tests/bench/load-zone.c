@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure zone loading speed in RR/s for the text format, and for the
+ * raw format with an increasing number of decoding threads.
+ *
+ * usage: load-zone [zonefile origin]
+ *
+ * Without arguments a synthetic zone is generated.  The raw file is
+ * written to the current directory and removed afterwards.
+ */
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <isc/buffer.h>
+#include <isc/lib.h>
+#include <isc/mem.h>
+#include <isc/os.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/callbacks.h>
+#include <dns/db.h>
+#include <dns/dbiterator.h>
+#include <dns/fixedname.h>
+#include <dns/lib.h>
+#include <dns/master.h>
+#include <dns/masterdump.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+#include <dns/rdatasetiter.h>
+
+#define SYNTHETIC_NAMES 500000
+
+static const char *textfile = "load-zone.tmp.db";
+static const char *rawfile = "load-zone.tmp.raw";
+
+static void
+CHECKRESULT(isc_result_t result, const char *msg) {
+	if (result != ISC_R_SUCCESS) {
+		printf("%s: %s\n", msg, isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+generate(const char *filename, const char *origin) {
+	FILE *f = fopen(filename, "w");
+	if (f == NULL) {
+		err(1, "fopen(%s)", filename);
+	}
+
+	fprintf(f, "$TTL 3600\n");
+	fprintf(f, "@ SOA ns.%s hostmaster.%s 1 3600 900 604800 300\n",
+		origin, origin);
+	fprintf(f, "@ NS ns.%s\n", origin);
+	fprintf(f, "ns A 192.0.2.1\n");
+	for (unsigned int i = 0; i < SYNTHETIC_NAMES; i++) {
+		fprintf(f, "name%u A 10.%u.%u.%u\n", i, (i >> 16) & 0xff,
+			(i >> 8) & 0xff, i & 0xff);
+		fprintf(f, "name%u A 10.%u.%u.%u\n", i,
+			((i >> 16) & 0xff) | 128, (i >> 8) & 0xff, i & 0xff);
+		fprintf(f, "name%u AAAA 2001:db8::%x:%x\n", i, i >> 16,
+			i & 0xffff);
+		fprintf(f, "name%u TXT \"record number %u\"\n", i, i);
+	}
+
+	if (fclose(f) != 0) {
+		err(1, "fclose(%s)", filename);
+	}
+}
+
+static uint64_t
+count_rrs(dns_db_t *db) {
+	dns_dbiterator_t *dbiter = NULL;
+	dns_dbversion_t *version = NULL;
+	uint64_t count = 0;
+	isc_result_t result;
+
+	dns_db_currentversion(db, &version);
+	result = dns_db_createiterator(db, 0, &dbiter);
+	CHECKRESULT(result, "dns_db_createiterator");
+
+	DNS_DBITERATOR_FOREACH (dbiter) {
+		dns_dbnode_t *node = NULL;
+		dns_rdatasetiter_t *rdsiter = NULL;
+
+		result = dns_dbiterator_current(dbiter, &node, NULL);
+		CHECKRESULT(result, "dns_dbiterator_current");
+		result = dns_db_allrdatasets(db, node, version, 0, 0, &rdsiter);
+		CHECKRESULT(result, "dns_db_allrdatasets");
+		DNS_RDATASETITER_FOREACH (rdsiter) {
+			dns_rdataset_t rdataset = DNS_RDATASET_INIT;
+			dns_rdatasetiter_current(rdsiter, &rdataset);
+			count += dns_rdataset_count(&rdataset);
+			dns_rdataset_disassociate(&rdataset);
+		}
+		dns_rdatasetiter_destroy(&rdsiter);
+		dns_db_detachnode(db, &node);
+	}
+
+	dns_dbiterator_destroy(&dbiter);
+	dns_db_closeversion(db, &version, false);
+
+	return count;
+}
+
+static dns_db_t *
+load(const dns_name_t *origin, const char *filename,
+     dns_masterformat_t format, unsigned int nthreads, uint64_t *usp) {
+	dns_rdatacallbacks_t callbacks;
+	dns_db_t *db = NULL;
+	isc_result_t result;
+	isc_time_t start, finish;
+
+	result = dns_db_create(isc_g_mctx, "qpzone", origin, dns_dbtype_zone,
+			       dns_rdataclass_in, 0, NULL, &db);
+	CHECKRESULT(result, "dns_db_create");
+
+	start = isc_time_now_hires();
+
+	dns_rdatacallbacks_init_stdio(&callbacks);
+	result = dns_db_beginload(db, &callbacks);
+	CHECKRESULT(result, "dns_db_beginload");
+	callbacks.nthreads = nthreads;
+
+	result = dns_master_loadfile(filename, UNCONST(origin),
+				     UNCONST(origin), dns_rdataclass_in, 0, 0,
+				     &callbacks, NULL, NULL, isc_g_mctx,
+				     format, 0);
+	CHECKRESULT(result, "dns_master_loadfile");
+
+	result = dns_db_endload(db, &callbacks);
+	CHECKRESULT(result, "dns_db_endload");
+
+	finish = isc_time_now_hires();
+	*usp = isc_time_microdiff(&finish, &start);
+
+	return db;
+}
+
+static void
+report(const char *format, unsigned int nthreads, uint64_t rrs, uint64_t us) {
+	printf("%6s | %7u | %10.3f | %12.0f\n", format, nthreads,
+	       (double)us / 1000000.0, (double)rrs * 1000000.0 / (double)us);
+	fflush(stdout);
+}
+
+int
+main(int argc, char *argv[]) {
+	const char *zonefile = NULL;
+	const char *origintext = "example.";
+	dns_fixedname_t fixed;
+	dns_name_t *origin = dns_fixedname_initname(&fixed);
+	dns_dbversion_t *version = NULL;
+	dns_db_t *db = NULL;
+	isc_buffer_t buf;
+	isc_result_t result;
+	unsigned int ncpus = isc_os_ncpus();
+	uint64_t rrs, us;
+
+	if (argc == 3) {
+		zonefile = argv[1];
+		origintext = argv[2];
+	} else if (argc != 1) {
+		fprintf(stderr, "usage: load-zone [zonefile origin]\n");
+		exit(EXIT_FAILURE);
+	} else {
+		zonefile = textfile;
+		generate(zonefile, origintext);
+	}
+
+	isc_buffer_constinit(&buf, origintext, strlen(origintext));
+	isc_buffer_add(&buf, strlen(origintext));
+	result = dns_name_fromtext(origin, &buf, dns_rootname, 0);
+	CHECKRESULT(result, origintext);
+
+	printf("%6s | %7s | %10s | %12s\n", "format", "threads", "seconds",
+	       "RR/s");
+	printf("------ | ------- | ---------- | ------------\n");
+
+	db = load(origin, zonefile, dns_masterformat_text, 1, &us);
+	rrs = count_rrs(db);
+	report("text", 1, rrs, us);
+
+	dns_db_currentversion(db, &version);
+	result = dns_master_dump(isc_g_mctx, db, version,
+				 &dns_master_style_default, rawfile,
+				 dns_masterformat_raw, NULL);
+	CHECKRESULT(result, "dns_master_dump(raw)");
+	dns_db_closeversion(db, &version, false);
+	dns_db_detach(&db);
+
+	for (unsigned int n = 1; n <= ncpus; n *= 2) {
+		db = load(origin, rawfile, dns_masterformat_raw, n, &us);
+		report("raw", n, rrs, us);
+		dns_db_detach(&db);
+	}
+
+	printf("\n%" PRIu64 " RRs\n", rrs);
+
+	(void)unlink(rawfile);
+	if (zonefile == textfile) {
+		(void)unlink(textfile);
+	}
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the cost of parsing and rendering a typical response with a
+ * message that is reused (reset) between iterations, as the server does
+ * for each client.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/buffer.h>
+#include <isc/lib.h>
+#include <isc/mem.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/compress.h>
+#include <dns/fixedname.h>
+#include <dns/lib.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+
+#define ANSWERS	    8
+#define AUTHORITIES 4
+#define REPEAT	    200000
+
+static void
+CHECKRESULT(isc_result_t result, const char *msg) {
+	if (result != ISC_R_SUCCESS) {
+		printf("%s: %s\n", msg, isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+addrrset(dns_message_t *msg, dns_section_t section, const char *owner,
+	 dns_rdatatype_t type, unsigned char *data, unsigned int length) {
+	dns_name_t *name = NULL;
+	dns_rdata_t *rdata = NULL;
+	dns_rdatalist_t *rdatalist = NULL;
+	dns_rdataset_t *rdataset = NULL;
+	isc_region_t r = { .base = data, .length = length };
+
+	dns_message_gettempname(msg, &name);
+	CHECKRESULT(dns_name_fromstring(name, owner, dns_rootname, 0, NULL),
+		    owner);
+
+	dns_message_gettemprdatalist(msg, &rdatalist);
+	rdatalist->rdclass = dns_rdataclass_in;
+	rdatalist->type = type;
+	rdatalist->ttl = 3600;
+
+	if (data != NULL) {
+		dns_message_gettemprdata(msg, &rdata);
+		dns_rdata_fromregion(rdata, dns_rdataclass_in, type, &r);
+		ISC_LIST_APPEND(rdatalist->rdata, rdata, link);
+	}
+
+	dns_message_gettemprdataset(msg, &rdataset);
+	dns_rdatalist_tordataset(rdatalist, rdataset);
+	if (section == DNS_SECTION_QUESTION) {
+		rdataset->attributes.question = true;
+	}
+
+	ISC_LIST_APPEND(name->list, rdataset, link);
+	dns_message_addname(msg, name, section);
+}
+
+static void
+build(dns_message_t *msg) {
+	static unsigned char ns[] = "\003ns1\007example\003com";
+	unsigned char a[4] = { 192, 0, 2, 0 };
+	char owner[DNS_NAME_FORMATSIZE];
+
+	msg->id = 0x1234;
+	msg->flags = DNS_MESSAGEFLAG_QR | DNS_MESSAGEFLAG_AA;
+	msg->opcode = dns_opcode_query;
+	msg->rdclass = dns_rdataclass_in;
+
+	addrrset(msg, DNS_SECTION_QUESTION, "www.example.com.",
+		 dns_rdatatype_a, NULL, 0);
+
+	for (unsigned int i = 0; i < ANSWERS; i++) {
+		snprintf(owner, sizeof(owner), "host%u.example.com.", i);
+		a[3] = i;
+		addrrset(msg, DNS_SECTION_ANSWER, owner, dns_rdatatype_a, a,
+			 sizeof(a));
+	}
+
+	for (unsigned int i = 0; i < AUTHORITIES; i++) {
+		snprintf(owner, sizeof(owner), "sub%u.example.com.", i);
+		addrrset(msg, DNS_SECTION_AUTHORITY, owner, dns_rdatatype_ns,
+			 ns, sizeof(ns));
+	}
+}
+
+static void
+render(dns_message_t *msg, isc_buffer_t *target) {
+	dns_compress_t cctx;
+
+	dns_compress_init(&cctx, isc_g_mctx, 0);
+	CHECKRESULT(dns_message_renderbegin(msg, &cctx, target),
+		    "dns_message_renderbegin");
+	for (dns_section_t s = DNS_SECTION_QUESTION; s < DNS_SECTION_MAX; s++)
+	{
+		CHECKRESULT(dns_message_rendersection(msg, s, 0),
+			    "dns_message_rendersection");
+	}
+	CHECKRESULT(dns_message_renderend(msg), "dns_message_renderend");
+	dns_compress_invalidate(&cctx);
+}
+
+int
+main(void) {
+	static unsigned char wire[4096];
+	static unsigned char out[4096];
+	dns_message_t *msg = NULL;
+	isc_buffer_t buf;
+	isc_time_t start, finish;
+	uint64_t parse, build_render;
+	size_t inuse;
+
+	dns_message_create(isc_g_mctx, DNS_MESSAGE_INTENTRENDER, &msg);
+	isc_buffer_init(&buf, wire, sizeof(wire));
+	build(msg);
+	render(msg, &buf);
+	dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+
+	printf("message %u bytes, %u answers, %u authorities\n",
+	       isc_buffer_usedlength(&buf), ANSWERS, AUTHORITIES);
+
+	start = isc_time_now_hires();
+	for (unsigned int n = 0; n < REPEAT; n++) {
+		isc_buffer_t source = buf;
+
+		isc_buffer_first(&source);
+		CHECKRESULT(dns_message_parse(msg, &source, 0),
+			    "dns_message_parse");
+		dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+	}
+	finish = isc_time_now_hires();
+	parse = isc_time_microdiff(&finish, &start);
+
+	dns_message_reset(msg, DNS_MESSAGE_INTENTRENDER);
+
+	start = isc_time_now_hires();
+	for (unsigned int n = 0; n < REPEAT; n++) {
+		isc_buffer_t target;
+
+		isc_buffer_init(&target, out, sizeof(out));
+		build(msg);
+		render(msg, &target);
+		dns_message_reset(msg, DNS_MESSAGE_INTENTRENDER);
+	}
+	finish = isc_time_now_hires();
+	build_render = isc_time_microdiff(&finish, &start);
+
+	inuse = isc_mem_inuse(isc_g_mctx);
+	dns_message_detach(&msg);
+
+	printf("parse + reset:  %0.3f us per message\n",
+	       (double)parse / REPEAT);
+	printf("build + render + reset: %0.3f us per message\n",
+	       (double)build_render / REPEAT);
+	printf("memory in use with one idle message: %zu bytes\n", inuse);
+
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure how statistics counters that are bumped by every loop scale
+ * with the number of loops: a single array of atomic counters shared by
+ * all threads, as isc_stats_create() statistics, against statistics
+ * created with isc_stats_create_perloop().
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/atomic.h>
+#include <isc/barrier.h>
+#include <isc/lib.h>
+#include <isc/mem.h>
+#include <isc/os.h>
+#include <isc/stats.h>
+#include <isc/thread.h>
+#include <isc/tid.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+/* Roughly what a query bumps: request, opcode, qtype, rcode, response */
+#define COUNTERS   64
+#define PERQUERY   5
+#define QUERIES	   2000000
+#define MAXTHREADS 256
+
+static isc_barrier_t barrier;
+static isc_atomic_statscounter_t shared[COUNTERS];
+static isc_stats_t *stats = NULL;
+
+static struct thread_s {
+	isc_thread_t thread;
+	isc_tid_t tid;
+	uint64_t usecs;
+} threads[MAXTHREADS];
+
+static void *
+thread_shared(void *arg0) {
+	struct thread_s *arg = arg0;
+
+	isc_barrier_wait(&barrier);
+
+	isc_time_t t0 = isc_time_now_hires();
+	for (size_t q = 0; q < QUERIES; q++) {
+		for (size_t c = 0; c < PERQUERY; c++) {
+			atomic_fetch_add_relaxed(
+				&shared[(q + c * 7) % COUNTERS], 1);
+		}
+	}
+	isc_time_t t1 = isc_time_now_hires();
+
+	arg->usecs = isc_time_microdiff(&t1, &t0);
+	return NULL;
+}
+
+static void *
+thread_stats(void *arg0) {
+	struct thread_s *arg = arg0;
+
+	isc__tid_init(arg->tid);
+	isc_barrier_wait(&barrier);
+
+	isc_time_t t0 = isc_time_now_hires();
+	for (size_t q = 0; q < QUERIES; q++) {
+		for (size_t c = 0; c < PERQUERY; c++) {
+			isc_stats_increment(stats, (q + c * 7) % COUNTERS);
+		}
+	}
+	isc_time_t t1 = isc_time_now_hires();
+
+	arg->usecs = isc_time_microdiff(&t1, &t0);
+	return NULL;
+}
+
+static void
+sum_dump(isc_statscounter_t counter, uint64_t val, void *arg) {
+	uint64_t *sum = arg;
+
+	UNUSED(counter);
+
+	*sum += val;
+}
+
+static double
+run(isc_threadfunc_t fn, size_t nthreads) {
+	uint64_t usecs = 0;
+
+	isc_barrier_init(&barrier, nthreads);
+
+	for (size_t i = 0; i < nthreads; i++) {
+		threads[i] = (struct thread_s){ .tid = i };
+		isc_thread_create(fn, &threads[i], &threads[i].thread);
+	}
+	for (size_t i = 0; i < nthreads; i++) {
+		isc_thread_join(threads[i].thread, NULL);
+		usecs = ISC_MAX(usecs, threads[i].usecs);
+	}
+
+	isc_barrier_destroy(&barrier);
+
+	/* nanoseconds per query, across all threads */
+	return (double)usecs * 1000.0 / ((double)QUERIES * nthreads);
+}
+
+int
+main(void) {
+	size_t maxthreads = ISC_MIN(isc_os_ncpus(), MAXTHREADS);
+
+	/* The slabs are sized when the statistics are created */
+	isc__tid_initcount(maxthreads);
+
+	printf("%d counters, %d bumped per query, %d queries per thread\n\n",
+	       COUNTERS, PERQUERY, QUERIES);
+	printf("%10s | %14s | %14s |\n", "threads", "shared ns/q",
+	       "isc_stats ns/q");
+	printf("---------- | -------------- | -------------- |\n");
+
+	for (size_t nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+		uint64_t sum = 0;
+		double ns_shared, ns_stats;
+
+		for (size_t i = 0; i < COUNTERS; i++) {
+			atomic_init(&shared[i], 0);
+		}
+		ns_shared = run(thread_shared, nthreads);
+
+		isc_stats_create_perloop(isc_g_mctx, &stats, COUNTERS);
+		ns_stats = run(thread_stats, nthreads);
+
+		isc_stats_dump(stats, sum_dump, &sum, 0);
+		INSIST(sum == (uint64_t)QUERIES * PERQUERY * nthreads);
+		isc_stats_detach(&stats);
+
+		printf("%10zu | %14.2f | %14.2f |\n", nthreads, ns_shared,
+		       ns_stats);
+	}
+
+	return 0;
+}
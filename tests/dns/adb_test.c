@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/lib.h>
+#include <isc/net.h>
+#include <isc/sockaddr.h>
+#include <isc/stdtime.h>
+#include <isc/util.h>
+
+#include <dns/adb.h>
+#include <dns/lib.h>
+#include <dns/view.h>
+
+#include <tests/dns.h>
+
+static void
+getaddr(dns_adb_t *adb, const char *text, dns_adbaddrinfo_t **addrp) {
+	isc_result_t result;
+	isc_sockaddr_t sa;
+	struct in_addr ina;
+
+	assert_int_equal(inet_pton(AF_INET, text, &ina), 1);
+	isc_sockaddr_fromin(&sa, &ina, 0);
+
+	result = dns_adb_findaddrinfo(adb, &sa, addrp, isc_stdtime_now());
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+/* dns_adb_snapshot() and dns_adb_restore() round trip */
+ISC_LOOP_TEST_IMPL(snapshot) {
+	isc_result_t result;
+	dns_view_t *view = NULL;
+	dns_adb_t *adb = NULL;
+	dns_adbaddrinfo_t *addr = NULL;
+	isc_buffer_t *b = NULL;
+	isc_buffer_t text;
+	uint64_t count = 0;
+
+	result = dns_test_makeview("view", false, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_adb_create(isc_g_mctx, view, &adb);
+
+	/* The 0x08 flag (no cookie) only makes sense to the running server */
+	getaddr(adb, "192.0.2.1", &addr);
+	dns_adb_adjustsrtt(adb, addr, 123450, DNS_ADB_RTTADJREPLACE);
+	dns_adb_changeflags(adb, addr, 0x48, 0xff);
+	dns_adb_setudpsize(adb, addr, 1400);
+	dns_adb_freeaddrinfo(adb, &addr);
+
+	dns_adb_snapshot(adb, &b, &count);
+	assert_non_null(b);
+	assert_int_equal(count, 1);
+
+	dns_adb_shutdown(adb);
+	dns_adb_detach(&adb);
+
+	/* Restore into a new, empty ADB */
+	dns_adb_create(isc_g_mctx, view, &adb);
+
+	result = dns_adb_restore(adb, b, &count);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(count, 1);
+
+	getaddr(adb, "192.0.2.1", &addr);
+	assert_int_equal(addr->srtt, 123450);
+	assert_int_equal(addr->flags & 0xff, 0x40);
+	assert_int_equal(dns_adb_getudpsize(adb, addr), 1400);
+	dns_adb_freeaddrinfo(adb, &addr);
+
+	/* A truncated snapshot is rejected */
+	isc_buffer_first(b);
+	isc_buffer_subtract(b, 1);
+	result = dns_adb_restore(adb, b, &count);
+	assert_int_equal(result, ISC_R_UNEXPECTEDEND);
+	isc_buffer_free(&b);
+
+	/* A buffer that is not a snapshot is rejected */
+	isc_buffer_constinit(&text, "not a snapshot, just some text", 30);
+	isc_buffer_add(&text, 30);
+	result = dns_adb_restore(adb, &text, &count);
+	assert_int_equal(result, ISC_R_NOTIMPLEMENTED);
+
+	dns_adb_shutdown(adb);
+	dns_adb_detach(&adb);
+	dns_view_detach(&view);
+
+	isc_loopmgr_shutdown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(snapshot, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
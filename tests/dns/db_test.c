@@ -26,6 +26,7 @@
 
 #include <dns/db.h>
 #include <dns/dbiterator.h>
+#include <dns/ecs.h>
 #include <dns/journal.h>
 #include <dns/lib.h>
 #include <dns/name.h>
@@ -242,6 +243,278 @@ ISC_LOOP_TEST_IMPL(dns_dbfind_staleok) {
 	isc_loopmgr_shutdown();
 }
 
+static isc_result_t
+ecs_sourceip(dns_clientinfo_t *ci, isc_sockaddr_t **addrp) {
+	*addrp = ci->data;
+	return ISC_R_SUCCESS;
+}
+
+static isc_result_t
+ecs_find(dns_db_t *db, const dns_name_t *name, const char *addr,
+	 unsigned int options, dns_rdataset_t *rdataset) {
+	dns_clientinfomethods_t cm;
+	dns_clientinfo_t ci;
+	isc_sockaddr_t sa;
+	struct in_addr in;
+	isc_result_t result;
+
+	assert_int_equal(inet_pton(AF_INET, addr, &in), 1);
+	isc_sockaddr_fromin(&sa, &in, 53);
+
+	dns_clientinfomethods_init(&cm, ecs_sourceip);
+	dns_clientinfo_init(&ci, &sa, NULL);
+
+	result = dns_db_findext(db, name, NULL, dns_rdatatype_a, options, 0,
+				NULL, NULL, &cm, &ci, rdataset, NULL);
+	if (dns_rdataset_isassociated(rdataset)) {
+		dns_rdataset_disassociate(rdataset);
+	}
+	return result;
+}
+
+/* client subnet scoped cache data */
+ISC_LOOP_TEST_IMPL(ecs_scoped) {
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_fixedname_t example_fixed;
+	dns_name_t *example = NULL;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	isc_netaddr_t netaddr;
+	struct in_addr in;
+	dns_ecs_t ecs;
+	isc_result_t result;
+	unsigned char data[] = { 0x0a, 0x00, 0x00, 0x01 };
+
+	result = dns_db_create(isc_g_mctx, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	example = dns_fixedname_initname(&example_fixed);
+	result = dns_name_fromstring(example, "example", dns_rootname, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rdata.data = data;
+	rdata.length = 4;
+	rdata.rdclass = dns_rdataclass_in;
+	rdata.type = dns_rdatatype_a;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.ttl = 300;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.rdclass = dns_rdataclass_in;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+
+	/* 192.0.2.0/24, scope 24 */
+	assert_int_equal(inet_pton(AF_INET, "192.0.2.77", &in), 1);
+	isc_netaddr_fromin(&netaddr, &in);
+	dns_ecs_fromnetaddr(&ecs, &netaddr, 24);
+	ecs.scope = 24;
+
+	result = dns_db_findnode(db, example, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addecsrdataset(db, node, 0, &ecs, &rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+	dns_rdataset_disassociate(&rdataset);
+
+	/* Visible to clients in the subnet only. */
+	result = ecs_find(db, example, "192.0.2.1", 0, &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = ecs_find(db, example, "192.0.3.1", 0, &rdataset);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+	result = dns_db_find(db, example, NULL, dns_rdatatype_a, 0, 0, NULL,
+			     NULL, &rdataset, NULL);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+
+	/* Flushing the name removes the scoped data as well. */
+	result = dns_db_findnode(db, example, false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_deleterdataset(db, node, NULL, dns_rdatatype_any, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+
+	result = ecs_find(db, example, "192.0.2.1", 0, &rdataset);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown();
+}
+
+/* client subnet scoped cache data which has not been validated yet */
+ISC_LOOP_TEST_IMPL(ecs_pending) {
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_fixedname_t example_fixed;
+	dns_name_t *example = NULL;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	isc_netaddr_t netaddr;
+	struct in_addr in;
+	dns_ecs_t ecs;
+	isc_result_t result;
+	unsigned char data[] = { 0x0a, 0x00, 0x00, 0x01 };
+
+	result = dns_db_create(isc_g_mctx, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	example = dns_fixedname_initname(&example_fixed);
+	result = dns_name_fromstring(example, "example", dns_rootname, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rdata.data = data;
+	rdata.length = 4;
+	rdata.rdclass = dns_rdataclass_in;
+	rdata.type = dns_rdatatype_a;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.ttl = 300;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.rdclass = dns_rdataclass_in;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	rdataset.trust = dns_trust_pending_answer;
+
+	/* 192.0.2.0/24, scope 24 */
+	assert_int_equal(inet_pton(AF_INET, "192.0.2.77", &in), 1);
+	isc_netaddr_fromin(&netaddr, &in);
+	dns_ecs_fromnetaddr(&ecs, &netaddr, 24);
+	ecs.scope = 24;
+
+	result = dns_db_findnode(db, example, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addecsrdataset(db, node, 0, &ecs, &rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+	dns_rdataset_disassociate(&rdataset);
+
+	/* Only a caller accepting pending data gets it. */
+	result = ecs_find(db, example, "192.0.2.1", 0, &rdataset);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+	result = ecs_find(db, example, "192.0.2.1", DNS_DBFIND_GLUEOK,
+			  &rdataset);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+	result = ecs_find(db, example, "192.0.2.1", DNS_DBFIND_PENDINGOK,
+			  &rdataset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown();
+}
+
+/* cache snapshots */
+ISC_LOOP_TEST_IMPL(snapshot) {
+	const char *filename = "db_test.snapshot";
+	dns_db_t *db = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_fixedname_t fixed;
+	dns_name_t *name = NULL;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	isc_stdtime_t now = isc_stdtime_now();
+	uint64_t count = 0;
+	FILE *fp = NULL;
+	isc_result_t result;
+	unsigned char data[] = { 0x0a, 0x00, 0x00, 0x01 };
+
+	result = dns_db_create(isc_g_mctx, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rdata.data = data;
+	rdata.length = 4;
+	rdata.rdclass = dns_rdataclass_in;
+	rdata.type = dns_rdatatype_a;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.ttl = 300;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.rdclass = dns_rdataclass_in;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	/* One live and one expired rdataset. */
+	name = dns_fixedname_initname(&fixed);
+	result = dns_name_fromstring(name, "live.example", dns_rootname, 0,
+				     NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findnode(db, name, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db, &node);
+
+	result = dns_name_fromstring(name, "expired.example", dns_rootname, 0,
+				     NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findnode(db, name, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	result = dns_db_addrdataset(db, node, NULL, now - 600, &rdataset, 0,
+				    NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db, &node);
+
+	fp = fopen(filename, "wb");
+	assert_non_null(fp);
+	result = dns_db_savesnapshot(db, fp, &count);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(fclose(fp), 0);
+	assert_int_equal(count, 1);
+	dns_db_detach(&db);
+
+	/* Restore into a new cache. */
+	result = dns_db_create(isc_g_mctx, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	count = 0;
+	result = dns_db_loadsnapshot(db, filename, 2, &count);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(count, 1);
+
+	result = dns_name_fromstring(name, "live.example", dns_rootname, 0,
+				     NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_find(db, name, NULL, dns_rdatatype_a, 0, now, NULL,
+			     NULL, &rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(rdataset.ttl, 300);
+	dns_rdataset_disassociate(&rdataset);
+
+	result = dns_name_fromstring(name, "expired.example", dns_rootname, 0,
+				     NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_find(db, name, NULL, dns_rdatatype_a, 0, now, NULL,
+			     NULL, &rdataset, NULL);
+	assert_int_not_equal(result, ISC_R_SUCCESS);
+
+	/* A truncated snapshot is rejected. */
+	assert_int_equal(truncate(filename, 20), 0);
+	result = dns_db_loadsnapshot(db, filename, 1, &count);
+	assert_int_equal(result, ISC_R_UNEXPECTEDEND);
+
+	(void)unlink(filename);
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown();
+}
+
 /* database class */
 ISC_LOOP_TEST_IMPL(class) {
 	isc_result_t result;
@@ -392,6 +665,9 @@ ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(getoriginnode, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(getsetservestalettl, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(dns_dbfind_staleok, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(ecs_scoped, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(ecs_pending, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(snapshot, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(class, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(dbtype, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(version, setup_managers, teardown_managers)
@@ -132,8 +132,56 @@ ISC_RUN_TEST_IMPL(dns_diff_size) {
 	}
 }
 
+ISC_RUN_TEST_IMPL(dns_diff_move) {
+	dns_diff_t source, target;
+	dns_diff_init(isc_g_mctx, &source);
+	dns_diff_init(isc_g_mctx, &target);
+
+	dns_rdata_t rdatas[3] = { 0 };
+	unsigned char bufs[sizeof(rdatas) / sizeof(*rdatas)][128] = { 0 };
+	size_t buf_len = sizeof(bufs[0]);
+
+	for (size_t idx = 0; idx < sizeof(rdatas) / sizeof(*rdatas); ++idx) {
+		prepare_rdata(&rdatas[idx], bufs[idx], buf_len);
+	}
+
+	dns_difftuple_t *tup_1 = NULL, *tup_2 = NULL, *tup_3 = NULL;
+	dns_difftuple_create(isc_g_mctx, DNS_DIFFOP_ADD, &name_1, 1, &rdatas[0],
+			     &tup_1);
+	dns_difftuple_create(isc_g_mctx, DNS_DIFFOP_ADD, &name_2, 1, &rdatas[1],
+			     &tup_2);
+	dns_difftuple_create(isc_g_mctx, DNS_DIFFOP_ADD, &name_3, 1, &rdatas[2],
+			     &tup_3);
+
+	/* Moving an empty diff */
+	dns_diff_move(&target, &source);
+	assert_true(dns_diff_size(&target) == 0);
+	assert_true(dns_diff_size(&source) == 0);
+
+	dns_diff_append(&source, &tup_1);
+	dns_diff_append(&source, &tup_2);
+	dns_diff_move(&target, &source);
+	assert_true(dns_diff_size(&source) == 0);
+	assert_true(dns_diff_size(&source) == count_elements(&source));
+	assert_true(dns_diff_size(&target) == 2);
+	assert_true(dns_diff_size(&target) == count_elements(&target));
+
+	/* The tuples are appended to the target */
+	dns_diff_append(&source, &tup_3);
+	dns_diff_move(&target, &source);
+	assert_true(dns_diff_size(&source) == 0);
+	assert_true(dns_diff_size(&target) == 3);
+	assert_true(dns_diff_size(&target) == count_elements(&target));
+	assert_true(dns_name_equal(&ISC_LIST_TAIL(target.tuples)->name,
+				   &name_3));
+
+	dns_diff_clear(&target);
+	assert_true(dns_diff_size(&target) == 0);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(dns_diff_size)
+ISC_TEST_ENTRY(dns_diff_move)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -865,6 +865,268 @@ ISC_LOOP_TEST_IMPL(dispatch_newtcp) {
 	dns_dispatch_connect(test->dispentry);
 }
 
+/*
+ * Pooled UDP dispatches: the queries are sent through unconnected
+ * sockets shared by the dispatch entries, and the responses are matched
+ * by the QID, the peer address and the local port.
+ */
+#define POOL_ID 0x1234
+
+static isc_nmhandle_t *spoof_handle = NULL;
+static unsigned char pool_replies[6][16];
+static unsigned int pool_nreplies = 0;
+static unsigned int pool_responses = 0;
+static test_dispatch_t *pool_tests[3];
+static unsigned int pool_connects = 0;
+static isc_sockaddr_t fixed_addr;
+
+static void
+server_sendtodone(isc_nmhandle_t *handle, isc_result_t eresult ISC_ATTR_UNUSED,
+		  void *arg ISC_ATTR_UNUSED) {
+	isc_nmhandle_t *sendhandle = handle;
+
+	isc_nmhandle_detach(&sendhandle);
+}
+
+/*
+ * Build an answer to 'query' with the given ID, which carries the source
+ * port of the query and whether it is the genuine answer.
+ */
+static isc_region_t
+pool_reply(isc_region_t *query, uint16_t id, in_port_t port, bool genuine) {
+	unsigned char *buf = NULL;
+
+	assert_true(pool_nreplies < ARRAY_SIZE(pool_replies));
+	buf = pool_replies[pool_nreplies++];
+
+	memmove(buf, query->base, 12);
+	buf[0] = id >> 8;
+	buf[1] = id & 0xff;
+	buf[2] |= 0x80; /* qr=1 */
+	buf[12] = port >> 8;
+	buf[13] = port & 0xff;
+	buf[14] = genuine;
+	buf[15] = 0;
+
+	return (isc_region_t){ .base = buf, .length = 16 };
+}
+
+/*
+ * Answer every query with the wrong ID first, then with the right ID
+ * from a different address, and only then with the genuine answer.
+ */
+static void
+pool_nameserver(isc_nmhandle_t *handle, isc_result_t eresult,
+		isc_region_t *region, void *arg ISC_ATTR_UNUSED) {
+	isc_region_t response;
+	isc_sockaddr_t peer;
+	in_port_t port;
+	uint16_t id;
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	assert_true(region->length >= 12);
+
+	peer = isc_nmhandle_peeraddr(handle);
+	port = isc_sockaddr_getport(&peer);
+	id = (region->base[0] << 8) | region->base[1];
+
+	response = pool_reply(region, id ^ 0x0101, port, false);
+	isc_nm_send(handle, &response, server_senddone, NULL);
+
+	response = pool_reply(region, id, port, false);
+	isc_nm_udpsendto(spoof_handle, &peer, &response, server_sendtodone,
+			 NULL);
+
+	response = pool_reply(region, id, port, true);
+	isc_nm_send(handle, &response, server_senddone, NULL);
+}
+
+static void
+pool_response(isc_result_t eresult, isc_region_t *region, void *arg) {
+	test_dispatch_t *test = arg;
+	isc_sockaddr_t local;
+	isc_result_t result;
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+	assert_int_equal(region->length, 16);
+
+	/* Only the genuine answer, sent to our own port, gets through */
+	assert_int_equal((region->base[0] << 8) | region->base[1], test->id);
+	result = dns_dispentry_getlocaladdress(test->dispentry, &local);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal((region->base[12] << 8) | region->base[13],
+			 isc_sockaddr_getport(&local));
+	assert_int_equal(region->base[14], 1);
+
+	test_dispatch_done(test);
+
+	if (++pool_responses == 2) {
+		isc_nmhandle_detach(&spoof_handle);
+		isc_loopmgr_shutdown();
+	}
+}
+
+ISC_LOOP_TEST_IMPL(dispatch_udp_pool_response) {
+	isc_result_t result;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+
+	UNUSED(arg);
+
+	pool_nreplies = 0;
+	pool_responses = 0;
+
+	/* Server */
+	result = isc_nm_listenudp(ISC_NM_LISTEN_ONE, &udp_server_addr,
+				  pool_nameserver, NULL, &sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_loop_teardown(isc_loop_main(), stop_listening, sock);
+
+	/* The same server address, but a different port */
+	result = isc_nm_udpbind(&udp_connect_addr, noop_nameserver, NULL,
+				&spoof_handle);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Client */
+	testdata.region.base = testdata.message;
+	testdata.region.length = sizeof(testdata.message);
+	testdata.message[0] = POOL_ID >> 8;
+	testdata.message[1] = POOL_ID & 0xff;
+
+	result = dns_dispatchmgr_create(isc_g_mctx, &dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_dispatchmgr_setudppool(dispatchmgr, 1);
+
+	/*
+	 * Two dispatches with a shared socket each send a query with the
+	 * same ID to the same server; only the local port tells their
+	 * responses apart.
+	 */
+	for (size_t i = 0; i < 2; i++) {
+		test_dispatch_t *test = isc_mem_get(isc_g_mctx, sizeof(*test));
+		*test = (test_dispatch_t){
+			.dispatchmgr = dns_dispatchmgr_ref(dispatchmgr),
+			.id = POOL_ID,
+		};
+
+		result = dns_dispatch_createudp(test->dispatchmgr,
+						&udp_connect_addr,
+						&test->dispatch);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		result = dns_dispatch_add(
+			test->dispatch, isc_loop_main(),
+			DNS_DISPATCHOPT_FIXEDID, T_CLIENT_CONNECT,
+			T_CLIENT_INIT, &udp_server_addr, NULL, NULL, connected,
+			client_senddone, pool_response, test, &test->id,
+			&test->dispentry);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(test->id, POOL_ID);
+
+		dns_dispatch_connect(test->dispentry);
+	}
+
+	dns_dispatchmgr_detach(&dispatchmgr);
+}
+
+static void
+pool_connected(isc_result_t eresult, isc_region_t *region ISC_ATTR_UNUSED,
+	       void *arg ISC_ATTR_UNUSED) {
+	isc_sockaddr_t local[ARRAY_SIZE(pool_tests)];
+	isc_result_t result;
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	if (++pool_connects < ARRAY_SIZE(pool_tests)) {
+		return;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(pool_tests); i++) {
+		result = dns_dispentry_getlocaladdress(pool_tests[i]->dispentry,
+						       &local[i]);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	/* The entries of the pooled dispatch share its only socket */
+	assert_int_equal(isc_sockaddr_getport(&local[0]),
+			 isc_sockaddr_getport(&local[1]));
+
+	/* The dispatch with a fixed port doesn't use the pool */
+	assert_int_equal(isc_sockaddr_getport(&local[2]),
+			 isc_sockaddr_getport(&fixed_addr));
+
+	for (size_t i = 0; i < ARRAY_SIZE(pool_tests); i++) {
+		test_dispatch_done(pool_tests[i]);
+	}
+
+	isc_loopmgr_shutdown();
+}
+
+ISC_LOOP_TEST_IMPL(dispatch_udp_pool_port) {
+	isc_result_t result;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+	uv_os_sock_t socket = -1;
+
+	UNUSED(arg);
+
+	pool_connects = 0;
+
+	fixed_addr = (isc_sockaddr_t){ .length = 0 };
+	socket = setup_ephemeral_port(&fixed_addr, SOCK_DGRAM);
+	assert_true(socket >= 0);
+	close(socket);
+
+	result = dns_dispatchmgr_create(isc_g_mctx, &dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_dispatchmgr_setudppool(dispatchmgr, 1);
+
+	for (size_t i = 0; i < ARRAY_SIZE(pool_tests); i++) {
+		test_dispatch_t *test = isc_mem_get(isc_g_mctx, sizeof(*test));
+		*test = (test_dispatch_t){
+			.dispatchmgr = dns_dispatchmgr_ref(dispatchmgr),
+		};
+
+		/* The first two entries use the same pooled dispatch */
+		switch (i) {
+		case 0:
+			result = dns_dispatch_createudp(test->dispatchmgr,
+							&udp_connect_addr,
+							&test->dispatch);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			break;
+		case 1:
+			dns_dispatch_attach(pool_tests[0]->dispatch,
+					    &test->dispatch);
+			break;
+		default:
+			result = dns_dispatch_createudp(test->dispatchmgr,
+							&fixed_addr,
+							&test->dispatch);
+			assert_int_equal(result, ISC_R_SUCCESS);
+		}
+
+		result = dns_dispatch_add(
+			test->dispatch, isc_loop_main(), 0, T_CLIENT_CONNECT,
+			T_CLIENT_INIT, &udp_server_addr, NULL, NULL,
+			pool_connected, client_senddone, response_noop, test,
+			&test->id, &test->dispentry);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		pool_tests[i] = test;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(pool_tests); i++) {
+		dns_dispatch_connect(pool_tests[i]->dispentry);
+	}
+
+	dns_dispatchmgr_detach(&dispatchmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(dispatch_gettcp, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_newtcp, setup_test, teardown_test)
@@ -876,6 +1138,8 @@ ISC_TEST_ENTRY_CUSTOM(dispatch_timeout_tcp_connect, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_tcp_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_tls_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_getnext, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(dispatch_udp_pool_response, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(dispatch_udp_pool_port, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
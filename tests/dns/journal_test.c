@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/file.h>
+#include <isc/lib.h>
+#include <isc/util.h>
+
+#include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/journal.h>
+#include <dns/lib.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+
+#include <tests/dns.h>
+
+#define JOURNAL "journal_test.jnl"
+
+/* The journal holds the transactions from serial FIRST to FIRST + COUNT */
+#define FIRST 4294967200U /* wraps around */
+#define COUNT 200
+
+static void
+addtuple(dns_diff_t *diff, dns_diffop_t op, const char *owner,
+	 dns_rdatatype_t type, const char *text) {
+	dns_fixedname_t fname;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	unsigned char buf[1024];
+	dns_difftuple_t *tuple = NULL;
+	isc_result_t result;
+
+	dns_fixedname_init(&fname);
+	result = dns_test_namefromstring(owner, &fname);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_test_rdatafromstring(&rdata, dns_rdataclass_in, type, buf,
+					  sizeof(buf), text, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_difftuple_create(isc_g_mctx, op, dns_fixedname_name(&fname), 300,
+			     &rdata, &tuple);
+	dns_diff_append(diff, &tuple);
+}
+
+static void
+addsoa(dns_diff_t *diff, dns_diffop_t op, uint32_t serial) {
+	char text[256];
+
+	snprintf(text, sizeof(text),
+		 "ns.example. hostmaster.example. %u 3600 600 86400 300",
+		 serial);
+	addtuple(diff, op, "example.", dns_rdatatype_soa, text);
+}
+
+static int
+setup(void **state ISC_ATTR_UNUSED) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+
+	(void)isc_file_remove(JOURNAL);
+
+	result = dns_journal_open(isc_g_mctx, JOURNAL, DNS_JOURNAL_CREATE, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (uint32_t i = 0; i < COUNT; i++) {
+		dns_diff_t diff;
+		char owner[64], address[64];
+
+		dns_diff_init(isc_g_mctx, &diff);
+
+		snprintf(owner, sizeof(owner), "host%u.example.", i);
+		snprintf(address, sizeof(address), "10.0.%u.%u", i / 256,
+			 i % 256);
+
+		addsoa(&diff, DNS_DIFFOP_DEL, FIRST + i);
+		addsoa(&diff, DNS_DIFFOP_ADD, FIRST + i + 1);
+		addtuple(&diff, DNS_DIFFOP_ADD, owner, dns_rdatatype_a,
+			 address);
+
+		result = dns_journal_write_transaction(j, &diff);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		dns_diff_clear(&diff);
+	}
+
+	dns_journal_destroy(&j);
+
+	return 0;
+}
+
+static int
+teardown(void **state ISC_ATTR_UNUSED) {
+	(void)isc_file_remove(JOURNAL);
+
+	return 0;
+}
+
+/*
+ * Iterate over the journal from 'begin' to its end, and check the RRs.
+ */
+static void
+iterate(dns_journal_t *j, uint32_t begin) {
+	uint32_t end = FIRST + COUNT;
+	unsigned int nrr = 0;
+	size_t size = 0;
+	isc_result_t result;
+
+	/* The IXFR size is only asked for when the serials differ */
+	result = dns_journal_iter_init(j, begin, end,
+				       begin != end ? &size : NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (result = dns_journal_first_rr(j); result == ISC_R_SUCCESS;
+	     result = dns_journal_next_rr(j))
+	{
+		dns_name_t *name = NULL;
+		dns_rdata_t *rdata = NULL;
+		uint32_t ttl;
+
+		dns_journal_current_rr(j, &name, &ttl, &rdata);
+		assert_int_equal(ttl, 300);
+
+		/* Each transaction is SOA, SOA, A */
+		if (nrr % 3 == 2) {
+			assert_int_equal(rdata->type, dns_rdatatype_a);
+		} else {
+			assert_int_equal(rdata->type, dns_rdatatype_soa);
+		}
+		nrr++;
+	}
+	assert_int_equal(result, ISC_R_NOMORE);
+	assert_int_equal(nrr, 3 * (end - begin));
+	assert_int_equal(size == 0, begin == end);
+}
+
+static void
+check(unsigned int mode) {
+	dns_journal_t *j = NULL;
+	isc_result_t result;
+
+	result = dns_journal_open(isc_g_mctx, JOURNAL, mode, &j);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	assert_int_equal(dns_journal_first_serial(j), FIRST);
+	assert_int_equal(dns_journal_last_serial(j), FIRST + COUNT);
+
+	iterate(j, FIRST);
+	iterate(j, FIRST + 1);
+	iterate(j, FIRST + COUNT / 2);
+	iterate(j, FIRST + COUNT - 1);
+	iterate(j, FIRST + COUNT);
+
+	/* Serials between and before the ones already looked for */
+	iterate(j, FIRST + COUNT / 4);
+	iterate(j, FIRST + 3 * COUNT / 4);
+	iterate(j, FIRST + COUNT / 4 - 1);
+	iterate(j, FIRST + COUNT / 2);
+
+	/* Out of range */
+	result = dns_journal_iter_init(j, FIRST - 1, FIRST + COUNT, NULL);
+	assert_int_equal(result, ISC_R_RANGE);
+	result = dns_journal_iter_init(j, FIRST, FIRST + COUNT + 1, NULL);
+	assert_int_equal(result, ISC_R_RANGE);
+
+	dns_journal_destroy(&j);
+}
+
+/* Read the journal from the file */
+ISC_RUN_TEST_IMPL(dns_journal_read) {
+	check(DNS_JOURNAL_READ);
+}
+
+/* Read the journal mapped in memory */
+ISC_RUN_TEST_IMPL(dns_journal_map) {
+	check(DNS_JOURNAL_READ | DNS_JOURNAL_MAP);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(dns_journal_read, setup, teardown)
+ISC_TEST_ENTRY_CUSTOM(dns_journal_map, setup, teardown)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/lib.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/dnssec.h>
+#include <dns/fixedname.h>
+#include <dns/keycache.h>
+#include <dns/lib.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+
+#include <dst/dst.h>
+
+#include <tests/dns.h>
+
+#define KEY1 "256 3 15 zyiLjDymEPN90rwi/y0mWXLnUm0Nq7T9Kc8VoubF2Io="
+#define KEY2 "256 3 15 ZLlkI5q8XDkP3D7Zxdbmuqh4yp90mbvdcNT0xSGLDtI="
+
+static void
+makekey(const char *namestr, const char *keystr, dns_fixedname_t *fname,
+	dns_rdata_t *rdata, unsigned char *buf, size_t buflen,
+	dst_key_t **keyp) {
+	isc_result_t result;
+
+	dns_test_namefromstring(namestr, fname);
+	result = dns_test_rdatafromstring(rdata, dns_rdataclass_in,
+					  dns_rdatatype_dnskey, buf, buflen,
+					  keystr, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	if (keyp != NULL) {
+		result = dns_dnssec_keyfromrdata(dns_fixedname_name(fname),
+						 rdata, isc_g_mctx, keyp);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+}
+
+ISC_LOOP_TEST_IMPL(basic) {
+	dns_keycache_t *kc = NULL;
+	dns_fixedname_t fname1, fname2;
+	dns_rdata_t rdata1 = DNS_RDATA_INIT, rdata2 = DNS_RDATA_INIT;
+	unsigned char buf1[1024], buf2[1024];
+	dst_key_t *key = NULL, *found = NULL;
+	isc_result_t result;
+
+	makekey("example.", KEY1, &fname1, &rdata1, buf1, sizeof(buf1), &key);
+	makekey("example.", KEY2, &fname2, &rdata2, buf2, sizeof(buf2), NULL);
+
+	kc = dns_keycache_new(isc_g_mctx, DNS_KEYCACHE_SIZE);
+
+	result = dns_keycache_find(kc, dns_fixedname_name(&fname1), &rdata1,
+				   &found);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+	assert_null(found);
+
+	dns_keycache_add(kc, dns_fixedname_name(&fname1), &rdata1, key);
+
+	/* The very same key is shared */
+	result = dns_keycache_find(kc, dns_fixedname_name(&fname1), &rdata1,
+				   &found);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_ptr_equal(found, key);
+	dst_key_free(&found);
+
+	/* The owner name is case insensitive */
+	dns_test_namefromstring("EXAMPLE.", &fname2);
+	result = dns_keycache_find(kc, dns_fixedname_name(&fname2), &rdata1,
+				   &found);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_ptr_equal(found, key);
+	dst_key_free(&found);
+
+	/* ...but it has to match */
+	dns_test_namefromstring("example.com.", &fname2);
+	result = dns_keycache_find(kc, dns_fixedname_name(&fname2), &rdata1,
+				   &found);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* So does the key */
+	result = dns_keycache_find(kc, dns_fixedname_name(&fname1), &rdata2,
+				   &found);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* Adding the same key twice keeps the first one */
+	dns_keycache_add(kc, dns_fixedname_name(&fname1), &rdata1, key);
+	dst_key_free(&key);
+
+	result = dns_keycache_find(kc, dns_fixedname_name(&fname1), &rdata1,
+				   &found);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dst_key_free(&found);
+
+	dns_keycache_destroy(&kc);
+	assert_null(kc);
+
+	isc_loopmgr_shutdown();
+}
+
+ISC_LOOP_TEST_IMPL(evict) {
+	dns_keycache_t *kc = NULL;
+	dns_fixedname_t fname;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	unsigned char buf[1024];
+	char namestr[DNS_NAME_FORMATSIZE];
+	dst_key_t *key = NULL, *found = NULL;
+	size_t nloops = ISC_MAX(isc_loopmgr_nloops(), 1);
+	size_t nfound = 0;
+	isc_result_t result;
+
+	/* One key per list */
+	kc = dns_keycache_new(isc_g_mctx, nloops);
+
+	for (size_t i = 0; i < 64; i++) {
+		snprintf(namestr, sizeof(namestr), "example%zu.", i);
+		dns_rdata_reset(&rdata);
+		makekey(namestr, KEY1, &fname, &rdata, buf, sizeof(buf), &key);
+		dns_keycache_add(kc, dns_fixedname_name(&fname), &rdata, key);
+		dst_key_free(&key);
+	}
+
+	for (size_t i = 0; i < 64; i++) {
+		snprintf(namestr, sizeof(namestr), "example%zu.", i);
+		dns_rdata_reset(&rdata);
+		makekey(namestr, KEY1, &fname, &rdata, buf, sizeof(buf), NULL);
+		result = dns_keycache_find(kc, dns_fixedname_name(&fname),
+					   &rdata, &found);
+		if (result == ISC_R_SUCCESS) {
+			dst_key_free(&found);
+			nfound++;
+		}
+	}
+
+	/* The last key added is always there */
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(nfound >= 1);
+	assert_true(nfound <= nloops);
+
+	dns_keycache_destroy(&kc);
+
+	isc_loopmgr_shutdown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(basic, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(evict, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -19,12 +19,14 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define UNIT_TESTING
 #include <cmocka.h>
 
 #include <isc/dir.h>
+#include <isc/file.h>
 #include <isc/lib.h>
 #include <isc/string.h>
 #include <isc/util.h>
@@ -509,6 +511,121 @@ ISC_RUN_TEST_IMPL(dumpraw) {
 	dns_db_detach(&db);
 }
 
+static void
+load_threaded(dns_db_t *db, const char *filename, dns_masterformat_t format,
+	      isc_result_t expect) {
+	dns_rdatacallbacks_t cb;
+	isc_result_t result;
+
+	dns_rdatacallbacks_init_stdio(&cb);
+	cb.error = nullmsg;
+	result = dns_db_beginload(db, &cb);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	cb.nthreads = 4;
+
+	result = dns_master_loadfile(filename, dns_origin, dns_origin,
+				     dns_rdataclass_in, 0, 0, &cb, NULL, NULL,
+				     isc_g_mctx, format, 0);
+	assert_int_equal(result, expect);
+
+	result = dns_db_endload(db, &cb);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+/*
+ * Parallel load test:
+ * large raw files are decoded by several threads and load the same
+ * data as a single-threaded text load
+ */
+ISC_RUN_TEST_IMPL(loadparallel) {
+	isc_result_t result;
+	dns_db_t *db = NULL, *db2 = NULL;
+	dns_dbversion_t *version = NULL;
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset = DNS_RDATASET_INIT;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	FILE *f = NULL;
+	off_t size;
+
+	UNUSED(state);
+
+	result = setup_master(nullmsg, nullmsg);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(BUILDDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Big enough to be cut into several chunks. */
+	f = fopen("test.parallel", "w");
+	assert_non_null(f);
+	fprintf(f, "$TTL 300\n@ SOA ns hostmaster 1 3600 900 604800 300\n"
+		   "@ NS ns\nns A 192.0.2.1\n");
+	for (unsigned int i = 0; i < 40000; i++) {
+		fprintf(f, "name%u A 10.%u.%u.%u\n", i, i >> 16,
+			(i >> 8) & 0xff, i & 0xff);
+		fprintf(f, "name%u TXT \"some text to make this longer %u\"\n",
+			i, i);
+	}
+	assert_int_equal(fclose(f), 0);
+
+	result = dns_db_create(isc_g_mctx, ZONEDB_DEFAULT, dns_origin,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_load(db, "test.parallel", dns_masterformat_text, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	unlink("test.parallel");
+
+	result = dns_name_fromstring(name, "name31337", dns_origin, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_db_currentversion(db, &version);
+
+	result = dns_master_dump(isc_g_mctx, db, version,
+				 &dns_master_style_default, "test.dump",
+				 dns_masterformat_raw, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_file_getsize("test.dump", &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(size > 2 * 1024 * 1024);
+
+	result = dns_db_create(isc_g_mctx, ZONEDB_DEFAULT, dns_origin,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	load_threaded(db2, "test.dump", dns_masterformat_raw, ISC_R_SUCCESS);
+
+	assert_int_equal(dns_db_nodecount(db2, dns_dbtree_main),
+			 dns_db_nodecount(db, dns_dbtree_main));
+
+	result = dns_db_findnode(db2, name, false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findrdataset(db2, node, NULL, dns_rdatatype_txt, 0, 0,
+				     &rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(rdataset.ttl, 300);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db2, &node);
+	dns_db_detach(&db2);
+
+	/* A truncated file is rejected. */
+	assert_int_equal(truncate("test.dump", size - 1), 0);
+	result = dns_db_create(isc_g_mctx, ZONEDB_DEFAULT, dns_origin,
+			       dns_dbtype_zone, dns_rdataclass_in, 0, NULL,
+			       &db2);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	load_threaded(db2, "test.dump", dns_masterformat_raw,
+		      ISC_R_UNEXPECTEDEND);
+	dns_db_detach(&db2);
+
+	unlink("test.dump");
+
+	dns_db_closeversion(db, &version, false);
+	dns_db_detach(&db);
+}
+
 static const char *warn_expect_value;
 static bool warn_expect_result;
 
@@ -563,6 +680,7 @@ ISC_TEST_ENTRY(leadingzero)
 ISC_TEST_ENTRY(totext)
 ISC_TEST_ENTRY(loadraw)
 ISC_TEST_ENTRY(dumpraw)
+ISC_TEST_ENTRY(loadparallel)
 ISC_TEST_ENTRY(toobig)
 ISC_TEST_ENTRY(maxrdata)
 ISC_TEST_ENTRY(neworigin)
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/lib.h>
+#include <isc/loop.h>
+#include <isc/netaddr.h>
+#include <isc/sockaddr.h>
+#include <isc/stdtime.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/lib.h>
+#include <dns/name.h>
+#include <dns/rrl.h>
+#include <dns/view.h>
+
+#include <tests/dns.h>
+
+#define RATE	  100
+#define QPS_SCALE 250
+#define CLIENTS	  1000
+
+static dns_view_t *view = NULL;
+static dns_rrl_t *rrl = NULL;
+
+static int
+setup_test(void **state) {
+	isc_result_t result;
+
+	setup_loopmgr(state);
+
+	result = dns_test_makeview("view", false, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_rrl_init(&rrl, view, 500);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* The same settings as configure_rrl() would apply */
+	rrl->max_entries = 20000;
+	rrl->window = 15;
+	rrl->qps_scale = QPS_SCALE;
+	rrl->ipv4_prefixlen = 24;
+	rrl->ipv4_mask = htonl(0xffffff00);
+	rrl->responses_per_second.r = RATE;
+	atomic_store_relaxed(&rrl->responses_per_second.scaled, RATE);
+	rrl->responses_per_second.str = "responses-per-second";
+	rrl->referrals_per_second.str = "referrals-per-second";
+	rrl->nodata_per_second.str = "nodata-per-second";
+	rrl->nxdomains_per_second.str = "nxdomains-per-second";
+	rrl->errors_per_second.str = "errors-per-second";
+	rrl->all_per_second.str = "all-per-second";
+	rrl->slip.r = 2;
+	atomic_store_relaxed(&rrl->slip.scaled, 2);
+	rrl->slip.str = "slip";
+
+	return 0;
+}
+
+static int
+teardown_test(void **state) {
+	rrl = NULL;
+	dns_view_detach(&view);
+
+	teardown_loopmgr(state);
+
+	return 0;
+}
+
+/*
+ * Send one response to each of CLIENTS clients, one per /24 prefix, so
+ * that the responses are spread over all of the shards.
+ */
+static void
+respond(isc_stdtime_t now) {
+	dns_fixedname_t fixed;
+	dns_name_t *qname = dns_fixedname_initname(&fixed);
+	char log_buf[DNS_RRL_LOG_BUF_LEN];
+	isc_result_t result;
+
+	result = dns_name_fromstring(qname, "www.example.", NULL, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (unsigned int i = 0; i < CLIENTS; i++) {
+		struct in_addr ina;
+		isc_sockaddr_t client;
+		dns_rrl_result_t rrl_result;
+
+		ina.s_addr = htonl(0x0a000001 | (i << 8));
+		isc_sockaddr_fromin(&client, &ina, 53);
+
+		rrl_result = dns_rrl(view, NULL, &client, false,
+				     dns_rdataclass_in, dns_rdatatype_a, qname,
+				     ISC_R_SUCCESS, now, false, log_buf,
+				     sizeof(log_buf));
+		assert_int_equal(rrl_result, DNS_RRL_RESULT_OK);
+	}
+}
+
+/*
+ * The limits are scaled by "qps-scale" over the response rate of the
+ * whole view, however the clients are spread over the shards.
+ */
+ISC_RUN_TEST_IMPL(dns_rrl_qps_scale) {
+	isc_stdtime_t start = atomic_load_relaxed(&rrl->qps_time);
+
+	assert_true(rrl->nshards > 1);
+
+	/* The first second has no full second of history yet */
+	respond(start + 1);
+	assert_false(atomic_load_relaxed(&rrl->scaled));
+	assert_int_equal(atomic_load_relaxed(&rrl->responses_per_second.scaled),
+			 RATE);
+
+	/*
+	 * The first response of the next second makes CLIENTS + 1 responses
+	 * in 2 seconds, i.e. CLIENTS / 2 per second, from all of the shards.
+	 */
+	respond(start + 2);
+	assert_true(atomic_load_relaxed(&rrl->scaled));
+	assert_int_equal(atomic_load_relaxed(&rrl->responses_per_second.scaled),
+			 RATE * QPS_SCALE / (CLIENTS / 2));
+	assert_int_equal(atomic_load_relaxed(&rrl->slip.scaled), 2);
+
+	/* The same second does not scale the limits again */
+	respond(start + 2);
+	assert_int_equal(atomic_load_relaxed(&rrl->responses_per_second.scaled),
+			 RATE * QPS_SCALE / (CLIENTS / 2));
+
+	/*
+	 * After a full window, the rate drops to 3 * CLIENTS responses over
+	 * 20 seconds, which is under "qps-scale": the limits are restored.
+	 */
+	respond(start + 20);
+	assert_false(atomic_load_relaxed(&rrl->scaled));
+	assert_int_equal(atomic_load_relaxed(&rrl->qps), 3 * CLIENTS / 20);
+	assert_int_equal(atomic_load_relaxed(&rrl->responses_per_second.scaled),
+			 RATE);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(dns_rrl_qps_scale, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
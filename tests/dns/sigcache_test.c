@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/lib.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/dnssec.h>
+#include <dns/fixedname.h>
+#include <dns/lib.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+#include <dns/sigcache.h>
+
+#include <dst/dst.h>
+
+#include <tests/dns.h>
+
+#define DNSKEY "256 3 15 zyiLjDymEPN90rwi/y0mWXLnUm0Nq7T9Kc8VoubF2Io="
+#define RRSIG                                                    \
+	"A 15 2 3600 20300101000000 20000101000000 37529 example. " \
+	"Y29mZmVlY29mZmVlY29mZmVlY29mZmVlY29mZmVlY29mZmVlY29mZmVl" \
+	"Y29mZmVlY29mZmVlY29mZmVlY29mZmVlY29mZg=="
+
+#define INSIDE	1500000000 /* between inception and expiration */
+#define BEFORE	900000000  /* before inception */
+#define EXPIRED 1900000000 /* after expiration */
+
+static const char *addresses[] = { "192.0.2.1", "192.0.2.2", "192.0.2.3" };
+
+static unsigned char abuf[ARRAY_SIZE(addresses)][16];
+static dns_rdata_t ardata[ARRAY_SIZE(addresses)];
+static unsigned char sigbuf[1024];
+static dns_rdata_t sigrdata = DNS_RDATA_INIT;
+static unsigned char keybuf[1024];
+static dst_key_t *key = NULL;
+static dns_fixedname_t fowner;
+static dns_name_t *owner = NULL;
+
+static void
+setup(void) {
+	dns_rdata_t keyrdata = DNS_RDATA_INIT;
+	isc_result_t result;
+
+	owner = dns_fixedname_initname(&fowner);
+	dns_test_namefromstring("www.example.", &fowner);
+
+	for (size_t i = 0; i < ARRAY_SIZE(addresses); i++) {
+		dns_rdata_init(&ardata[i]);
+		result = dns_test_rdatafromstring(
+			&ardata[i], dns_rdataclass_in, dns_rdatatype_a,
+			abuf[i], sizeof(abuf[i]), addresses[i], false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	dns_rdata_init(&sigrdata);
+	result = dns_test_rdatafromstring(&sigrdata, dns_rdataclass_in,
+					  dns_rdatatype_rrsig, sigbuf,
+					  sizeof(sigbuf), RRSIG, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_test_rdatafromstring(&keyrdata, dns_rdataclass_in,
+					  dns_rdatatype_dnskey, keybuf,
+					  sizeof(keybuf), DNSKEY, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_dnssec_keyfromrdata(owner, &keyrdata, isc_g_mctx, &key);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static void
+teardown(void) {
+	dst_key_free(&key);
+}
+
+/*
+ * Compute the key of the RRset made of the addresses at 'order'.
+ */
+static void
+makekey(const size_t *order, size_t n, dns_sigcachekey_t *skey) {
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset = DNS_RDATASET_INIT;
+	dns_rdata_t rdata[ARRAY_SIZE(addresses)];
+	isc_result_t result;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.ttl = 3600;
+	for (size_t i = 0; i < n; i++) {
+		dns_rdata_init(&rdata[i]);
+		dns_rdata_clone(&ardata[order[i]], &rdata[i]);
+		ISC_LIST_APPEND(rdatalist.rdata, &rdata[i], link);
+	}
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+
+	result = dns_sigcache_key(owner, &rdataset, key, &sigrdata,
+				  isc_g_mctx, skey);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdataset_disassociate(&rdataset);
+}
+
+ISC_LOOP_TEST_IMPL(basic) {
+	dns_sigcache_t *sc = NULL;
+	dns_sigcachekey_t skey, other;
+	isc_result_t result;
+
+	setup();
+
+	makekey((size_t[]){ 0, 1, 2 }, 3, &skey);
+
+	/* The order of the rdata doesn't matter */
+	makekey((size_t[]){ 2, 0, 1 }, 3, &other);
+	assert_memory_equal(skey.digest, other.digest, sizeof(skey.digest));
+
+	/* ...but the content does */
+	makekey((size_t[]){ 0, 1 }, 2, &other);
+	assert_memory_not_equal(skey.digest, other.digest,
+				sizeof(skey.digest));
+
+	sc = dns_sigcache_new(isc_g_mctx, DNS_SIGCACHE_SIZE);
+
+	result = dns_sigcache_find(sc, &skey, INSIDE, NULL);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_sigcache_add(sc, &skey, ISC_R_SUCCESS, NULL);
+
+	result = dns_sigcache_find(sc, &skey, INSIDE, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_sigcache_find(sc, &other, INSIDE, NULL);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	/* Only while the signature is temporally valid */
+	result = dns_sigcache_find(sc, &skey, BEFORE, NULL);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	result = dns_sigcache_find(sc, &skey, EXPIRED, NULL);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_sigcache_destroy(&sc);
+	assert_null(sc);
+
+	teardown();
+
+	isc_loopmgr_shutdown();
+}
+
+ISC_LOOP_TEST_IMPL(wildcard) {
+	dns_sigcache_t *sc = NULL;
+	dns_sigcachekey_t skey;
+	dns_fixedname_t fwild, ffound;
+	dns_name_t *wild = dns_fixedname_initname(&fwild);
+	dns_name_t *found = dns_fixedname_initname(&ffound);
+	isc_result_t result;
+
+	setup();
+
+	dns_test_namefromstring("*.example.", &fwild);
+	makekey((size_t[]){ 0, 1, 2 }, 3, &skey);
+
+	sc = dns_sigcache_new(isc_g_mctx, DNS_SIGCACHE_SIZE);
+
+	dns_sigcache_add(sc, &skey, DNS_R_FROMWILDCARD, wild);
+
+	result = dns_sigcache_find(sc, &skey, INSIDE, found);
+	assert_int_equal(result, DNS_R_FROMWILDCARD);
+	assert_true(dns_name_equal(found, wild));
+
+	dns_sigcache_destroy(&sc);
+
+	teardown();
+
+	isc_loopmgr_shutdown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(basic, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(wildcard, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/histo.h>
+#include <isc/lib.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/tid.h>
+#include <isc/util.h>
+
+#include <dns/lib.h>
+#include <dns/verifyqueue.h>
+
+#include <tests/dns.h>
+
+#define JOBS 1000
+
+static dns_verifyqueue_t *vq = NULL;
+static atomic_uint_fast32_t ran;
+static unsigned int done;
+
+static void
+job_done(void *arg) {
+	isc_histo_t *hg = NULL;
+	double pop = 0.0;
+
+	UNUSED(arg);
+
+	if (++done < JOBS) {
+		return;
+	}
+
+	assert_int_equal(atomic_load(&ran), JOBS);
+	assert_int_equal(dns_verifyqueue_depth(vq), 0);
+
+	/* Every job has been timed */
+	dns_verifyqueue_latency(vq, &hg);
+	isc_histo_moments(hg, &pop, NULL, NULL);
+	isc_histo_destroy(&hg);
+	assert_int_equal((uint64_t)pop, JOBS);
+
+	dns_verifyqueue_detach(&vq);
+
+	isc_loopmgr_shutdown();
+}
+
+static void
+job(void *arg) {
+	/* Jobs run on the helper threads, never on the loops */
+	assert_int_equal(isc_tid(), ISC_TID_UNKNOWN);
+
+	atomic_fetch_add(&ran, 1);
+	isc_async_run(isc_loop_main(), job_done, arg);
+}
+
+ISC_LOOP_TEST_IMPL(run) {
+	atomic_init(&ran, 0);
+	done = 0;
+
+	vq = dns_verifyqueue_new(isc_g_mctx);
+
+	for (size_t i = 0; i < JOBS; i++) {
+		dns_verifyqueue_run(vq, isc_tid(), job, NULL);
+	}
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(run, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -91,6 +91,14 @@ ns_test_getdata(const char *file, unsigned char *buf, size_t bufsiz,
 void
 ns_test_getclient(ns_interface_t *ifp0, bool tcp, ns_client_t **clientp);
 
+/*%
+ * Synthesize a DNS message based on supplied QNAME, QTYPE and flags, then
+ * parse it and store the results in client->message.
+ */
+isc_result_t
+ns_test_makequery(ns_client_t *client, const char *qnamestr,
+		  dns_rdatatype_t qtype, unsigned int qflags);
+
 /*%
  * Structure containing parameters for ns_test_qctx_create().
  */
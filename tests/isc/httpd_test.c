@@ -0,0 +1,421 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * As a workaround, include an OpenSSL header file before including cmocka.h,
+ * because OpenSSL 3.1.0 uses __attribute__(malloc), conflicting with a
+ * redefined malloc in cmocka.h.
+ */
+#include <openssl/err.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/httpd.h>
+#include <isc/lib.h>
+#include <isc/loop.h>
+#include <isc/netmgr.h>
+#include <isc/sockaddr.h>
+#include <isc/util.h>
+
+#include "netmgr_common.h"
+
+#include <tests/isc.h>
+
+#define HTTP11_REQUEST             \
+	"GET /stream HTTP/1.1\r\n" \
+	"Host: localhost\r\n"      \
+	"Connection: close\r\n\r\n"
+#define HTTP10_REQUEST "GET /stream HTTP/1.0\r\n\r\n"
+
+/*
+ * The streaming action renders one of these per call.  The empty piece
+ * must not end a chunked response early.
+ */
+static const char *pieces[] = {
+	"first piece\n",
+	"",
+	"second piece\n",
+	"last piece\n",
+};
+
+static size_t failat;	/* the call that fails */
+static size_t rendered; /* pieces rendered so far */
+static bool released;	/* called again to release its state */
+static int state_token;
+
+static isc_httpdmgr_t *httpdmgr = NULL;
+static isc_sockaddr_t httpd_addr;
+static isc_sockaddr_t client_addr;
+
+static const char *request = NULL;
+static void (*check)(void) = NULL;
+static isc_buffer_t *response = NULL;
+static isc_result_t response_result;
+
+static isc_result_t
+stream_action(const isc_httpd_t *httpd, const isc_httpdurl_t *urlinfo,
+	      void *arg, void **statep, isc_buffer_t *chunk) {
+	UNUSED(httpd);
+	UNUSED(urlinfo);
+	UNUSED(arg);
+
+	if (chunk == NULL) {
+		assert_ptr_equal(*statep, &state_token);
+		*statep = NULL;
+		released = true;
+		return ISC_R_NOMORE;
+	}
+
+	if (rendered == 0) {
+		assert_null(*statep);
+		*statep = &state_token;
+	}
+	assert_ptr_equal(*statep, &state_token);
+
+	if (rendered == failat) {
+		*statep = NULL;
+		return ISC_R_FAILURE;
+	}
+
+	isc_buffer_putstr(chunk, pieces[rendered++]);
+	if (rendered == ARRAY_SIZE(pieces)) {
+		*statep = NULL;
+		return ISC_R_NOMORE;
+	}
+
+	return ISC_R_SUCCESS;
+}
+
+static void
+client_read(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
+	    void *cbarg) {
+	UNUSED(cbarg);
+
+	if (eresult == ISC_R_SUCCESS) {
+		isc_buffer_putmem(response, region->base, region->length);
+		return;
+	}
+
+	/* The server has closed the connection */
+	response_result = eresult;
+	isc_nmhandle_detach(&handle);
+
+	/* Keep the response NUL-terminated for the string functions */
+	isc_buffer_putuint8(response, 0);
+	isc_buffer_subtract(response, 1);
+	check();
+
+	isc_httpdmgr_shutdown(&httpdmgr);
+	isc_loopmgr_shutdown();
+}
+
+static void
+client_senddone(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	UNUSED(handle);
+	UNUSED(cbarg);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+}
+
+static void
+client_connected(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	isc_nmhandle_t *readhandle = NULL;
+	isc_region_t r = {
+		.base = (unsigned char *)request,
+		.length = strlen(request),
+	};
+
+	UNUSED(cbarg);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	isc_nmhandle_attach(handle, &readhandle);
+	isc_nm_read(handle, client_read, NULL);
+	isc_nm_send(handle, &r, client_senddone, NULL);
+}
+
+/*
+ * Serve the streaming action at "/stream", send 'req' and call 'checkfn'
+ * once the whole response has been read.
+ */
+static void
+fetch(const char *req, void (*checkfn)(void)) {
+	isc_result_t result;
+
+	request = req;
+	check = checkfn;
+
+	result = isc_httpdmgr_create(isc_g_mctx, &httpd_addr, NULL, NULL, NULL,
+				     &httpdmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = isc_httpdmgr_addstream(httpdmgr, "/stream", "text/plain",
+					stream_action, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_nm_tcpconnect(&client_addr, &httpd_addr, client_connected, NULL,
+			  T_CONNECT);
+}
+
+/*
+ * Split the response into its headers, including the status line, and
+ * its body.
+ */
+static void
+split(isc_region_t *headers, isc_region_t *body) {
+	const char *base = isc_buffer_base(response);
+	const char *end = strstr(base, "\r\n\r\n");
+
+	assert_non_null(end);
+	end += 4;
+
+	headers->base = (unsigned char *)base;
+	headers->length = end - base;
+	body->base = (unsigned char *)end;
+	body->length = isc_buffer_usedlength(response) - headers->length;
+}
+
+static bool
+has_header(const isc_region_t *headers, const char *header) {
+	size_t len = strlen(header);
+
+	for (size_t i = 0; i + len <= headers->length; i++) {
+		if (strncasecmp((const char *)headers->base + i, header, len) ==
+		    0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Decode a chunked body into 'out', counting the chunks in '*nchunksp'.
+ * Returns true if the body ends with the terminating zero-length chunk
+ * and nothing follows it.
+ */
+static bool
+dechunk(const isc_region_t *body, isc_buffer_t *out, size_t *nchunksp) {
+	const char *p = (const char *)body->base;
+	const char *end = p + body->length;
+
+	*nchunksp = 0;
+	while (p < end) {
+		char *eol = NULL;
+		unsigned long len = strtoul(p, &eol, 16);
+
+		assert_true(eol > p);
+		assert_true(end - eol >= 2);
+		assert_memory_equal(eol, "\r\n", 2);
+		p = eol + 2;
+
+		if (len == 0) {
+			return end - p == 2 && memcmp(p, "\r\n", 2) == 0;
+		}
+
+		/* Partial chunks are not sent */
+		assert_true((unsigned long)(end - p) >= len + 2);
+		isc_buffer_putmem(out, (const unsigned char *)p, len);
+		p += len;
+		assert_memory_equal(p, "\r\n", 2);
+		p += 2;
+		(*nchunksp)++;
+	}
+
+	return false;
+}
+
+/*
+ * Check that 'body' holds the first 'n' pieces.
+ */
+static void
+check_pieces(const unsigned char *body, size_t length, size_t n) {
+	size_t offset = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		size_t len = strlen(pieces[i]);
+
+		assert_true(offset + len <= length);
+		assert_memory_equal(body + offset, pieces[i], len);
+		offset += len;
+	}
+	assert_int_equal(offset, length);
+}
+
+static void
+check_dechunked(const isc_region_t *body, size_t n, bool terminated,
+		size_t nchunks) {
+	isc_buffer_t *decoded = NULL;
+	size_t chunks;
+
+	isc_buffer_allocate(isc_g_mctx, &decoded, 1024);
+	assert_int_equal(dechunk(body, decoded, &chunks), terminated);
+	assert_int_equal(chunks, nchunks);
+	check_pieces(isc_buffer_base(decoded), isc_buffer_usedlength(decoded),
+		     n);
+	isc_buffer_free(&decoded);
+}
+
+static void
+check_chunked(void) {
+	isc_region_t headers, body;
+
+	assert_int_equal(response_result, ISC_R_EOF);
+	assert_int_equal(rendered, ARRAY_SIZE(pieces));
+	assert_false(released);
+
+	split(&headers, &body);
+	assert_memory_equal(headers.base, "HTTP/1.1 200 OK\r\n", 17);
+	assert_true(has_header(&headers, "\r\nTransfer-Encoding: chunked\r\n"));
+	assert_false(has_header(&headers, "\r\nContent-Length:"));
+
+	/* One chunk per non-empty piece, then "0\r\n\r\n" */
+	check_dechunked(&body, ARRAY_SIZE(pieces), true,
+			ARRAY_SIZE(pieces) - 1);
+}
+
+static void
+check_http10(void) {
+	isc_region_t headers, body;
+
+	assert_int_equal(response_result, ISC_R_EOF);
+	assert_int_equal(rendered, ARRAY_SIZE(pieces));
+
+	split(&headers, &body);
+	assert_memory_equal(headers.base, "HTTP/1.0 200 OK\r\n", 17);
+	assert_true(has_header(&headers, "\r\nConnection: close\r\n"));
+	assert_false(has_header(&headers, "\r\nTransfer-Encoding:"));
+	assert_false(has_header(&headers, "\r\nContent-Length:"));
+
+	/* The body is not framed; it ends when the connection does */
+	check_pieces(body.base, body.length, ARRAY_SIZE(pieces));
+}
+
+static void
+check_fail_chunked(void) {
+	isc_region_t headers, body;
+
+	assert_int_equal(rendered, failat);
+	assert_false(released);
+
+	split(&headers, &body);
+	assert_memory_equal(headers.base, "HTTP/1.1 200 OK\r\n", 17);
+	assert_true(has_header(&headers, "\r\nTransfer-Encoding: chunked\r\n"));
+
+	/*
+	 * The pieces rendered before the failure were sent, but the
+	 * terminating chunk is missing, so the client can tell the
+	 * response is incomplete.
+	 */
+	check_dechunked(&body, failat, false, failat - 1);
+}
+
+static void
+check_fail_http10(void) {
+	isc_region_t headers, body;
+
+	assert_int_equal(response_result, ISC_R_EOF);
+	assert_int_equal(rendered, failat);
+
+	split(&headers, &body);
+	assert_memory_equal(headers.base, "HTTP/1.0 200 OK\r\n", 17);
+
+	/*
+	 * An HTTP/1.0 client sees a shorter body that ends like a
+	 * complete one; see isc_httpdmgr_addstream().
+	 */
+	check_pieces(body.base, body.length, failat);
+}
+
+static void
+check_fail_first(void) {
+	isc_region_t headers, body;
+
+	assert_int_equal(response_result, ISC_R_EOF);
+	assert_int_equal(rendered, 0);
+
+	/* Nothing has been sent yet, so this is a plain error response */
+	split(&headers, &body);
+	assert_memory_equal(headers.base, "HTTP/1.1 500 ", 13);
+	assert_true(has_header(&headers, "\r\nContent-Length:"));
+	assert_false(has_header(&headers, "\r\nTransfer-Encoding:"));
+}
+
+static int
+setup_test(void **state) {
+	setup_managers(state);
+
+	isc_sockaddr_fromin6(&httpd_addr, &in6addr_loopback, HTTPD_TEST_PORT);
+	isc_sockaddr_fromin6(&client_addr, &in6addr_loopback, 0);
+	isc_buffer_allocate(isc_g_mctx, &response, 1024);
+	response_result = ISC_R_UNSET;
+
+	failat = ARRAY_SIZE(pieces);
+	rendered = 0;
+	released = false;
+
+	return 0;
+}
+
+static int
+teardown_test(void **state) {
+	isc_buffer_free(&response);
+	teardown_managers(state);
+
+	return 0;
+}
+
+ISC_LOOP_TEST_IMPL(httpd_stream_chunked) {
+	fetch(HTTP11_REQUEST, check_chunked);
+}
+
+ISC_LOOP_TEST_IMPL(httpd_stream_http10) {
+	fetch(HTTP10_REQUEST, check_http10);
+}
+
+ISC_LOOP_TEST_IMPL(httpd_stream_fail_chunked) {
+	failat = 3;
+	fetch(HTTP11_REQUEST, check_fail_chunked);
+}
+
+ISC_LOOP_TEST_IMPL(httpd_stream_fail_http10) {
+	failat = 3;
+	fetch(HTTP10_REQUEST, check_fail_http10);
+}
+
+ISC_LOOP_TEST_IMPL(httpd_stream_fail_first) {
+	failat = 0;
+	fetch(HTTP11_REQUEST, check_fail_first);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(httpd_stream_chunked, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(httpd_stream_http10, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(httpd_stream_fail_chunked, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(httpd_stream_fail_http10, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(httpd_stream_fail_first, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
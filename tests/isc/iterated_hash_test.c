@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/base32.h>
+#include <isc/buffer.h>
+#include <isc/iterated_hash.h>
+#include <isc/lib.h>
+#include <isc/random.h>
+#include <isc/region.h>
+#include <isc/util.h>
+
+#include <tests/isc.h>
+
+/*
+ * Hashes from RFC 5155 Appendix A: salt aabbccdd, 12 iterations.
+ */
+static struct {
+	const char *name;
+	const char *hash;
+} rfc5155[] = {
+	{ "example", "0p9mhaveqvm6t7vbl5lop2u3t2rp3tom" },
+	{ "a.example", "35mthgpgcu1qg68fab165klnsnk3dpvl" },
+	{ "ai.example", "gjeqe526plbf1g8mklp59enfd789njgi" },
+	{ "ns1.example", "2t7b4g4vsa5smi47k61mv5bv1a22bojr" },
+	{ "ns2.example", "q04jkcevqvmu85r014c7dkba38o0ji5r" },
+	{ "w.example", "k8udemvp1j2f7eg6jebps17vp3n8i58h" },
+	{ "*.w.example", "r53bq7cc2uvmubfu5ocmm6pers9tk9en" },
+	{ "x.w.example", "b4um86eghhds6nea196smvmlo4ors995" },
+	{ "y.w.example", "ji6neoaepv8b5o6k4ev33abha8ht9fgc" },
+	{ "x.y.w.example", "2vptu5timamqttgl4luu9kg21e0aor3s" },
+	{ "xx.example", "t644ebqk9bibcna874givr6joj62mlhv" },
+};
+
+#define NAMES ARRAY_SIZE(rfc5155)
+
+#define MAXCOUNT (2 * ISC_ITERATED_HASH_LANES + 1)
+
+/*
+ * Convert a relative name in text form to an absolute name in wire format.
+ */
+static int
+towire(const char *text, unsigned char *wire) {
+	unsigned char *label = wire;
+	int len = 1;
+
+	*label = 0;
+	for (const char *p = text; *p != '\0'; p++) {
+		if (*p == '.') {
+			label = wire + len++;
+			*label = 0;
+		} else {
+			wire[len++] = *p;
+			(*label)++;
+		}
+	}
+	wire[len++] = 0;
+
+	return len;
+}
+
+/* Known answers from the batched and the single chain functions */
+ISC_RUN_TEST_IMPL(isc_iterated_hash_rfc5155) {
+	const unsigned char salt[] = { 0xaa, 0xbb, 0xcc, 0xdd };
+	unsigned char wire[NAMES][256];
+	unsigned char hash[NAMES][NSEC3_MAX_HASH_LENGTH];
+	unsigned char *out[NAMES];
+	const unsigned char *in[NAMES];
+	int inlength[NAMES];
+	int len;
+
+	for (size_t i = 0; i < NAMES; i++) {
+		inlength[i] = towire(rfc5155[i].name, wire[i]);
+		in[i] = wire[i];
+		out[i] = hash[i];
+	}
+
+	len = isc_iterated_hash_batch(out, 1, 12, salt, sizeof(salt), in,
+				      inlength, NAMES);
+	assert_int_equal(len, 20);
+
+	for (size_t i = 0; i < NAMES; i++) {
+		unsigned char single[NSEC3_MAX_HASH_LENGTH];
+		char text[64];
+		isc_buffer_t b;
+		isc_region_t r = { .base = hash[i], .length = len };
+
+		isc_buffer_init(&b, text, sizeof(text));
+		assert_int_equal(isc_base32hexnp_totext(&r, 1, "", &b),
+				 ISC_R_SUCCESS);
+		isc_buffer_putuint8(&b, 0);
+		assert_int_equal(strcasecmp(text, rfc5155[i].hash), 0);
+
+		assert_int_equal(isc_iterated_hash(single, 1, 12, salt,
+						   sizeof(salt), in[i],
+						   inlength[i]),
+				 20);
+		assert_memory_equal(single, hash[i], 20);
+	}
+}
+
+/* Batches of every size against the single chain function */
+ISC_RUN_TEST_IMPL(isc_iterated_hash_batch) {
+	static const int iterations[] = { 0, 1, 15, 150 };
+	static const int saltlengths[] = { 0, 1, 35, 44, 255 };
+	unsigned char salt[255];
+	unsigned char wire[MAXCOUNT][255];
+	unsigned char hash[MAXCOUNT][NSEC3_MAX_HASH_LENGTH];
+	unsigned char *out[MAXCOUNT];
+	const unsigned char *in[MAXCOUNT];
+	int inlength[MAXCOUNT];
+
+	isc_random_buf(salt, sizeof(salt));
+	isc_random_buf(wire, sizeof(wire));
+
+	for (size_t i = 0; i < MAXCOUNT; i++) {
+		/* 0, 1 and 255 octets, and sizes around block boundaries */
+		inlength[i] = (i * 37 + 1) % 256;
+		in[i] = wire[i];
+		out[i] = hash[i];
+	}
+	inlength[0] = 0;
+	inlength[1] = 255;
+
+	for (size_t it = 0; it < ARRAY_SIZE(iterations); it++) {
+		for (size_t sl = 0; sl < ARRAY_SIZE(saltlengths); sl++) {
+			for (unsigned int n = 1; n <= MAXCOUNT; n++) {
+				int len = isc_iterated_hash_batch(
+					out, 1, iterations[it], salt,
+					saltlengths[sl], in, inlength, n);
+				assert_int_equal(len, 20);
+
+				for (size_t i = 0; i < n; i++) {
+					unsigned char single[20];
+
+					isc_iterated_hash(single, 1,
+							  iterations[it], salt,
+							  saltlengths[sl],
+							  in[i], inlength[i]);
+					assert_memory_equal(single, hash[i],
+							    20);
+				}
+			}
+		}
+	}
+
+	/* Unsupported algorithm */
+	assert_int_equal(isc_iterated_hash_batch(out, 2, 0, salt, 0, in,
+						 inlength, MAXCOUNT),
+			 0);
+}
+
+ISC_TEST_LIST_START
+
+ISC_TEST_ENTRY(isc_iterated_hash_rfc5155)
+ISC_TEST_ENTRY(isc_iterated_hash_batch)
+
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
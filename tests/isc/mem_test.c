@@ -125,6 +125,56 @@ ISC_RUN_TEST_IMPL(isc_mem_get) {
 	isc_mempool_destroy(&mp1);
 }
 
+/* mempool limits follow the demand */
+ISC_RUN_TEST_IMPL(isc_mempool_adapt) {
+#if !__SANITIZE_ADDRESS__
+	void *items[64];
+	isc_mempool_t *mp = NULL;
+	unsigned int i, j;
+
+	isc_mempool_create(isc_g_mctx, 24, "mp", &mp);
+	isc_mempool_setfreemax(mp, 8);
+	isc_mempool_setfillcount(mp, 8);
+
+	/*
+	 * A working set of 64 items thrashes a free list of 8; the pool
+	 * should grow its limits until it can keep the working set.
+	 */
+	for (j = 0; j < 1000; j++) {
+		for (i = 0; i < ARRAY_SIZE(items); i++) {
+			items[i] = isc_mempool_get(mp);
+		}
+		for (i = 0; i < ARRAY_SIZE(items); i++) {
+			isc_mempool_put(mp, items[i]);
+		}
+	}
+
+	assert_int_equal(isc_mempool_getfreemax(mp), 64);
+	assert_int_equal(isc_mempool_getfreecount(mp), 64);
+
+	/* Once the misses stop, larger fills are not needed anymore. */
+	assert_int_equal(isc_mempool_getfillcount(mp), 8);
+
+	/*
+	 * With only a single item in use, the idle items are returned to
+	 * the memory context and the limits go back down.
+	 */
+	for (j = 0; j < 100000; j++) {
+		items[0] = isc_mempool_get(mp);
+		isc_mempool_put(mp, items[0]);
+	}
+
+	assert_int_equal(isc_mempool_getfillcount(mp), 8);
+	assert_true(isc_mempool_getfreemax(mp) <= 8);
+	assert_true(isc_mempool_getfreecount(mp) <= 8);
+	assert_int_equal(isc_mempool_getallocated(mp), 0);
+
+	isc_mempool_destroy(&mp);
+#else  /* !__SANITIZE_ADDRESS__ */
+	skip();
+#endif /* !__SANITIZE_ADDRESS__ */
+}
+
 /* zeroed memory system tests */
 ISC_RUN_TEST_IMPL(isc_mem_cget_zero) {
 	uint8_t *ptr;
@@ -546,6 +596,7 @@ ISC_RUN_TEST_IMPL(isc_mem_benchmark) {
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY(isc_mem_get)
+ISC_TEST_ENTRY(isc_mempool_adapt)
 ISC_TEST_ENTRY(isc_mem_cget_zero)
 ISC_TEST_ENTRY(isc_mem_callocate_zero)
 ISC_TEST_ENTRY(isc_mem_inuse)
@@ -30,6 +30,7 @@
 #define TLSDNS_TEST_PORT      9157
 #define PROXYSTREAM_TEST_PORT 9158
 #define PROXYUDP_TEST_PORT    9159
+#define HTTPD_TEST_PORT	      9160
 
 typedef void (*stream_connect_function)(void);
 typedef void (*connect_func)(void);
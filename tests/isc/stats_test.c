@@ -22,7 +22,10 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/async.h>
+#include <isc/atomic.h>
 #include <isc/lib.h>
+#include <isc/loop.h>
 #include <isc/mem.h>
 #include <isc/result.h>
 #include <isc/stats.h>
@@ -89,12 +92,93 @@ ISC_RUN_TEST_IMPL(isc_stats_basic) {
 		assert_int_equal(isc_stats_get_counter(stats, i), expect);
 	}
 
+	/* Test add. */
+	isc_stats_add(stats, 4, 10);
+	assert_int_equal(isc_stats_get_counter(stats, 4), 10);
+
 	isc_stats_detach(&stats);
 }
 
+/*
+ * Counters 0 and 1 are counted per loop, counter 2 is shared.
+ */
+#define PERLOOP_INCREMENTS 1000
+
+static isc_stats_t *perloop_stats = NULL;
+static atomic_uint_fast64_t perloop_returned = 0;
+static atomic_uint perloop_done = 0;
+
+static void
+perloop_cb(void *arg ISC_ATTR_UNUSED) {
+	isc_statscounter_t value;
+
+	for (size_t i = 0; i < PERLOOP_INCREMENTS; i++) {
+		isc_stats_increment(perloop_stats, 0);
+	}
+	isc_stats_increment(perloop_stats, 1);
+
+	/* The shared counter returns the total, not this loop's share */
+	value = isc_stats_increment(perloop_stats, 2);
+	assert_true(value < isc_loopmgr_nloops());
+	atomic_fetch_add(&perloop_returned, value);
+
+	if (atomic_fetch_add(&perloop_done, 1) + 1 == isc_loopmgr_nloops()) {
+		isc_loopmgr_shutdown();
+	}
+}
+
+static void
+perloop_setup_cb(void *arg ISC_ATTR_UNUSED) {
+	for (size_t i = 0; i < isc_loopmgr_nloops(); i++) {
+		isc_async_run(isc_loop_get(i), perloop_cb, NULL);
+	}
+}
+
+/* test statistics counted in per-loop slabs */
+ISC_RUN_TEST_IMPL(isc_stats_perloop) {
+	uint64_t nloops = isc_loopmgr_nloops();
+
+	isc_stats_create_perloop(isc_g_mctx, &perloop_stats, 3);
+	isc_stats_setshared(perloop_stats, 2);
+
+	isc_loop_setup(isc_loop_main(), perloop_setup_cb, NULL);
+	isc_loopmgr_run();
+
+	/* The slabs are summed */
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 0),
+			 nloops * PERLOOP_INCREMENTS);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 1), nloops);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 2), nloops);
+
+	/* Each loop got a different old value of the shared counter */
+	assert_int_equal(atomic_load(&perloop_returned),
+			 nloops * (nloops - 1) / 2);
+
+	/* Set, update and decrement the shared counter */
+	isc_stats_set(perloop_stats, 0, 2);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 2), 0);
+	isc_stats_update_if_greater(perloop_stats, 2, 5);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 2), 5);
+	isc_stats_update_if_greater(perloop_stats, 2, 3);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 2), 5);
+	isc_stats_decrement(perloop_stats, 2);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 2), 4);
+
+	/* The slabs are folded into the shared array when resizing */
+	isc_stats_resize(&perloop_stats, 4);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 0),
+			 nloops * PERLOOP_INCREMENTS);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 1), nloops);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 2), 4);
+	assert_int_equal(isc_stats_get_counter(perloop_stats, 3), 0);
+
+	isc_stats_detach(&perloop_stats);
+}
+
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY(isc_stats_basic)
+ISC_TEST_ENTRY_CUSTOM(isc_stats_perloop, setup_loopmgr, teardown_loopmgr)
 
 ISC_TEST_LIST_END
 
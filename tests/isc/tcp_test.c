@@ -120,6 +120,177 @@ ISC_LOOP_TEST_IMPL(tcp_recv_send_quota_sendback) {
 	stream_recv_send(arg);
 }
 
+/* TCP gather writes */
+
+#define SENDV_LEN 4096
+
+static uint8_t sendv_data[SENDV_LEN];
+static uint8_t sendv_recv[2 * SENDV_LEN];
+static size_t sendv_received = 0;
+static atomic_int sendv_done = 0;
+
+static void
+sendv_finished(void) {
+	/* Both the sender and the receiver have to be done */
+	if (atomic_fetch_add(&sendv_done, 1) + 1 == 2) {
+		isc_loopmgr_shutdown();
+	}
+}
+
+static void
+sendv_send_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg);
+
+/*
+ * Send the data as three regions, while uv_try_write() only writes
+ * 'limit' bytes of them; the rest has to be queued with uv_write().
+ */
+static void
+sendv_send(isc_nmhandle_t *handle, int limit) {
+	isc_region_t regions[] = {
+		{ .base = sendv_data, .length = 3 },
+		{ .base = sendv_data + 3, .length = SENDV_LEN - 10 },
+		{ .base = sendv_data + SENDV_LEN - 7, .length = 7 },
+	};
+	isc_nmhandle_t *sendhandle = NULL;
+
+	WILL_RETURN(uv_try_write, limit);
+
+	isc_refcount_increment0(&active_csends);
+	isc_nmhandle_attach(handle, &sendhandle);
+	isc_nm_sendv(sendhandle, regions, ARRAY_SIZE(regions), sendv_send_cb,
+		     NULL);
+}
+
+static void
+sendv_send_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	isc_nmhandle_t *sendhandle = handle;
+	isc_result_t result;
+
+	UNUSED(cbarg);
+
+	F();
+
+	WILL_RETURN(uv_try_write, 0);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+	isc_refcount_decrement(&active_csends);
+
+	if (atomic_fetch_add(&csends, 1) + 1 == 1) {
+		/* This partial write ends exactly after the first region */
+		sendv_send(handle, 3);
+	} else {
+		result = isc_nmhandle_set_tcp_cork(handle, false);
+		assert_true(result == ISC_R_SUCCESS ||
+			    result == ISC_R_NOTIMPLEMENTED);
+		sendv_finished();
+	}
+
+	isc_nmhandle_detach(&sendhandle);
+}
+
+static void
+sendv_connect_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	isc_result_t result;
+
+	UNUSED(cbarg);
+
+	F();
+
+	isc_refcount_decrement(&active_cconnects);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+	atomic_fetch_add(&cconnects, 1);
+
+	result = isc_nmhandle_set_tcp_cork(handle, true);
+	assert_true(result == ISC_R_SUCCESS || result == ISC_R_NOTIMPLEMENTED);
+
+	/* This partial write ends in the middle of the second region */
+	sendv_send(handle, 5);
+}
+
+static void
+sendv_read_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+	      isc_region_t *region, void *cbarg) {
+	isc_nmhandle_t *readhandle = handle;
+
+	UNUSED(cbarg);
+
+	F();
+
+	if (eresult != ISC_R_SUCCESS) {
+		isc_refcount_decrement(&active_sreads);
+		isc_nmhandle_detach(&readhandle);
+		return;
+	}
+
+	assert_true(region->length <= sizeof(sendv_recv) - sendv_received);
+	memmove(sendv_recv + sendv_received, region->base, region->length);
+	sendv_received += region->length;
+	atomic_fetch_add(&sreads, 1);
+
+	if (sendv_received == sizeof(sendv_recv)) {
+		/* Both of the sends have arrived whole and in order */
+		assert_memory_equal(sendv_recv, sendv_data, SENDV_LEN);
+		assert_memory_equal(sendv_recv + SENDV_LEN, sendv_data,
+				    SENDV_LEN);
+		sendv_finished();
+	}
+}
+
+static isc_result_t
+sendv_accept_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	isc_nmhandle_t *readhandle = NULL;
+
+	UNUSED(cbarg);
+
+	F();
+
+	if (eresult != ISC_R_SUCCESS) {
+		return eresult;
+	}
+
+	atomic_fetch_add(&saccepts, 1);
+
+	isc_refcount_increment0(&active_sreads);
+	isc_nmhandle_attach(handle, &readhandle);
+	isc_nm_read(handle, sendv_read_cb, readhandle);
+
+	return ISC_R_SUCCESS;
+}
+
+static int
+tcp_sendv_setup(void **state) {
+	int r = setup_netmgr_test(state);
+
+	isc_nonce_buf(sendv_data, sizeof(sendv_data));
+	sendv_received = 0;
+	atomic_store(&sendv_done, 0);
+
+	return r;
+}
+
+static int
+tcp_sendv_teardown(void **state) {
+	atomic_assert_int_eq(cconnects, 1);
+	atomic_assert_int_eq(csends, 2);
+	atomic_assert_int_eq(saccepts, 1);
+	assert_int_equal(sendv_received, sizeof(sendv_recv));
+
+	RESET_RETURN;
+
+	return teardown_netmgr_test(state);
+}
+
+ISC_LOOP_TEST_IMPL(tcp_sendv) {
+	isc_result_t result;
+
+	result = stream_listen(sendv_accept_cb, NULL, 128, NULL, &listen_sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_loop_teardown(isc_loop_main(), stop_listening, listen_sock);
+
+	stream_connect(sendv_connect_cb, NULL, T_CONNECT);
+}
+
 ISC_TEST_LIST_START
 
 /* TCP */
@@ -140,6 +311,7 @@ ISC_TEST_ENTRY_CUSTOM(tcp_recv_send, stream_recv_send_setup,
 		      stream_recv_send_teardown)
 ISC_TEST_ENTRY_CUSTOM(tcp_recv_send_sendback, stream_recv_send_setup,
 		      stream_recv_send_teardown)
+ISC_TEST_ENTRY_CUSTOM(tcp_sendv, tcp_sendv_setup, tcp_sendv_teardown)
 
 /* TCP Quota */
 ISC_TEST_ENTRY_CUSTOM(tcp_recv_one_quota, stream_recv_one_setup,
@@ -37,6 +37,7 @@
 #include <isc/quota.h>
 #include <isc/refcount.h>
 #include <isc/sockaddr.h>
+#include <isc/stats.h>
 #include <isc/thread.h>
 #include <isc/util.h>
 
@@ -193,8 +194,149 @@ ISC_LOOP_TEST_IMPL(udp_recv_two) { udp_recv_two(arg); }
 
 ISC_LOOP_TEST_IMPL(udp_recv_send) { udp_recv_send(arg); }
 
+static isc_stats_t *batch_stats = NULL;
+
+static int
+udp_recv_send_batch_setup(void **state) {
+	int r = udp_recv_send_setup(state);
+
+	isc_nm_setudpsendbatch(ISC_NM_UDP_SENDBATCH_MAX);
+	assert_int_equal(isc_nm_getudpsendbatch(), ISC_NM_UDP_SENDBATCH_MAX);
+
+	isc_stats_create(isc_g_mctx, &batch_stats, isc_sockstatscounter_max);
+	isc_nm_setstats(batch_stats);
+
+	return r;
+}
+
+static int
+udp_recv_send_batch_teardown(void **state) {
+#if USE_UDP_SENDBATCH
+	isc_statscounter_t batches = isc_stats_get_counter(
+		batch_stats, isc_sockstatscounter_udp6sendbatch);
+	isc_statscounter_t batched = isc_stats_get_counter(
+		batch_stats, isc_sockstatscounter_udp6sendbatched);
+
+	/*
+	 * The server reads with recvmmsg(2), so its responses must have
+	 * gone out with sendmmsg(2) rather than one by one.
+	 */
+	assert_true(batches > 0);
+	assert_true(batched >= batches);
+#endif /* USE_UDP_SENDBATCH */
+
+	isc_stats_detach(&batch_stats);
+
+	return udp_recv_send_teardown(state);
+}
+
+ISC_LOOP_TEST_IMPL(udp_recv_send_batch) { udp_recv_send(arg); }
+
 ISC_LOOP_TEST_IMPL(udp_double_read) { udp_double_read(arg); }
 
+/*
+ * Send from an unconnected socket opened with isc_nm_udpbind(), and read
+ * the answers back on the same socket.
+ */
+static isc_nmhandle_t *bind_handle = NULL;
+
+static void
+udp_bind_listen_read_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+			isc_region_t *region, void *cbarg) {
+	if (eresult != ISC_R_SUCCESS) {
+		isc_refcount_increment0(&active_sreads);
+	}
+	listen_read_cb(handle, eresult, region, cbarg);
+}
+
+static void
+udp_bind_send_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	isc_nmhandle_t *sendhandle = handle;
+
+	UNUSED(cbarg);
+
+	F();
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	atomic_fetch_add(&csends, 1);
+	isc_refcount_decrement(&active_csends);
+	isc_nmhandle_detach(&sendhandle);
+}
+
+static void
+udp_bind_sendto(void) {
+	isc_refcount_increment0(&active_csends);
+	isc_nm_udpsendto(bind_handle, &udp_listen_addr, &send_msg,
+			 udp_bind_send_cb, NULL);
+}
+
+static void
+udp_bind_read_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		 isc_region_t *region, void *cbarg) {
+	isc_sockaddr_t peer;
+	uint64_t magic = 0;
+
+	UNUSED(cbarg);
+
+	F();
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	/* The answer has to come from the address it was sent to */
+	peer = isc_nmhandle_peeraddr(handle);
+	assert_true(isc_sockaddr_equal(&peer, &udp_listen_addr));
+
+	assert_true(region->length >= sizeof(magic));
+	memmove(&magic, region->base, sizeof(magic));
+	assert_true(magic == send_magic);
+
+	if (!have_expected_creads(atomic_fetch_add(&creads, 1) + 1)) {
+		/* Send again over the same socket */
+		udp_bind_sendto();
+		return;
+	}
+
+	isc_nmhandle_detach(&bind_handle);
+	isc_loopmgr_shutdown();
+}
+
+static int
+udp_bind_sendto_setup(void **state) {
+	setup_udp_test(state);
+	expected_creads = 2;
+	return 0;
+}
+
+static int
+udp_bind_sendto_teardown(void **state) {
+	atomic_assert_int_eq(csends, 2);
+	atomic_assert_int_eq(creads, 2);
+	atomic_assert_int_eq(sreads, 2);
+	atomic_assert_int_ge(ssends, 1);
+
+	teardown_udp_test(state);
+	return 0;
+}
+
+ISC_LOOP_TEST_IMPL(udp_bind_sendto) {
+	isc_result_t result;
+
+	result = isc_nm_listenudp(ISC_NM_LISTEN_ONE, &udp_listen_addr,
+				  udp_bind_listen_read_cb, NULL, &listen_sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	isc_loop_teardown(isc_loop_main(), stop_listening, listen_sock);
+
+	result = isc_nm_udpbind(&udp_connect_addr, udp_bind_read_cb, NULL,
+				&bind_handle);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_non_null(bind_handle);
+
+	udp_bind_sendto();
+}
+
 ISC_TEST_LIST_START
 
 ISC_TEST_ENTRY_CUSTOM(mock_listenudp_uv_udp_open, setup_udp_test,
@@ -231,6 +373,10 @@ ISC_TEST_ENTRY_CUSTOM(udp_recv_one, udp_recv_one_setup, udp_recv_one_teardown)
 ISC_TEST_ENTRY_CUSTOM(udp_recv_two, udp_recv_two_setup, udp_recv_two_teardown)
 ISC_TEST_ENTRY_CUSTOM(udp_recv_send, udp_recv_send_setup,
 		      udp_recv_send_teardown)
+ISC_TEST_ENTRY_CUSTOM(udp_recv_send_batch, udp_recv_send_batch_setup,
+		      udp_recv_send_batch_teardown)
+ISC_TEST_ENTRY_CUSTOM(udp_bind_sendto, udp_bind_sendto_setup,
+		      udp_bind_sendto_teardown)
 
 ISC_TEST_LIST_END
 
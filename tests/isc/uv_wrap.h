@@ -78,6 +78,9 @@ int
 __wrap_uv_listen(uv_stream_t *stream, int backlog, uv_connection_cb cb);
 int
 __wrap_uv_accept(uv_stream_t *server, uv_stream_t *client);
+int
+__wrap_uv_try_write(uv_stream_t *handle, const uv_buf_t bufs[],
+		    unsigned int nbufs);
 
 /* uv_handle_t */
 int
@@ -243,6 +246,36 @@ __wrap_uv_accept(uv_stream_t *server, uv_stream_t *client) {
 	return atomic_load(&__state_uv_accept);
 }
 
+/*
+ * A positive value makes uv_try_write() write at most that many bytes,
+ * to simulate a partial write; a negative value is returned as the error.
+ */
+static atomic_int __state_uv_try_write = 0;
+int
+__wrap_uv_try_write(uv_stream_t *handle, const uv_buf_t bufs[],
+		    unsigned int nbufs) {
+	int limit = atomic_load(&__state_uv_try_write);
+	uv_buf_t partial[16];
+	unsigned int npartial = 0;
+
+	if (limit == 0) {
+		return uv_try_write(handle, bufs, nbufs);
+	} else if (limit < 0) {
+		return limit;
+	}
+
+	for (unsigned int i = 0;
+	     i < nbufs && npartial < ARRAY_SIZE(partial) && limit > 0; i++)
+	{
+		unsigned int len = ISC_MIN(bufs[i].len, (unsigned int)limit);
+
+		partial[npartial++] = uv_buf_init(bufs[i].base, len);
+		limit -= len;
+	}
+
+	return uv_try_write(handle, partial, npartial);
+}
+
 static atomic_int __state_uv_send_buffer_size = 0;
 int
 __wrap_uv_send_buffer_size(uv_handle_t *handle, int *value) {
@@ -285,8 +318,9 @@ __wrap_uv_fileno(const uv_handle_t *handle, uv_os_fd_t *fd) {
 #define uv_tcp_getpeername(...) __wrap_uv_tcp_getpeername(__VA_ARGS__)
 #define uv_tcp_connect(...)	__wrap_uv_tcp_connect(__VA_ARGS__)
 
-#define uv_listen(...) __wrap_uv_listen(__VA_ARGS__)
-#define uv_accept(...) __wrap_uv_accept(__VA_ARGS__)
+#define uv_listen(...)	  __wrap_uv_listen(__VA_ARGS__)
+#define uv_accept(...)	  __wrap_uv_accept(__VA_ARGS__)
+#define uv_try_write(...) __wrap_uv_try_write(__VA_ARGS__)
 
 #define uv_send_buffer_size(...) __wrap_uv_send_buffer_size(__VA_ARGS__)
 #define uv_recv_buffer_size(...) __wrap_uv_recv_buffer_size(__VA_ARGS__)
@@ -309,6 +343,7 @@ __wrap_uv_fileno(const uv_handle_t *handle, uv_os_fd_t *fd) {
 		atomic_store(&__state_uv_tcp_connect, 0);      \
 		atomic_store(&__state_uv_listen, 0);           \
 		atomic_store(&__state_uv_accept, 0);           \
+		atomic_store(&__state_uv_try_write, 0);        \
 		atomic_store(&__state_uv_send_buffer_size, 0); \
 		atomic_store(&__state_uv_recv_buffer_size, 0); \
 		atomic_store(&__state_uv_fileno, 0);           \
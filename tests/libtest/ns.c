@@ -237,13 +237,9 @@ ns_test_getclient(ns_interface_t *ifp0, bool tcp, ns_client_t **clientp) {
 	*clientp = client;
 }
 
-/*%
- * Synthesize a DNS message based on supplied QNAME, QTYPE and flags, then
- * parse it and store the results in client->message.
- */
-static isc_result_t
-attach_query_msg_to_client(ns_client_t *client, const char *qnamestr,
-			   dns_rdatatype_t qtype, unsigned int qflags) {
+isc_result_t
+ns_test_makequery(ns_client_t *client, const char *qnamestr,
+		  dns_rdatatype_t qtype, unsigned int qflags) {
 	dns_rdataset_t *qrdataset = NULL;
 	dns_message_t *message = NULL;
 	unsigned char query[65535];
@@ -258,8 +254,7 @@ attach_query_msg_to_client(ns_client_t *client, const char *qnamestr,
 	/*
 	 * Create a new DNS message holding a query.
 	 */
-	dns_message_create(isc_g_mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER,
-			   &message);
+	dns_message_create(isc_g_mctx, DNS_MESSAGE_INTENTRENDER, &message);
 
 	/*
 	 * Set query ID to a random value.
@@ -434,8 +429,8 @@ ns_test_qctx_create(const ns_test_qctx_create_params_t *params,
 	 * Synthesize a DNS query using given QNAME, QTYPE and flags, storing
 	 * it in client->message.
 	 */
-	result = attach_query_msg_to_client(client, params->qname,
-					    params->qtype, params->qflags);
+	result = ns_test_makequery(client, params->qname, params->qtype,
+				   params->qflags);
 	if (result != ISC_R_SUCCESS) {
 		goto detach_view;
 	}
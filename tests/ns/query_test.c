@@ -23,12 +23,15 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/buffer.h>
+#include <isc/histo.h>
 #include <isc/lib.h>
 #include <isc/quota.h>
 #include <isc/util.h>
 
 #include <dns/badcache.h>
 #include <dns/lib.h>
+#include <dns/message.h>
 #include <dns/view.h>
 #include <dns/zone.h>
 
@@ -1480,11 +1483,81 @@ ISC_LOOP_TEST_IMPL(ns__query_hookasync_e2e) {
 	isc_loopmgr_shutdown();
 }
 
+/*****
+ ***** ns_client_sendwire() tests
+ *****/
+
+/*
+ * A pre-rendered response, such as one from the response cache, is
+ * counted in the query latency statistics as an authoritative answer
+ * if it has the AA bit set.
+ */
+ISC_LOOP_TEST_IMPL(ns_client_sendwire) {
+	const ns_test_qctx_create_params_t qctx_params = {
+		.qname = "foo",
+		.qtype = dns_rdatatype_a,
+	};
+	query_ctx_t *qctx = NULL;
+	ns_client_t *client = NULL;
+	dns_name_t *qname = NULL;
+	unsigned char data[512];
+	isc_buffer_t b;
+	isc_region_t r, qr;
+	isc_histomulti_t **latency = NULL;
+	isc_histo_t *hg = NULL;
+	double count = 0;
+	isc_result_t result;
+
+	result = ns_test_qctx_create(&qctx_params, &qctx);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	client = qctx->client;
+	client->inner.sendcb = send_noop;
+	dns_view_createlatencystats(client->inner.view);
+
+	qname = ISC_LIST_HEAD(client->message->sections[DNS_SECTION_QUESTION]);
+	dns_name_toregion(qname, &qr);
+
+	/* An authoritative NODATA answer */
+	isc_buffer_init(&b, data, sizeof(data));
+	isc_buffer_putuint16(&b, 0);
+	isc_buffer_putuint16(&b, DNS_MESSAGEFLAG_QR | DNS_MESSAGEFLAG_AA);
+	isc_buffer_putuint16(&b, 1);
+	isc_buffer_putuint16(&b, 0);
+	isc_buffer_putuint16(&b, 0);
+	isc_buffer_putuint16(&b, 0);
+	isc_buffer_putmem(&b, qr.base, qr.length);
+	isc_buffer_putuint16(&b, dns_rdatatype_a);
+	isc_buffer_putuint16(&b, dns_rdataclass_in);
+	isc_buffer_usedregion(&b, &r);
+
+	result = ns_client_sendwire(client, &r);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	latency = client->inner.view->latencystats[DNS_TRANSPORT_UDP];
+
+	isc_histomulti_merge(&hg, latency[dns_latencyoutcome_auth]);
+	isc_histo_moments(hg, &count, NULL, NULL);
+	assert_int_equal((int)count, 1);
+	isc_histo_destroy(&hg);
+
+	isc_histomulti_merge(&hg, latency[dns_latencyoutcome_cache]);
+	isc_histo_moments(hg, &count, NULL, NULL);
+	assert_int_equal((int)count, 0);
+	isc_histo_destroy(&hg);
+
+	ns_test_qctx_destroy(&qctx);
+
+	isc_loop_teardown(isc_loop_main(), shutdown_interfacemgr, NULL);
+	isc_loopmgr_shutdown();
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(ns__query_sfcache, setup_server, teardown_server)
 ISC_TEST_ENTRY_CUSTOM(ns__query_start, setup_server, teardown_server)
 ISC_TEST_ENTRY_CUSTOM(ns__query_hookasync, setup_server, teardown_server)
 ISC_TEST_ENTRY_CUSTOM(ns__query_hookasync_e2e, setup_server, teardown_server)
+ISC_TEST_ENTRY_CUSTOM(ns_client_sendwire, setup_server, teardown_server)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
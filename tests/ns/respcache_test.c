@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/lib.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/diff.h>
+#include <dns/fixedname.h>
+#include <dns/lib.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/view.h>
+#include <dns/zone.h>
+
+#include <ns/client.h>
+#include <ns/query.h>
+#include <ns/server.h>
+#include <ns/stats.h>
+
+#include <tests/ns.h>
+
+#define ZONEFILE TESTS_DIR "/testdata/respcache/foo.db"
+
+static dns_view_t *view = NULL;
+
+/* The last response sent */
+static unsigned char response[512];
+static unsigned int responselen = 0;
+
+static void
+send_save(isc_buffer_t *buffer) {
+	isc_region_t r;
+
+	isc_buffer_usedregion(buffer, &r);
+	INSIST(r.length <= sizeof(response));
+	memmove(response, r.base, r.length);
+	responselen = r.length;
+}
+
+static void
+setup_view(void) {
+	isc_result_t result;
+
+	result = dns_test_makeview("view", false, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = ns_test_serve_zone("foo", ZONEFILE, view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	sctx->respcache_size = 16;
+}
+
+static void
+teardown_view(void) {
+	ns_test_cleanup_zone();
+	dns_view_detach(&view);
+
+	isc_loop_teardown(isc_loop_main(), shutdown_interfacemgr, NULL);
+	isc_loopmgr_shutdown();
+}
+
+static dns_zone_t *
+getzone(void) {
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	dns_zone_t *zone = NULL;
+	isc_result_t result;
+
+	result = dns_name_fromstring(name, "foo", dns_rootname, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_view_findzone(view, name, 0, &zone);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	return zone;
+}
+
+/*
+ * Send a query from a new client of 'view', and return what the
+ * response cache made of it: ISC_R_SUCCESS for a hit, ISC_R_NOTFOUND
+ * for a miss and ISC_R_DISABLED when the query was not eligible.
+ */
+static isc_result_t
+query(const char *qname, dns_rdatatype_t qtype, unsigned int attributes) {
+	ns_client_t *client = NULL;
+	isc_nmhandle_t *handle = NULL;
+	isc_statscounter_t hits, misses;
+	isc_result_t result;
+
+	hits = ns_stats_get_counter(sctx->nsstats,
+				    ns_statscounter_respcachehit);
+	misses = ns_stats_get_counter(sctx->nsstats,
+				      ns_statscounter_respcachemiss);
+
+	ns_test_getclient(NULL, false, &client);
+	client->inner.tnow = isc_time_now();
+	client->inner.attributes |= attributes;
+	client->inner.sendcb = send_save;
+	dns_view_attach(view, &client->inner.view);
+
+	result = ns_test_makequery(client, qname, qtype, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	responselen = 0;
+	client->inner.state = NS_CLIENTSTATE_WORKING;
+	ns_query_start(client, client->inner.handle);
+	assert_true(responselen >= DNS_MESSAGE_HEADERLEN);
+
+	/*
+	 * The response has the ID of the query, and the question as it
+	 * was sent.
+	 */
+	assert_int_equal((response[0] << 8) | response[1], client->message->id);
+	{
+		dns_name_t *name = ISC_LIST_HEAD(
+			client->message->sections[DNS_SECTION_QUESTION]);
+		isc_region_t r;
+
+		dns_name_toregion(name, &r);
+		assert_memory_equal(response + DNS_MESSAGE_HEADERLEN, r.base,
+				    r.length);
+	}
+
+	/* The reference count for "client" is at 2 */
+	handle = client->inner.handle;
+	isc_nmhandle_detach(&handle);
+	isc_nmhandle_detach(&client->inner.handle);
+
+	if (ns_stats_get_counter(sctx->nsstats, ns_statscounter_respcachehit) !=
+	    hits)
+	{
+		return ISC_R_SUCCESS;
+	}
+	if (ns_stats_get_counter(sctx->nsstats,
+				 ns_statscounter_respcachemiss) != misses)
+	{
+		return ISC_R_NOTFOUND;
+	}
+	return ISC_R_DISABLED;
+}
+
+/*
+ * A response sent from the cache is the rendered one, with the ID and
+ * the case of the question name taken from the query.
+ */
+ISC_LOOP_TEST_IMPL(ns_respcache_hit) {
+	unsigned char saved[sizeof(response)];
+	unsigned int savedlen;
+
+	setup_view();
+
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_NOTFOUND);
+	assert_int_equal(response[3] & 0x0f, dns_rcode_noerror);
+	memmove(saved, response, responselen);
+	savedlen = responselen;
+
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_SUCCESS);
+	assert_int_equal(responselen, savedlen);
+	assert_memory_equal(response + 2, saved + 2, savedlen - 2);
+
+	assert_int_equal(query("NS.Foo", dns_rdatatype_a, 0), ISC_R_SUCCESS);
+	assert_int_equal(responselen, savedlen);
+
+	/* Another type is another entry */
+	assert_int_equal(query("ns.foo", dns_rdatatype_aaaa, 0),
+			 ISC_R_NOTFOUND);
+	assert_int_equal(query("ns.foo", dns_rdatatype_aaaa, 0),
+			 ISC_R_SUCCESS);
+
+	/* NXDOMAIN is cached as well */
+	assert_int_equal(query("none.foo", dns_rdatatype_a, 0),
+			 ISC_R_NOTFOUND);
+	assert_int_equal(query("none.foo", dns_rdatatype_a, 0),
+			 ISC_R_SUCCESS);
+	assert_int_equal(response[3] & 0x0f, dns_rcode_nxdomain);
+
+	teardown_view();
+}
+
+/*
+ * Queries and responses which are not cached.
+ */
+ISC_LOOP_TEST_IMPL(ns_respcache_eligible) {
+	setup_view();
+
+	/* The cache is disabled */
+	sctx->respcache_size = 0;
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_DISABLED);
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_DISABLED);
+	sctx->respcache_size = 16;
+
+	/* Client-specific data goes into the response */
+	assert_int_equal(query("ns.foo", dns_rdatatype_a,
+			       NS_CLIENTATTR_WANTNSID),
+			 ISC_R_DISABLED);
+	assert_int_equal(query("ns.foo", dns_rdatatype_a,
+			       NS_CLIENTATTR_WANTNSID),
+			 ISC_R_DISABLED);
+
+	/* A referral is not authoritative and is not stored */
+	assert_int_equal(query("www.sub.foo", dns_rdatatype_a, 0),
+			 ISC_R_NOTFOUND);
+	assert_int_equal((response[2] << 8) & DNS_MESSAGEFLAG_AA, 0);
+	assert_int_equal(query("www.sub.foo", dns_rdatatype_a, 0),
+			 ISC_R_NOTFOUND);
+
+	/* The same query without the client-specific data is stored */
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_NOTFOUND);
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_SUCCESS);
+
+	teardown_view();
+}
+
+/*
+ * Change the SOA serial of 'zone' from 'oldserial' to 'serial' in a new
+ * version of its database.
+ */
+static void
+setserial(dns_zone_t *zone, uint32_t oldserial, uint32_t serial) {
+	dns_db_t *db = NULL;
+	dns_dbversion_t *version = NULL;
+	dns_diff_t diff;
+	dns_fixedname_t fixed;
+	dns_name_t *origin = NULL;
+	isc_result_t result;
+	uint32_t serials[] = { oldserial, serial };
+	dns_diffop_t ops[] = { DNS_DIFFOP_DEL, DNS_DIFFOP_ADD };
+
+	result = dns_test_namefromstring("foo.", &fixed);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	origin = dns_fixedname_name(&fixed);
+
+	result = dns_zone_getdb(zone, &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_diff_init(isc_g_mctx, &diff);
+	for (size_t i = 0; i < ARRAY_SIZE(serials); i++) {
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+		dns_difftuple_t *tuple = NULL;
+		unsigned char buf[1024];
+		char text[256];
+
+		snprintf(text, sizeof(text),
+			 "localhost. postmaster.localhost. %u 3600 1800 "
+			 "604800 3600",
+			 serials[i]);
+		result = dns_test_rdatafromstring(&rdata, dns_rdataclass_in,
+						  dns_rdatatype_soa, buf,
+						  sizeof(buf), text, false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		dns_difftuple_create(isc_g_mctx, ops[i], origin, 3600, &rdata,
+				     &tuple);
+		dns_diff_append(&diff, &tuple);
+	}
+
+	result = dns_db_newversion(db, &version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_diff_apply(&diff, db, version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(db, &version, true);
+
+	dns_diff_clear(&diff);
+	dns_db_detach(&db);
+}
+
+/*
+ * Entries are dropped when their zone gets a new database, even one
+ * with the same serial, or a new version with another serial.
+ */
+ISC_LOOP_TEST_IMPL(ns_respcache_invalidate) {
+	dns_zone_t *zone = NULL;
+	dns_db_t *db = NULL;
+	isc_result_t result;
+
+	setup_view();
+	zone = getzone();
+
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_NOTFOUND);
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_SUCCESS);
+
+	/* The same contents, reloaded into a new database */
+	result = ns_test_loaddb(&db, dns_dbtype_zone, "foo", ZONEFILE);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_replacedb(zone, db, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detach(&db);
+
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_NOTFOUND);
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_SUCCESS);
+
+	/* A new version of the same database */
+	setserial(zone, 1, 2);
+
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_NOTFOUND);
+	assert_int_equal(query("ns.foo", dns_rdatatype_a, 0), ISC_R_SUCCESS);
+
+	dns_zone_detach(&zone);
+	teardown_view();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(ns_respcache_hit, setup_server, teardown_server)
+ISC_TEST_ENTRY_CUSTOM(ns_respcache_eligible, setup_server, teardown_server)
+ISC_TEST_ENTRY_CUSTOM(ns_respcache_invalidate, setup_server, teardown_server)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN